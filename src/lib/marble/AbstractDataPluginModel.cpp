@@ -20,6 +20,8 @@
 #include <QVariant>
 #include <QAbstractListModel>
 #include <QMetaProperty>
+#include <QSet>
+#include <QVector>
 
 // Marble
 #include "MarbleDebug.h"
@@ -32,6 +34,7 @@
 #include "MarbleDirs.h"
 #include "ViewportParams.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace Marble
@@ -51,6 +54,10 @@ const qreal boxComparisonFactor = 16.0;
 // Separator to separate the id of the item from the file type
 const char fileIdSeparator = '_';
 
+// The items are indexed by their position in a grid of one degree cells
+const int gridColumns = 360;
+const int gridRows = 180;
+
 class FavoritesModel;
 
 class AbstractDataPluginModelPrivate
@@ -67,6 +74,27 @@ public:
 
     void updateFavoriteItems();
 
+    QList<AbstractDataPluginItem*> sortedFavoriteItems() const;
+
+    static int gridColumn( qreal longitude );
+    static int gridRow( qreal latitude );
+    static int gridCell( const GeoDataCoordinates &coordinates );
+
+    void insertItem( AbstractDataPluginItem *item );
+    void removeItem( QObject *item );
+    void relocateItem( AbstractDataPluginItem *item );
+
+    /**
+     * Returns the items in the grid cells intersecting @p box, unsorted.
+     */
+    QVector<AbstractDataPluginItem*> itemsInBox( const GeoDataLatLonBox &box ) const;
+
+    struct ItemLocation
+    {
+        QString id;
+        int cell;
+    };
+
     AbstractDataPluginModel *m_parent;
     const QString m_name;
     const MarbleModel *const m_marbleModel;
@@ -75,7 +103,12 @@ public:
     qint32 m_lastNumber;
     qint32 m_downloadedNumber;
     QString m_currentPlanetId;
-    QList<AbstractDataPluginItem*> m_itemSet;
+    /** All items by their id */
+    QHash<QString, AbstractDataPluginItem*> m_itemsById;
+    /** The id and grid cell each item was indexed with, by the item */
+    QHash<const QObject*, ItemLocation> m_itemLocations;
+    /** The items of each non-empty grid cell */
+    QHash<int, QVector<AbstractDataPluginItem*> > m_gridCells;
     QHash<QString, AbstractDataPluginItem*> m_downloadingItems;
     QList<AbstractDataPluginItem*> m_displayedItems;
     QTimer m_downloadTimer;
@@ -105,10 +138,21 @@ public:
 
     void reset();
 
+    /**
+     * Drops the cached favorites without notifying views, for changes that
+     * only affect their order or what data() returns next.
+     */
+    void invalidate();
+
     QHash<int, QByteArray> roleNames() const;
 
 private:
+    const QList<AbstractDataPluginItem*> &favorites() const;
+
     QHash<int, QByteArray> m_roleNames;
+    // Sorted on demand, views ask for each row and role separately
+    mutable QList<AbstractDataPluginItem*> m_favorites;
+    mutable bool m_favoritesValid;
 };
 
 AbstractDataPluginModelPrivate::AbstractDataPluginModelPrivate( const QString& name,
@@ -135,8 +179,8 @@ AbstractDataPluginModelPrivate::AbstractDataPluginModelPrivate( const QString& n
 }
 
 AbstractDataPluginModelPrivate::~AbstractDataPluginModelPrivate() {
-    QList<AbstractDataPluginItem*>::iterator lIt = m_itemSet.begin();
-    QList<AbstractDataPluginItem*>::iterator const lItEnd = m_itemSet.end();
+    QHash<QString,AbstractDataPluginItem*>::iterator lIt = m_itemsById.begin();
+    QHash<QString,AbstractDataPluginItem*>::iterator const lItEnd = m_itemsById.end();
     for (; lIt != lItEnd; ++lIt ) {
         (*lIt)->deleteLater();
     }
@@ -161,6 +205,124 @@ void AbstractDataPluginModelPrivate::updateFavoriteItems()
     }
 }
 
+int AbstractDataPluginModelPrivate::gridColumn( qreal longitude )
+{
+    return qBound( 0, int( floor( longitude + 180.0 ) ), gridColumns - 1 );
+}
+
+int AbstractDataPluginModelPrivate::gridRow( qreal latitude )
+{
+    return qBound( 0, int( floor( latitude + 90.0 ) ), gridRows - 1 );
+}
+
+int AbstractDataPluginModelPrivate::gridCell( const GeoDataCoordinates &coordinates )
+{
+    return gridRow( coordinates.latitude( GeoDataCoordinates::Degree ) ) * gridColumns
+            + gridColumn( coordinates.longitude( GeoDataCoordinates::Degree ) );
+}
+
+void AbstractDataPluginModelPrivate::insertItem( AbstractDataPluginItem *item )
+{
+    ItemLocation location;
+    location.id = item->id();
+    location.cell = gridCell( item->coordinate() );
+
+    m_itemsById.insert( location.id, item );
+    m_itemLocations.insert( item, location );
+    m_gridCells[location.cell].append( item );
+}
+
+void AbstractDataPluginModelPrivate::removeItem( QObject *item )
+{
+    QHash<const QObject*, ItemLocation>::iterator const location = m_itemLocations.find( item );
+    if ( location == m_itemLocations.end() ) {
+        return;
+    }
+
+    // The item may be in its destructor already, so only its address is used.
+    // QObject is the first base class of AbstractDataPluginItem, the cast doesn't change it.
+    AbstractDataPluginItem *const pluginItem = static_cast<AbstractDataPluginItem*>( item );
+
+    QHash<QString, AbstractDataPluginItem*>::iterator const byId = m_itemsById.find( location->id );
+    if ( byId != m_itemsById.end() && *byId == pluginItem ) {
+        m_itemsById.erase( byId );
+    }
+
+    QHash<int, QVector<AbstractDataPluginItem*> >::iterator const cell = m_gridCells.find( location->cell );
+    if ( cell != m_gridCells.end() ) {
+        cell->remove( cell->indexOf( pluginItem ) );
+        if ( cell->isEmpty() ) {
+            m_gridCells.erase( cell );
+        }
+    }
+
+    m_itemLocations.erase( location );
+    m_displayedItems.removeAll( pluginItem );
+
+    if ( m_favoritesModel ) {
+        m_favoritesModel->invalidate();
+    }
+}
+
+void AbstractDataPluginModelPrivate::relocateItem( AbstractDataPluginItem *item )
+{
+    QHash<const QObject*, ItemLocation>::iterator const location = m_itemLocations.find( item );
+    if ( location == m_itemLocations.end() ) {
+        return;
+    }
+
+    int const cell = gridCell( item->coordinate() );
+    if ( cell != location->cell ) {
+        QVector<AbstractDataPluginItem*> &previous = m_gridCells[location->cell];
+        previous.remove( previous.indexOf( item ) );
+        if ( previous.isEmpty() ) {
+            m_gridCells.remove( location->cell );
+        }
+        m_gridCells[cell].append( item );
+        location->cell = cell;
+    }
+}
+
+QVector<AbstractDataPluginItem*> AbstractDataPluginModelPrivate::itemsInBox( const GeoDataLatLonBox &box ) const
+{
+    int const west = gridColumn( box.west( GeoDataCoordinates::Degree ) );
+    int const east = gridColumn( box.east( GeoDataCoordinates::Degree ) );
+    int const south = gridRow( box.south( GeoDataCoordinates::Degree ) );
+    int const north = gridRow( box.north( GeoDataCoordinates::Degree ) );
+    bool const crossesDateLine = box.crossesDateLine();
+    int const columns = crossesDateLine ? gridColumns - west + east + 1 : east - west + 1;
+
+    QVector<AbstractDataPluginItem*> result;
+    if ( ( north - south + 1 ) * columns > m_gridCells.size() ) {
+        // Fewer non-empty cells than cells in the box, check each of them
+        QHash<int, QVector<AbstractDataPluginItem*> >::const_iterator iter = m_gridCells.constBegin();
+        QHash<int, QVector<AbstractDataPluginItem*> >::const_iterator const end = m_gridCells.constEnd();
+        for (; iter != end; ++iter ) {
+            int const row = iter.key() / gridColumns;
+            int const column = iter.key() % gridColumns;
+            bool const inColumns = crossesDateLine ? ( column >= west || column <= east )
+                                                   : ( column >= west && column <= east );
+            if ( inColumns && row >= south && row <= north ) {
+                result += *iter;
+            }
+        }
+    }
+    else {
+        for ( int row = south; row <= north; ++row ) {
+            for ( int i = 0; i < columns; ++i ) {
+                int const column = ( west + i ) % gridColumns;
+                QHash<int, QVector<AbstractDataPluginItem*> >::const_iterator const cell =
+                        m_gridCells.constFind( row * gridColumns + column );
+                if ( cell != m_gridCells.constEnd() ) {
+                    result += *cell;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
 void AbstractDataPluginModel::themeChanged()
 {
     if ( d->m_currentPlanetId != d->m_marbleModel->planetId() ) {
@@ -189,8 +351,27 @@ static bool lessThanByPointer( const AbstractDataPluginItem *item1,
     }
 }
 
+static bool greaterThanByPointer( const AbstractDataPluginItem *item1,
+                                  const AbstractDataPluginItem *item2 )
+{
+    return lessThanByPointer( item2, item1 );
+}
+
+QList<AbstractDataPluginItem*> AbstractDataPluginModelPrivate::sortedFavoriteItems() const
+{
+    QList<AbstractDataPluginItem*> favorites;
+    foreach( AbstractDataPluginItem* item, m_itemsById ) {
+        if ( item->initialized() && item->isFavorite() ) {
+            favorites << item;
+        }
+    }
+
+    qSort( favorites.begin(), favorites.end(), lessThanByPointer );
+    return favorites;
+}
+
 FavoritesModel::FavoritesModel( AbstractDataPluginModelPrivate *_d, QObject* parent ) :
-    QAbstractListModel( parent ), d(_d)
+    QAbstractListModel( parent ), d(_d), m_favoritesValid( false )
 {
     QHash<int,QByteArray> roles;
     int const size = d->m_hasMetaObject ? d->m_metaObject.propertyCount() : 0;
@@ -209,30 +390,16 @@ int FavoritesModel::rowCount ( const QModelIndex &parent ) const
         return 0;
     }
 
-    int count = 0;
-    foreach( AbstractDataPluginItem* item, d->m_itemSet ) {
-        if ( item->initialized() && item->isFavorite() ) {
-            ++count;
-        }
-    }
-
-    return count;
+    return favorites().size();
 }
 
 QVariant FavoritesModel::data( const QModelIndex &index, int role ) const
 {
     int const row = index.row();
-    if ( row >= 0 && row < rowCount() ) {
-        int count = 0;
-        foreach( AbstractDataPluginItem* item, d->m_itemSet ) {
-            if ( item->initialized() && item->isFavorite() ) {
-                if ( count == row ) {
-                    QString const roleName = roleNames().value( role );
-                    return item->property( roleName.toLatin1() );
-                }
-                ++count;
-            }
-        }
+    QList<AbstractDataPluginItem*> const &favorites = this->favorites();
+    if ( row >= 0 && row < favorites.size() ) {
+        QString const roleName = roleNames().value( role );
+        return favorites.at( row )->property( roleName.toLatin1() );
     }
 
     return QVariant();
@@ -241,9 +408,26 @@ QVariant FavoritesModel::data( const QModelIndex &index, int role ) const
 void FavoritesModel::reset()
 {
     beginResetModel();
+    invalidate();
     endResetModel();
 }
 
+void FavoritesModel::invalidate()
+{
+    m_favoritesValid = false;
+    m_favorites.clear();
+}
+
+const QList<AbstractDataPluginItem*> &FavoritesModel::favorites() const
+{
+    if ( !m_favoritesValid ) {
+        m_favorites = d->sortedFavoriteItems();
+        m_favoritesValid = true;
+    }
+
+    return m_favorites;
+}
+
 QHash<int, QByteArray> FavoritesModel::roleNames() const
 {
     return m_roleNames;
@@ -286,50 +470,66 @@ QList<AbstractDataPluginItem*> AbstractDataPluginModel::items( const ViewportPar
     QList<AbstractDataPluginItem*> list;
     
     Q_ASSERT( !d->m_displayedItems.contains( 0 ) && "Null item in m_displayedItems. Please report a bug to marble-devel@kde.org" );
-    Q_ASSERT( !d->m_itemSet.contains( 0 ) && "Null item in m_itemSet. Please report a bug to marble-devel@kde.org" );
-
-    QList<AbstractDataPluginItem*> candidates = d->m_displayedItems + d->m_itemSet;
 
     if ( d->m_needsSorting ) {
-        // Both the candidates list and the list of all items need to be sorted
-        qSort( candidates.begin(), candidates.end(), lessThanByPointer );
-        qSort( d->m_itemSet.begin(), d->m_itemSet.end(), lessThanByPointer );
+        qSort( d->m_displayedItems.begin(), d->m_displayedItems.end(), lessThanByPointer );
         d->m_needsSorting =  false;
     }
 
-    QList<AbstractDataPluginItem*>::const_iterator i = candidates.constBegin();
-    QList<AbstractDataPluginItem*>::const_iterator end = candidates.constEnd();
+    // Only items near the viewport are considered. They are kept in a heap, so only
+    // as many of them as needed to fill the list are brought into order.
+    QVector<AbstractDataPluginItem*> candidates = d->itemsInBox( currentBox );
+    QVector<AbstractDataPluginItem*>::iterator heapEnd = candidates.end();
+    std::make_heap( candidates.begin(), heapEnd, greaterThanByPointer );
+
+    QSet<AbstractDataPluginItem*> const displayed = d->m_displayedItems.toSet();
+    QSet<AbstractDataPluginItem*> listed;
+    int displayedIndex = 0;
+
+    while ( list.size() < number ) {
+        // Items that are already shown have the highest priority
+        AbstractDataPluginItem *item = 0;
+        if ( displayedIndex < d->m_displayedItems.size() ) {
+            item = d->m_displayedItems.at( displayedIndex );
+            ++displayedIndex;
+        }
+        else if ( heapEnd != candidates.begin() ) {
+            std::pop_heap( candidates.begin(), heapEnd, greaterThanByPointer );
+            --heapEnd;
+            item = *heapEnd;
+        }
+        else {
+            break;
+        }
 
-    // Items that are already shown have the highest priority
-    for (; i != end && list.size() < number; ++i ) {
         // Only show items that are initialized
-        if( !(*i)->initialized() ) {
+        if( !item->initialized() ) {
             continue;
         }
 
         // Hide non-favorite items if necessary
-        if( d->m_favoriteItemsOnly && !(*i)->isFavorite() ) {
+        if( d->m_favoriteItemsOnly && !item->isFavorite() ) {
             continue;
         }
-        
-        (*i)->setProjection( viewport );
-        if( (*i)->positions().isEmpty() ) {
+
+        if ( listed.contains( item ) ) {
             continue;
         }
 
-        if ( list.contains( *i ) ) {
+        item->setProjection( viewport );
+        if( item->positions().isEmpty() ) {
             continue;
         }
 
         // If the item was added initially at a nearer position, they don't have priority,
         // because we zoomed out since then.
-        bool const alreadyDisplayed = d->m_displayedItems.contains( *i );
-        if ( !alreadyDisplayed || (*i)->addedAngularResolution() >= viewport->angularResolution() || (*i)->isSticky() ) {
+        bool const alreadyDisplayed = displayed.contains( item );
+        if ( !alreadyDisplayed || item->addedAngularResolution() >= viewport->angularResolution() || item->isSticky() ) {
             bool collides = false;
             int const length = list.length();
             for ( int j=0; !collides && j<length; ++j ) {
                 foreach( const QRectF &rect, list[j]->boundingRects() ) {
-                    foreach( const QRectF &itemRect, (*i)->boundingRects() ) {
+                    foreach( const QRectF &itemRect, item->boundingRects() ) {
                         if ( rect.intersects( itemRect ) )
                             collides = true;
                     }
@@ -337,12 +537,13 @@ QList<AbstractDataPluginItem*> AbstractDataPluginModel::items( const ViewportPar
             }
 
             if ( !collides ) {
-                list.append( *i );
-                (*i)->setSettings( d->m_itemSettings );
+                list.append( item );
+                listed.insert( item );
+                item->setSettings( d->m_itemSettings );
 
                 // We want to save the angular resolution of the first time the item got added.
                 if( !alreadyDisplayed ) {
-                    (*i)->setAddedAngularResolution( viewport->angularResolution() );
+                    item->setAddedAngularResolution( viewport->angularResolution() );
                 }
             }
         }
@@ -414,7 +615,7 @@ void AbstractDataPluginModel::addItemsToList( const QList<AbstractDataPluginItem
         }
 
         // If the item is already in our list, don't add it.
-        if ( d->m_itemSet.contains( item ) ) {
+        if ( d->m_itemLocations.contains( item ) ) {
             continue;
         }
 
@@ -425,17 +626,11 @@ void AbstractDataPluginModel::addItemsToList( const QList<AbstractDataPluginItem
 
         mDebug() << "New item " << item->id();
 
-        // This find the right position in the sorted to insert the new item
-        QList<AbstractDataPluginItem*>::iterator i = qLowerBound( d->m_itemSet.begin(),
-                                                                  d->m_itemSet.end(),
-                                                                  item,
-                                                                  lessThanByPointer );
-        // Insert the item on the right position in the list
-        d->m_itemSet.insert( i, item );
+        d->insertItem( item );
 
         connect( item, SIGNAL(stickyChanged()), this, SLOT(scheduleItemSort()) );
         connect( item, SIGNAL(destroyed(QObject*)), this, SLOT(removeItem(QObject*)) );
-        connect( item, SIGNAL(updated()), this, SIGNAL(itemsUpdated()) );
+        connect( item, SIGNAL(updated()), this, SLOT(updateItem()) );
         connect( item, SIGNAL(favoriteChanged(QString,bool)), this,
                  SLOT(favoriteItemChanged(QString,bool)) );
 
@@ -521,6 +716,11 @@ void AbstractDataPluginModel::favoriteItemChanged( const QString& id, bool isFav
 void AbstractDataPluginModel::scheduleItemSort()
 {
     d->m_needsSorting = true;
+
+    // Sticky items come first among the favorites as well
+    if ( d->m_favoritesModel ) {
+        d->m_favoritesModel->invalidate();
+    }
 }
 
 QString AbstractDataPluginModelPrivate::generateFilename( const QString& id, const QString& type ) const
@@ -540,13 +740,7 @@ QString AbstractDataPluginModelPrivate::generateFilepath( const QString& id, con
 
 AbstractDataPluginItem *AbstractDataPluginModel::findItem( const QString& id ) const
 {
-    foreach ( AbstractDataPluginItem *item, d->m_itemSet ) {
-        if( item->id() == id ) {
-            return item;
-        }
-    }
-    
-    return 0;
+    return d->m_itemsById.value( id, 0 );
 }
 
 bool AbstractDataPluginModel::itemExists( const QString& id ) const
@@ -637,25 +831,50 @@ void AbstractDataPluginModel::processFinishedJob( const QString& relativeUrlStri
 
 void AbstractDataPluginModel::removeItem( QObject *item )
 {
-    AbstractDataPluginItem * pluginItem = qobject_cast<AbstractDataPluginItem*>( item );
-    d->m_itemSet.removeAll( pluginItem );
-    QHash<QString, AbstractDataPluginItem *>::iterator i;
-    for( i = d->m_downloadingItems.begin(); i != d->m_downloadingItems.end(); ++i ) {
-        if( *i == pluginItem ) {
+    d->removeItem( item );
+
+    // The item is being destroyed, so it is compared by address only
+    QHash<QString, AbstractDataPluginItem *>::iterator i = d->m_downloadingItems.begin();
+    while ( i != d->m_downloadingItems.end() ) {
+        if( static_cast<QObject*>( *i ) == item ) {
             i = d->m_downloadingItems.erase( i );
         }
+        else {
+            ++i;
+        }
+    }
+}
+
+void AbstractDataPluginModel::updateItem()
+{
+    AbstractDataPluginItem *item = qobject_cast<AbstractDataPluginItem*>( sender() );
+    if ( item ) {
+        // The item may have got its coordinates only now
+        d->relocateItem( item );
+    }
+
+    // Only initialized items are listed as favorites
+    if ( d->m_favoritesModel ) {
+        d->m_favoritesModel->invalidate();
     }
+
+    emit itemsUpdated();
 }
 
 void AbstractDataPluginModel::clear()
 {
     d->m_displayedItems.clear();
-    QList<AbstractDataPluginItem*>::iterator iter = d->m_itemSet.begin();
-    QList<AbstractDataPluginItem*>::iterator const end = d->m_itemSet.end();
+    QHash<QString, AbstractDataPluginItem*>::iterator iter = d->m_itemsById.begin();
+    QHash<QString, AbstractDataPluginItem*>::iterator const end = d->m_itemsById.end();
     for (; iter != end; ++iter ) {
         (*iter)->deleteLater();
     }
-    d->m_itemSet.clear();
+    d->m_itemsById.clear();
+    d->m_itemLocations.clear();
+    d->m_gridCells.clear();
+    if ( d->m_favoritesModel ) {
+        d->m_favoritesModel->invalidate();
+    }
     d->m_lastBox = GeoDataLatLonAltBox();
     d->m_downloadedBox = GeoDataLatLonAltBox();
     d->m_downloadedNumber = 0;
@@ -168,6 +168,11 @@ public Q_SLOTS:
      */
     void removeItem( QObject *item );
 
+    /**
+     * @brief Updates the position of the sending item in the spatial index.
+     */
+    void updateItem();
+
     void favoriteItemChanged( const QString& id, bool isFavorite );
 
     void scheduleItemSort();
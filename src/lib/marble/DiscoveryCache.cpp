@@ -0,0 +1,155 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "DiscoveryCache.h"
+
+#include "MarbleDebug.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+
+namespace Marble
+{
+
+namespace
+{
+    const quint32 discoveryCacheMagic = 0x4d444331;
+    const quint32 discoveryCacheVersion = 1;
+
+    // Keys of the file state stored with each entry
+    const QString lastModifiedKey = "_lastModified";
+    const QString sizeKey = "_size";
+}
+
+class Q_DECL_HIDDEN DiscoveryCache::Private
+{
+ public:
+    explicit Private( const QString &fileName );
+
+    void load();
+
+    const QString m_fileName;
+    QHash<QString, QVariantMap> m_entries;
+    bool m_dirty;
+};
+
+DiscoveryCache::Private::Private( const QString &fileName ) :
+    m_fileName( fileName ),
+    m_dirty( false )
+{
+}
+
+void DiscoveryCache::Private::load()
+{
+    QFile file( m_fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return;
+    }
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_0 );
+    quint32 magic;
+    quint32 version;
+    stream >> magic >> version;
+    if ( magic != discoveryCacheMagic || version != discoveryCacheVersion ) {
+        mDebug() << "Ignoring discovery cache" << m_fileName << "of an unknown format";
+        return;
+    }
+
+    stream >> m_entries;
+    if ( stream.status() != QDataStream::Ok ) {
+        mDebug() << "Ignoring corrupt discovery cache" << m_fileName;
+        m_entries.clear();
+    }
+}
+
+DiscoveryCache::DiscoveryCache( const QString &fileName ) :
+    d( new Private( fileName ) )
+{
+    d->load();
+}
+
+DiscoveryCache::~DiscoveryCache()
+{
+    delete d;
+}
+
+QVariantMap DiscoveryCache::value( const QString &path ) const
+{
+    QHash<QString, QVariantMap>::const_iterator const iter = d->m_entries.constFind( path );
+    if ( iter == d->m_entries.constEnd() ) {
+        return QVariantMap();
+    }
+
+    const QFileInfo fileInfo( path );
+    if ( !fileInfo.exists()
+         || fileInfo.lastModified() != iter->value( lastModifiedKey ).toDateTime()
+         || fileInfo.size() != iter->value( sizeKey ).toLongLong() ) {
+        return QVariantMap();
+    }
+
+    QVariantMap result = *iter;
+    result.remove( lastModifiedKey );
+    result.remove( sizeKey );
+    return result;
+}
+
+void DiscoveryCache::insert( const QString &path, const QVariantMap &values )
+{
+    const QFileInfo fileInfo( path );
+    QVariantMap entry = values;
+    entry.insert( lastModifiedKey, fileInfo.lastModified() );
+    entry.insert( sizeKey, fileInfo.size() );
+
+    if ( d->m_entries.value( path ) != entry ) {
+        d->m_entries.insert( path, entry );
+        d->m_dirty = true;
+    }
+}
+
+bool DiscoveryCache::save()
+{
+    QHash<QString, QVariantMap>::iterator iter = d->m_entries.begin();
+    while ( iter != d->m_entries.end() ) {
+        if ( QFileInfo::exists( iter.key() ) ) {
+            ++iter;
+        } else {
+            iter = d->m_entries.erase( iter );
+            d->m_dirty = true;
+        }
+    }
+
+    if ( !d->m_dirty ) {
+        return true;
+    }
+
+    QDir().mkpath( QFileInfo( d->m_fileName ).path() );
+    QSaveFile file( d->m_fileName );
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        mDebug() << "Cannot write discovery cache" << d->m_fileName << file.errorString();
+        return false;
+    }
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_5_0 );
+    stream << discoveryCacheMagic << discoveryCacheVersion << d->m_entries;
+    if ( stream.status() != QDataStream::Ok || !file.commit() ) {
+        mDebug() << "Cannot write discovery cache" << d->m_fileName << file.errorString();
+        return false;
+    }
+
+    d->m_dirty = false;
+    return true;
+}
+
+}
@@ -0,0 +1,72 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_DISCOVERYCACHE_H
+#define MARBLE_DISCOVERYCACHE_H
+
+#include "marble_export.h"
+
+#include <QVariantMap>
+
+class QString;
+
+namespace Marble
+{
+
+/**
+ * @short A persistent cache of information derived from files.
+ *
+ * Startup needs some information about all installed map themes and
+ * plugins, like the name of a theme or the kind of a plugin. Obtaining it
+ * means parsing each theme or loading each plugin library. The discovery
+ * cache keeps that information across sessions, keyed by the path of the
+ * file it was derived from. An entry is only returned while the size and
+ * modification time of its file are unchanged, so edited, replaced or
+ * removed files are picked up automatically.
+ *
+ * The cache is read in the constructor and written by save().
+ */
+class MARBLE_EXPORT DiscoveryCache
+{
+ public:
+    /**
+     * Creates a cache stored in @p fileName and reads the stored entries.
+     * A missing or unreadable file results in an empty cache.
+     */
+    explicit DiscoveryCache( const QString &fileName );
+
+    ~DiscoveryCache();
+
+    /**
+     * Returns the values stored for the file @p path, or an empty map if
+     * there are none or the file changed since they were stored.
+     */
+    QVariantMap value( const QString &path ) const;
+
+    /**
+     * Stores @p values for the file @p path in its current state.
+     */
+    void insert( const QString &path, const QVariantMap &values );
+
+    /**
+     * Writes the cache back to its file if it was changed. Entries of
+     * files which do not exist anymore are dropped.
+     * @return whether the cache is stored on disk now
+     */
+    bool save();
+
+ private:
+    Q_DISABLE_COPY( DiscoveryCache )
+
+    class Private;
+    Private * const d;
+};
+
+}
+
+#endif
@@ -0,0 +1,1156 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "DocumentSnapshot.h"
+
+#include "GeoDataBalloonStyle.h"
+#include "GeoDataData.h"
+#include "GeoDataDocument.h"
+#include "GeoDataExtendedData.h"
+#include "GeoDataFolder.h"
+#include "GeoDataIconStyle.h"
+#include "GeoDataLabelStyle.h"
+#include "GeoDataLinearRing.h"
+#include "GeoDataLineStyle.h"
+#include "GeoDataListStyle.h"
+#include "GeoDataMultiGeometry.h"
+#include "GeoDataPlacemark.h"
+#include "GeoDataPoint.h"
+#include "GeoDataPolygon.h"
+#include "GeoDataPolyStyle.h"
+#include "GeoDataRegion.h"
+#include "GeoDataSnippet.h"
+#include "GeoDataStyle.h"
+#include "GeoDataStyleMap.h"
+#include "GeoDataTimeSpan.h"
+#include "GeoDataTimeStamp.h"
+#include "GeoDataTypes.h"
+#include "MarbleDebug.h"
+#include "osm/OsmPlacemarkData.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <QVariant>
+#include <QVector>
+
+namespace Marble
+{
+
+namespace
+{
+
+// "MSNP" when read as little endian
+const quint32 snapshotMagic = 0x504e534d;
+// Increase whenever the layout of any record changes
+const quint32 snapshotVersion = 2;
+// Tells whether the snapshot was written on a machine with the same byte order
+const quint32 byteOrderMark = 0x01020304;
+// All sections start at a multiple of this, so that doubles can be read in place
+const int sectionAlignment = 8;
+
+enum SectionType {
+    StringIndexSection,
+    StringDataSection,
+    FeatureSection,
+    GeometrySection,
+    LongitudeSection,
+    LatitudeSection,
+    AltitudeSection,
+    DetailSection,
+    PropertySection,
+    StyleSection,
+    StyleMapSection,
+    SectionCount
+};
+
+enum FeatureType {
+    DocumentFeature,
+    FolderFeature,
+    PlacemarkFeature
+};
+
+enum FeatureFlag {
+    VisibleFlag = 0x1,
+    DescriptionCDATAFlag = 0x2,
+    OsmDataFlag = 0x4
+};
+
+enum GeometryType {
+    PointGeometry,
+    LineStringGeometry,
+    LinearRingGeometry,
+    PolygonGeometry,
+    MultiGeometryGeometry
+};
+
+enum GeometryFlag {
+    LevelIndicesFlag = 0x1
+};
+
+enum PropertyType {
+    StringProperty,
+    IntProperty,
+    DoubleProperty,
+    BoolProperty
+};
+
+enum StyleFlag {
+    LabelGlowFlag = 0x1,
+    LineBackgroundFlag = 0x2,
+    LineCosmeticOutlineFlag = 0x4,
+    PolyFillFlag = 0x8,
+    PolyOutlineFlag = 0x10
+};
+
+struct FileHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 byteOrder;
+    quint32 sectionCount;
+};
+
+struct SectionHeader
+{
+    quint32 type;
+    quint32 count;      // number of records
+    quint64 offset;     // from the start of the file
+};
+
+struct StringRecord
+{
+    quint32 offset;     // in characters, into the string data section
+    quint32 length;
+};
+
+// Features are stored in document order, parents before their children.
+// All strings are indices into the string index section, 0 is the empty string.
+struct FeatureRecord
+{
+    quint32 type;
+    qint32 parent;      // -1 for the root document
+    quint32 id;
+    quint32 name;
+    quint32 description;
+    quint32 snippet;
+    quint32 snippetMaxLines;
+    quint32 address;
+    quint32 phoneNumber;
+    quint32 styleUrl;
+    quint32 role;
+    quint32 countryCode;
+    quint32 state;
+    quint32 flags;
+    qint32 geometry;    // -1 if none
+    qint32 style;       // inline style, -1 if none
+    quint32 firstExtendedData;
+    quint32 extendedDataCount;
+    quint32 firstOsmTag;
+    quint32 osmTagCount;
+    qint32 visualCategory;
+    qint32 zoomLevel;
+    qint64 popularity;
+    qint64 population;
+    qint64 osmId;
+    double area;
+};
+
+// The children of polygons (their rings, outer boundary first) and multi
+// geometries are stored consecutively after their parent. Points, line
+// strings and linear rings refer to a range of the coordinate and detail
+// sections. The level indices of optimized line strings are derived from
+// the details again when reading.
+struct GeometryRecord
+{
+    quint32 type;
+    quint32 extrude;
+    quint32 altitudeMode;
+    quint32 tessellation;
+    quint32 first;
+    quint32 count;
+    qint32 renderOrder;
+    quint32 flags;
+};
+
+// Extended data and OSM tags of features, and the pairs of style maps
+struct PropertyRecord
+{
+    quint32 key;
+    quint32 value;
+    quint32 type;
+    quint32 reserved;
+};
+
+struct StyleRecord
+{
+    quint32 id;
+    qint32 document;    // the document the style belongs to, -1 for inline styles
+    quint32 flags;
+    quint32 iconPath;
+    quint32 iconColor;
+    float iconScale;
+    quint32 labelColor;
+    float labelScale;
+    quint32 labelAlignment;
+    quint32 lineColor;
+    float lineWidth;
+    float linePhysicalWidth;
+    quint32 lineCapStyle;
+    quint32 linePenStyle;
+    quint32 polyColor;
+    quint32 polyBrushStyle;
+    quint32 polyColorIndex;
+    quint32 reserved;
+};
+
+struct StyleMapRecord
+{
+    quint32 id;
+    qint32 document;
+    quint32 firstPair;
+    quint32 pairCount;
+};
+
+Q_STATIC_ASSERT( sizeof( FileHeader ) == 16 );
+Q_STATIC_ASSERT( sizeof( SectionHeader ) == 16 );
+Q_STATIC_ASSERT( sizeof( FeatureRecord ) == 120 );
+Q_STATIC_ASSERT( sizeof( GeometryRecord ) == 32 );
+Q_STATIC_ASSERT( sizeof( PropertyRecord ) == 16 );
+Q_STATIC_ASSERT( sizeof( StyleRecord ) == 72 );
+Q_STATIC_ASSERT( sizeof( StyleMapRecord ) == 16 );
+
+class SnapshotWriter
+{
+ public:
+    SnapshotWriter();
+
+    bool addFeature( const GeoDataFeature *feature, qint32 parent, QString &error );
+
+    bool write( const QString &fileName, QString &error ) const;
+
+ private:
+    quint32 addString( const QString &string );
+    static bool isSupported( const GeoDataFeature *feature, QString &error );
+    static bool isSupported( const GeoDataStyle &style, QString &error );
+    qint32 addStyle( const GeoDataStyle &style, qint32 document );
+    void addStyleMap( const GeoDataStyleMap &styleMap, qint32 document );
+    void addProperty( const QString &key, const QString &value, PropertyType type );
+    void addNodes( const GeoDataLineString &lineString );
+    bool writeGeometry( const GeoDataGeometry *geometry, int index, QString &error );
+
+    QHash<QString, quint32> m_stringIndices;
+    QVector<StringRecord> m_strings;
+    QVector<ushort> m_stringData;
+    QVector<FeatureRecord> m_features;
+    QVector<GeometryRecord> m_geometries;
+    QVector<double> m_longitudes;
+    QVector<double> m_latitudes;
+    QVector<double> m_altitudes;
+    QVector<quint8> m_details;
+    QVector<PropertyRecord> m_properties;
+    QVector<StyleRecord> m_styles;
+    QVector<StyleMapRecord> m_styleMaps;
+};
+
+SnapshotWriter::SnapshotWriter()
+{
+    addString( QString() );
+}
+
+quint32 SnapshotWriter::addString( const QString &string )
+{
+    QHash<QString, quint32>::const_iterator const iter = m_stringIndices.constFind( string );
+    if ( iter != m_stringIndices.constEnd() ) {
+        return *iter;
+    }
+
+    StringRecord record;
+    record.offset = m_stringData.size();
+    record.length = string.size();
+    m_stringData.resize( m_stringData.size() + string.size() );
+    memcpy( m_stringData.data() + record.offset, string.utf16(), string.size() * sizeof( ushort ) );
+
+    quint32 const index = m_strings.size();
+    m_strings << record;
+    m_stringIndices.insert( string, index );
+    return index;
+}
+
+bool SnapshotWriter::isSupported( const GeoDataFeature *feature, QString &error )
+{
+    // Rather than losing them, let the caller fall back to the source file
+    if ( feature->abstractView() ) {
+        error = QString( "The view of feature %1 cannot be stored in a snapshot" ).arg( feature->name() );
+        return false;
+    }
+    if ( feature->timeSpan() != GeoDataTimeSpan() || feature->timeStamp() != GeoDataTimeStamp() ) {
+        error = QString( "The time of feature %1 cannot be stored in a snapshot" ).arg( feature->name() );
+        return false;
+    }
+    if ( feature->region() != GeoDataRegion() ) {
+        error = QString( "The region of feature %1 cannot be stored in a snapshot" ).arg( feature->name() );
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotWriter::isSupported( const GeoDataStyle &style, QString &error )
+{
+    if ( style.balloonStyle() != GeoDataBalloonStyle() || style.listStyle() != GeoDataListStyle() ) {
+        error = QString( "Balloon and list styles of style %1 cannot be stored in a snapshot" ).arg( style.id() );
+        return false;
+    }
+
+    return true;
+}
+
+void SnapshotWriter::addProperty( const QString &key, const QString &value, PropertyType type )
+{
+    PropertyRecord record;
+    record.key = addString( key );
+    record.value = addString( value );
+    record.type = type;
+    record.reserved = 0;
+    m_properties << record;
+}
+
+qint32 SnapshotWriter::addStyle( const GeoDataStyle &style, qint32 document )
+{
+    StyleRecord record;
+    memset( &record, 0, sizeof( record ) );
+    record.id = addString( style.id() );
+    record.document = document;
+
+    const GeoDataIconStyle &iconStyle = style.iconStyle();
+    record.iconPath = addString( iconStyle.iconPath() );
+    record.iconColor = iconStyle.color().rgba();
+    record.iconScale = iconStyle.scale();
+
+    const GeoDataLabelStyle &labelStyle = style.labelStyle();
+    record.labelColor = labelStyle.color().rgba();
+    record.labelScale = labelStyle.scale();
+    record.labelAlignment = labelStyle.alignment();
+    record.flags |= labelStyle.glow() ? LabelGlowFlag : 0;
+
+    const GeoDataLineStyle &lineStyle = style.lineStyle();
+    record.lineColor = lineStyle.color().rgba();
+    record.lineWidth = lineStyle.width();
+    record.linePhysicalWidth = lineStyle.physicalWidth();
+    record.lineCapStyle = lineStyle.capStyle();
+    record.linePenStyle = lineStyle.penStyle();
+    record.flags |= lineStyle.background() ? LineBackgroundFlag : 0;
+    record.flags |= lineStyle.cosmeticOutline() ? LineCosmeticOutlineFlag : 0;
+
+    const GeoDataPolyStyle &polyStyle = style.polyStyle();
+    record.polyColor = polyStyle.color().rgba();
+    record.polyBrushStyle = polyStyle.brushStyle();
+    record.polyColorIndex = polyStyle.colorIndex();
+    record.flags |= polyStyle.fill() ? PolyFillFlag : 0;
+    record.flags |= polyStyle.outline() ? PolyOutlineFlag : 0;
+
+    m_styles << record;
+    return m_styles.size() - 1;
+}
+
+void SnapshotWriter::addStyleMap( const GeoDataStyleMap &styleMap, qint32 document )
+{
+    StyleMapRecord record;
+    record.id = addString( styleMap.id() );
+    record.document = document;
+    record.firstPair = m_properties.size();
+    record.pairCount = styleMap.size();
+
+    QMap<QString, QString>::const_iterator iter = styleMap.constBegin();
+    for (; iter != styleMap.constEnd(); ++iter ) {
+        addProperty( iter.key(), iter.value(), StringProperty );
+    }
+
+    m_styleMaps << record;
+}
+
+void SnapshotWriter::addNodes( const GeoDataLineString &lineString )
+{
+    int const size = lineString.size();
+    m_longitudes.reserve( m_longitudes.size() + size );
+    m_latitudes.reserve( m_latitudes.size() + size );
+    m_altitudes.reserve( m_altitudes.size() + size );
+    m_details.reserve( m_details.size() + size );
+    for ( int i = 0; i < size; ++i ) {
+        const GeoDataCoordinates &coordinates = lineString.at( i );
+        m_longitudes << coordinates.longitude();
+        m_latitudes << coordinates.latitude();
+        m_altitudes << coordinates.altitude();
+        m_details << coordinates.detail();
+    }
+}
+
+bool SnapshotWriter::writeGeometry( const GeoDataGeometry *geometry, int index, QString &error )
+{
+    GeometryRecord record;
+    memset( &record, 0, sizeof( record ) );
+    record.extrude = geometry->extrude() ? 1 : 0;
+    record.altitudeMode = geometry->altitudeMode();
+
+    QVector<const GeoDataGeometry*> children;
+    if ( geometry->nodeType() == GeoDataTypes::GeoDataPointType ) {
+        const GeoDataCoordinates &coordinates = static_cast<const GeoDataPoint*>( geometry )->coordinates();
+        record.type = PointGeometry;
+        record.first = m_longitudes.size();
+        record.count = 1;
+        m_longitudes << coordinates.longitude();
+        m_latitudes << coordinates.latitude();
+        m_altitudes << coordinates.altitude();
+        m_details << coordinates.detail();
+    }
+    else if ( geometry->nodeType() == GeoDataTypes::GeoDataLineStringType
+              || geometry->nodeType() == GeoDataTypes::GeoDataLinearRingType ) {
+        const GeoDataLineString *lineString = static_cast<const GeoDataLineString*>( geometry );
+        record.type = geometry->nodeType() == GeoDataTypes::GeoDataLineStringType ? LineStringGeometry : LinearRingGeometry;
+        record.tessellation = lineString->tessellationFlags();
+        record.flags |= lineString->hasLevelIndices() ? LevelIndicesFlag : 0;
+        record.first = m_longitudes.size();
+        record.count = lineString->size();
+        addNodes( *lineString );
+    }
+    else if ( geometry->nodeType() == GeoDataTypes::GeoDataPolygonType ) {
+        const GeoDataPolygon *polygon = static_cast<const GeoDataPolygon*>( geometry );
+        record.type = PolygonGeometry;
+        record.tessellation = polygon->tessellationFlags();
+        record.renderOrder = polygon->renderOrder();
+        const QVector<GeoDataLinearRing> &innerBoundaries = polygon->innerBoundaries();
+        children << &polygon->outerBoundary();
+        for ( int i = 0; i < innerBoundaries.size(); ++i ) {
+            children << &innerBoundaries.at( i );
+        }
+    }
+    else if ( geometry->nodeType() == GeoDataTypes::GeoDataMultiGeometryType ) {
+        const GeoDataMultiGeometry *multiGeometry = static_cast<const GeoDataMultiGeometry*>( geometry );
+        record.type = MultiGeometryGeometry;
+        QVector<GeoDataGeometry*>::ConstIterator iter = multiGeometry->constBegin();
+        for (; iter != multiGeometry->constEnd(); ++iter ) {
+            children << *iter;
+        }
+    }
+    else {
+        error = QString( "Geometries of type %1 cannot be stored in a snapshot" ).arg( geometry->nodeType() );
+        return false;
+    }
+
+    if ( !children.isEmpty() ) {
+        record.first = m_geometries.size();
+        record.count = children.size();
+        m_geometries.resize( m_geometries.size() + children.size() );
+        for ( int i = 0; i < children.size(); ++i ) {
+            if ( !writeGeometry( children.at( i ), record.first + i, error ) ) {
+                return false;
+            }
+        }
+    }
+
+    m_geometries[index] = record;
+    return true;
+}
+
+bool SnapshotWriter::addFeature( const GeoDataFeature *feature, qint32 parent, QString &error )
+{
+    if ( !isSupported( feature, error ) ) {
+        return false;
+    }
+
+    FeatureRecord record;
+    memset( &record, 0, sizeof( record ) );
+    record.parent = parent;
+    record.id = addString( feature->id() );
+    record.name = addString( feature->name() );
+    record.description = addString( feature->description() );
+    record.snippet = addString( feature->snippet().text() );
+    record.snippetMaxLines = feature->snippet().maxLines();
+    record.address = addString( feature->address() );
+    record.phoneNumber = addString( feature->phoneNumber() );
+    record.styleUrl = addString( feature->styleUrl() );
+    record.role = addString( feature->role() );
+    record.flags |= feature->isVisible() ? VisibleFlag : 0;
+    record.flags |= feature->descriptionIsCDATA() ? DescriptionCDATAFlag : 0;
+    record.geometry = -1;
+    record.style = -1;
+    record.visualCategory = feature->visualCategory();
+    record.zoomLevel = feature->zoomLevel();
+    record.popularity = feature->popularity();
+
+    qint32 const index = m_features.size();
+
+    if ( feature->nodeType() == GeoDataTypes::GeoDataDocumentType ) {
+        record.type = DocumentFeature;
+    }
+    else if ( feature->nodeType() == GeoDataTypes::GeoDataFolderType ) {
+        record.type = FolderFeature;
+    }
+    else if ( feature->nodeType() == GeoDataTypes::GeoDataPlacemarkType ) {
+        const GeoDataPlacemark *placemark = static_cast<const GeoDataPlacemark*>( feature );
+        record.type = PlacemarkFeature;
+        record.countryCode = addString( placemark->countryCode() );
+        record.state = addString( placemark->state() );
+        record.population = placemark->population();
+        record.area = placemark->area();
+        if ( placemark->hasOsmData() ) {
+            const OsmPlacemarkData &osmData = placemark->osmData();
+            record.flags |= OsmDataFlag;
+            record.osmId = osmData.id();
+            record.firstOsmTag = m_properties.size();
+            QHash<QString, QString>::const_iterator tag = osmData.tagsBegin();
+            for (; tag != osmData.tagsEnd(); ++tag ) {
+                addProperty( tag.key(), tag.value(), StringProperty );
+            }
+            record.osmTagCount = m_properties.size() - record.firstOsmTag;
+        }
+        if ( placemark->geometry() ) {
+            record.geometry = m_geometries.size();
+            m_geometries.resize( m_geometries.size() + 1 );
+            if ( !writeGeometry( placemark->geometry(), record.geometry, error ) ) {
+                return false;
+            }
+        }
+    }
+    else {
+        error = QString( "Features of type %1 cannot be stored in a snapshot" ).arg( feature->nodeType() );
+        return false;
+    }
+
+    if ( feature->customStyle() ) {
+        if ( !isSupported( *feature->customStyle(), error ) ) {
+            return false;
+        }
+        record.style = addStyle( *feature->customStyle(), -1 );
+    }
+
+    record.firstExtendedData = m_properties.size();
+    QHash<QString, GeoDataData>::const_iterator data = feature->extendedData().constBegin();
+    for (; data != feature->extendedData().constEnd(); ++data ) {
+        QVariant const value = data->value();
+        PropertyType type = StringProperty;
+        if ( value.type() == QVariant::Int || value.type() == QVariant::LongLong ) {
+            type = IntProperty;
+        } else if ( value.type() == QVariant::Double ) {
+            type = DoubleProperty;
+        } else if ( value.type() == QVariant::Bool ) {
+            type = BoolProperty;
+        }
+        addProperty( data.key(), value.toString(), type );
+    }
+    record.extendedDataCount = m_properties.size() - record.firstExtendedData;
+
+    m_features << record;
+
+    if ( record.type == DocumentFeature ) {
+        const GeoDataDocument *document = static_cast<const GeoDataDocument*>( feature );
+        foreach ( const GeoDataStyle::ConstPtr &style, document->styles() ) {
+            if ( !isSupported( *style, error ) ) {
+                return false;
+            }
+            addStyle( *style, index );
+        }
+        foreach ( const GeoDataStyleMap &styleMap, document->styleMaps() ) {
+            addStyleMap( styleMap, index );
+        }
+    }
+
+    if ( record.type == DocumentFeature || record.type == FolderFeature ) {
+        const GeoDataContainer *container = static_cast<const GeoDataContainer*>( feature );
+        foreach ( const GeoDataFeature *child, container->featureList() ) {
+            if ( !addFeature( child, index, error ) ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<class T>
+SectionHeader sectionHeader( SectionType type, const QVector<T> &records, quint64 &offset )
+{
+    SectionHeader header;
+    header.type = type;
+    header.count = records.size();
+    header.offset = offset;
+    quint64 const size = records.size() * sizeof( T );
+    offset += ( size + sectionAlignment - 1 ) / sectionAlignment * sectionAlignment;
+    return header;
+}
+
+template<class T>
+bool writeSection( QIODevice &device, const QVector<T> &records )
+{
+    static const char padding[sectionAlignment] = { 0 };
+    qint64 const size = records.size() * sizeof( T );
+    int const paddingSize = ( sectionAlignment - size % sectionAlignment ) % sectionAlignment;
+    return device.write( reinterpret_cast<const char*>( records.constData() ), size ) == size
+            && device.write( padding, paddingSize ) == paddingSize;
+}
+
+bool SnapshotWriter::write( const QString &fileName, QString &error ) const
+{
+    FileHeader fileHeader;
+    fileHeader.magic = snapshotMagic;
+    fileHeader.version = snapshotVersion;
+    fileHeader.byteOrder = byteOrderMark;
+    fileHeader.sectionCount = SectionCount;
+
+    quint64 offset = sizeof( FileHeader ) + SectionCount * sizeof( SectionHeader );
+    SectionHeader sections[SectionCount];
+    sections[StringIndexSection] = sectionHeader( StringIndexSection, m_strings, offset );
+    sections[StringDataSection] = sectionHeader( StringDataSection, m_stringData, offset );
+    sections[FeatureSection] = sectionHeader( FeatureSection, m_features, offset );
+    sections[GeometrySection] = sectionHeader( GeometrySection, m_geometries, offset );
+    sections[LongitudeSection] = sectionHeader( LongitudeSection, m_longitudes, offset );
+    sections[LatitudeSection] = sectionHeader( LatitudeSection, m_latitudes, offset );
+    sections[AltitudeSection] = sectionHeader( AltitudeSection, m_altitudes, offset );
+    sections[DetailSection] = sectionHeader( DetailSection, m_details, offset );
+    sections[PropertySection] = sectionHeader( PropertySection, m_properties, offset );
+    sections[StyleSection] = sectionHeader( StyleSection, m_styles, offset );
+    sections[StyleMapSection] = sectionHeader( StyleMapSection, m_styleMaps, offset );
+
+    // Readers never see a partially written snapshot
+    QSaveFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        error = QString( "Cannot open %1 for writing: %2" ).arg( fileName ).arg( file.errorString() );
+        return false;
+    }
+
+    bool const written = file.write( reinterpret_cast<const char*>( &fileHeader ), sizeof( fileHeader ) ) == sizeof( fileHeader )
+            && file.write( reinterpret_cast<const char*>( sections ), sizeof( sections ) ) == sizeof( sections )
+            && writeSection( file, m_strings )
+            && writeSection( file, m_stringData )
+            && writeSection( file, m_features )
+            && writeSection( file, m_geometries )
+            && writeSection( file, m_longitudes )
+            && writeSection( file, m_latitudes )
+            && writeSection( file, m_altitudes )
+            && writeSection( file, m_details )
+            && writeSection( file, m_properties )
+            && writeSection( file, m_styles )
+            && writeSection( file, m_styleMaps );
+
+    if ( !written || !file.commit() ) {
+        error = QString( "Cannot write %1: %2" ).arg( fileName ).arg( file.errorString() );
+        return false;
+    }
+
+    return true;
+}
+
+class SnapshotReader
+{
+ public:
+    SnapshotReader( const uchar *data, qint64 size );
+
+    GeoDataDocument *read( QString &error );
+
+ private:
+    template<class T>
+    bool section( SectionType type, const T *&records, quint32 &count ) const;
+
+    QString string( quint32 index );
+    GeoDataCoordinates coordinates( quint32 node ) const;
+    void setNodes( GeoDataLineString &lineString, const GeometryRecord &record ) const;
+    bool isValidGeometry( quint32 index ) const;
+    GeoDataGeometry *createGeometry( quint32 index );
+    void readGeometry( GeoDataGeometry *geometry, const GeometryRecord &record ) const;
+    GeoDataStyle::Ptr createStyle( const StyleRecord &record );
+    GeoDataFeature *createFeature( const FeatureRecord &record, const QVector<GeoDataStyle::Ptr> &styles );
+
+    const uchar *const m_data;
+    quint64 const m_size;
+    const SectionHeader *m_sections;
+
+    const StringRecord *m_stringIndex;
+    quint32 m_stringCount;
+    const ushort *m_stringData;
+    quint32 m_stringDataSize;
+    const FeatureRecord *m_features;
+    quint32 m_featureCount;
+    const GeometryRecord *m_geometries;
+    quint32 m_geometryCount;
+    const double *m_longitudes;
+    const double *m_latitudes;
+    const double *m_altitudes;
+    const quint8 *m_details;
+    quint32 m_nodeCount;
+    const PropertyRecord *m_properties;
+    quint32 m_propertyCount;
+    const StyleRecord *m_styles;
+    quint32 m_styleCount;
+    const StyleMapRecord *m_styleMaps;
+    quint32 m_styleMapCount;
+
+    // Each string is created once, features share it
+    QVector<QString> m_strings;
+};
+
+SnapshotReader::SnapshotReader( const uchar *data, qint64 size ) :
+    m_data( data ),
+    m_size( size ),
+    m_sections( 0 ),
+    m_stringIndex( 0 ),
+    m_stringCount( 0 ),
+    m_stringData( 0 ),
+    m_stringDataSize( 0 ),
+    m_features( 0 ),
+    m_featureCount( 0 ),
+    m_geometries( 0 ),
+    m_geometryCount( 0 ),
+    m_longitudes( 0 ),
+    m_latitudes( 0 ),
+    m_altitudes( 0 ),
+    m_details( 0 ),
+    m_nodeCount( 0 ),
+    m_properties( 0 ),
+    m_propertyCount( 0 ),
+    m_styles( 0 ),
+    m_styleCount( 0 ),
+    m_styleMaps( 0 ),
+    m_styleMapCount( 0 )
+{
+    // nothing to do
+}
+
+template<class T>
+bool SnapshotReader::section( SectionType type, const T *&records, quint32 &count ) const
+{
+    const SectionHeader &header = m_sections[type];
+    if ( header.type != quint32( type ) || header.offset % sectionAlignment != 0 || header.offset > m_size
+         || quint64( header.count ) * sizeof( T ) > m_size - header.offset ) {
+        return false;
+    }
+
+    records = reinterpret_cast<const T*>( m_data + header.offset );
+    count = header.count;
+    return true;
+}
+
+QString SnapshotReader::string( quint32 index )
+{
+    if ( index >= m_stringCount ) {
+        return QString();
+    }
+
+    if ( m_strings[index].isNull() && index != 0 ) {
+        const StringRecord &record = m_stringIndex[index];
+        if ( record.offset <= m_stringDataSize && record.length <= m_stringDataSize - record.offset ) {
+            m_strings[index] = QString( reinterpret_cast<const QChar*>( m_stringData + record.offset ), record.length );
+        }
+    }
+
+    return m_strings[index];
+}
+
+GeoDataCoordinates SnapshotReader::coordinates( quint32 node ) const
+{
+    return GeoDataCoordinates( m_longitudes[node], m_latitudes[node], m_altitudes[node],
+                               GeoDataCoordinates::Radian, m_details[node] );
+}
+
+void SnapshotReader::setNodes( GeoDataLineString &lineString, const GeometryRecord &record ) const
+{
+    // Packed storage avoids one allocation per node
+    lineString.setPackedStorage( true );
+    lineString.reserve( record.count );
+    quint32 const end = record.first + record.count;
+    for ( quint32 node = record.first; node < end; ++node ) {
+        lineString.append( coordinates( node ) );
+    }
+
+    if ( record.flags & LevelIndicesFlag ) {
+        lineString.restoreLevelIndices();
+    }
+}
+
+bool SnapshotReader::isValidGeometry( quint32 index ) const
+{
+    const GeometryRecord &record = m_geometries[index];
+    switch ( record.type ) {
+    case PointGeometry:
+        return record.count == 1 && record.first < m_nodeCount;
+    case LineStringGeometry:
+    case LinearRingGeometry:
+        return record.first <= m_nodeCount && record.count <= m_nodeCount - record.first;
+    case PolygonGeometry:
+    case MultiGeometryGeometry:
+        // Children come after their parent, which rules out cycles
+        if ( record.first <= index || record.first > m_geometryCount || record.count > m_geometryCount - record.first ) {
+            return false;
+        }
+        if ( record.type == PolygonGeometry ) {
+            if ( record.count == 0 ) {
+                return false;
+            }
+            for ( quint32 i = record.first; i < record.first + record.count; ++i ) {
+                if ( m_geometries[i].type != LinearRingGeometry || !isValidGeometry( i ) ) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void SnapshotReader::readGeometry( GeoDataGeometry *geometry, const GeometryRecord &record ) const
+{
+    geometry->setExtrude( record.extrude != 0 );
+    geometry->setAltitudeMode( AltitudeMode( record.altitudeMode ) );
+}
+
+GeoDataGeometry *SnapshotReader::createGeometry( quint32 index )
+{
+    if ( index >= m_geometryCount || !isValidGeometry( index ) ) {
+        return 0;
+    }
+
+    const GeometryRecord &record = m_geometries[index];
+    TessellationFlags const tessellation = TessellationFlags( QFlag( record.tessellation ) );
+    GeoDataGeometry *geometry = 0;
+
+    switch ( record.type ) {
+    case PointGeometry:
+        geometry = new GeoDataPoint( coordinates( record.first ) );
+        break;
+    case LineStringGeometry: {
+        GeoDataLineString *lineString = new GeoDataLineString( tessellation );
+        setNodes( *lineString, record );
+        geometry = lineString;
+        break;
+    }
+    case LinearRingGeometry: {
+        GeoDataLinearRing *linearRing = new GeoDataLinearRing( tessellation );
+        setNodes( *linearRing, record );
+        geometry = linearRing;
+        break;
+    }
+    case PolygonGeometry: {
+        GeoDataPolygon *polygon = new GeoDataPolygon( tessellation );
+        polygon->setRenderOrder( record.renderOrder );
+        for ( quint32 i = 0; i < record.count; ++i ) {
+            const GeometryRecord &ringRecord = m_geometries[record.first + i];
+            if ( i == 0 ) {
+                setNodes( polygon->outerBoundary(), ringRecord );
+                readGeometry( &polygon->outerBoundary(), ringRecord );
+            } else {
+                GeoDataLinearRing ring( TessellationFlags( QFlag( ringRecord.tessellation ) ) );
+                setNodes( ring, ringRecord );
+                readGeometry( &ring, ringRecord );
+                polygon->appendInnerBoundary( ring );
+            }
+        }
+        geometry = polygon;
+        break;
+    }
+    case MultiGeometryGeometry: {
+        GeoDataMultiGeometry *multiGeometry = new GeoDataMultiGeometry;
+        for ( quint32 i = 0; i < record.count; ++i ) {
+            GeoDataGeometry *child = createGeometry( record.first + i );
+            if ( !child ) {
+                delete multiGeometry;
+                return 0;
+            }
+            multiGeometry->append( child );
+        }
+        geometry = multiGeometry;
+        break;
+    }
+    }
+
+    readGeometry( geometry, record );
+    return geometry;
+}
+
+GeoDataStyle::Ptr SnapshotReader::createStyle( const StyleRecord &record )
+{
+    GeoDataStyle::Ptr style( new GeoDataStyle );
+    style->setId( string( record.id ) );
+
+    GeoDataIconStyle &iconStyle = style->iconStyle();
+    iconStyle.setIconPath( string( record.iconPath ) );
+    iconStyle.setColor( QColor::fromRgba( record.iconColor ) );
+    iconStyle.setScale( record.iconScale );
+
+    GeoDataLabelStyle &labelStyle = style->labelStyle();
+    labelStyle.setColor( QColor::fromRgba( record.labelColor ) );
+    labelStyle.setScale( record.labelScale );
+    labelStyle.setAlignment( GeoDataLabelStyle::Alignment( record.labelAlignment ) );
+    labelStyle.setGlow( record.flags & LabelGlowFlag );
+
+    GeoDataLineStyle &lineStyle = style->lineStyle();
+    lineStyle.setColor( QColor::fromRgba( record.lineColor ) );
+    lineStyle.setWidth( record.lineWidth );
+    lineStyle.setPhysicalWidth( record.linePhysicalWidth );
+    lineStyle.setCapStyle( Qt::PenCapStyle( record.lineCapStyle ) );
+    lineStyle.setPenStyle( Qt::PenStyle( record.linePenStyle ) );
+    lineStyle.setBackground( record.flags & LineBackgroundFlag );
+    lineStyle.setCosmeticOutline( record.flags & LineCosmeticOutlineFlag );
+
+    GeoDataPolyStyle &polyStyle = style->polyStyle();
+    polyStyle.setColor( QColor::fromRgba( record.polyColor ) );
+    polyStyle.setBrushStyle( Qt::BrushStyle( record.polyBrushStyle ) );
+    polyStyle.setColorIndex( record.polyColorIndex );
+    polyStyle.setFill( record.flags & PolyFillFlag );
+    polyStyle.setOutline( record.flags & PolyOutlineFlag );
+
+    return style;
+}
+
+GeoDataFeature *SnapshotReader::createFeature( const FeatureRecord &record, const QVector<GeoDataStyle::Ptr> &styles )
+{
+    GeoDataFeature *feature = 0;
+    switch ( record.type ) {
+    case DocumentFeature:
+        feature = new GeoDataDocument;
+        break;
+    case FolderFeature:
+        feature = new GeoDataFolder;
+        break;
+    case PlacemarkFeature: {
+        GeoDataPlacemark *placemark = new GeoDataPlacemark;
+        placemark->setCountryCode( string( record.countryCode ) );
+        placemark->setState( string( record.state ) );
+        placemark->setPopulation( record.population );
+        placemark->setArea( record.area );
+        if ( record.geometry >= 0 ) {
+            GeoDataGeometry *geometry = createGeometry( record.geometry );
+            if ( !geometry ) {
+                delete placemark;
+                return 0;
+            }
+            placemark->setGeometry( geometry );
+        }
+        if ( record.flags & OsmDataFlag ) {
+            if ( record.firstOsmTag > m_propertyCount || record.osmTagCount > m_propertyCount - record.firstOsmTag ) {
+                delete placemark;
+                return 0;
+            }
+            OsmPlacemarkData osmData;
+            osmData.setId( record.osmId );
+            for ( quint32 i = record.firstOsmTag; i < record.firstOsmTag + record.osmTagCount; ++i ) {
+                osmData.addTag( string( m_properties[i].key ), string( m_properties[i].value ) );
+            }
+            placemark->setOsmData( osmData );
+        }
+        feature = placemark;
+        break;
+    }
+    default:
+        return 0;
+    }
+
+    feature->setId( string( record.id ) );
+    feature->setName( string( record.name ) );
+    // Most features have none of these, don't create their extras for nothing
+    if ( record.description != 0 || ( record.flags & DescriptionCDATAFlag ) ) {
+        feature->setDescription( string( record.description ) );
+        feature->setDescriptionCDATA( record.flags & DescriptionCDATAFlag );
+    }
+    if ( record.snippet != 0 || record.snippetMaxLines != 0 ) {
+        feature->setSnippet( GeoDataSnippet( string( record.snippet ), record.snippetMaxLines ) );
+    }
+    if ( record.address != 0 ) {
+        feature->setAddress( string( record.address ) );
+    }
+    if ( record.phoneNumber != 0 ) {
+        feature->setPhoneNumber( string( record.phoneNumber ) );
+    }
+    feature->setStyleUrl( string( record.styleUrl ) );
+    feature->setRole( string( record.role ) );
+    feature->setVisible( record.flags & VisibleFlag );
+    if ( record.visualCategory >= 0 && record.visualCategory < GeoDataFeature::LastIndex ) {
+        feature->setVisualCategory( GeoDataFeature::GeoDataVisualCategory( record.visualCategory ) );
+    }
+    feature->setZoomLevel( record.zoomLevel );
+    feature->setPopularity( record.popularity );
+
+    if ( record.style >= 0 && record.style < styles.size() ) {
+        feature->setStyle( styles.at( record.style ) );
+    }
+
+    if ( record.firstExtendedData > m_propertyCount || record.extendedDataCount > m_propertyCount - record.firstExtendedData ) {
+        delete feature;
+        return 0;
+    }
+    for ( quint32 i = record.firstExtendedData; i < record.firstExtendedData + record.extendedDataCount; ++i ) {
+        const PropertyRecord &property = m_properties[i];
+        QString const value = string( property.value );
+        QVariant data;
+        switch ( property.type ) {
+        case IntProperty:
+            data = value.toLongLong();
+            break;
+        case DoubleProperty:
+            data = value.toDouble();
+            break;
+        case BoolProperty:
+            data = value == "true";
+            break;
+        default:
+            data = value;
+        }
+        feature->extendedData().addValue( GeoDataData( string( property.key ), data ) );
+    }
+
+    return feature;
+}
+
+GeoDataDocument *SnapshotReader::read( QString &error )
+{
+    if ( m_size < sizeof( FileHeader ) ) {
+        error = "File too small";
+        return 0;
+    }
+
+    const FileHeader *header = reinterpret_cast<const FileHeader*>( m_data );
+    if ( header->magic != snapshotMagic || header->byteOrder != byteOrderMark ) {
+        error = "Not a snapshot, or written on a machine with a different byte order";
+        return 0;
+    }
+    if ( header->version != snapshotVersion ) {
+        error = QString( "Unsupported snapshot version %1, need %2" ).arg( header->version ).arg( snapshotVersion );
+        return 0;
+    }
+    if ( header->sectionCount != SectionCount
+         || m_size < sizeof( FileHeader ) + SectionCount * sizeof( SectionHeader ) ) {
+        error = "Invalid section table";
+        return 0;
+    }
+    m_sections = reinterpret_cast<const SectionHeader*>( m_data + sizeof( FileHeader ) );
+
+    quint32 latitudeCount = 0;
+    quint32 altitudeCount = 0;
+    quint32 detailCount = 0;
+    if ( !section( StringIndexSection, m_stringIndex, m_stringCount )
+         || !section( StringDataSection, m_stringData, m_stringDataSize )
+         || !section( FeatureSection, m_features, m_featureCount )
+         || !section( GeometrySection, m_geometries, m_geometryCount )
+         || !section( LongitudeSection, m_longitudes, m_nodeCount )
+         || !section( LatitudeSection, m_latitudes, latitudeCount )
+         || !section( AltitudeSection, m_altitudes, altitudeCount )
+         || !section( DetailSection, m_details, detailCount )
+         || !section( PropertySection, m_properties, m_propertyCount )
+         || !section( StyleSection, m_styles, m_styleCount )
+         || !section( StyleMapSection, m_styleMaps, m_styleMapCount )
+         || latitudeCount != m_nodeCount || altitudeCount != m_nodeCount || detailCount != m_nodeCount ) {
+        error = "Truncated or corrupt snapshot";
+        return 0;
+    }
+
+    if ( m_featureCount == 0 || m_features[0].type != DocumentFeature || m_features[0].parent != -1 ) {
+        error = "The snapshot does not contain a document";
+        return 0;
+    }
+
+    m_strings.resize( m_stringCount );
+
+    QVector<GeoDataStyle::Ptr> styles;
+    styles.reserve( m_styleCount );
+    for ( quint32 i = 0; i < m_styleCount; ++i ) {
+        styles << createStyle( m_styles[i] );
+    }
+
+    QVector<GeoDataFeature*> features( m_featureCount, 0 );
+    for ( quint32 i = 0; i < m_featureCount; ++i ) {
+        const FeatureRecord &record = m_features[i];
+        // Parents come before their children, the root document has no parent
+        bool const validParent = i == 0 || ( record.parent >= 0 && quint32( record.parent ) < i
+                                              && m_features[record.parent].type != PlacemarkFeature );
+        GeoDataFeature *feature = validParent ? createFeature( record, styles ) : 0;
+        if ( !feature ) {
+            delete features[0];
+            error = QString( "Invalid feature %1" ).arg( i );
+            return 0;
+        }
+
+        features[i] = feature;
+        if ( i > 0 ) {
+            static_cast<GeoDataContainer*>( features[record.parent] )->append( feature );
+        }
+    }
+
+    for ( quint32 i = 0; i < m_styleCount; ++i ) {
+        qint32 const document = m_styles[i].document;
+        if ( document >= 0 && quint32( document ) < m_featureCount && m_features[document].type == DocumentFeature ) {
+            static_cast<GeoDataDocument*>( features[document] )->addStyle( styles[i] );
+        }
+    }
+
+    for ( quint32 i = 0; i < m_styleMapCount; ++i ) {
+        const StyleMapRecord &record = m_styleMaps[i];
+        if ( record.document < 0 || quint32( record.document ) >= m_featureCount
+             || m_features[record.document].type != DocumentFeature
+             || record.firstPair > m_propertyCount || record.pairCount > m_propertyCount - record.firstPair ) {
+            continue;
+        }
+        GeoDataStyleMap styleMap;
+        styleMap.setId( string( record.id ) );
+        for ( quint32 pair = record.firstPair; pair < record.firstPair + record.pairCount; ++pair ) {
+            styleMap.insert( string( m_properties[pair].key ), string( m_properties[pair].value ) );
+        }
+        static_cast<GeoDataDocument*>( features[record.document] )->addStyleMap( styleMap );
+    }
+
+    return static_cast<GeoDataDocument*>( features[0] );
+}
+
+}
+
+bool DocumentSnapshot::write( const GeoDataDocument &document, const QString &fileName, QString &error )
+{
+    SnapshotWriter writer;
+    return writer.addFeature( &document, -1, error ) && writer.write( fileName, error );
+}
+
+GeoDataDocument *DocumentSnapshot::read( const QString &fileName, QString &error )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        error = QString( "Cannot open %1: %2" ).arg( fileName ).arg( file.errorString() );
+        return 0;
+    }
+
+    // Fall back to reading the file if it cannot be mapped
+    QByteArray contents;
+    const uchar *data = file.map( 0, file.size() );
+    qint64 const size = file.size();
+    if ( !data ) {
+        contents = file.readAll();
+        data = reinterpret_cast<const uchar*>( contents.constData() );
+    }
+
+    SnapshotReader reader( data, size );
+    GeoDataDocument *document = reader.read( error );
+    if ( document ) {
+        document->setFileName( fileName );
+    } else {
+        error = QString( "Cannot read snapshot %1: %2" ).arg( fileName ).arg( error );
+        mDebug() << error;
+    }
+
+    return document;
+}
+
+QString DocumentSnapshot::snapshotFileName( const QString &sourceFileName )
+{
+    return sourceFileName + '.' + fileExtension();
+}
+
+QString DocumentSnapshot::fileExtension()
+{
+    return "snapshot";
+}
+
+}
@@ -0,0 +1,70 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_DOCUMENTSNAPSHOT_H
+#define MARBLE_DOCUMENTSNAPSHOT_H
+
+#include "marble_export.h"
+
+#include <QString>
+
+namespace Marble
+{
+
+class GeoDataDocument;
+
+/**
+ * @short Reads and writes parsed documents in a binary snapshot format.
+ *
+ * A snapshot stores the features, styles and geometries of a document in
+ * flat sections of fixed size records: Strings are stored once and referred
+ * to by index, the coordinates of all geometries are kept in three arrays of
+ * longitudes, latitudes and altitudes. Reading a snapshot maps the file into
+ * memory and creates the document from the records directly, without any
+ * parsing or per-element stream decoding.
+ *
+ * Snapshots are meant as a cache of files that are expensive to parse.
+ * They are only readable by the same format version on a machine of the
+ * same byte order. Callers should fall back to the source file otherwise.
+ *
+ * Documents, folders and placemarks with point, line string, linear ring,
+ * polygon and multi geometries are supported, including the detail values
+ * and level indices of optimized line strings, as well as the icon, label,
+ * line and poly styles and the style maps of documents. Other features and
+ * geometries, views, time primitives, regions and balloon or list styles
+ * make write() fail. OSM node and member references are not stored.
+ */
+class MARBLE_EXPORT DocumentSnapshot
+{
+ public:
+    /**
+     * Writes @p document to the file @p fileName.
+     * @return true on success, otherwise false and a description of the problem in @p error
+     */
+    static bool write( const GeoDataDocument &document, const QString &fileName, QString &error );
+
+    /**
+     * Reads the snapshot @p fileName. The caller takes ownership of the returned document.
+     * @return the document, or 0 and a description of the problem in @p error
+     */
+    static GeoDataDocument *read( const QString &fileName, QString &error );
+
+    /**
+     * Returns the name of the snapshot that caches @p sourceFileName.
+     */
+    static QString snapshotFileName( const QString &sourceFileName );
+
+    /**
+     * The file extension of snapshots, without the dot.
+     */
+    static QString fileExtension();
+};
+
+}
+
+#endif
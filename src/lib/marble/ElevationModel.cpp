@@ -9,6 +9,7 @@
 //
 
 #include "ElevationModel.h"
+#include "GeoDataLineString.h"
 #include "GeoSceneHead.h"
 #include "GeoSceneLayer.h"
 #include "GeoSceneMap.h"
@@ -24,12 +25,51 @@
 #include "PluginManager.h"
 
 #include <QCache>
+#include <QHash>
 #include <QImage>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
 #include <qmath.h>
 
 namespace Marble
 {
 
+namespace
+{
+
+/**
+ * Loads an elevation tile in a worker thread and hands it to the
+ * tileCompleted() slot of the elevation model.
+ */
+class ElevationTileRunner : public QRunnable
+{
+public:
+    ElevationTileRunner( TileLoader *loader, const GeoSceneTextureTileDataset *textureLayer,
+                         const TileId &id, ElevationModel *model )
+        : m_loader( loader ),
+          m_textureLayer( textureLayer ),
+          m_id( id ),
+          m_model( model )
+    {
+    }
+
+    void run()
+    {
+        const QImage image = m_loader->loadTileImage( m_textureLayer, m_id, DownloadBrowse );
+        QMetaObject::invokeMethod( m_model, "tileCompleted", Qt::QueuedConnection,
+                                   Q_ARG( TileId, m_id ), Q_ARG( QImage, image ) );
+    }
+
+private:
+    TileLoader *const m_loader;
+    const GeoSceneTextureTileDataset *const m_textureLayer;
+    const TileId m_id;
+    ElevationModel *const m_model;
+};
+
+}
+
 class ElevationModelPrivate
 {
 public:
@@ -37,9 +77,17 @@ public:
         : q( _q ),
           m_tileLoader( downloadManager, pluginManager ),
           m_textureLayer( 0 ),
-          m_srtmTheme(0)
+          m_srtmTheme( 0 ),
+          m_tileZoomLevel( 0 ),
+          m_tileWidth( 0 ),
+          m_tileHeight( 0 ),
+          m_numTilesX( 0 ),
+          m_numTilesY( 0 )
     {
-        m_cache.setMaxCost( 10 ); //keep 10 tiles in memory (~17MB)
+        m_cache.setMaxCost( 20 ); //keep 20 tiles in memory (~17MB)
+
+        // Tiles are loaded one after the other in the background
+        m_threadPool.setMaxThreadCount( 1 );
 
         m_srtmTheme = MapThemeManager::loadMapTheme( "earth/srtm2/srtm2.dgml" );
         if ( !m_srtmTheme ) {
@@ -58,64 +106,125 @@ public:
 
         m_textureLayer = dynamic_cast<GeoSceneTextureTileDataset*>( sceneLayer->datasets().first() );
         Q_ASSERT( m_textureLayer );
+
+        // Determining the maximum tile level may need to look at the installed tiles,
+        // so it is done once here instead of for each height
+        m_tileZoomLevel = TileLoader::maximumTileLevel( *m_textureLayer );
+        Q_ASSERT( m_tileZoomLevel == 9 );
+
+        m_tileWidth = m_textureLayer->tileSize().width();
+        m_tileHeight = m_textureLayer->tileSize().height();
+
+        m_numTilesX = TileLoaderHelper::levelToColumn( m_textureLayer->levelZeroColumns(), m_tileZoomLevel );
+        m_numTilesY = TileLoaderHelper::levelToRow( m_textureLayer->levelZeroRows(), m_tileZoomLevel );
+        Q_ASSERT( m_numTilesX > 0 );
+        Q_ASSERT( m_numTilesY > 0 );
     }
 
     ~ElevationModelPrivate()
     {
+       // Running jobs use the texture layer
+       m_threadPool.waitForDone();
        delete m_srtmTheme;
     }
 
     void tileCompleted( const TileId & tileId, const QImage &image )
     {
-        m_cache.insert( tileId, new QImage( image ) );
+        m_pendingTiles.remove( tileId );
+        m_cache.insert( tileId, new QVector<quint16>( heights( image ) ) );
         emit q->updateAvailable();
     }
 
+    /**
+     * Returns the 16 bit height values of @p image, row by row.
+     */
+    QVector<quint16> heights( const QImage &image ) const;
+
+    /**
+     * Returns the height values of the tile @p id. If it is not in the cache, it
+     * is either loaded right away if @p wait is true, or an empty vector is
+     * returned and the tile gets loaded in the background.
+     */
+    QVector<quint16> tile( const TileId &id, bool wait );
+
+    /**
+     * Returns the height at the given coordinates in degrees. The tiles are
+     * looked up in @p tiles first, tiles not found there are added to it,
+     * see tile(). This way a tile is looked up only once for many heights,
+     * and stays around while it is used even if the cache drops it.
+     */
+    qreal height( qreal lon, qreal lat, QHash<TileId, QVector<quint16> > &tiles, bool wait );
+
 public:
     ElevationModel *q;
 
     TileLoader m_tileLoader;
     const GeoSceneTextureTileDataset *m_textureLayer;
-    QCache<TileId, const QImage> m_cache;
+    QCache<TileId, const QVector<quint16> > m_cache;
     GeoSceneDocument *m_srtmTheme;
+
+    int m_tileZoomLevel;
+    int m_tileWidth;
+    int m_tileHeight;
+    int m_numTilesX;
+    int m_numTilesY;
+
+    // Tiles which are being loaded in the background
+    QSet<TileId> m_pendingTiles;
+    QThreadPool m_threadPool;
 };
 
-ElevationModel::ElevationModel( HttpDownloadManager *downloadManager, PluginManager* pluginManager, QObject *parent ) :
-    QObject( parent ),
-    d( new ElevationModelPrivate( this, downloadManager, pluginManager ) )
+QVector<quint16> ElevationModelPrivate::heights( const QImage &image ) const
 {
-    connect( &d->m_tileLoader, SIGNAL(tileCompleted(TileId,QImage)),
-             this, SLOT(tileCompleted(TileId,QImage)) );
-}
+    Q_ASSERT( !image.isNull() );
+    Q_ASSERT( m_tileWidth == image.width() );
+    Q_ASSERT( m_tileHeight == image.height() );
+
+    const QImage tile = ( image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32 )
+                        ? image : image.convertToFormat( QImage::Format_ARGB32 );
+
+    const int width = qMin( tile.width(), m_tileWidth );
+    const int height = qMin( tile.height(), m_tileHeight );
+    QVector<quint16> result( m_tileWidth * m_tileHeight, invalidElevationData );
+    for ( int y = 0; y < height; ++y ) {
+        const QRgb *line = reinterpret_cast<const QRgb *>( tile.constScanLine( y ) );
+        quint16 *heights = result.data() + y * m_tileWidth;
+        for ( int x = 0; x < width; ++x ) {
+            heights[x] = line[x] & 0xffff; // 16 valid bits
+        }
+    }
 
-ElevationModel::~ElevationModel()
-{
-    delete d;
+    return result;
 }
 
-
-qreal ElevationModel::height( qreal lon, qreal lat ) const
+QVector<quint16> ElevationModelPrivate::tile( const TileId &id, bool wait )
 {
-    if ( !d->m_textureLayer ) {
-        return invalidElevationData;
+    const QVector<quint16> *cached = m_cache[id];
+    if ( cached ) {
+        return *cached;
     }
 
-    const int tileZoomLevel = TileLoader::maximumTileLevel( *( d->m_textureLayer ) );
-    Q_ASSERT( tileZoomLevel == 9 );
+    if ( wait ) {
+        const QVector<quint16> result = heights( m_tileLoader.loadTileImage( m_textureLayer, id, DownloadBrowse ) );
+        m_cache.insert( id, new QVector<quint16>( result ) );
+        return result;
+    }
 
-    const int width = d->m_textureLayer->tileSize().width();
-    const int height = d->m_textureLayer->tileSize().height();
+    if ( !m_pendingTiles.contains( id ) ) {
+        m_pendingTiles.insert( id );
+        m_threadPool.start( new ElevationTileRunner( &m_tileLoader, m_textureLayer, id, q ) );
+    }
 
-    const int numTilesX = TileLoaderHelper::levelToColumn( d->m_textureLayer->levelZeroColumns(), tileZoomLevel );
-    const int numTilesY = TileLoaderHelper::levelToRow( d->m_textureLayer->levelZeroRows(), tileZoomLevel );
-    Q_ASSERT( numTilesX > 0 );
-    Q_ASSERT( numTilesY > 0 );
+    return QVector<quint16>();
+}
 
+qreal ElevationModelPrivate::height( qreal lon, qreal lat, QHash<TileId, QVector<quint16> > &tiles, bool wait )
+{
     qreal textureX = 180 + lon;
-    textureX *= numTilesX * width / 360;
+    textureX *= m_numTilesX * m_tileWidth / 360;
 
     qreal textureY = 90 - lat;
-    textureY *= numTilesY * height / 180;
+    textureY *= m_numTilesY * m_tileHeight / 180;
 
     qreal ret = 0;
     bool hasHeight = false;
@@ -125,36 +234,34 @@ qreal ElevationModel::height( qreal lon, qreal lat ) const
         const int x = static_cast<int>( textureX + ( i % 2 ) );
         const int y = static_cast<int>( textureY + ( i / 2 ) );
 
-        //mDebug() << "x" << x << ( x / width );
-        //mDebug() << "y" << y << ( y / height );
+        //mDebug() << "x" << x << ( x / m_tileWidth );
+        //mDebug() << "y" << y << ( y / m_tileHeight );
 
-        const TileId id( 0, tileZoomLevel, ( x % ( numTilesX * width ) ) / width, ( y % ( numTilesY * height ) ) / height );
-        //mDebug() << "LAT" << lat << "LON" << lon << "tile" << ( x % ( numTilesX * width ) ) / width << ( y % ( numTilesY * height ) ) / height;
+        const TileId id( 0, m_tileZoomLevel, ( x % ( m_numTilesX * m_tileWidth ) ) / m_tileWidth, ( y % ( m_numTilesY * m_tileHeight ) ) / m_tileHeight );
+        //mDebug() << "LAT" << lat << "LON" << lon << "tile" << ( x % ( m_numTilesX * m_tileWidth ) ) / m_tileWidth << ( y % ( m_numTilesY * m_tileHeight ) ) / m_tileHeight;
 
-        const QImage *image = d->m_cache[id];
-        if ( image == 0 ) {
-            image = new QImage( d->m_tileLoader.loadTileImage( d->m_textureLayer, id, DownloadBrowse ) );
-            d->m_cache.insert( id, image );
+        QHash<TileId, QVector<quint16> >::const_iterator tileIter = tiles.constFind( id );
+        if ( tileIter == tiles.constEnd() ) {
+            tileIter = tiles.insert( id, tile( id, wait ) );
         }
-        Q_ASSERT( image );
-        Q_ASSERT( !image->isNull() );
-        Q_ASSERT( width == image->width() );
-        Q_ASSERT( height == image->height() );
+        const QVector<quint16> &tileHeights = tileIter.value();
 
         const qreal dx = ( textureX > ( qreal )x ) ? textureX - ( qreal )x : ( qreal )x - textureX;
         const qreal dy = ( textureY > ( qreal )y ) ? textureY - ( qreal )y : ( qreal )y - textureY;
 
         Q_ASSERT( 0 <= dx && dx <= 1 );
         Q_ASSERT( 0 <= dy && dy <= 1 );
-        unsigned int pixel = image->pixel( x % width, y % height ) & 0xffff; // 16 valid bits
+        // tiles which are still being loaded have no data
+        unsigned int pixel = tileHeights.isEmpty() ? invalidElevationData
+                           : tileHeights.at( ( y % m_tileHeight ) * m_tileWidth + x % m_tileWidth );
         short int elevation = (short int) pixel; // and signed type, so just cast it
         //mDebug() << "(1-dx)" << (1-dx) << "(1-dy)" << (1-dy);
         if ( pixel != invalidElevationData ) { //no data?
-            //mDebug() << "got at x" << x % width << "y" << y % height << "a height of" << pixel << "** RGB" << qRed(pixel) << qGreen(pixel) << qBlue(pixel);
+            //mDebug() << "got at x" << x % m_tileWidth << "y" << y % m_tileHeight << "a height of" << pixel;
             ret += ( qreal )elevation * ( 1 - dx ) * ( 1 - dy );
             hasHeight = true;
         } else {
-            //mDebug() << "no data at" <<  x % width << "y" << y % height;
+            //mDebug() << "no data at" <<  x % m_tileWidth << "y" << y % m_tileHeight;
             noData += ( 1 - dx ) * ( 1 - dy );
         }
     }
@@ -172,17 +279,38 @@ qreal ElevationModel::height( qreal lon, qreal lat ) const
     return ret;
 }
 
+ElevationModel::ElevationModel( HttpDownloadManager *downloadManager, PluginManager* pluginManager, QObject *parent ) :
+    QObject( parent ),
+    d( new ElevationModelPrivate( this, downloadManager, pluginManager ) )
+{
+    qRegisterMetaType<TileId>( "TileId" );
+    connect( &d->m_tileLoader, SIGNAL(tileCompleted(TileId,QImage)),
+             this, SLOT(tileCompleted(TileId,QImage)) );
+}
+
+ElevationModel::~ElevationModel()
+{
+    delete d;
+}
+
+
+qreal ElevationModel::height( qreal lon, qreal lat ) const
+{
+    if ( !d->m_textureLayer ) {
+        return invalidElevationData;
+    }
+
+    QHash<TileId, QVector<quint16> > tiles;
+    return d->height( lon, lat, tiles, true );
+}
+
 QVector<GeoDataCoordinates> ElevationModel::heightProfile( qreal fromLon, qreal fromLat, qreal toLon, qreal toLat ) const
 {
     if ( !d->m_textureLayer ) {
         return QVector<GeoDataCoordinates>();
     }
 
-    const int tileZoomLevel = TileLoader::maximumTileLevel( *( d->m_textureLayer ) );
-    const int width = d->m_textureLayer->tileSize().width();
-    const int numTilesX = TileLoaderHelper::levelToColumn( d->m_textureLayer->levelZeroColumns(), tileZoomLevel );
-
-    qreal distPerPixel = ( qreal )360 / ( width * numTilesX );
+    qreal distPerPixel = ( qreal )360 / ( d->m_tileWidth * d->m_numTilesX );
     //mDebug() << "heightProfile" << fromLat << fromLon << toLat << toLon << "distPerPixel" << distPerPixel;
 
     qreal lat = fromLat;
@@ -194,9 +322,10 @@ QVector<GeoDataCoordinates> ElevationModel::heightProfile( qreal fromLon, qreal
     //mDebug() << "diff lon" << ( fromLon - toLon ) << "diff lat" << ( fromLat - toLat );
     //mDebug() << "dirLon" << QString::number(dirLon) << "dirLat" << QString::number(dirLat) << "k" << k;
     QVector<GeoDataCoordinates> ret;
+    QHash<TileId, QVector<quint16> > tiles;
     while ( lat*dirLat <= toLat*dirLat && lon*dirLon <= toLon * dirLon ) {
         //mDebug() << lat << lon;
-        qreal h = height( lon, lat );
+        qreal h = d->height( lon, lat, tiles, true );
         if ( h < 32000 ) {
             ret << GeoDataCoordinates( lon, lat, h, GeoDataCoordinates::Degree );
         }
@@ -214,6 +343,37 @@ QVector<GeoDataCoordinates> ElevationModel::heightProfile( qreal fromLon, qreal
     return ret;
 }
 
+QVector<qreal> ElevationModel::heights( const QVector<GeoDataCoordinates> &coordinates ) const
+{
+    QVector<qreal> result;
+    if ( !d->m_textureLayer ) {
+        result.fill( invalidElevationData, coordinates.size() );
+        return result;
+    }
+
+    result.reserve( coordinates.size() );
+    QHash<TileId, QVector<quint16> > tiles;
+    foreach ( const GeoDataCoordinates &coordinate, coordinates ) {
+        const qreal lon = coordinate.longitude( GeoDataCoordinates::Degree );
+        const qreal lat = coordinate.latitude( GeoDataCoordinates::Degree );
+        result << d->height( lon, lat, tiles, false );
+    }
+
+    return result;
+}
+
+QVector<qreal> ElevationModel::heights( const GeoDataLineString &lineString ) const
+{
+    QVector<GeoDataCoordinates> coordinates;
+    coordinates.reserve( lineString.size() );
+    GeoDataLineString::ConstIterator const end = lineString.constEnd();
+    for ( GeoDataLineString::ConstIterator iter = lineString.constBegin(); iter != end; ++iter ) {
+        coordinates << *iter;
+    }
+
+    return heights( coordinates );
+}
+
 }
 
 
@@ -16,6 +16,7 @@
 #include "marble_export.h"
 
 #include <QObject>
+#include <QVector>
 
 class QImage;
 
@@ -28,6 +29,7 @@ namespace {
 
 class TileId;
 class ElevationModelPrivate;
+class GeoDataLineString;
 class HttpDownloadManager;
 class PluginManager;
 
@@ -41,6 +43,22 @@ public:
     qreal height( qreal lon, qreal lat ) const;
     QVector<GeoDataCoordinates> heightProfile( qreal fromLon, qreal fromLat, qreal toLon, qreal toLat ) const;
 
+    /**
+     * Returns the height at each of the given coordinates, or invalidElevationData
+     * where it is not known. Each elevation tile is looked up only once per call.
+     *
+     * Unlike height(), this never waits for tiles to be loaded: Tiles which are
+     * not in memory yet get loaded in the background, and updateAvailable() is
+     * emitted once they are ready. Until then, the coordinates covered by them
+     * have no height.
+     **/
+    QVector<qreal> heights( const QVector<GeoDataCoordinates> &coordinates ) const;
+
+    /**
+     * Returns the height at each node of @p lineString, see above.
+     **/
+    QVector<qreal> heights( const GeoDataLineString &lineString ) const;
+
 Q_SIGNALS:
     /**
      * Elevation tiles loaded. You will get more accurate results when querying height
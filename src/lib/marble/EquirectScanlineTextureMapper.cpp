@@ -22,6 +22,7 @@
 // Marble
 #include "GeoPainter.h"
 #include "MarbleDebug.h"
+#include "ScanlineRowScheduler.h"
 #include "ScanlineTextureMapperContext.h"
 #include "StackedTileLoader.h"
 #include "TextureColorizer.h"
@@ -29,10 +30,26 @@
 
 using namespace Marble;
 
+namespace
+{
+
+// The offsets are rounded to whole pixels so that moving the center by
+// some pixels moves the rendered texture by exactly the same amount.
+void centerOffsets( const ViewportParams *viewport, int &xCenterOffset, int &yCenterOffset )
+{
+    // Calculate how many degrees are being represented per pixel.
+    const qreal rad2Pixel = (qreal)( 2 * viewport->radius() ) / M_PI;
+
+    xCenterOffset = qRound( viewport->centerLongitude() * rad2Pixel );
+    yCenterOffset = (int)( viewport->centerLatitude() * rad2Pixel );
+}
+
+}
+
 class EquirectScanlineTextureMapper::RenderJob : public QRunnable
 {
 public:
-    RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewportParams, MapQuality mapQuality, int yTop, int yBottom );
+    RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewportParams, MapQuality mapQuality, int xStart, int xEnd, ScanlineRowScheduler *rowScheduler );
 
     virtual void run();
 
@@ -42,18 +59,20 @@ private:
     QImage *const m_canvasImage;
     const ViewportParams *const m_viewport;
     const MapQuality m_mapQuality;
-    const int m_yPaintedTop;
-    const int m_yPaintedBottom;
+    const int m_xStart;
+    const int m_xEnd;
+    ScanlineRowScheduler *const m_rowScheduler;
 };
 
-EquirectScanlineTextureMapper::RenderJob::RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, int yTop, int yBottom )
+EquirectScanlineTextureMapper::RenderJob::RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, int xStart, int xEnd, ScanlineRowScheduler *rowScheduler )
     : m_tileLoader( tileLoader ),
       m_tileLevel( tileLevel ),
       m_canvasImage( canvasImage ),
       m_viewport( viewport ),
       m_mapQuality( mapQuality ),
-      m_yPaintedTop( yTop ),
-      m_yPaintedBottom( yBottom )
+      m_xStart( xStart ),
+      m_xEnd( xEnd ),
+      m_rowScheduler( rowScheduler )
 {
 }
 
@@ -62,7 +81,13 @@ EquirectScanlineTextureMapper::EquirectScanlineTextureMapper( StackedTileLoader
     : TextureMapperInterface(),
       m_tileLoader( tileLoader ),
       m_radius( 0 ),
-      m_oldYPaintedTop( 0 )
+      m_oldYPaintedTop( 0 ),
+      m_oldYPaintedBottom( 0 ),
+      m_oldXCenterOffset( 0 ),
+      m_oldYCenterOffset( 0 ),
+      m_oldTileZoomLevel( -1 ),
+      m_oldMapQuality( NormalQuality ),
+      m_centerChanged( false )
 {
 }
 
@@ -87,6 +112,17 @@ void EquirectScanlineTextureMapper::mapTexture( GeoPainter *painter,
         m_repaintNeeded = true;
     }
 
+    // The colorized canvas can't be reused, as the colorizer works on
+    // the whole image.
+    if ( m_centerChanged && !m_repaintNeeded ) {
+        if ( texColorizer
+             || tileZoomLevel != m_oldTileZoomLevel
+             || painter->mapQuality() != m_oldMapQuality
+             || !scrollTexture( viewport, tileZoomLevel, painter->mapQuality() ) ) {
+            m_repaintNeeded = true;
+        }
+    }
+
     if ( m_repaintNeeded ) {
         mapTexture( viewport, tileZoomLevel, painter->mapQuality() );
 
@@ -97,9 +133,18 @@ void EquirectScanlineTextureMapper::mapTexture( GeoPainter *painter,
         m_repaintNeeded = false;
     }
 
+    m_centerChanged = false;
+    m_oldTileZoomLevel = tileZoomLevel;
+    m_oldMapQuality = painter->mapQuality();
+
     painter->drawImage( dirtyRect, m_canvasImage, dirtyRect );
 }
 
+void EquirectScanlineTextureMapper::setCenterChanged()
+{
+    m_centerChanged = true;
+}
+
 void EquirectScanlineTextureMapper::mapTexture( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality )
 {
     // Reset backend
@@ -109,17 +154,15 @@ void EquirectScanlineTextureMapper::mapTexture( const ViewportParams *viewport,
 
     const int imageHeight = m_canvasImage.height();
     const qint64  radius      = viewport->radius();
-    // Calculate how many degrees are being represented per pixel.
-    const float rad2Pixel = (float)( 2 * radius ) / M_PI;
 
     // Calculate translation of center point
-    const qreal centerLat = viewport->centerLatitude();
-
-    int yCenterOffset = (int)( centerLat * rad2Pixel );
+    int xCenterOffset = 0;
+    int yCenterOffset = 0;
+    centerOffsets( viewport, xCenterOffset, yCenterOffset );
 
     // Calculate y-range the represented by the center point, yTop and
     // what actually can be painted
-    const int yTop     = imageHeight / 2 - radius + yCenterOffset;;
+    const int yTop     = imageHeight / 2 - radius + yCenterOffset;
     int yPaintedTop    = imageHeight / 2 - radius + yCenterOffset;
     int yPaintedBottom = imageHeight / 2 + radius + yCenterOffset;
  
@@ -128,12 +171,10 @@ void EquirectScanlineTextureMapper::mapTexture( const ViewportParams *viewport,
     if (yPaintedBottom < 0)             yPaintedBottom = 0;
     if (yPaintedBottom > imageHeight) yPaintedBottom = imageHeight;
 
+    ScanlineRowScheduler rowScheduler( yPaintedTop, yPaintedBottom );
     const int numThreads = m_threadPool.maxThreadCount();
-    const int yStep = ( yPaintedBottom - yPaintedTop ) / numThreads;
     for ( int i = 0; i < numThreads; ++i ) {
-        const int yStart = yPaintedTop +  i      * yStep;
-        const int yEnd   = yPaintedTop + (i + 1) * yStep;
-        QRunnable *const job = new RenderJob( m_tileLoader, tileZoomLevel, &m_canvasImage, viewport, mapQuality, yStart, yEnd );
+        QRunnable *const job = new RenderJob( m_tileLoader, tileZoomLevel, &m_canvasImage, viewport, mapQuality, 0, m_canvasImage.width(), &rowScheduler );
         m_threadPool.start( job );
     }
 
@@ -151,8 +192,103 @@ void EquirectScanlineTextureMapper::mapTexture( const ViewportParams *viewport,
     m_threadPool.waitForDone();
 
     m_oldYPaintedTop = yPaintedTop;
+    m_oldYPaintedBottom = yPaintedBottom;
+    m_oldXCenterOffset = xCenterOffset;
+    m_oldYCenterOffset = yCenterOffset;
+
+    m_tileLoader->cleanupTilehash();
+}
+
+bool EquirectScanlineTextureMapper::scrollTexture( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality )
+{
+    const int imageWidth  = m_canvasImage.width();
+    const int imageHeight = m_canvasImage.height();
+    const qint64  radius  = viewport->radius();
+
+    int xCenterOffset = 0;
+    int yCenterOffset = 0;
+    centerOffsets( viewport, xCenterOffset, yCenterOffset );
+
+    // The map repeats itself every 4 * radius pixels horizontally,
+    // so take the shortest way around the dateline.
+    const int mapWidth = 4 * radius;
+    int dx = ( m_oldXCenterOffset - xCenterOffset ) % mapWidth;
+    if ( dx >= mapWidth / 2 )  dx -= mapWidth;
+    if ( dx < -mapWidth / 2 )  dx += mapWidth;
+    const int dy = yCenterOffset - m_oldYCenterOffset;
+
+    if ( qAbs( dx ) >= imageWidth || qAbs( dy ) >= imageHeight ) {
+        return false;
+    }
+
+    const int yPaintedTop    = qBound<int>( 0, imageHeight / 2 - radius + yCenterOffset, imageHeight );
+    const int yPaintedBottom = qBound<int>( 0, imageHeight / 2 + radius + yCenterOffset, imageHeight );
+
+    m_tileLoader->resetTilehash();
+
+    ScanlineTextureMapperContext::scrollCanvas( &m_canvasImage, dx, dy );
+
+    // Lines which still hold valid content after scrolling
+    const int yValidTop    = qMax( qMax( 0, dy ), qMax( m_oldYPaintedTop + dy, yPaintedTop ) );
+    const int yValidBottom = qMin( qMin( imageHeight, imageHeight + dy ), qMin( m_oldYPaintedBottom + dy, yPaintedBottom ) );
+
+    if ( yValidTop < yValidBottom ) {
+        mapRegion( viewport, tileZoomLevel, mapQuality, 0, imageWidth, yPaintedTop, yValidTop );
+        mapRegion( viewport, tileZoomLevel, mapQuality, 0, imageWidth, yValidBottom, yPaintedBottom );
+
+        const int xExposedStart = ( dx > 0 ) ? 0 : imageWidth + dx;
+        const int xExposedEnd   = ( dx > 0 ) ? dx : imageWidth;
+        mapRegion( viewport, tileZoomLevel, mapQuality, xExposedStart, xExposedEnd, yValidTop, yValidBottom );
+
+        // The scrolled content isn't mapped again, but its tiles are still
+        // on display and must not be removed from the tile hash.
+        const qreal pixel2Rad = M_PI / ( 2 * radius );
+        const int xValidStart = ( dx > 0 ) ? dx : 0;
+        const int xValidEnd   = ( dx > 0 ) ? imageWidth : imageWidth + dx;
+        const int yTop = imageHeight / 2 - radius + yCenterOffset;
+        ScanlineTextureMapperContext context( m_tileLoader, tileZoomLevel );
+        context.loadTiles( ( xCenterOffset - imageWidth / 2 + xValidStart ) * pixel2Rad,
+                           M_PI / 2 - ( yValidTop - yTop ) * pixel2Rad,
+                           ( xCenterOffset - imageWidth / 2 + xValidEnd - 1 ) * pixel2Rad,
+                           M_PI / 2 - ( yValidBottom - 1 - yTop ) * pixel2Rad );
+    }
+    else {
+        mapRegion( viewport, tileZoomLevel, mapQuality, 0, imageWidth, yPaintedTop, yPaintedBottom );
+    }
+
+    // Remove unused lines
+    for ( int y = 0; y < yPaintedTop; ++y ) {
+        memset( m_canvasImage.scanLine( y ), 0, imageWidth * sizeof( QRgb ) );
+    }
+    for ( int y = yPaintedBottom; y < imageHeight; ++y ) {
+        memset( m_canvasImage.scanLine( y ), 0, imageWidth * sizeof( QRgb ) );
+    }
+
+    m_oldYPaintedTop = yPaintedTop;
+    m_oldYPaintedBottom = yPaintedBottom;
+    m_oldXCenterOffset = xCenterOffset;
+    m_oldYCenterOffset = yCenterOffset;
 
     m_tileLoader->cleanupTilehash();
+
+    return true;
+}
+
+void EquirectScanlineTextureMapper::mapRegion( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality,
+                                               int xStart, int xEnd, int yStart, int yEnd )
+{
+    if ( xStart >= xEnd || yStart >= yEnd ) {
+        return;
+    }
+
+    ScanlineRowScheduler rowScheduler( yStart, yEnd );
+    const int numThreads = m_threadPool.maxThreadCount();
+    for ( int i = 0; i < numThreads; ++i ) {
+        QRunnable *const job = new RenderJob( m_tileLoader, tileZoomLevel, &m_canvasImage, viewport, mapQuality, xStart, xEnd, &rowScheduler );
+        m_threadPool.start( job );
+    }
+
+    m_threadPool.waitForDone();
 }
 
 void EquirectScanlineTextureMapper::RenderJob::run()
@@ -175,18 +311,17 @@ void EquirectScanlineTextureMapper::RenderJob::run()
     const int n = ScanlineTextureMapperContext::interpolationStep( m_viewport, m_mapQuality );
 
     // Calculate translation of center point
-    const qreal centerLon = m_viewport->centerLongitude();
-    const qreal centerLat = m_viewport->centerLatitude();
-
-    const int yCenterOffset = (int)( centerLat * rad2Pixel );
+    int xCenterOffset = 0;
+    int yCenterOffset = 0;
+    centerOffsets( m_viewport, xCenterOffset, yCenterOffset );
 
     const int yTop = imageHeight / 2 - radius + yCenterOffset;
 
-    qreal leftLon = + centerLon - ( imageWidth / 2 * pixel2Rad );
+    qreal leftLon = ( xCenterOffset - imageWidth / 2 + m_xStart ) * pixel2Rad;
     while ( leftLon < -M_PI ) leftLon += 2 * M_PI;
     while ( leftLon >  M_PI ) leftLon -= 2 * M_PI;
 
-    const int maxInterpolationPointX = n * (int)( imageWidth / n - 1 ) + 1;
+    const int maxInterpolationPointX = m_xStart + n * (int)( ( m_xEnd - m_xStart ) / n - 1 ) + 1;
 
 
     // initialize needed variables that are modified during texture mapping:
@@ -196,58 +331,62 @@ void EquirectScanlineTextureMapper::RenderJob::run()
 
     // Scanline based algorithm to do texture mapping
 
-    for ( int y = m_yPaintedTop; y < m_yPaintedBottom; ++y ) {
-
-        QRgb * scanLine = (QRgb*)( m_canvasImage->scanLine( y ) );
-
-        qreal lon = leftLon;
-        const qreal lat = M_PI/2 - (y - yTop )* pixel2Rad;
-
-        for ( int x = 0; x < imageWidth; ++x ) {
-
-            // Prepare for interpolation
-            bool interpolate = false;
-            if ( x > 0 && x <= maxInterpolationPointX ) {
-                x += n - 1;
-                lon += (n - 1) * pixel2Rad;
-                interpolate = !printQuality;
-            }
-            else {
-                interpolate = false;
+    int yStart = 0;
+    int yEnd = 0;
+    while ( m_rowScheduler->nextChunk( yStart, yEnd ) ) {
+        for ( int y = yStart; y < yEnd; ++y ) {
+
+            QRgb * scanLine = (QRgb*)( m_canvasImage->scanLine( y ) ) + m_xStart;
+
+            qreal lon = leftLon;
+            const qreal lat = M_PI/2 - (y - yTop )* pixel2Rad;
+
+            for ( int x = m_xStart; x < m_xEnd; ++x ) {
+
+                // Prepare for interpolation
+                bool interpolate = false;
+                if ( x > m_xStart && x <= maxInterpolationPointX ) {
+                    x += n - 1;
+                    lon += (n - 1) * pixel2Rad;
+                    interpolate = !printQuality;
+                }
+                else {
+                    interpolate = false;
+                }
+
+                if ( lon < -M_PI ) lon += 2 * M_PI;
+                if ( lon >  M_PI ) lon -= 2 * M_PI;
+
+                if ( interpolate ) {
+                    if (highQuality)
+                        context.pixelValueApproxF( lon, lat, scanLine, n );
+                    else
+                        context.pixelValueApprox( lon, lat, scanLine, n );
+
+                    scanLine += ( n - 1 );
+                }
+
+                if ( x < m_xEnd ) {
+                    if ( highQuality )
+                        context.pixelValueF( lon, lat, scanLine );
+                    else
+                        context.pixelValue( lon, lat, scanLine );
+                }
+
+                ++scanLine;
+                lon += pixel2Rad;
             }
 
-            if ( lon < -M_PI ) lon += 2 * M_PI;
-            if ( lon >  M_PI ) lon -= 2 * M_PI;
+            // copy scanline to improve performance
+            if ( interlaced && y + 1 < yEnd ) { 
 
-            if ( interpolate ) {
-                if (highQuality)
-                    context.pixelValueApproxF( lon, lat, scanLine, n );
-                else
-                    context.pixelValueApprox( lon, lat, scanLine, n );
+                const int pixelByteSize = m_canvasImage->bytesPerLine() / imageWidth;
 
-                scanLine += ( n - 1 );
+                memcpy( m_canvasImage->scanLine( y + 1 ) + m_xStart * pixelByteSize,
+                        m_canvasImage->scanLine( y     ) + m_xStart * pixelByteSize,
+                        ( m_xEnd - m_xStart ) * pixelByteSize );
+                ++y;
             }
-
-            if ( x < imageWidth ) {
-                if ( highQuality )
-                    context.pixelValueF( lon, lat, scanLine );
-                else
-                    context.pixelValue( lon, lat, scanLine );
-            }
-
-            ++scanLine;
-            lon += pixel2Rad;
-        }
-
-        // copy scanline to improve performance
-        if ( interlaced && y + 1 < m_yPaintedBottom ) { 
-
-            const int pixelByteSize = m_canvasImage->bytesPerLine() / imageWidth;
-
-            memcpy( m_canvasImage->scanLine( y + 1 ),
-                    m_canvasImage->scanLine( y     ),
-                    imageWidth * pixelByteSize );
-            ++y;
         }
     }
 }
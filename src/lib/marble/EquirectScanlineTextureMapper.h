@@ -36,9 +36,21 @@ class EquirectScanlineTextureMapper : public TextureMapperInterface
                              const QRect &dirtyRect,
                              TextureColorizer *texColorizer );
 
+    virtual void setCenterChanged();
+
  private:
     void mapTexture( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality );
 
+    /**
+     * Moves the previous canvas content by the distance the center moved and
+     * only maps the newly exposed areas. Returns false if nothing of the previous
+     * canvas can be reused.
+     */
+    bool scrollTexture( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality );
+
+    void mapRegion( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality,
+                    int xStart, int xEnd, int yStart, int yEnd );
+
  private:
     class RenderJob;
 
@@ -46,6 +58,12 @@ class EquirectScanlineTextureMapper : public TextureMapperInterface
     int m_radius;
     QImage m_canvasImage;
     int    m_oldYPaintedTop;
+    int    m_oldYPaintedBottom;
+    int    m_oldXCenterOffset;
+    int    m_oldYCenterOffset;
+    int    m_oldTileZoomLevel;
+    MapQuality m_oldMapQuality;
+    bool   m_centerChanged;
     QThreadPool m_threadPool;
 };
 
@@ -13,8 +13,10 @@
 #include <QBuffer>
 #include <QDataStream>
 #include <QFile>
+#include <QFileInfo>
 #include <QThread>
 
+#include "DocumentSnapshot.h"
 #include "GeoDataParser.h"
 #include "GeoDataDocument.h"
 #include "GeoDataFolder.h"
@@ -163,6 +165,19 @@ void FileLoader::run()
             }
         }
 
+        // A snapshot at least as recent as the source saves parsing it
+        const QFileInfo snapshotInfo( DocumentSnapshot::snapshotFileName( defaultSourceName ) );
+        if ( snapshotInfo.exists() && snapshotInfo.lastModified() >= QFileInfo( defaultSourceName ).lastModified() ) {
+            QString error;
+            GeoDataDocument *document = DocumentSnapshot::read( snapshotInfo.filePath(), error );
+            if ( document ) {
+                document->setFileName( defaultSourceName );
+                document->setDocumentRole( d->m_documentRole );
+                d->documentParsed( document, QString() );
+                return;
+            }
+        }
+
         if ( QFile::exists( defaultSourceName ) ) {
             mDebug() << "No recent Default Placemark Cache File available!";
 
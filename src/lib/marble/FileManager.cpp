@@ -11,13 +11,17 @@
 
 #include "FileManager.h"
 
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QSet>
 #include <QTime>
+#include <QTimer>
 #include <QMessageBox>
 
 #include "FileLoader.h"
 #include "MarbleDebug.h"
 #include "MarbleModel.h"
+#include "MarblePlacemarkModel.h"
 #include "GeoDataTreeModel.h"
 
 #include "GeoDataDocument.h"
@@ -31,6 +35,12 @@ using namespace Marble;
 
 namespace Marble
 {
+
+// Large documents are added to the tree model in batches of this many features,
+// and adding batches pauses for the event loop after this many milliseconds.
+static const int ingestionBatchSize = 500;
+static const int ingestionTimeBudget = 20;
+
 class FileManagerPrivate
 {
 public:
@@ -39,6 +49,8 @@ public:
         m_treeModel( treeModel ),
         m_pluginManager( pluginManager )
     {
+        m_ingestionTimer.setSingleShot( true );
+        m_ingestionTimer.setInterval( 0 );
     }
 
     ~FileManagerPrivate()
@@ -48,11 +60,31 @@ public:
                 loader->wait();
             }
         }
+        foreach ( const PendingFeatures &pending, m_pendingFeatures ) {
+            qDeleteAll( pending.features );
+        }
     }
 
+    /**
+     * Features of a large document that are not part of the tree model yet.
+     * They have been taken out of @p parent and are appended to it again
+     * by addPendingFeatures().
+     */
+    struct PendingFeatures
+    {
+        GeoDataDocument *document;
+        GeoDataContainer *parent;
+        QVector<GeoDataFeature*> features;
+    };
+
     void appendLoader( FileLoader *loader );
     void closeFile( const QString &key );
     void cleanupLoader( FileLoader *loader );
+    void queueFeatures( GeoDataDocument *document, GeoDataContainer *container );
+    void removePendingFeatures( GeoDataDocument *document );
+    void restorePendingFeatures( const QModelIndex &parent, int first, int last );
+    void addPendingFeatures();
+    static int featureCount( const GeoDataContainer *container );
 
     FileManager *const q;
     GeoDataTreeModel *const m_treeModel;
@@ -62,6 +94,10 @@ public:
     QHash < QString, GeoDataDocument* > m_fileItemHash;
     GeoDataLatLonBox m_latLonBox;
     QTime m_timer;
+
+    QList<PendingFeatures> m_pendingFeatures;
+    QHash<GeoDataDocument*, QString> m_ingestedDocuments;
+    QTimer m_ingestionTimer;
 };
 }
 
@@ -69,6 +105,9 @@ FileManager::FileManager( GeoDataTreeModel *treeModel, const PluginManager *plug
     : QObject( parent )
     , d( new FileManagerPrivate( treeModel, pluginManager, this ) )
 {
+    connect( &d->m_ingestionTimer, SIGNAL(timeout()), this, SLOT(addPendingFeatures()) );
+    connect( treeModel, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+             this, SLOT(restorePendingFeatures(QModelIndex,int,int)) );
 }
 
 
@@ -134,6 +173,7 @@ void FileManagerPrivate::closeFile( const QString& key )
     mDebug() << "FileManager::closeFile " << key;
     if( m_fileItemHash.contains( key ) ) {
         GeoDataDocument *doc = m_fileItemHash.value( key );
+        removePendingFeatures( doc );
         m_treeModel->removeDocument( doc );
         emit q->fileRemoved( key );
         delete doc;
@@ -182,7 +222,7 @@ GeoDataDocument * FileManager::at( const QString &key )
 
 int FileManager::pendingFiles() const
 {
-    return d->m_loaderList.size();
+    return d->m_loaderList.size() + d->m_ingestedDocuments.size();
 }
 
 void FileManagerPrivate::cleanupLoader( FileLoader* loader )
@@ -196,12 +236,22 @@ void FileManagerPrivate::cleanupLoader( FileLoader* loader )
                 QFileInfo file( doc->fileName() );
                 doc->setName( file.baseName() );
             }
-            m_treeModel->addDocument( doc );
-            m_fileItemHash.insert( loader->path(), doc );
-            emit q->fileAdded( loader->path() );
             if( loader->recenter() ) {
                 m_latLonBox |= doc->latLonAltBox();
             }
+            m_fileItemHash.insert( loader->path(), doc );
+            if ( featureCount( doc ) > ingestionBatchSize ) {
+                // Add the document empty and its features in batches later, so
+                // that the models and layers don't block the event loop for a
+                // long time and the map shows the data while it is being added.
+                queueFeatures( doc, doc );
+                m_ingestedDocuments.insert( doc, loader->path() );
+                m_treeModel->addDocument( doc );
+                m_ingestionTimer.start();
+            } else {
+                m_treeModel->addDocument( doc );
+                emit q->fileAdded( loader->path() );
+            }
         }
         if ( !loader->error().isEmpty() ) {
             QMessageBox errorBox;
@@ -224,4 +274,122 @@ void FileManagerPrivate::cleanupLoader( FileLoader* loader )
     }
 }
 
+int FileManagerPrivate::featureCount( const GeoDataContainer *container )
+{
+    int count = container->size();
+    foreach ( const GeoDataFeature *feature, container->featureList() ) {
+        if ( const GeoDataContainer *child = dynamic_cast<const GeoDataContainer*>( feature ) ) {
+            count += featureCount( child );
+        }
+    }
+    return count;
+}
+
+void FileManagerPrivate::queueFeatures( GeoDataDocument *document, GeoDataContainer *container )
+{
+    const QVector<GeoDataFeature*> features = container->featureList();
+    container->remove( 0, features.size() );
+
+    for ( int i = 0; i < features.size(); i += ingestionBatchSize ) {
+        PendingFeatures pending;
+        pending.document = document;
+        pending.parent = container;
+        pending.features = features.mid( i, ingestionBatchSize );
+        m_pendingFeatures.append( pending );
+    }
+
+    // Children are queued after their parent, so that they are always added below an existing index
+    foreach ( GeoDataFeature *feature, features ) {
+        if ( GeoDataContainer *child = dynamic_cast<GeoDataContainer*>( feature ) ) {
+            queueFeatures( document, child );
+        }
+    }
+}
+
+void FileManagerPrivate::removePendingFeatures( GeoDataDocument *document )
+{
+    if ( !m_ingestedDocuments.contains( document ) ) {
+        return;
+    }
+
+    QList<PendingFeatures>::iterator it = m_pendingFeatures.begin();
+    while ( it != m_pendingFeatures.end() ) {
+        if ( it->document == document ) {
+            qDeleteAll( it->features );
+            it = m_pendingFeatures.erase( it );
+        } else {
+            ++it;
+        }
+    }
+    m_ingestedDocuments.remove( document );
+}
+
+void FileManagerPrivate::restorePendingFeatures( const QModelIndex &parent, int first, int last )
+{
+    if ( m_pendingFeatures.isEmpty() ) {
+        return;
+    }
+
+    QSet<const GeoDataObject*> removedObjects;
+    for ( int row = first; row <= last; ++row ) {
+        const QModelIndex index = m_treeModel->index( row, 0, parent );
+        removedObjects.insert( qvariant_cast<GeoDataObject*>( index.data( MarblePlacemarkModel::ObjectPointerRole ) ) );
+    }
+
+    // The pending features below a removed container are appended to their
+    // parents right away, as the container may be deleted or added again
+    // along with all of its features.
+    QList<PendingFeatures>::iterator it = m_pendingFeatures.begin();
+    while ( it != m_pendingFeatures.end() ) {
+        bool removed = false;
+        for ( const GeoDataObject *object = it->parent; object && !removed; object = object->parent() ) {
+            removed = removedObjects.contains( object );
+        }
+
+        if ( removed ) {
+            foreach ( GeoDataFeature *feature, it->features ) {
+                it->parent->append( feature );
+            }
+            if ( removedObjects.contains( it->document ) ) {
+                m_ingestedDocuments.remove( it->document );
+            }
+            it = m_pendingFeatures.erase( it );
+        } else {
+            ++it;
+        }
+    }
+
+    // addPendingFeatures() finishes the documents without pending features
+    m_ingestionTimer.start();
+}
+
+void FileManagerPrivate::addPendingFeatures()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while ( !m_pendingFeatures.isEmpty() && timer.elapsed() < ingestionTimeBudget ) {
+        const PendingFeatures pending = m_pendingFeatures.takeFirst();
+        m_treeModel->addFeatures( pending.parent, pending.features );
+    }
+
+    // The receivers of the model signals may have closed documents or removed
+    // containers meanwhile, so finished documents are looked up afterwards.
+    QSet<GeoDataDocument*> pendingDocuments;
+    foreach ( const PendingFeatures &pending, m_pendingFeatures ) {
+        pendingDocuments.insert( pending.document );
+    }
+    foreach ( GeoDataDocument *document, m_ingestedDocuments.keys() ) {
+        if ( m_ingestedDocuments.contains( document ) && !pendingDocuments.contains( document ) ) {
+            const QString key = m_ingestedDocuments.take( document );
+            mDebug() << "Finished adding" << key << m_timer.elapsed();
+            emit q->fileAdded( key );
+        }
+    }
+
+    if ( !m_pendingFeatures.isEmpty() ) {
+        m_ingestionTimer.start();
+    }
+}
+
 #include "moc_FileManager.cpp"
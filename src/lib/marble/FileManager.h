@@ -84,6 +84,8 @@ class FileManager : public QObject
  private:
 
     Q_PRIVATE_SLOT( d, void cleanupLoader( FileLoader *loader ) )
+    Q_PRIVATE_SLOT( d, void restorePendingFeatures( const QModelIndex &parent, int first, int last ) )
+    Q_PRIVATE_SLOT( d, void addPendingFeatures() )
 
     Q_DISABLE_COPY( FileManager )
 
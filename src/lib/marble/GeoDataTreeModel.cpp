@@ -814,6 +814,32 @@ int GeoDataTreeModel::addFeature( GeoDataContainer *parent, GeoDataFeature *feat
     return row; //-1 if it failed, the relative index otherwise.
 }
 
+int GeoDataTreeModel::addFeatures( GeoDataContainer *parent, const QVector<GeoDataFeature*> &features )
+{
+    if ( !parent || features.isEmpty() ) {
+        qWarning() << "Null pointer or no features in call to GeoDataTreeModel::addFeatures (parent " << parent << ")";
+        return -1;
+    }
+
+    QModelIndex modelindex = index( parent );
+    if ( parent != d->m_rootDocument && !modelindex.isValid() ) {
+        qWarning() << "GeoDataTreeModel::addFeatures (parent " << parent << ") : parent not found on the TreeModel";
+        return -1;
+    }
+
+    int const row = parent->size();
+    beginInsertRows( modelindex, row, row + features.size() - 1 );
+    foreach ( GeoDataFeature *feature, features ) {
+        parent->append( feature );
+    }
+    endInsertRows();
+
+    foreach ( GeoDataFeature *feature, features ) {
+        emit added( feature );
+    }
+    return row;
+}
+
 int GeoDataTreeModel::addDocument( GeoDataDocument *document )
 {
     return addFeature( d->m_rootDocument, document );
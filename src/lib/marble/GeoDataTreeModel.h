@@ -14,6 +14,7 @@
 #include "marble_export.h"
 
 #include <QAbstractItemModel>
+#include <QVector>
 
 class QItemSelectionModel;
 
@@ -88,6 +89,13 @@ public Q_SLOTS:
 
     int addFeature( GeoDataContainer *parent, GeoDataFeature *feature, int row = -1 );
 
+    /**
+      * Appends @p features to @p parent with a single row insertion. This is
+      * much cheaper than adding them one by one when many features are added.
+      * @return the row of the first added feature, or -1 if it failed
+      */
+    int addFeatures( GeoDataContainer *parent, const QVector<GeoDataFeature*> &features );
+
     bool removeFeature( GeoDataContainer *parent, int index );
 
     int removeFeature( const GeoDataFeature *feature );
@@ -0,0 +1,578 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "GeoGraphicsItemIndex.h"
+
+#include "GeoDataLatLonBox.h"
+#include "GeoGraphicsItem.h"
+#include "MarbleDebug.h"
+
+#include <QHash>
+#include <QSet>
+#include <QTime>
+#include <QVector>
+#include <QtMath>
+
+#include <algorithm>
+#include <climits>
+
+namespace Marble
+{
+
+namespace
+{
+
+/** The maximum number of entries or children of a node */
+const int MaxNodeSize = 16;
+
+/** A box in radians which does not cross the date line, i.e. west <= east */
+struct Rect
+{
+    qreal west;
+    qreal south;
+    qreal east;
+    qreal north;
+
+    bool intersects( const Rect &other ) const
+    {
+        return west <= other.east && other.west <= east
+            && south <= other.north && other.south <= north;
+    }
+
+    void unite( const Rect &other )
+    {
+        west = qMin( west, other.west );
+        south = qMin( south, other.south );
+        east = qMax( east, other.east );
+        north = qMax( north, other.north );
+    }
+
+    qreal area() const
+    {
+        return ( east - west ) * ( north - south );
+    }
+
+    bool operator==( const Rect &other ) const
+    {
+        return west == other.west && south == other.south
+            && east == other.east && north == other.north;
+    }
+};
+
+/**
+ * Converts the given box to rects, splitting it at the date line if it
+ * crosses it. Returns the number of rects written to @p rects, which has
+ * to provide space for two of them.
+ */
+int toRects( qreal west, qreal south, qreal east, qreal north, Rect *rects )
+{
+    if ( west > east ) {
+        Rect const eastern = { west, south, M_PI, north };
+        Rect const western = { -M_PI, south, east, north };
+        rects[0] = eastern;
+        rects[1] = western;
+        return 2;
+    }
+
+    Rect const rect = { west, south, east, north };
+    rects[0] = rect;
+    return 1;
+}
+
+struct Entry
+{
+    Rect rect;
+    GeoGraphicsItem *item;
+    int minZoomLevel;
+    /** Whether the item is stored in two entries since its box crosses the date line */
+    bool split;
+};
+
+struct Node
+{
+    explicit Node( bool isLeaf ) :
+        minZoomLevel( INT_MAX ),
+        leaf( isLeaf )
+    {
+        rect.west = rect.south = rect.east = rect.north = 0.0;
+    }
+
+    ~Node()
+    {
+        qDeleteAll( children );
+    }
+
+    bool isEmpty() const
+    {
+        return leaf ? entries.isEmpty() : children.isEmpty();
+    }
+
+    /** Recalculates the bounding box and the minimum zoom level from the content */
+    void update();
+
+    Rect rect;
+    /** The smallest minimum zoom level of all items below this node */
+    int minZoomLevel;
+    bool leaf;
+    QVector<Node *> children;
+    QVector<Entry> entries;
+};
+
+const Rect &rectOf( const Entry &entry )
+{
+    return entry.rect;
+}
+
+const Rect &rectOf( const Node *node )
+{
+    return node->rect;
+}
+
+int minZoomLevelOf( const Entry &entry )
+{
+    return entry.minZoomLevel;
+}
+
+int minZoomLevelOf( const Node *node )
+{
+    return node->minZoomLevel;
+}
+
+template<class T>
+QVector<T> &contentOf( Node *node );
+
+template<>
+QVector<Entry> &contentOf<Entry>( Node *node )
+{
+    return node->entries;
+}
+
+template<>
+QVector<Node *> &contentOf<Node *>( Node *node )
+{
+    return node->children;
+}
+
+template<class T>
+bool lessByLongitude( const T &one, const T &two )
+{
+    return rectOf( one ).west + rectOf( one ).east < rectOf( two ).west + rectOf( two ).east;
+}
+
+template<class T>
+bool lessByLatitude( const T &one, const T &two )
+{
+    return rectOf( one ).south + rectOf( one ).north < rectOf( two ).south + rectOf( two ).north;
+}
+
+template<class T>
+void bounds( const QVector<T> &content, Rect &rect, int &minZoomLevel )
+{
+    minZoomLevel = INT_MAX;
+    for ( int i = 0; i < content.size(); ++i ) {
+        if ( i == 0 ) {
+            rect = rectOf( content[i] );
+        } else {
+            rect.unite( rectOf( content[i] ) );
+        }
+        minZoomLevel = qMin( minZoomLevel, minZoomLevelOf( content[i] ) );
+    }
+}
+
+void Node::update()
+{
+    if ( leaf ) {
+        bounds( entries, rect, minZoomLevel );
+    } else {
+        bounds( children, rect, minZoomLevel );
+    }
+}
+
+/**
+ * Moves half of the content of the overfull @p node into a new sibling,
+ * splitting along the axis in which the node extends most.
+ */
+template<class T>
+Node *split( Node *node )
+{
+    QVector<T> &content = contentOf<T>( node );
+    if ( node->rect.east - node->rect.west >= node->rect.north - node->rect.south ) {
+        std::sort( content.begin(), content.end(), lessByLongitude<T> );
+    } else {
+        std::sort( content.begin(), content.end(), lessByLatitude<T> );
+    }
+
+    Node *sibling = new Node( node->leaf );
+    int const half = content.size() / 2;
+    contentOf<T>( sibling ) = content.mid( half );
+    content.resize( half );
+    sibling->update();
+    return sibling;
+}
+
+/**
+ * Packs @p content into nodes of up to MaxNodeSize elements each, which are
+ * arranged in vertical slices of similar longitude (Sort-Tile-Recursive).
+ */
+template<class T>
+QVector<Node *> pack( QVector<T> &content, bool leaf )
+{
+    int const nodeCount = ( content.size() + MaxNodeSize - 1 ) / MaxNodeSize;
+    int const sliceSize = qCeil( qSqrt( nodeCount ) ) * MaxNodeSize;
+
+    QVector<Node *> result;
+    result.reserve( nodeCount );
+
+    std::sort( content.begin(), content.end(), lessByLongitude<T> );
+    for ( int slice = 0; slice < content.size(); slice += sliceSize ) {
+        int const sliceEnd = qMin( slice + sliceSize, content.size() );
+        std::sort( content.begin() + slice, content.begin() + sliceEnd, lessByLatitude<T> );
+        for ( int begin = slice; begin < sliceEnd; begin += MaxNodeSize ) {
+            int const end = qMin( begin + MaxNodeSize, sliceEnd );
+            Node *node = new Node( leaf );
+            contentOf<T>( node ) = content.mid( begin, end - begin );
+            node->update();
+            result << node;
+        }
+    }
+
+    return result;
+}
+
+}
+
+class Q_DECL_HIDDEN GeoGraphicsItemIndex::Private
+{
+ public:
+    /** What the index knows about an item */
+    struct Key
+    {
+        Rect rects[2];
+        int rectCount;
+        int minZoomLevel;
+        /** Whether the item has not been moved into the tree yet */
+        bool pending;
+    };
+
+    Private();
+
+    ~Private();
+
+    /** Moves the pending items into the tree */
+    void flush();
+
+    void bulkLoad();
+
+    void insert( const Entry &entry );
+
+    /** Inserts @p entry below @p node and returns the new sibling if @p node had to be split */
+    Node *insert( Node *node, const Entry &entry );
+
+    Node *chooseChild( const Node *node, const Rect &rect ) const;
+
+    bool remove( Node *node, GeoGraphicsItem *item, const Rect &rect );
+
+    void collect( const Node *node, const Rect &rect, int zoomLevel, bool dedupe,
+                  QSet<GeoGraphicsItem *> &seen, QList<GeoGraphicsItem *> &result ) const;
+
+    static Entry entry( GeoGraphicsItem *item, const Key &key, int index );
+
+    Node *m_root;
+
+    QHash<GeoGraphicsItem *, Key> m_keys;
+
+    /** Items which have been inserted, but not moved into the tree yet. May contain removed items. */
+    QVector<GeoGraphicsItem *> m_pending;
+};
+
+GeoGraphicsItemIndex::Private::Private() :
+    m_root( 0 )
+{
+    // nothing to do
+}
+
+GeoGraphicsItemIndex::Private::~Private()
+{
+    delete m_root;
+}
+
+Entry GeoGraphicsItemIndex::Private::entry( GeoGraphicsItem *item, const Key &key, int index )
+{
+    Entry const result = { key.rects[index], item, key.minZoomLevel, key.rectCount > 1 };
+    return result;
+}
+
+void GeoGraphicsItemIndex::Private::flush()
+{
+    if ( m_pending.isEmpty() ) {
+        return;
+    }
+
+    // Inserting items one by one results in overlapping nodes, so rebuild
+    // the whole tree if a significant share of the items is new, e.g. after
+    // loading a file
+    if ( m_pending.size() * 4 > m_keys.size() ) {
+        bulkLoad();
+        return;
+    }
+
+    foreach ( GeoGraphicsItem *item, m_pending ) {
+        QHash<GeoGraphicsItem *, Key>::iterator key = m_keys.find( item );
+        if ( key != m_keys.end() && key->pending ) {
+            key->pending = false;
+            for ( int i = 0; i < key->rectCount; ++i ) {
+                insert( entry( item, *key, i ) );
+            }
+        }
+    }
+    m_pending.clear();
+}
+
+void GeoGraphicsItemIndex::Private::bulkLoad()
+{
+    QTime t;
+    t.start();
+
+    QVector<Entry> entries;
+    entries.reserve( m_keys.size() );
+    QHash<GeoGraphicsItem *, Key>::iterator const end = m_keys.end();
+    for ( QHash<GeoGraphicsItem *, Key>::iterator key = m_keys.begin(); key != end; ++key ) {
+        key->pending = false;
+        for ( int i = 0; i < key->rectCount; ++i ) {
+            entries << entry( key.key(), *key, i );
+        }
+    }
+    m_pending.clear();
+
+    delete m_root;
+    m_root = 0;
+    if ( entries.isEmpty() ) {
+        return;
+    }
+
+    QVector<Node *> nodes = pack( entries, true );
+    while ( nodes.size() > 1 ) {
+        nodes = pack( nodes, false );
+    }
+    m_root = nodes.first();
+
+    mDebug() << "Indexed" << m_keys.size() << "graphics items in" << t.elapsed() << "ms";
+}
+
+void GeoGraphicsItemIndex::Private::insert( const Entry &entry )
+{
+    if ( !m_root ) {
+        m_root = new Node( true );
+    }
+
+    Node *sibling = insert( m_root, entry );
+    if ( sibling ) {
+        Node *root = new Node( false );
+        root->children << m_root << sibling;
+        root->update();
+        m_root = root;
+    }
+}
+
+Node *GeoGraphicsItemIndex::Private::insert( Node *node, const Entry &entry )
+{
+    Node *sibling = 0;
+    if ( node->leaf ) {
+        node->entries << entry;
+        if ( node->entries.size() > MaxNodeSize ) {
+            sibling = split<Entry>( node );
+        }
+    } else {
+        Node *const childSibling = insert( chooseChild( node, entry.rect ), entry );
+        if ( childSibling ) {
+            node->children << childSibling;
+            if ( node->children.size() > MaxNodeSize ) {
+                sibling = split<Node *>( node );
+            }
+        }
+    }
+
+    node->update();
+    return sibling;
+}
+
+Node *GeoGraphicsItemIndex::Private::chooseChild( const Node *node, const Rect &rect ) const
+{
+    // Choose the child which needs the least enlargement, and the smallest one on ties
+    Node *result = 0;
+    qreal minEnlargement = 0.0;
+    qreal minArea = 0.0;
+    foreach ( Node *child, node->children ) {
+        Rect united = child->rect;
+        united.unite( rect );
+        qreal const area = child->rect.area();
+        qreal const enlargement = united.area() - area;
+        if ( !result || enlargement < minEnlargement || ( enlargement == minEnlargement && area < minArea ) ) {
+            result = child;
+            minEnlargement = enlargement;
+            minArea = area;
+        }
+    }
+
+    return result;
+}
+
+bool GeoGraphicsItemIndex::Private::remove( Node *node, GeoGraphicsItem *item, const Rect &rect )
+{
+    if ( !node->rect.intersects( rect ) ) {
+        return false;
+    }
+
+    bool removed = false;
+    if ( node->leaf ) {
+        for ( int i = 0; i < node->entries.size(); ++i ) {
+            if ( node->entries[i].item == item && node->entries[i].rect == rect ) {
+                node->entries.remove( i );
+                removed = true;
+                break;
+            }
+        }
+    } else {
+        for ( int i = 0; i < node->children.size(); ++i ) {
+            Node *child = node->children[i];
+            if ( remove( child, item, rect ) ) {
+                // Underfull nodes are kept, only empty ones are dropped
+                if ( child->isEmpty() ) {
+                    node->children.remove( i );
+                    delete child;
+                }
+                removed = true;
+                break;
+            }
+        }
+    }
+
+    if ( removed ) {
+        node->update();
+    }
+    return removed;
+}
+
+void GeoGraphicsItemIndex::Private::collect( const Node *node, const Rect &rect, int zoomLevel, bool dedupe,
+                                             QSet<GeoGraphicsItem *> &seen, QList<GeoGraphicsItem *> &result ) const
+{
+    if ( node->minZoomLevel > zoomLevel || !node->rect.intersects( rect ) ) {
+        return;
+    }
+
+    if ( !node->leaf ) {
+        foreach ( const Node *child, node->children ) {
+            collect( child, rect, zoomLevel, dedupe, seen, result );
+        }
+        return;
+    }
+
+    foreach ( const Entry &entry, node->entries ) {
+        if ( entry.minZoomLevel <= zoomLevel && entry.rect.intersects( rect ) && entry.item->visible() ) {
+            if ( dedupe || entry.split ) {
+                int const size = seen.size();
+                seen.insert( entry.item );
+                if ( seen.size() == size ) {
+                    continue;
+                }
+            }
+            result << entry.item;
+        }
+    }
+}
+
+GeoGraphicsItemIndex::GeoGraphicsItemIndex() :
+    d( new Private )
+{
+    // nothing to do
+}
+
+GeoGraphicsItemIndex::~GeoGraphicsItemIndex()
+{
+    delete d;
+}
+
+void GeoGraphicsItemIndex::insert( GeoGraphicsItem *item )
+{
+    remove( item );
+
+    qreal north, south, east, west;
+    item->latLonAltBox().boundaries( north, south, east, west );
+    Private::Key key;
+    key.rectCount = toRects( west, south, east, north, key.rects );
+    key.minZoomLevel = item->minZoomLevel();
+    key.pending = true;
+
+    d->m_keys.insert( item, key );
+    d->m_pending << item;
+}
+
+bool GeoGraphicsItemIndex::remove( GeoGraphicsItem *item )
+{
+    QHash<GeoGraphicsItem *, Private::Key>::iterator const key = d->m_keys.find( item );
+    if ( key == d->m_keys.end() ) {
+        return false;
+    }
+
+    // Pending items are not in the tree yet, flush() skips them once they are gone
+    if ( !key->pending ) {
+        for ( int i = 0; i < key->rectCount; ++i ) {
+            d->remove( d->m_root, item, key->rects[i] );
+        }
+
+        if ( d->m_root->isEmpty() ) {
+            delete d->m_root;
+            d->m_root = 0;
+        } else if ( !d->m_root->leaf && d->m_root->children.size() == 1 ) {
+            Node *const root = d->m_root->children.first();
+            d->m_root->children.clear();
+            delete d->m_root;
+            d->m_root = root;
+        }
+    }
+
+    d->m_keys.erase( key );
+    return true;
+}
+
+void GeoGraphicsItemIndex::clear()
+{
+    delete d->m_root;
+    d->m_root = 0;
+    d->m_keys.clear();
+    d->m_pending.clear();
+}
+
+int GeoGraphicsItemIndex::size() const
+{
+    return d->m_keys.size();
+}
+
+QList<GeoGraphicsItem *> GeoGraphicsItemIndex::items( const GeoDataLatLonBox &box, int zoomLevel ) const
+{
+    d->flush();
+
+    QList<GeoGraphicsItem *> result;
+    if ( !d->m_root ) {
+        return result;
+    }
+
+    Rect rects[2];
+    int const rectCount = toRects( box.west(), box.south(), box.east(), box.north(), rects );
+
+    // An item may intersect both halves of a box crossing the date line
+    bool const dedupe = rectCount > 1;
+    QSet<GeoGraphicsItem *> seen;
+    for ( int i = 0; i < rectCount; ++i ) {
+        d->collect( d->m_root, rects[i], zoomLevel, dedupe, seen, result );
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,82 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_GEOGRAPHICSITEMINDEX_H
+#define MARBLE_GEOGRAPHICSITEMINDEX_H
+
+#include <QList>
+#include <QtGlobal>
+
+namespace Marble
+{
+
+class GeoDataLatLonBox;
+class GeoGraphicsItem;
+
+/**
+ * @short A spatial index of GeoGraphicsItems, keyed by their bounding boxes.
+ *
+ * The index is an R-tree. Boxes crossing the date line are stored as two
+ * halves, one on each side of it, so queries don't need to care about the
+ * date line apart from splitting the query box in the same way.
+ *
+ * Items added through insert() are collected first and moved into the tree
+ * on the next query. If many items were added since the last query, the
+ * whole tree is rebuilt by Sort-Tile-Recursive bulk loading, which yields
+ * a much better packed tree than inserting the items one by one. Smaller
+ * additions are inserted dynamically.
+ *
+ * The bounding box and minimum zoom level of an item are taken when the
+ * item is inserted. If either changes later, the item has to be removed
+ * and inserted again.
+ */
+class GeoGraphicsItemIndex
+{
+ public:
+    GeoGraphicsItemIndex();
+
+    ~GeoGraphicsItemIndex();
+
+    /**
+     * Adds @p item to the index. The index does not take ownership.
+     */
+    void insert( GeoGraphicsItem *item );
+
+    /**
+     * Removes @p item from the index.
+     * @return whether the item was part of the index
+     */
+    bool remove( GeoGraphicsItem *item );
+
+    /**
+     * Removes all items from the index.
+     */
+    void clear();
+
+    /**
+     * Returns the number of items in the index.
+     */
+    int size() const;
+
+    /**
+     * Returns the visible items whose bounding box intersects @p box and
+     * whose minimum zoom level is not larger than @p zoomLevel. Each item
+     * is returned once, even if both @p box and the item cross the date line.
+     */
+    QList<GeoGraphicsItem *> items( const GeoDataLatLonBox &box, int zoomLevel ) const;
+
+ private:
+    Q_DISABLE_COPY( GeoGraphicsItemIndex )
+
+    class Private;
+    Private * const d;
+};
+
+}
+
+#endif
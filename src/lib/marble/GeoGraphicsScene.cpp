@@ -20,12 +20,10 @@
 #include "GeoDataDocument.h"
 #include "GeoDataTypes.h"
 #include "GeoGraphicsItem.h"
-#include "TileId.h"
-#include "TileCoordsPyramid.h"
+#include "GeoGraphicsItemIndex.h"
 #include "MarbleDebug.h"
 
-#include <QMap>
-#include <QRect>
+#include <QMultiHash>
 
 namespace Marble
 {
@@ -44,8 +42,8 @@ public:
         q->clear();
     }
 
-    QMap<TileId, QList<GeoGraphicsItem*> > m_items;
-    QMultiHash<const GeoDataFeature*, TileId> m_features;
+    GeoGraphicsItemIndex m_index;
+    QMultiHash<const GeoDataFeature*, GeoGraphicsItem*> m_features;
 
     // Stores the items which have been clicked;
     QList<GeoGraphicsItem*> m_selectedItems;
@@ -96,63 +94,7 @@ GeoGraphicsScene::~GeoGraphicsScene()
 
 QList< GeoGraphicsItem* > GeoGraphicsScene::items( const GeoDataLatLonBox &box, int zoomLevel ) const
 {
-    if ( box.west() > box.east() ) {
-        // Handle boxes crossing the IDL by splitting it into two separate boxes
-        GeoDataLatLonBox left;
-        left.setWest( -M_PI );
-        left.setEast( box.east() );
-        left.setNorth( box.north() );
-        left.setSouth( box.south() );
-
-        GeoDataLatLonBox right;
-        right.setWest( box.west() );
-        right.setEast( M_PI );
-        right.setNorth( box.north() );
-        right.setSouth( box.south() );
-
-        QList< GeoGraphicsItem* > allItems = items( left, zoomLevel );
-        foreach( GeoGraphicsItem* item, items( right, zoomLevel ) ) {
-            if ( !allItems.contains( item ) ) {
-                allItems << item;
-            }
-        }
-        return allItems;
-    }
-
-    QList< GeoGraphicsItem* > result;
-    QRect rect;
-    qreal north, south, east, west;
-    box.boundaries( north, south, east, west );
-    TileId key;
-
-    key = TileId::fromCoordinates( GeoDataCoordinates(west, north, 0), zoomLevel );
-    rect.setLeft( key.x() );
-    rect.setTop( key.y() );
-
-    key = TileId::fromCoordinates( GeoDataCoordinates(east, south, 0), zoomLevel );
-    rect.setRight( key.x() );
-    rect.setBottom( key.y() );
-    
-    TileCoordsPyramid pyramid( 0, zoomLevel );
-    pyramid.setBottomLevelCoords( rect );
-
-    for ( int level = pyramid.topLevel(); level <= pyramid.bottomLevel(); ++level ) {
-        QRect const coords = pyramid.coords( level );
-        int x1, y1, x2, y2;
-        coords.getCoords( &x1, &y1, &x2, &y2 );
-        for ( int x = x1; x <= x2; ++x ) {
-            for ( int y = y1; y <= y2; ++y ) {
-                const TileId tileId = TileId( 0, level, x, y );
-                foreach(GeoGraphicsItem *object, d->m_items.value( tileId )) {
-                    if (object->minZoomLevel() <= zoomLevel && object->visible()) {
-                        result.push_back(object);
-                    }
-                }
-            }
-        }
-    }
-
-    return result;
+    return d->m_index.items( box, zoomLevel );
 }
 
 QList< GeoGraphicsItem* > GeoGraphicsScene::selectedItems() const
@@ -179,41 +121,35 @@ void GeoGraphicsScene::applyHighlight( const QVector< GeoDataPlacemark* > &selec
      * items to use highlight style
      */
     foreach( const GeoDataPlacemark *placemark, selectedPlacemarks ) {
-        QList<TileId> tiles = d->m_features.values( placemark );
-        foreach( const TileId &tileId, tiles ) {
-            QList<GeoGraphicsItem*> clickedItems = d->m_items[tileId];
-            foreach ( GeoGraphicsItem *item, clickedItems ) {
-                if ( item->feature() == placemark ) {
-                    GeoDataObject *parent = placemark->parent();
-                    if ( parent ) {
-                        if ( parent->nodeType() == GeoDataTypes::GeoDataDocumentType ) {
-                            GeoDataDocument *doc = static_cast<GeoDataDocument*>( parent );
-                            QString styleUrl = placemark->styleUrl();
-                            styleUrl.remove('#');
-                            if ( !styleUrl.isEmpty() ) {
-                                GeoDataStyleMap const &styleMap = doc->styleMap( styleUrl );
-                                GeoDataStyle::Ptr style = d->highlightStyle( doc, styleMap );
-                                if ( style ) {
-                                    d->selectItem( item );
-                                    d->applyHighlightStyle( item, style );
-                                }
-                            }
+        foreach ( GeoGraphicsItem *item, d->m_features.values( placemark ) ) {
+            GeoDataObject *parent = placemark->parent();
+            if ( parent ) {
+                if ( parent->nodeType() == GeoDataTypes::GeoDataDocumentType ) {
+                    GeoDataDocument *doc = static_cast<GeoDataDocument*>( parent );
+                    QString styleUrl = placemark->styleUrl();
+                    styleUrl.remove('#');
+                    if ( !styleUrl.isEmpty() ) {
+                        GeoDataStyleMap const &styleMap = doc->styleMap( styleUrl );
+                        GeoDataStyle::Ptr style = d->highlightStyle( doc, styleMap );
+                        if ( style ) {
+                            d->selectItem( item );
+                            d->applyHighlightStyle( item, style );
+                        }
+                    }
 
-                            /**
-                            * If a placemark is using an inline style instead of a shared
-                            * style ( e.g in case when theme file specifies the colorMap
-                            * attribute ) then highlight it if any of the style maps have a
-                            * highlight styleId
-                            */
-                            else {
-                                foreach ( const GeoDataStyleMap &styleMap, doc->styleMaps() ) {
-                                    GeoDataStyle::Ptr style = d->highlightStyle( doc, styleMap );
-                                    if ( style ) {
-                                        d->selectItem( item );
-                                        d->applyHighlightStyle( item, style );
-                                        break;
-                                    }
-                                }
+                    /**
+                    * If a placemark is using an inline style instead of a shared
+                    * style ( e.g in case when theme file specifies the colorMap
+                    * attribute ) then highlight it if any of the style maps have a
+                    * highlight styleId
+                    */
+                    else {
+                        foreach ( const GeoDataStyleMap &styleMap, doc->styleMaps() ) {
+                            GeoDataStyle::Ptr style = d->highlightStyle( doc, styleMap );
+                            if ( style ) {
+                                d->selectItem( item );
+                                d->applyHighlightStyle( item, style );
+                                break;
                             }
                         }
                     }
@@ -226,48 +162,26 @@ void GeoGraphicsScene::applyHighlight( const QVector< GeoDataPlacemark* > &selec
 
 void GeoGraphicsScene::removeItem( const GeoDataFeature* feature )
 {
-    QList<TileId> keys = d->m_features.values( feature );
-    foreach( const TileId& key, keys ) {
-        QList< GeoGraphicsItem* >& tileList = d->m_items[key];
-        foreach( GeoGraphicsItem* item, tileList ) {
-            if( item->feature() == feature ) {
-                d->m_features.remove( feature );
-                tileList.removeAll( item );
-                delete item;
-                break;
-            }
-        }
+    foreach( GeoGraphicsItem* item, d->m_features.values( feature ) ) {
+        d->m_index.remove( item );
+        d->m_selectedItems.removeAll( item );
+        delete item;
     }
+    d->m_features.remove( feature );
 }
 
 void GeoGraphicsScene::clear()
 {
-    foreach(const QList<GeoGraphicsItem*> &list, d->m_items.values()) {
-        qDeleteAll(list);
-    }
-    d->m_items.clear();
+    qDeleteAll( d->m_features );
+    d->m_index.clear();
     d->m_features.clear();
+    d->m_selectedItems.clear();
 }
 
 void GeoGraphicsScene::addItem( GeoGraphicsItem* item )
 {
-    // Select zoom level so that the object fit in single tile
-    int zoomLevel;
-    qreal north, south, east, west;
-    item->latLonAltBox().boundaries( north, south, east, west );
-    for(zoomLevel = item->minZoomLevel(); zoomLevel >= 0; zoomLevel--)
-    {
-        if( TileId::fromCoordinates( GeoDataCoordinates(west, north, 0), zoomLevel ) ==
-            TileId::fromCoordinates( GeoDataCoordinates(east, south, 0), zoomLevel ) )
-            break;
-    }
-
-    const TileId key = TileId::fromCoordinates( GeoDataCoordinates(west, north, 0), zoomLevel ); // same as GeoDataCoordinates(east, south, 0), see above
-
-    QList< GeoGraphicsItem* >& tileList = d->m_items[key];
-    QList< GeoGraphicsItem* >::iterator position = qLowerBound( tileList.begin(), tileList.end(), item, GeoGraphicsItem::zValueLessThan );
-    tileList.insert( position, item );
-    d->m_features.insert( item->feature(), key );
+    d->m_index.insert( item );
+    d->m_features.insert( item->feature(), item );
 }
 
 }
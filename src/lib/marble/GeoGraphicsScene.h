@@ -64,8 +64,11 @@ public:
     /**
      * @brief Get the list of items in the specified Box
      *
+     * The items are looked up in a spatial index, boxes crossing the
+     * date line are supported.
+     *
      * @param box The box around the items.
-     * @param maxZoomLevel The max zoom level of tiling
+     * @param maxZoomLevel Only visible items whose minimum zoom level does not exceed this level are returned
      * @return The list of items in the specified box in no specific order.
      */
     QList<GeoGraphicsItem *> items( const GeoDataLatLonBox &box, int maxZoomLevel ) const;
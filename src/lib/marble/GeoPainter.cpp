@@ -565,6 +565,17 @@ void GeoPainter::drawPolyline ( const GeoDataLineString & lineString,
     QVector<QPolygonF*> polygons;
     d->m_viewport->screenCoordinates( lineString, polygons );
 
+    drawPolyline( polygons, labelText, labelPositionFlags, labelColor, labelFont );
+
+    qDeleteAll( polygons );
+}
+
+
+void GeoPainter::drawPolyline ( const QVector<QPolygonF*> & polygons,
+                                const QString& labelText,
+                                LabelPositionFlags labelPositionFlags,
+                                const QColor& labelColor, const QFont& labelFont )
+{
     if ( labelText.isEmpty() || labelPositionFlags.testFlag( NoLabel ) ) {
         foreach( QPolygonF* itPolygon, polygons ) {
             ClipPainter::drawPolyline( *itPolygon );
@@ -679,7 +690,6 @@ void GeoPainter::drawPolyline ( const GeoDataLineString & lineString,
             }
         }
     }
-    qDeleteAll( polygons );
 }
 
 
@@ -320,6 +320,23 @@ class MARBLE_EXPORT GeoPainter : public ClipPainter
                         LabelPositionFlags labelPositionFlags = LineCenter,
                         const QColor& labelcolor = Qt::black, const QFont& labelFont = QFont(QLatin1String("Arial")));
 
+/*!
+    \brief Draws line strings which have been projected to screen coordinates already.
+
+    The \a polygons are drawn like drawPolyline( GeoDataLineString ) draws
+    the polygons it gets from ViewportParams::screenCoordinates(). This
+    allows to project a line string once and draw it several times, e.g.
+    with different pens. Unlike drawPolyline( GeoDataLineString ), this
+    method doesn't skip line strings outside the viewport or below its
+    resolution.
+
+    \see ViewportParams::screenCoordinates()
+*/
+    void drawPolyline ( const QVector<QPolygonF*> & polygons,
+                        const QString& labelText = QString(),
+                        LabelPositionFlags labelPositionFlags = LineCenter,
+                        const QColor& labelcolor = Qt::black, const QFont& labelFont = QFont(QLatin1String("Arial")));
+
 
 /*!
     \brief Creates a region for a given line string (a "polyline").
@@ -128,6 +128,11 @@ void HttpDownloadManager::setDownloadEnabled( const bool enable )
 
 }
 
+StoragePolicy *HttpDownloadManager::storagePolicy() const
+{
+    return d->m_storagePolicy;
+}
+
 void HttpDownloadManager::addDownloadPolicy( const DownloadPolicy& policy )
 {
     if ( d->hasDownloadPolicy( policy ))
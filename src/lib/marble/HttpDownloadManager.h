@@ -66,6 +66,11 @@ class MARBLE_EXPORT HttpDownloadManager : public QObject
     void setDownloadEnabled( const bool enable );
     void addDownloadPolicy( const DownloadPolicy& );
 
+    /**
+     * Returns the storage policy downloaded files are saved with.
+     */
+    StoragePolicy *storagePolicy() const;
+
     static QByteArray userAgent(const QString &platform, const QString &plugin);
 
  public Q_SLOTS:
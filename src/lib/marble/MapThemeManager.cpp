@@ -24,6 +24,7 @@
 #include <QStandardItemModel>
 
 // Local dir
+#include "DiscoveryCache.h"
 #include "GeoDataPhotoOverlay.h"
 #include "GeoSceneDocument.h"
 #include "GeoSceneMap.h"
@@ -90,10 +91,19 @@ public:
 
     static GeoSceneDocument* loadMapThemeFile( const QString& mapThemeId );
 
+    /**
+     * @brief Returns the head properties of a map theme needed for the model.
+     *
+     * The properties are taken from the discovery cache if the .dgml file did
+     * not change since it was parsed last, otherwise the file gets parsed.
+     * An empty map is returned for map themes which cannot be loaded.
+     */
+    QVariantMap mapThemeProperties( const QString& mapThemeID );
+
     /**
      * @brief Helper method for updateMapThemeModel().
      */
-    static QList<QStandardItem *> createMapThemeRow( const QString& mapThemeID );
+    QList<QStandardItem *> createMapThemeRow( const QString& mapThemeID );
 
     /**
      * @brief Deletes any directory with its contents.
@@ -106,6 +116,7 @@ public:
     QStandardItemModel m_mapThemeModel;
     QStandardItemModel m_celestialList;
     QFileSystemWatcher m_fileSystemWatcher;
+    DiscoveryCache m_discoveryCache;
     bool m_isInitialized;
 
 private:
@@ -121,6 +132,7 @@ MapThemeManager::Private::Private( MapThemeManager *parent )
       m_mapThemeModel( 0, 3 ),
       m_celestialList(),
       m_fileSystemWatcher(),
+      m_discoveryCache( MarbleDirs::localPath() + "/discovery/mapthemes.cache" ),
       m_isInitialized( false )
 {
 }
@@ -348,12 +360,36 @@ QStandardItemModel *MapThemeManager::celestialBodiesModel()
     return &d->m_celestialList;
 }
 
+QVariantMap MapThemeManager::Private::mapThemeProperties( const QString& mapThemeID )
+{
+    const QString dgmlPath = MarbleDirs::path( mapDirName + '/' + mapThemeID );
+    QVariantMap properties = m_discoveryCache.value( dgmlPath );
+    if ( !properties.isEmpty() ) {
+        return properties.value( "valid" ).toBool() ? properties : QVariantMap();
+    }
+
+    QScopedPointer<GeoSceneDocument> mapTheme( loadMapThemeFile( mapThemeID ) );
+    properties.insert( "valid", !mapTheme.isNull() );
+    if ( mapTheme ) {
+        const GeoSceneHead *head = mapTheme->head();
+        properties.insert( "visible", head->visible() );
+        properties.insert( "name", head->name() );
+        properties.insert( "description", head->description() );
+        properties.insert( "target", head->target() );
+        properties.insert( "theme", head->theme() );
+        properties.insert( "icon", head->icon()->pixmap() );
+    }
+    m_discoveryCache.insert( dgmlPath, properties );
+
+    return mapTheme ? properties : QVariantMap();
+}
+
 QList<QStandardItem *> MapThemeManager::Private::createMapThemeRow( QString const& mapThemeID )
 {
     QList<QStandardItem *> itemList;
 
-    QScopedPointer<GeoSceneDocument> mapTheme( loadMapThemeFile( mapThemeID ) );
-    if ( !mapTheme || !mapTheme->head()->visible() ) {
+    const QVariantMap properties = mapThemeProperties( mapThemeID );
+    if ( properties.isEmpty() || !properties.value( "visible" ).toBool() ) {
         return itemList;
     }
 
@@ -361,8 +397,8 @@ QList<QStandardItem *> MapThemeManager::Private::createMapThemeRow( QString cons
     QString relativePath;
 
     relativePath = mapDirName + '/'
-        + mapTheme->head()->target() + '/' + mapTheme->head()->theme() + '/'
-        + mapTheme->head()->icon()->pixmap();
+        + properties.value( "target" ).toString() + '/' + properties.value( "theme" ).toString() + '/'
+        + properties.value( "icon" ).toString();
     themeIconPixmap.load( MarbleDirs::path( relativePath ) );
 
     if ( themeIconPixmap.isNull() ) {
@@ -384,8 +420,8 @@ QList<QStandardItem *> MapThemeManager::Private::createMapThemeRow( QString cons
 
     QIcon mapThemeIcon =  QIcon( themeIconPixmap );
 
-    QString name = mapTheme->head()->name();
-    QString description = mapTheme->head()->description();
+    QString name = properties.value( "name" ).toString();
+    QString description = properties.value( "description" ).toString();
 
     QStandardItem *item = new QStandardItem( name );
     item->setData( QCoreApplication::translate("DGML", name.toUtf8() ), Qt::DisplayRole );
@@ -430,6 +466,8 @@ void MapThemeManager::Private::updateMapThemeModel()
                                 << new QStandardItem( celestialBodyId ) );
         }
     }
+
+    m_discoveryCache.save();
 }
 
 void MapThemeManager::Private::watchPaths()
@@ -491,6 +529,7 @@ void MapThemeManager::Private::fileChanged( const QString& path )
             m_mapThemeModel.insertRow( insertAtRow, newMapThemeRow );
         }
     }
+    m_discoveryCache.save();
 
     emit q->themesChanged();
 }
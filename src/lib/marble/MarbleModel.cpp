@@ -49,8 +49,9 @@
 
 #include "DgmlAuxillaryDictionary.h"
 #include "MarbleClock.h"
-#include "FileStoragePolicy.h"
 #include "FileStorageWatcher.h"
+#include "PackedStoragePolicy.h"
+#include "PlacemarkSearchIndex.h"
 #include "PositionTracking.h"
 #include "HttpDownloadManager.h"
 #include "MarbleDirs.h"
@@ -90,6 +91,7 @@ class MarbleModelPrivate
           m_treeModel(),
           m_descendantProxy(),
           m_placemarkProxyModel(),
+          m_placemarkSearchIndex(),
           m_placemarkSelectionModel( 0 ),
           m_fileManager( &m_treeModel, &m_pluginManager ),
           m_positionTracking( &m_treeModel ),
@@ -105,6 +107,7 @@ class MarbleModelPrivate
         m_placemarkProxyModel.setFilterFixedString( GeoDataTypes::GeoDataPlacemarkType );
         m_placemarkProxyModel.setFilterKeyColumn( 1 );
         m_placemarkProxyModel.setSourceModel( &m_descendantProxy );
+        m_placemarkSearchIndex.setSourceModel( &m_placemarkProxyModel );
 
         m_groundOverlayProxyModel.setFilterFixedString( GeoDataTypes::GeoDataGroundOverlayType );
         m_groundOverlayProxyModel.setFilterKeyColumn( 1 );
@@ -158,7 +161,7 @@ class MarbleModelPrivate
     // View and paint stuff
     GeoSceneDocument        *m_mapTheme;
 
-    FileStoragePolicy        m_storagePolicy;
+    PackedStoragePolicy      m_storagePolicy;
     HttpDownloadManager      m_downloadManager;
 
     // Cache related
@@ -169,6 +172,7 @@ class MarbleModelPrivate
     KDescendantsProxyModel   m_descendantProxy;
     QSortFilterProxyModel    m_placemarkProxyModel;
     QSortFilterProxyModel    m_groundOverlayProxyModel;
+    PlacemarkSearchIndex     m_placemarkSearchIndex;
 
     // Selection handling
     QItemSelectionModel      m_placemarkSelectionModel;
@@ -300,7 +304,9 @@ void MarbleModel::setMapTheme( GeoSceneDocument *document )
         }
     }
 
-    delete d->m_mapTheme;
+    // The previous theme is deleted only once the receivers of themeChanged()
+    // switched to the new one, tiles may still be decoded from its datasets
+    GeoSceneDocument *const previousMapTheme = d->m_mapTheme;
     d->m_mapTheme = mapTheme;
 
     addDownloadPolicies( d->m_mapTheme );
@@ -432,6 +438,10 @@ void MarbleModel::setMapTheme( GeoSceneDocument *document )
 
     mDebug() << "THEME CHANGED: ***" << mapTheme->head()->mapThemeId();
     emit themeChanged( mapTheme->head()->mapThemeId() );
+
+    if ( previousMapTheme != mapTheme ) {
+        delete previousMapTheme;
+    }
 }
 
 void MarbleModelPrivate::addHighlightStyle(GeoDataDocument* doc)
@@ -548,6 +558,11 @@ const QAbstractItemModel *MarbleModel::placemarkModel() const
     return &d->m_placemarkProxyModel;
 }
 
+const PlacemarkSearchIndex *MarbleModel::placemarkSearchIndex() const
+{
+    return &d->m_placemarkSearchIndex;
+}
+
 QAbstractItemModel *MarbleModel::groundOverlayModel()
 {
     return &d->m_groundOverlayProxyModel;
@@ -660,7 +675,13 @@ void MarbleModel::clearPersistentTileCache()
 
 void MarbleModel::setPersistentTileCacheLimit(quint64 kiloBytes)
 {
-    d->m_storageWatcher.setCacheLimit( kiloBytes * 1024 );
+    // The storage policy evicts the packed image tiles, the watcher only sees
+    // the plain files. Most downloads are packed, so the packed tiles get most
+    // of the limit and both together stay within it.
+    const quint64 bytes = kiloBytes * 1024;
+    const quint64 packedBytes = bytes / 10 * 9;
+    d->m_storageWatcher.setCacheLimit( bytes - packedBytes );
+    d->m_storagePolicy.setCacheLimit( packedBytes );
 
     if( kiloBytes != 0 )
     {
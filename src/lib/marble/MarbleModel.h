@@ -65,6 +65,7 @@ class RoutingManager;
 class BookmarkManager;
 class FileManager;
 class ElevationModel;
+class PlacemarkSearchIndex;
 
 /**
  * @short The data model (not based on QAbstractModel) for a MarbleWidget.
@@ -123,6 +124,11 @@ class MARBLE_EXPORT MarbleModel : public QObject
     QAbstractItemModel *placemarkModel();
     const QAbstractItemModel *placemarkModel() const;
 
+    /**
+     * @brief Return the name index over the placemarks of placemarkModel().
+     */
+    const PlacemarkSearchIndex *placemarkSearchIndex() const;
+
     QItemSelectionModel *placemarkSelectionModel();
 
     /**
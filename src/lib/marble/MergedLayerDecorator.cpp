@@ -20,6 +20,7 @@
 
 #include "blendings/Blending.h"
 #include "blendings/BlendingFactory.h"
+#include "blendings/SunLightBlending.h"
 #include "SunLocator.h"
 #include "MarbleMath.h"
 #include "MarbleDebug.h"
@@ -45,10 +46,10 @@ public:
 
     static int maxDivisor( int maximum, int fullLength );
 
-    StackedTile *createTile( const QVector<QSharedPointer<TextureTile> > &tiles ) const;
+    StackedTile *createTile( const QVector<QSharedPointer<TextureTile> > &tiles, const SunLocator *sunLocator ) const;
 
     void renderGroundOverlays( QImage *tileImage, const QVector<QSharedPointer<TextureTile> > &tiles ) const;
-    void paintSunShading( QImage *tileImage, const TileId &id ) const;
+    void paintSunShading( QImage *tileImage, const TileId &id, const SunLocator *sunLocator ) const;
     void paintTileId( QImage *tileImage, const TileId &id ) const;
 
     void detectMaxTileLevel();
@@ -159,7 +160,7 @@ QSize MergedLayerDecorator::tileSize() const
     return d->m_textureLayers.at( 0 )->tileSize();
 }
 
-StackedTile *MergedLayerDecorator::Private::createTile( const QVector<QSharedPointer<TextureTile> > &tiles ) const
+StackedTile *MergedLayerDecorator::Private::createTile( const QVector<QSharedPointer<TextureTile> > &tiles, const SunLocator *sunLocator ) const
 {
     Q_ASSERT( !tiles.isEmpty() );
 
@@ -186,7 +187,14 @@ StackedTile *MergedLayerDecorator::Private::createTile( const QVector<QSharedPoi
                 resultImage = QImage( tile->image()->size(), QImage::Format_ARGB32_Premultiplied );
             }
 
-            blending->blend( &resultImage, tile.data() );
+            if ( sunLocator != m_sunLocator && dynamic_cast<const SunLightBlending *>( blending ) ) {
+                // the shared blending follows the sun of the model
+                SunLightBlending sunLightBlending( sunLocator );
+                sunLightBlending.setLevelZeroLayout( m_levelZeroColumns, m_levelZeroRows );
+                sunLightBlending.blend( &resultImage, tile.data() );
+            } else {
+                blending->blend( &resultImage, tile.data() );
+            }
         }
         else {
             mDebug() << Q_FUNC_INFO << "no blending defined => copying top over bottom image";
@@ -201,7 +209,7 @@ StackedTile *MergedLayerDecorator::Private::createTile( const QVector<QSharedPoi
     renderGroundOverlays( &resultImage, tiles );
 
     if ( m_showSunShading && !m_showCityLights ) {
-        paintSunShading( &resultImage, id );
+        paintSunShading( &resultImage, id, sunLocator );
     }
 
     if ( m_showTileId ) {
@@ -302,6 +310,11 @@ void MergedLayerDecorator::Private::renderGroundOverlays( QImage *tileImage, con
 }
 
 StackedTile *MergedLayerDecorator::loadTile( const TileId &stackedTileId )
+{
+    return loadTile( stackedTileId, d->m_sunLocator );
+}
+
+StackedTile *MergedLayerDecorator::loadTile( const TileId &stackedTileId, const SunLocator *sunLocator )
 {
     const QVector<const GeoSceneTextureTileDataset *> textureLayers = d->findRelevantTextureLayers( stackedTileId );
     QVector<QSharedPointer<TextureTile> > tiles;
@@ -328,7 +341,12 @@ StackedTile *MergedLayerDecorator::loadTile( const TileId &stackedTileId )
 
     Q_ASSERT( !tiles.isEmpty() );
 
-    return d->createTile( tiles );
+    return d->createTile( tiles, sunLocator );
+}
+
+const SunLocator *MergedLayerDecorator::sunLocator() const
+{
+    return d->m_sunLocator;
 }
 
 RenderState MergedLayerDecorator::renderState( const TileId &stackedTileId ) const
@@ -342,7 +360,7 @@ RenderState MergedLayerDecorator::renderState( const TileId &stackedTileId ) con
         const TileId tileId( layer->sourceDir(), stackedTileId.zoomLevel(),
                              stackedTileId.x(), stackedTileId.y() );
         RenderStatus tileStatus = Complete;
-        switch ( TileLoader::tileStatus( layer, tileId ) ) {
+        switch ( d->m_tileLoader->tileStatus( layer, tileId ) ) {
         case TileLoader::Available:
             tileStatus = Complete;
             break;
@@ -381,7 +399,7 @@ StackedTile *MergedLayerDecorator::updateTile( const StackedTile &stackedTile, c
         }
     }
 
-    return d->createTile( tiles );
+    return d->createTile( tiles, d->m_sunLocator );
 }
 
 void MergedLayerDecorator::downloadStackedTile( const TileId &id, DownloadUsage usage )
@@ -389,7 +407,7 @@ void MergedLayerDecorator::downloadStackedTile( const TileId &id, DownloadUsage
     const QVector<const GeoSceneTextureTileDataset *> textureLayers = d->findRelevantTextureLayers( id );
 
     foreach ( const GeoSceneTextureTileDataset *textureLayer, textureLayers ) {
-        if ( TileLoader::tileStatus( textureLayer, id ) != TileLoader::Available || usage == DownloadBrowse ) {
+        if ( d->m_tileLoader->tileStatus( textureLayer, id ) != TileLoader::Available || usage == DownloadBrowse ) {
             d->m_tileLoader->downloadTile( textureLayer, id, usage );
         }
     }
@@ -420,7 +438,7 @@ void MergedLayerDecorator::setShowTileId( bool visible )
     d->m_showTileId = visible;
 }
 
-void MergedLayerDecorator::Private::paintSunShading( QImage *tileImage, const TileId &id ) const
+void MergedLayerDecorator::Private::paintSunShading( QImage *tileImage, const TileId &id, const SunLocator *sunLocator ) const
 {
     if ( tileImage->depth() != 32 )
         return;
@@ -442,8 +460,8 @@ void MergedLayerDecorator::Private::paintSunShading( QImage *tileImage, const Ti
 
     for ( int cur_y = 0; cur_y < tileHeight; ++cur_y ) {
         const qreal lat = lat_scale * ( id.y() * tileHeight + cur_y ) - 0.5*M_PI;
-        const qreal a = sin( (lat+DEG2RAD * m_sunLocator->getLat() )/2.0 );
-        const qreal c = cos(lat)*cos( -DEG2RAD * m_sunLocator->getLat() );
+        const qreal a = sin( (lat+DEG2RAD * sunLocator->getLat() )/2.0 );
+        const qreal c = cos(lat)*cos( -DEG2RAD * sunLocator->getLat() );
 
         QRgb* scanline = (QRgb*)tileImage->scanLine( cur_y );
 
@@ -460,7 +478,7 @@ void MergedLayerDecorator::Private::paintSunShading( QImage *tileImage, const Ti
             if ( interpolate ) {
                 const int check = cur_x + n;
                 const qreal checklon   = lon_scale * ( id.x() * tileWidth + check );
-                shade = m_sunLocator->shading( checklon, a, c );
+                shade = sunLocator->shading( checklon, a, c );
 
                 // if the shading didn't change across the interpolation
                 // interval move on and don't change anything.
@@ -471,7 +489,7 @@ void MergedLayerDecorator::Private::paintSunShading( QImage *tileImage, const Ti
                 }
                 if ( shade == lastShade && shade == 0.0 ) {
                     for ( int t = 0; t < n; ++t ) {
-                        m_sunLocator->shadePixel( *scanline, shade );
+                        sunLocator->shadePixel( *scanline, shade );
                         ++scanline;
                     }
                     cur_x += n;
@@ -479,8 +497,8 @@ void MergedLayerDecorator::Private::paintSunShading( QImage *tileImage, const Ti
                 }
                 for ( int t = 0; t < n ; ++t ) {
                     const qreal lon   = lon_scale * ( id.x() * tileWidth + cur_x );
-                    shade = m_sunLocator->shading( lon, a, c );
-                    m_sunLocator->shadePixel( *scanline, shade );
+                    shade = sunLocator->shading( lon, a, c );
+                    sunLocator->shadePixel( *scanline, shade );
                     ++scanline;
                     ++cur_x;
                 }
@@ -490,8 +508,8 @@ void MergedLayerDecorator::Private::paintSunShading( QImage *tileImage, const Ti
                 // Make sure we don't exceed the image memory
                 if ( cur_x < tileWidth ) {
                     const qreal lon   = lon_scale * ( id.x() * tileWidth + cur_x );
-                    shade = m_sunLocator->shading( lon, a, c );
-                    m_sunLocator->shadePixel( *scanline, shade );
+                    shade = sunLocator->shading( lon, a, c );
+                    sunLocator->shadePixel( *scanline, shade );
                     ++scanline;
                     ++cur_x;
                 }
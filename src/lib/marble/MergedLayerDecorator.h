@@ -63,6 +63,20 @@ class MergedLayerDecorator
 
     StackedTile *loadTile( const TileId &id );
 
+    /**
+     * Same as loadTile( id ), but shades the tile with the sun position of
+     * @p sunLocator, a snapshot taken when the decoding was requested.
+     *
+     * Called from the worker threads of StackedTileLoader. It only reads the
+     * texture layers, ground overlays and display settings, so these must
+     * neither be changed nor freed before StackedTileLoader::waitForPendingTiles()
+     * returned. The tile lookups of TileLoader are thread-safe and it requests
+     * downloads through queued signals.
+     */
+    StackedTile *loadTile( const TileId &id, const SunLocator *sunLocator );
+
+    const SunLocator *sunLocator() const;
+
     StackedTile *updateTile( const StackedTile &stackedTile, const TileId &tileId, const QImage &tileImage );
 
     void downloadStackedTile( const TileId &id, DownloadUsage usage );
@@ -15,20 +15,269 @@
 
 #include <QProcess>
 #include <QMessageBox>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QThread>
 #include <QTimer>
 #include <QTime>
 #include <QFile>
+#include <QWaitCondition>
 
 namespace Marble
 {
 
+/**
+ * Feeds the recorded frames to the encoder process in a worker thread, so that
+ * the GUI thread only needs to grab the frames.
+ */
+class MovieEncoder : public QThread
+{
+public:
+    explicit MovieEncoder(MovieCapture *capture) :
+        m_capture(capture),
+        m_fps(30),
+        m_finishing(false),
+        m_cancelled(false),
+        m_stopped(true),
+        m_droppedFrames(0)
+    {}
+
+    /**
+     * @brief Starts a new movie, waiting for the previous one to be written first
+     */
+    void begin(const QString &encoderExec, const QString &destinationFile, int fps);
+
+    /**
+     * @brief Queues @p frame for encoding. If the encoder is behind by more than
+     * maximumQueuedFrames frames, either waits for it (@p wait) or drops the frame.
+     * @return whether the frame was queued
+     */
+    bool enqueue(const QImage &frame, bool wait);
+
+    /**
+     * @brief Lets the encoder finish the movie once all queued frames are written
+     */
+    void finish();
+
+    /**
+     * @brief Stops encoding right away, dropping the queued frames
+     */
+    void cancel();
+
+    int droppedFrames() const;
+
+protected:
+    void run();
+
+private:
+    bool isCancelled() const;
+
+    static void toRgb24(const QImage &frame, QByteArray &buffer);
+
+    static const int maximumQueuedFrames = 8;
+
+    MovieCapture *const m_capture;
+    QString m_encoderExec;
+    QString m_destinationFile;
+    int m_fps;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_frameQueued;
+    QWaitCondition m_frameTaken;
+    QQueue<QImage> m_frames;
+    bool m_finishing;
+    bool m_cancelled;
+    bool m_stopped;
+    int m_droppedFrames;
+};
+
+void MovieEncoder::begin(const QString &encoderExec, const QString &destinationFile, int fps)
+{
+    wait();
+
+    QMutexLocker locker(&m_mutex);
+    m_encoderExec = encoderExec;
+    m_destinationFile = destinationFile;
+    m_fps = fps;
+    m_frames.clear();
+    m_finishing = false;
+    m_cancelled = false;
+    m_stopped = false;
+    m_droppedFrames = 0;
+    start();
+}
+
+bool MovieEncoder::enqueue(const QImage &frame, bool wait)
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopped && !m_finishing && m_frames.size() >= maximumQueuedFrames) {
+        if (!wait) {
+            break;
+        }
+        m_frameTaken.wait(&m_mutex);
+    }
+
+    if (m_stopped || m_finishing || m_frames.size() >= maximumQueuedFrames) {
+        ++m_droppedFrames;
+        return false;
+    }
+
+    m_frames.enqueue(frame);
+    m_frameQueued.wakeOne();
+    return true;
+}
+
+void MovieEncoder::finish()
+{
+    QMutexLocker locker(&m_mutex);
+    m_finishing = true;
+    m_frameQueued.wakeOne();
+}
+
+void MovieEncoder::cancel()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancelled = true;
+        m_frames.clear();
+        m_frameQueued.wakeOne();
+        m_frameTaken.wakeAll();
+    }
+    wait();
+}
+
+int MovieEncoder::droppedFrames() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_droppedFrames;
+}
+
+bool MovieEncoder::isCancelled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cancelled;
+}
+
+void MovieEncoder::toRgb24(const QImage &frame, QByteArray &buffer)
+{
+    const QImage image = frame.format() == QImage::Format_RGB32 || frame.format() == QImage::Format_ARGB32
+                         ? frame : frame.convertToFormat(QImage::Format_RGB32);
+
+    // The buffer keeps its capacity, so it is allocated only once per movie
+    buffer.resize(image.width() * image.height() * 3);
+    char *rgb = buffer.data();
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            *rgb++ = qRed(line[x]);
+            *rgb++ = qGreen(line[x]);
+            *rgb++ = qBlue(line[x]);
+        }
+    }
+}
+
+void MovieEncoder::run()
+{
+    QProcess process;
+    QSize frameSize;
+    QByteArray buffer;
+    bool failed = false;
+
+    forever {
+        QImage frame;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_frames.isEmpty() && !m_finishing && !m_cancelled) {
+                m_frameQueued.wait(&m_mutex);
+            }
+            if (m_cancelled || m_frames.isEmpty()) {
+                break;
+            }
+            frame = m_frames.dequeue();
+            m_frameTaken.wakeAll();
+        }
+
+        if (process.state() == QProcess::NotRunning) {
+            frameSize = frame.size();
+            QStringList const arguments = QStringList()
+                    << "-y"
+                    << "-r" << QString::number(m_fps)
+                    << "-f" << "rawvideo"
+                    << "-pix_fmt" << "rgb24"
+                    << "-s" << QString("%1x%2").arg( frameSize.width() ).arg( frameSize.height() )
+                    << "-i" << "pipe:"
+                    << "-b" << "2000k"
+                    << m_destinationFile;
+            process.start( m_encoderExec, arguments );
+            if (!process.waitForStarted()) {
+                mDebug() << "[*] Failed to start" << m_encoderExec;
+                failed = true;
+                break;
+            }
+        }
+
+        if (frame.size() != frameSize) {
+            // The encoder expects all frames to have the same size
+            QMutexLocker locker(&m_mutex);
+            ++m_droppedFrames;
+            continue;
+        }
+
+        toRgb24(frame, buffer);
+
+        QTime t;
+        t.start();
+        process.write( buffer.constData(), buffer.size() );
+        while (process.bytesToWrite() > 0 && !isCancelled()) {
+            if (!process.waitForBytesWritten( 100 ) && process.state() == QProcess::NotRunning) {
+                break;
+            }
+        }
+        double const rate = ( buffer.size() * 1000.0 ) / ( qMax(1, t.elapsed()) * 1024 );
+        QMetaObject::invokeMethod(m_capture, "rateCalculated", Qt::QueuedConnection, Q_ARG(double, rate));
+
+        if (process.state() == QProcess::NotRunning) {
+            failed = true;
+            break;
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopped = true;
+        m_frames.clear();
+        m_frameTaken.wakeAll();
+    }
+
+    if (isCancelled()) {
+        process.kill();
+        process.waitForFinished();
+    } else if (process.state() != QProcess::NotRunning) {
+        process.closeWriteChannel();
+        process.waitForFinished(-1);
+        QMetaObject::invokeMethod(m_capture, "processWrittenMovie", Qt::QueuedConnection,
+                                  Q_ARG(int, process.exitCode()));
+    } else if (failed) {
+        QMetaObject::invokeMethod(m_capture, "processWrittenMovie", Qt::QueuedConnection,
+                                  Q_ARG(int, process.exitCode() ? process.exitCode() : -1));
+    }
+}
+
 class MovieCapturePrivate
 {
 public:
-    explicit MovieCapturePrivate(MarbleWidget *widget) :
-        marbleWidget(widget), method(MovieCapture::TimeDriven)
+    explicit MovieCapturePrivate(MarbleWidget *widget, MovieCapture *capture) :
+        marbleWidget(widget), method(MovieCapture::TimeDriven), recording(false), encoder(capture)
     {}
 
+    ~MovieCapturePrivate()
+    {
+        // Complete the movie with the frames recorded so far
+        encoder.finish();
+        encoder.wait();
+    }
+
     /**
      * @brief This gets called when user doesn't have avconv/ffmpeg installed
      */
@@ -46,14 +295,16 @@ public:
     MarbleWidget *marbleWidget;
     QString encoderExec;
     QString destinationFile;
-    QProcess process;
     MovieCapture::SnapshotMethod method;
     int fps;
+    /** Whether frames go to the current movie. The encoder may still be writing a stopped one. */
+    bool recording;
+    MovieEncoder encoder;
 };
 
 MovieCapture::MovieCapture(MarbleWidget *widget, QObject *parent) :
     QObject(parent),
-    d_ptr(new MovieCapturePrivate(widget))
+    d_ptr(new MovieCapturePrivate(widget, this))
 {
     Q_D(MovieCapture);
     if( d->method == MovieCapture::TimeDriven ){
@@ -163,33 +414,22 @@ bool MovieCapture::checkToolsAvailability()
 void MovieCapture::recordFrame()
 {
     Q_D(MovieCapture);
-    QImage const screenshot = d->marbleWidget->mapScreenShot().toImage().convertToFormat(QImage::Format_RGB888);
-    if (d->process.state() == QProcess::NotRunning) {
-        QStringList const arguments = QStringList()
-                << "-y"
-                << "-r" << QString::number(fps())
-                << "-f" << "rawvideo"
-                << "-pix_fmt" << "rgb24"
-                << "-s" << QString("%1x%2").arg( screenshot.width() ).arg( screenshot.height() )
-                << "-i" << "pipe:"
-                << "-b" << "2000k"
-                << d->destinationFile;
-        d->process.start( d->encoderExec, arguments );
-        connect(&d->process, SIGNAL(finished(int)), this, SLOT(processWrittenMovie(int)));
-    }
-    d->process.write( (char*) screenshot.bits(), screenshot.byteCount() );
-
-    for (int i=0; i<30 && d->process.bytesToWrite()>0; ++i) {
-        QTime t;
-        int then = d->process.bytesToWrite();
-        t.start();
-        d->process.waitForBytesWritten( 100 );
-        int span = t.elapsed();
-        int now = d->process.bytesToWrite();
-        int bytesWritten = then - now;
-        double rate = ( bytesWritten * 1000.0 ) / ( qMax(1, span) * 1024 );
-        emit rateCalculated( rate );
+    if (!d->recording) {
+        // A stopped movie may still be written, begin() waits for it
+        d->encoder.begin(d->encoderExec, d->destinationFile, fps());
+        d->recording = true;
     }
+
+    // Data driven recordings need every frame, live recordings rather drop
+    // frames than slow down the application when the encoder can't keep up
+    QImage const screenshot = d->marbleWidget->mapScreenShot().toImage();
+    d->encoder.enqueue(screenshot, d->method == MovieCapture::DataDriven);
+}
+
+int MovieCapture::droppedFrames() const
+{
+    Q_D(const MovieCapture);
+    return d->encoder.droppedFrames();
 }
 
 bool MovieCapture::startRecording()
@@ -213,7 +453,8 @@ void MovieCapture::stopRecording()
     Q_D(MovieCapture);
 
     d->frameTimer.stop();
-    d->process.closeWriteChannel();
+    d->recording = false;
+    d->encoder.finish();
 }
 
 void MovieCapture::cancelRecording()
@@ -221,7 +462,8 @@ void MovieCapture::cancelRecording()
     Q_D(MovieCapture);
 
     d->frameTimer.stop();
-    d->process.close();
+    d->recording = false;
+    d->encoder.cancel();
     QFile::remove( d->destinationFile );
 }
 
@@ -54,6 +54,14 @@ public:
     MovieCapture::SnapshotMethod snapshotMethod() const;
     bool checkToolsAvailability();
 
+    /**
+     * @brief Returns the number of frames of the current recording which were
+     * dropped because the encoder could not keep up. Frames are encoded in a
+     * separate thread. DataDriven recordings wait for the encoder instead of
+     * dropping frames.
+     */
+    int droppedFrames() const;
+
 public Q_SLOTS:
     void setFps(int fps);
     void setFilename(const QString &path);
@@ -0,0 +1,860 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "PackedStoragePolicy.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLockFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <QWriteLocker>
+
+#include <algorithm>
+
+#include "FileStoragePolicy.h"
+#include "MarbleDebug.h"
+#include "MarbleDirs.h"
+#include "MarbleGlobal.h"
+
+namespace Marble
+{
+
+namespace
+{
+
+const quint32 indexMagic = 0x4d54504b; // "MTPK"
+const quint32 indexVersion = 1;
+
+const QString indexFileName = "tiles.idx";
+const QString dataFileName = "tiles.pack";
+const QString lockFileName = "tiles.lock";
+
+enum IndexRecordType {
+    RemoveRecord = 0,
+    InsertRecord = 1
+};
+
+// The data file is only rewritten if at least half of it and more than
+// this number of bytes are unused.
+const quint64 minimumCompactionBytes = 4 * 1024 * 1024;
+
+// When evicting tiles, go down to 95% of the cache limit.
+const int softLimitPercent = 5;
+
+quint32 currentTime()
+{
+    return QDateTime::currentMSecsSinceEpoch() / 1000;
+}
+
+// Tiles are identified by a 64 bit FNV-1a hash of their path within the map
+// theme, which keeps the index small even for millions of tiles.
+quint64 tileKey( const QString &path )
+{
+    quint64 hash = Q_UINT64_C( 14695981039346656037 );
+    const ushort *it = path.utf16();
+    const ushort *const end = it + path.size();
+    for (; it != end; ++it ) {
+        hash = ( hash ^ *it ) * Q_UINT64_C( 1099511628211 );
+    }
+
+    return hash;
+}
+
+}
+
+// The tiles of one map theme: an append-only data file holding the tile
+// contents and an index file. While running, changes to the index are
+// appended as records to the index file. On destruction the index is
+// rewritten as one record per tile, including the last access times.
+//
+// The in-memory index is the only one that is up to date and compaction moves
+// the tiles around, so a container is owned by one process at a time. Other
+// processes, e.g. a second Marble instance, see an empty container and fall
+// back to plain files.
+//
+// Except for read(), the methods are called with the mutex of the policy held.
+// Tiles are read without it, each through a file handle of its own, so that
+// reading from disk doesn't block other lookups and the downloads.
+class PackedTileContainer
+{
+ public:
+    struct Entry
+    {
+        quint64 offset;
+        quint32 size;
+        quint32 storeTime;
+        quint32 accessTime;
+        quint8 level;
+    };
+
+    explicit PackedTileContainer( const QString &directory );
+    ~PackedTileContainer();
+
+    /**
+     * Returns false if another process uses this container.
+     */
+    bool isOwned() const;
+
+    bool contains( quint64 key ) const;
+
+    /**
+     * Looks up the tile @p key and marks it as used.
+     */
+    bool find( quint64 key, Entry *entry );
+
+    /**
+     * Reads the data of @p entry, which was found by find(), from the data
+     * file. dataFileLock() has to be locked for reading since then.
+     */
+    QByteArray read( const Entry &entry ) const;
+    QReadWriteLock *dataFileLock();
+
+    qint64 storeTime( quint64 key ) const;
+    bool insert( quint64 key, int level, const QByteArray &data, QString *errorMessage );
+    void remove( quint64 key );
+
+    quint64 size() const;
+    const QHash<quint64, Entry> &entries() const;
+
+    /**
+     * Drops the unused parts of the data file if that's worth it.
+     */
+    void compact();
+
+ private:
+    bool openDataFile();
+    bool openIndexFile();
+    void readIndex();
+    bool writeIndex();
+    void appendIndexRecord( IndexRecordType type, quint64 key, const Entry &entry );
+
+    const QString m_directory;
+    QLockFile m_lockFile;
+    QFile m_dataFile;
+    QFile m_indexFile;
+    // Held for reading while tiles are read, for writing while the data file
+    // is replaced or removed
+    QReadWriteLock m_dataFileLock;
+    QHash<quint64, Entry> m_entries;
+    quint64 m_size;
+    bool m_indexChanged;
+};
+
+PackedTileContainer::PackedTileContainer( const QString &directory )
+    : m_directory( directory ),
+      m_lockFile( directory + '/' + lockFileName ),
+      m_dataFile( directory + '/' + dataFileName ),
+      m_indexFile( directory + '/' + indexFileName ),
+      m_size( 0 ),
+      m_indexChanged( false )
+{
+    // The lock is held as long as the container exists. It is only stale
+    // once its process is gone.
+    m_lockFile.setStaleLockTime( 0 );
+    if ( !QDir().mkpath( m_directory ) || !m_lockFile.tryLock( 0 ) ) {
+        mDebug() << "Tiles in" << m_directory << "are in use by another process, storing plain files";
+        return;
+    }
+
+    readIndex();
+}
+
+PackedTileContainer::~PackedTileContainer()
+{
+    if ( m_indexChanged ) {
+        writeIndex();
+    }
+}
+
+bool PackedTileContainer::isOwned() const
+{
+    return m_lockFile.isLocked();
+}
+
+bool PackedTileContainer::contains( quint64 key ) const
+{
+    return m_entries.contains( key );
+}
+
+bool PackedTileContainer::find( quint64 key, Entry *entry )
+{
+    QHash<quint64, Entry>::iterator const it = m_entries.find( key );
+    if ( it == m_entries.end() ) {
+        return false;
+    }
+
+    it->accessTime = currentTime();
+    m_indexChanged = true;
+
+    *entry = *it;
+
+    return true;
+}
+
+QByteArray PackedTileContainer::read( const Entry &entry ) const
+{
+    QFile file( m_dataFile.fileName() );
+    if ( !file.open( QIODevice::ReadOnly ) || !file.seek( entry.offset ) ) {
+        return QByteArray();
+    }
+
+    QByteArray data = file.read( entry.size );
+    if ( data.size() != int( entry.size ) ) {
+        mDebug() << "Truncated tile in" << file.fileName();
+        data.clear();
+    }
+
+    return data;
+}
+
+QReadWriteLock *PackedTileContainer::dataFileLock()
+{
+    return &m_dataFileLock;
+}
+
+qint64 PackedTileContainer::storeTime( quint64 key ) const
+{
+    QHash<quint64, Entry>::const_iterator const it = m_entries.constFind( key );
+    return it == m_entries.constEnd() ? -1 : it->storeTime;
+}
+
+bool PackedTileContainer::insert( quint64 key, int level, const QByteArray &data, QString *errorMessage )
+{
+    if ( !isOwned() ) {
+        *errorMessage = QString( "%1: in use by another process" ).arg( m_directory );
+        return false;
+    }
+
+    if ( !openDataFile() || !openIndexFile() ) {
+        *errorMessage = QString( "%1: %2" ).arg( m_directory ).arg( m_dataFile.isOpen() ? m_indexFile.errorString()
+                                                                                          : m_dataFile.errorString() );
+        return false;
+    }
+
+    const quint64 offset = m_dataFile.size();
+    if ( !m_dataFile.seek( offset ) || m_dataFile.write( data ) != data.size() || !m_dataFile.flush() ) {
+        *errorMessage = QString( "%1: %2" ).arg( m_dataFile.fileName() ).arg( m_dataFile.errorString() );
+        return false;
+    }
+
+    const quint32 now = currentTime();
+    Entry entry;
+    entry.offset = offset;
+    entry.size = data.size();
+    entry.storeTime = now;
+    entry.accessTime = now;
+    entry.level = level;
+
+    QHash<quint64, Entry>::iterator const it = m_entries.find( key );
+    if ( it != m_entries.end() ) {
+        m_size -= it->size;
+    }
+    m_entries.insert( key, entry );
+    m_size += entry.size;
+
+    appendIndexRecord( InsertRecord, key, entry );
+
+    return true;
+}
+
+void PackedTileContainer::remove( quint64 key )
+{
+    QHash<quint64, Entry>::iterator const it = m_entries.find( key );
+    if ( it == m_entries.end() ) {
+        return;
+    }
+
+    const Entry entry = *it;
+    m_size -= entry.size;
+    m_entries.erase( it );
+
+    if ( openIndexFile() ) {
+        appendIndexRecord( RemoveRecord, key, entry );
+    }
+}
+
+quint64 PackedTileContainer::size() const
+{
+    return m_size;
+}
+
+const QHash<quint64, PackedTileContainer::Entry> &PackedTileContainer::entries() const
+{
+    return m_entries;
+}
+
+void PackedTileContainer::compact()
+{
+    if ( !isOwned() ) {
+        return;
+    }
+
+    if ( m_entries.isEmpty() ) {
+        QWriteLocker fileLocker( &m_dataFileLock );
+        m_dataFile.close();
+        m_indexFile.close();
+        QFile::remove( m_dataFile.fileName() );
+        QFile::remove( m_indexFile.fileName() );
+        m_size = 0;
+        m_indexChanged = false;
+        return;
+    }
+
+    if ( !openDataFile() ) {
+        return;
+    }
+
+    const quint64 unusedBytes = m_dataFile.size() - m_size;
+    if ( unusedBytes < minimumCompactionBytes || unusedBytes < m_size ) {
+        return;
+    }
+
+    mDebug() << "Compacting" << m_dataFile.fileName() << "dropping" << unusedBytes << "bytes";
+
+    QFile compactFile( m_dataFile.fileName() + ".new" );
+    if ( !compactFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        return;
+    }
+
+    QHash<quint64, Entry> compactEntries;
+    compactEntries.reserve( m_entries.size() );
+
+    QHash<quint64, Entry>::const_iterator it = m_entries.constBegin();
+    QHash<quint64, Entry>::const_iterator const end = m_entries.constEnd();
+    for (; it != end; ++it ) {
+        if ( !m_dataFile.seek( it->offset ) ) {
+            continue;
+        }
+        const QByteArray data = m_dataFile.read( it->size );
+        if ( data.size() != int( it->size ) ) {
+            continue;
+        }
+
+        Entry entry = *it;
+        entry.offset = compactFile.pos();
+        if ( compactFile.write( data ) != data.size() ) {
+            compactFile.close();
+            compactFile.remove();
+            return;
+        }
+        compactEntries.insert( it.key(), entry );
+    }
+    compactFile.close();
+
+    QWriteLocker fileLocker( &m_dataFileLock );
+    m_dataFile.close();
+    m_indexFile.close();
+    QFile::remove( m_dataFile.fileName() );
+    if ( !compactFile.rename( m_dataFile.fileName() ) ) {
+        qWarning() << "Could not replace" << m_dataFile.fileName() << compactFile.errorString();
+        compactEntries.clear();
+    }
+
+    m_entries = compactEntries;
+    m_size = 0;
+    foreach ( const Entry &entry, m_entries ) {
+        m_size += entry.size;
+    }
+
+    m_indexChanged = !writeIndex();
+}
+
+bool PackedTileContainer::openDataFile()
+{
+    if ( m_dataFile.isOpen() ) {
+        return true;
+    }
+
+    if ( !QDir().mkpath( m_directory ) ) {
+        return false;
+    }
+
+    return m_dataFile.open( QIODevice::ReadWrite ) || m_dataFile.open( QIODevice::ReadOnly );
+}
+
+bool PackedTileContainer::openIndexFile()
+{
+    if ( m_indexFile.isOpen() ) {
+        return true;
+    }
+
+    if ( !QDir().mkpath( m_directory ) || !m_indexFile.open( QIODevice::WriteOnly | QIODevice::Append ) ) {
+        return false;
+    }
+
+    if ( m_indexFile.size() == 0 ) {
+        QDataStream stream( &m_indexFile );
+        stream.setVersion( QDataStream::Qt_4_8 );
+        stream << indexMagic << indexVersion;
+    }
+
+    return true;
+}
+
+void PackedTileContainer::readIndex()
+{
+    if ( !m_indexFile.exists() ) {
+        return;
+    }
+
+    if ( !m_indexFile.open( QIODevice::ReadOnly ) ) {
+        qWarning() << "Unable to open tile index" << m_indexFile.fileName() << m_indexFile.errorString();
+        return;
+    }
+
+    const quint64 dataSize = QFileInfo( m_dataFile ).size();
+
+    QDataStream stream( &m_indexFile );
+    stream.setVersion( QDataStream::Qt_4_8 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+
+    bool valid = magic == indexMagic && version == indexVersion;
+    while ( valid && !stream.atEnd() ) {
+        quint8 type = RemoveRecord;
+        quint64 key = 0;
+        Entry entry;
+        stream >> type >> key;
+        if ( type == InsertRecord ) {
+            stream >> entry.offset >> entry.size >> entry.storeTime >> entry.accessTime >> entry.level;
+        }
+
+        // A record might have been cut off by a crash. Drop it as well as
+        // tiles whose data didn't make it to the disk.
+        if ( stream.status() != QDataStream::Ok ) {
+            valid = false;
+        }
+        else if ( type == InsertRecord && entry.offset + entry.size <= dataSize ) {
+            m_entries.insert( key, entry );
+        }
+        else {
+            m_entries.remove( key );
+        }
+    }
+
+    m_indexFile.close();
+
+    foreach ( const Entry &entry, m_entries ) {
+        m_size += entry.size;
+    }
+
+    if ( !valid ) {
+        mDebug() << "Repairing tile index" << m_indexFile.fileName();
+        writeIndex();
+    }
+}
+
+bool PackedTileContainer::writeIndex()
+{
+    m_indexFile.close();
+
+    QSaveFile file( m_indexFile.fileName() );
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        return false;
+    }
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_8 );
+    stream << indexMagic << indexVersion;
+
+    QHash<quint64, Entry>::const_iterator it = m_entries.constBegin();
+    QHash<quint64, Entry>::const_iterator const end = m_entries.constEnd();
+    for (; it != end; ++it ) {
+        stream << quint8( InsertRecord ) << it.key()
+               << it->offset << it->size << it->storeTime << it->accessTime << it->level;
+    }
+
+    return file.commit();
+}
+
+void PackedTileContainer::appendIndexRecord( IndexRecordType type, quint64 key, const Entry &entry )
+{
+    QDataStream stream( &m_indexFile );
+    stream.setVersion( QDataStream::Qt_4_8 );
+    stream << quint8( type ) << key;
+    if ( type == InsertRecord ) {
+        stream << entry.offset << entry.size << entry.storeTime << entry.accessTime << entry.level;
+    }
+    m_indexFile.flush();
+
+    m_indexChanged = true;
+}
+
+
+class PackedStoragePolicy::Private
+{
+ public:
+    // Evicts the least recently used tiles in the background.
+    class EvictionJob : public QRunnable
+    {
+     public:
+        explicit EvictionJob( Private *d ) : m_d( d ) {}
+        void run() { m_d->evictTiles(); }
+
+     private:
+        Private *const m_d;
+    };
+
+    explicit Private( const QString &dataDirectory );
+    ~Private();
+
+    static bool splitFileName( const QString &fileName, QString *containerName, quint64 *key, int *level );
+
+    PackedTileContainer *container( const QString &containerName );
+    void loadAllContainers();
+    quint64 cacheSize() const;
+    void scheduleEviction();
+    void evictTiles();
+
+    QString m_dataDirectory;
+    FileStoragePolicy m_fileStoragePolicy;
+    QHash<QString, PackedTileContainer *> m_containers;
+    bool m_allContainersLoaded;
+    quint64 m_cacheLimit;
+    QString m_errorMsg;
+    QMutex m_mutex;
+    QThreadPool m_evictionPool;
+    bool m_evictionPending;
+};
+
+PackedStoragePolicy::Private::Private( const QString &dataDirectory )
+    : m_dataDirectory( dataDirectory.isEmpty() ? MarbleDirs::localPath() + "/cache/" : dataDirectory ),
+      m_fileStoragePolicy( m_dataDirectory ),
+      m_allContainersLoaded( false ),
+      m_cacheLimit( 0 ),
+      m_evictionPending( false )
+{
+    m_evictionPool.setMaxThreadCount( 1 );
+}
+
+PackedStoragePolicy::Private::~Private()
+{
+    m_evictionPool.waitForDone();
+    qDeleteAll( m_containers );
+}
+
+bool PackedStoragePolicy::Private::splitFileName( const QString &fileName, QString *containerName, quint64 *key, int *level )
+{
+    if ( QFileInfo( fileName ).isAbsolute() ) {
+        return false;
+    }
+
+    // maps/<planet>/<theme>/<level>/<column or row>/<tile>.<suffix>
+    const QStringList parts = fileName.split( '/', QString::SkipEmptyParts );
+    if ( parts.size() != 6 || parts.first() != QLatin1String( "maps" ) ) {
+        return false;
+    }
+
+    const QString suffix = QFileInfo( parts.last() ).suffix().toLower();
+    if ( suffix != QLatin1String( "jpg" )
+         && suffix != QLatin1String( "jpeg" )
+         && suffix != QLatin1String( "png" )
+         && suffix != QLatin1String( "gif" ) ) {
+        return false;
+    }
+
+    if ( containerName ) {
+        *containerName = QStringList( parts.mid( 0, 3 ) ).join( "/" );
+    }
+    if ( key ) {
+        *key = tileKey( QStringList( parts.mid( 3 ) ).join( "/" ) );
+    }
+    if ( level ) {
+        *level = parts.at( 3 ).toInt();
+    }
+
+    return true;
+}
+
+PackedTileContainer *PackedStoragePolicy::Private::container( const QString &containerName )
+{
+    PackedTileContainer *result = m_containers.value( containerName, 0 );
+    if ( !result ) {
+        result = new PackedTileContainer( m_dataDirectory + '/' + containerName );
+        m_containers.insert( containerName, result );
+    }
+
+    return result;
+}
+
+void PackedStoragePolicy::Private::loadAllContainers()
+{
+    if ( m_allContainersLoaded ) {
+        return;
+    }
+
+    // Only maps/<planet>/<theme>/ needs to be looked at, not the tiles below.
+    QDirIterator planets( m_dataDirectory + "/maps", QDir::Dirs | QDir::NoDotAndDotDot );
+    while ( planets.hasNext() ) {
+        planets.next();
+        QDirIterator themes( planets.filePath(), QDir::Dirs | QDir::NoDotAndDotDot );
+        while ( themes.hasNext() ) {
+            themes.next();
+            if ( QFile::exists( themes.filePath() + '/' + indexFileName ) ) {
+                container( "maps/" + planets.fileName() + '/' + themes.fileName() );
+            }
+        }
+    }
+
+    m_allContainersLoaded = true;
+}
+
+quint64 PackedStoragePolicy::Private::cacheSize() const
+{
+    quint64 result = 0;
+    foreach ( const PackedTileContainer *container, m_containers ) {
+        result += container->size();
+    }
+
+    return result;
+}
+
+void PackedStoragePolicy::Private::scheduleEviction()
+{
+    if ( m_evictionPending || m_cacheLimit == 0 ) {
+        return;
+    }
+
+    // Reading the indexes of the other map themes is left to the job as well.
+    if ( m_allContainersLoaded && cacheSize() <= m_cacheLimit ) {
+        return;
+    }
+
+    m_evictionPending = true;
+    m_evictionPool.start( new EvictionJob( this ) );
+}
+
+void PackedStoragePolicy::Private::evictTiles()
+{
+    // Like FileStorageWatcher, keep the tiles of the lowest levels.
+    typedef QPair<quint32, QPair<PackedTileContainer *, quint64> > Candidate;
+    QVector<Candidate> candidates;
+    quint64 softLimit = 0;
+
+    {
+        QMutexLocker locker( &m_mutex );
+        m_evictionPending = false;
+
+        if ( m_cacheLimit == 0 ) {
+            return;
+        }
+
+        loadAllContainers();
+
+        if ( cacheSize() <= m_cacheLimit ) {
+            return;
+        }
+
+        softLimit = m_cacheLimit / 100 * ( 100 - softLimitPercent );
+        foreach ( PackedTileContainer *container, m_containers ) {
+            QHash<quint64, PackedTileContainer::Entry>::const_iterator it = container->entries().constBegin();
+            QHash<quint64, PackedTileContainer::Entry>::const_iterator const end = container->entries().constEnd();
+            for (; it != end; ++it ) {
+                if ( it->level >= maxBaseTileLevel ) {
+                    candidates.append( Candidate( it->accessTime, qMakePair( container, it.key() ) ) );
+                }
+            }
+        }
+    }
+
+    // Sorting takes a while for large caches, tiles can be looked up meanwhile.
+    std::sort( candidates.begin(), candidates.end() );
+
+    QMutexLocker locker( &m_mutex );
+
+    quint64 currentSize = cacheSize();
+    QVector<Candidate>::const_iterator it = candidates.constBegin();
+    QVector<Candidate>::const_iterator const end = candidates.constEnd();
+    for (; it != end && currentSize > softLimit; ++it ) {
+        PackedTileContainer *const container = it->second.first;
+        const quint64 key = it->second.second;
+
+        // Keep the tiles which were used or updated since sorting.
+        QHash<quint64, PackedTileContainer::Entry>::const_iterator const entry = container->entries().constFind( key );
+        if ( entry == container->entries().constEnd() || entry->accessTime != it->first ) {
+            continue;
+        }
+
+        const quint64 oldSize = container->size();
+        container->remove( key );
+        currentSize -= oldSize - container->size();
+    }
+
+    foreach ( PackedTileContainer *container, m_containers ) {
+        container->compact();
+    }
+}
+
+
+PackedStoragePolicy::PackedStoragePolicy( const QString &dataDirectory, QObject *parent )
+    : StoragePolicy( parent ),
+      d( new Private( dataDirectory ) )
+{
+    // Only plain files are accounted for, FileStorageWatcher doesn't know
+    // about packed tiles.
+    connect( &d->m_fileStoragePolicy, SIGNAL(sizeChanged(qint64)),
+             this, SIGNAL(sizeChanged(qint64)) );
+}
+
+PackedStoragePolicy::~PackedStoragePolicy()
+{
+    delete d;
+}
+
+bool PackedStoragePolicy::fileExists( const QString &fileName ) const
+{
+    QString containerName;
+    quint64 key = 0;
+    if ( Private::splitFileName( fileName, &containerName, &key, 0 ) ) {
+        QMutexLocker locker( &d->m_mutex );
+        if ( d->container( containerName )->contains( key ) ) {
+            return true;
+        }
+    }
+
+    return d->m_fileStoragePolicy.fileExists( fileName );
+}
+
+bool PackedStoragePolicy::updateFile( const QString &fileName, const QByteArray &data )
+{
+    QString containerName;
+    quint64 key = 0;
+    int level = 0;
+    if ( !Private::splitFileName( fileName, &containerName, &key, &level ) ) {
+        return d->m_fileStoragePolicy.updateFile( fileName, data );
+    }
+
+    QMutexLocker locker( &d->m_mutex );
+    PackedTileContainer *const container = d->container( containerName );
+    if ( !container->isOwned() ) {
+        locker.unlock();
+        return d->m_fileStoragePolicy.updateFile( fileName, data );
+    }
+
+    if ( !container->insert( key, level, data, &d->m_errorMsg ) ) {
+        qCritical() << "PackedStoragePolicy::updateFile" << d->m_errorMsg;
+        return false;
+    }
+
+    d->scheduleEviction();
+
+    return true;
+}
+
+void PackedStoragePolicy::clearCache()
+{
+    {
+        QMutexLocker locker( &d->m_mutex );
+
+        d->loadAllContainers();
+
+        // Like FileStoragePolicy, keep the tiles of the lowest levels.
+        foreach ( PackedTileContainer *container, d->m_containers ) {
+            QList<quint64> keys;
+            QHash<quint64, PackedTileContainer::Entry>::const_iterator it = container->entries().constBegin();
+            QHash<quint64, PackedTileContainer::Entry>::const_iterator const end = container->entries().constEnd();
+            for (; it != end; ++it ) {
+                if ( it->level > maxBaseTileLevel ) {
+                    keys.append( it.key() );
+                }
+            }
+            foreach ( quint64 key, keys ) {
+                container->remove( key );
+            }
+            container->compact();
+        }
+    }
+
+    d->m_fileStoragePolicy.clearCache();
+}
+
+QString PackedStoragePolicy::lastErrorMessage() const
+{
+    QMutexLocker locker( &d->m_mutex );
+    return d->m_errorMsg.isEmpty() ? d->m_fileStoragePolicy.lastErrorMessage() : d->m_errorMsg;
+}
+
+bool PackedStoragePolicy::isPackable( const QString &fileName )
+{
+    return Private::splitFileName( fileName, 0, 0, 0 );
+}
+
+QByteArray PackedStoragePolicy::data( const QString &fileName ) const
+{
+    QString containerName;
+    quint64 key = 0;
+    QByteArray result;
+    if ( !Private::splitFileName( fileName, &containerName, &key, 0 ) ) {
+        return result;
+    }
+
+    QMutexLocker locker( &d->m_mutex );
+    PackedTileContainer *const container = d->container( containerName );
+    PackedTileContainer::Entry entry;
+    if ( container->find( key, &entry ) ) {
+        // The data file is only replaced while holding both locks, so the
+        // entry stays valid while reading from disk without blocking others
+        QReadLocker fileLocker( container->dataFileLock() );
+        locker.unlock();
+        result = container->read( entry );
+    }
+
+    return result;
+}
+
+QDateTime PackedStoragePolicy::lastModified( const QString &fileName ) const
+{
+    QString containerName;
+    quint64 key = 0;
+    if ( !Private::splitFileName( fileName, &containerName, &key, 0 ) ) {
+        return QDateTime();
+    }
+
+    QMutexLocker locker( &d->m_mutex );
+    const qint64 storeTime = d->container( containerName )->storeTime( key );
+    return storeTime < 0 ? QDateTime() : QDateTime::fromMSecsSinceEpoch( storeTime * 1000 );
+}
+
+void PackedStoragePolicy::setCacheLimit( quint64 bytes )
+{
+    QMutexLocker locker( &d->m_mutex );
+    d->m_cacheLimit = bytes;
+    d->scheduleEviction();
+}
+
+quint64 PackedStoragePolicy::cacheLimit() const
+{
+    QMutexLocker locker( &d->m_mutex );
+    return d->m_cacheLimit;
+}
+
+quint64 PackedStoragePolicy::cacheSize() const
+{
+    QMutexLocker locker( &d->m_mutex );
+    return d->cacheSize();
+}
+
+}
+
+#include "moc_PackedStoragePolicy.cpp"
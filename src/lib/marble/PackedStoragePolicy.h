@@ -0,0 +1,115 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_PACKEDSTORAGEPOLICY_H
+#define MARBLE_PACKEDSTORAGEPOLICY_H
+
+#include "StoragePolicy.h"
+
+#include "marble_export.h"
+
+class QByteArray;
+class QDateTime;
+class QString;
+
+namespace Marble
+{
+
+/**
+ * @short Storage policy which packs the downloaded tiles of a map theme into one file.
+ *
+ * Image tiles below maps/<planet>/<theme>/ are appended to a single data file
+ * per map theme. An index next to it keeps the position, size, download time
+ * and last access time of each tile, so looking up a tile doesn't touch the
+ * file system. Once the cache limit is exceeded, the least recently used tiles
+ * are evicted in the background.
+ *
+ * All other files are stored as plain files, just like FileStoragePolicy does.
+ * So are the tiles of a map theme whose packed file is in use by another process.
+ *
+ * The methods of this class may be called from multiple threads.
+ */
+class MARBLE_EXPORT PackedStoragePolicy : public StoragePolicy
+{
+    Q_OBJECT
+
+    public:
+        /**
+         * Creates a new packed storage policy.
+         *
+         * @param dataDirectory The directory where the data should go to.
+         */
+        explicit PackedStoragePolicy( const QString &dataDirectory = QString(), QObject *parent = 0 );
+
+        /**
+         * Destroys the packed storage policy and writes back the indexes.
+         */
+        ~PackedStoragePolicy();
+
+        /**
+         * Returns whether the @p fileName exists already.
+         */
+        bool fileExists( const QString &fileName ) const;
+
+        /**
+         * Updates the @p fileName with the given @p data.
+         */
+        bool updateFile( const QString &fileName, const QByteArray &data );
+
+        /**
+         * Clears the cache.
+         */
+        void clearCache();
+
+        /**
+         * Returns the last error message.
+         */
+        QString lastErrorMessage() const;
+
+        /**
+         * Returns whether @p fileName is kept in a packed file rather than as a plain file.
+         */
+        static bool isPackable( const QString &fileName );
+
+        /**
+         * Returns the content of the packed @p fileName, or an empty byte array
+         * if it is not stored in a packed file.
+         */
+        QByteArray data( const QString &fileName ) const;
+
+        /**
+         * Returns when the packed @p fileName was stored, or an invalid date
+         * if it is not stored in a packed file.
+         */
+        QDateTime lastModified( const QString &fileName ) const;
+
+        /**
+         * Sets the limit of the packed files in @p bytes. 0 means no limit.
+         */
+        void setCacheLimit( quint64 bytes );
+
+        /**
+         * Returns the limit of the packed files in bytes.
+         */
+        quint64 cacheLimit() const;
+
+        /**
+         * Returns the size of all tiles stored in packed files.
+         */
+        quint64 cacheSize() const;
+
+    private:
+        Q_DISABLE_COPY( PackedStoragePolicy )
+
+        class Private;
+        Private * const d;
+};
+
+}
+
+#endif
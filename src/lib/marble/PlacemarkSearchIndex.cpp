@@ -0,0 +1,365 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "PlacemarkSearchIndex.h"
+
+#include "GeoDataLatLonBox.h"
+#include "GeoDataPlacemark.h"
+#include "MarbleDebug.h"
+#include "MarblePlacemarkModel.h"
+#include "MarblePlacemarkModel_P.h"
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QTime>
+#include <QWriteLocker>
+
+#include <algorithm>
+
+namespace Marble
+{
+
+namespace
+{
+
+struct Entry
+{
+    QString name;
+    GeoDataPlacemark *placemark;
+    qreal longitude;
+    qreal latitude;
+};
+
+bool lessThanByName( const Entry &one, const Entry &two )
+{
+    return one.name < two.name;
+}
+
+bool nameLessThan( const Entry &entry, const QString &name )
+{
+    return entry.name < name;
+}
+
+}
+
+class Q_DECL_HIDDEN PlacemarkSearchIndex::Private
+{
+ public:
+    Private();
+
+    void addRows( const QModelIndex &parent, int first, int last );
+
+    void removeRows( const QModelIndex &parent, int first, int last );
+
+    void updateRows( const QModelIndex &topLeft, const QModelIndex &bottomRight );
+
+    void rebuild();
+
+    GeoDataPlacemark *placemark( int row, const QModelIndex &parent ) const;
+
+    Entry entry( int row, const QModelIndex &parent ) const;
+
+    void insert( const QVector<Entry> &entries );
+
+    void remove( const QSet<const GeoDataPlacemark *> &placemarks );
+
+    bool hasPendingChanges() const;
+
+    void applyPendingChanges() const;
+
+    QVector<GeoDataPlacemark*> find( const QString &prefix, const GeoDataLatLonBox &preferred ) const;
+
+    const QAbstractItemModel *m_model;
+
+    /** The indexed name and position of each placemark. Only used in the thread of m_model. */
+    QHash<const GeoDataPlacemark *, Entry> m_indexed;
+
+    // Row changes are only collected, and merged into m_entries by the next
+    // search. Merging on each change would copy the whole index every time a
+    // file gets opened in several chunks. All of them are guarded by m_lock.
+
+    /** All entries, sorted by name, without the pending changes */
+    mutable QVector<Entry> m_entries;
+
+    /** The entries to add to m_entries */
+    mutable QHash<const GeoDataPlacemark *, Entry> m_pendingInsertions;
+
+    /** The placemarks whose entries are to be removed from m_entries */
+    mutable QSet<const GeoDataPlacemark *> m_pendingRemovals;
+
+    mutable QReadWriteLock m_lock;
+};
+
+PlacemarkSearchIndex::Private::Private() :
+    m_model( 0 )
+{
+    // nothing to do
+}
+
+GeoDataPlacemark *PlacemarkSearchIndex::Private::placemark( int row, const QModelIndex &parent ) const
+{
+    QModelIndex const index = m_model->index( row, 0, parent );
+    GeoDataObject *object = qvariant_cast<GeoDataObject *>( index.data( MarblePlacemarkModel::ObjectPointerRole ) );
+    return dynamic_cast<GeoDataPlacemark *>( object );
+}
+
+Entry PlacemarkSearchIndex::Private::entry( int row, const QModelIndex &parent ) const
+{
+    QModelIndex const index = m_model->index( row, 0, parent );
+    Entry result;
+    result.placemark = placemark( row, parent );
+    result.name = normalized( index.data( Qt::DisplayRole ).toString() );
+    result.longitude = 0.0;
+    result.latitude = 0.0;
+    if ( result.placemark ) {
+        GeoDataCoordinates const coordinate = result.placemark->coordinate();
+        result.longitude = coordinate.longitude();
+        result.latitude = coordinate.latitude();
+    }
+    return result;
+}
+
+void PlacemarkSearchIndex::Private::insert( const QVector<Entry> &entries )
+{
+    if ( entries.isEmpty() ) {
+        return;
+    }
+
+    QWriteLocker locker( &m_lock );
+    foreach ( const Entry &entry, entries ) {
+        m_indexed.insert( entry.placemark, entry );
+        m_pendingInsertions.insert( entry.placemark, entry );
+    }
+}
+
+void PlacemarkSearchIndex::Private::remove( const QSet<const GeoDataPlacemark *> &placemarks )
+{
+    if ( placemarks.isEmpty() ) {
+        return;
+    }
+
+    QWriteLocker locker( &m_lock );
+    foreach ( const GeoDataPlacemark *placemark, placemarks ) {
+        m_indexed.remove( placemark );
+        // Entries that are still pending never made it into m_entries
+        if ( !m_pendingInsertions.remove( placemark ) ) {
+            m_pendingRemovals.insert( placemark );
+        }
+    }
+}
+
+bool PlacemarkSearchIndex::Private::hasPendingChanges() const
+{
+    return !m_pendingInsertions.isEmpty() || !m_pendingRemovals.isEmpty();
+}
+
+void PlacemarkSearchIndex::Private::applyPendingChanges() const
+{
+    // Expects m_lock to be locked for writing.
+    // The removals go first: a removed placemark may have been deleted, and
+    // a new one created at its address is among the pending insertions.
+    QVector<Entry> remaining;
+    if ( m_pendingRemovals.isEmpty() ) {
+        remaining = m_entries;
+    } else {
+        remaining.reserve( m_entries.size() );
+        foreach ( const Entry &entry, m_entries ) {
+            if ( !m_pendingRemovals.contains( entry.placemark ) ) {
+                remaining << entry;
+            }
+        }
+    }
+
+    // Sort the new entries and merge them in one pass instead of inserting
+    // them one by one, which would move the whole index for each of them
+    QVector<Entry> entries;
+    entries.reserve( m_pendingInsertions.size() );
+    foreach ( const Entry &entry, m_pendingInsertions ) {
+        entries << entry;
+    }
+    std::sort( entries.begin(), entries.end(), lessThanByName );
+
+    QVector<Entry> merged( remaining.size() + entries.size() );
+    std::merge( remaining.constBegin(), remaining.constEnd(), entries.constBegin(), entries.constEnd(),
+                merged.begin(), lessThanByName );
+
+    m_entries.swap( merged );
+    m_pendingInsertions.clear();
+    m_pendingRemovals.clear();
+}
+
+QVector<GeoDataPlacemark*> PlacemarkSearchIndex::Private::find( const QString &prefix, const GeoDataLatLonBox &preferred ) const
+{
+    bool const searchEverywhere = preferred.isEmpty();
+    QVector<GeoDataPlacemark*> result;
+
+    QVector<Entry>::const_iterator iter = std::lower_bound( m_entries.constBegin(), m_entries.constEnd(),
+                                                            prefix, nameLessThan );
+    for ( ; iter != m_entries.constEnd() && iter->name.startsWith( prefix ); ++iter ) {
+        if ( searchEverywhere || preferred.contains( GeoDataCoordinates( iter->longitude, iter->latitude ) ) ) {
+            result << new GeoDataPlacemark( *iter->placemark );
+        }
+    }
+
+    return result;
+}
+
+void PlacemarkSearchIndex::Private::addRows( const QModelIndex &parent, int first, int last )
+{
+    QVector<Entry> entries;
+    entries.reserve( last - first + 1 );
+    for ( int row = first; row <= last; ++row ) {
+        Entry const entry = this->entry( row, parent );
+        if ( entry.placemark && !m_indexed.contains( entry.placemark ) ) {
+            entries << entry;
+        }
+    }
+
+    insert( entries );
+}
+
+void PlacemarkSearchIndex::Private::removeRows( const QModelIndex &parent, int first, int last )
+{
+    QSet<const GeoDataPlacemark *> placemarks;
+    for ( int row = first; row <= last; ++row ) {
+        GeoDataPlacemark const *placemark = this->placemark( row, parent );
+        if ( placemark && m_indexed.contains( placemark ) ) {
+            placemarks << placemark;
+        }
+    }
+
+    remove( placemarks );
+}
+
+void PlacemarkSearchIndex::Private::updateRows( const QModelIndex &topLeft, const QModelIndex &bottomRight )
+{
+    if ( !topLeft.isValid() || !bottomRight.isValid() ) {
+        return;
+    }
+
+    QSet<const GeoDataPlacemark *> changed;
+    QVector<Entry> entries;
+    for ( int row = topLeft.row(); row <= bottomRight.row(); ++row ) {
+        Entry const entry = this->entry( row, topLeft.parent() );
+        if ( !entry.placemark ) {
+            continue;
+        }
+
+        QHash<const GeoDataPlacemark *, Entry>::const_iterator const indexed = m_indexed.constFind( entry.placemark );
+        if ( indexed == m_indexed.constEnd() ) {
+            entries << entry;
+        } else if ( indexed->name != entry.name || indexed->longitude != entry.longitude || indexed->latitude != entry.latitude ) {
+            changed << entry.placemark;
+            entries << entry;
+        }
+    }
+
+    remove( changed );
+    insert( entries );
+}
+
+void PlacemarkSearchIndex::Private::rebuild()
+{
+    QTime t;
+    t.start();
+
+    QVector<Entry> entries;
+    m_indexed.clear();
+    if ( m_model ) {
+        int const rowCount = m_model->rowCount();
+        entries.reserve( rowCount );
+        for ( int row = 0; row < rowCount; ++row ) {
+            Entry const entry = this->entry( row, QModelIndex() );
+            if ( entry.placemark && !m_indexed.contains( entry.placemark ) ) {
+                m_indexed.insert( entry.placemark, entry );
+                entries << entry;
+            }
+        }
+        std::sort( entries.begin(), entries.end(), lessThanByName );
+    }
+
+    QWriteLocker locker( &m_lock );
+    m_entries.swap( entries );
+    m_pendingInsertions.clear();
+    m_pendingRemovals.clear();
+
+    mDebug() << "Indexed" << m_entries.size() << "placemarks in" << t.elapsed() << "ms";
+}
+
+PlacemarkSearchIndex::PlacemarkSearchIndex( QObject *parent ) :
+    QObject( parent ),
+    d( new Private )
+{
+    // nothing to do
+}
+
+PlacemarkSearchIndex::~PlacemarkSearchIndex()
+{
+    delete d;
+}
+
+void PlacemarkSearchIndex::setSourceModel( const QAbstractItemModel *model )
+{
+    if ( d->m_model ) {
+        disconnect( d->m_model, 0, this, 0 );
+    }
+
+    d->m_model = model;
+
+    if ( model ) {
+        connect( model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                 this, SLOT(addRows(QModelIndex,int,int)) );
+        connect( model, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+                 this, SLOT(removeRows(QModelIndex,int,int)) );
+        connect( model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                 this, SLOT(updateRows(QModelIndex,QModelIndex)) );
+        connect( model, SIGNAL(modelReset()),
+                 this, SLOT(rebuild()) );
+    }
+
+    d->rebuild();
+}
+
+int PlacemarkSearchIndex::size() const
+{
+    QReadLocker locker( &d->m_lock );
+    // Pending removals only refer to entries of m_entries
+    return d->m_entries.size() - d->m_pendingRemovals.size() + d->m_pendingInsertions.size();
+}
+
+QVector<GeoDataPlacemark*> PlacemarkSearchIndex::findPlacemarks( const QString &searchTerm,
+                                                                 const GeoDataLatLonBox &preferred ) const
+{
+    QString const prefix = normalized( searchTerm );
+
+    // The placemarks are copied while the lock is held, so they can't be
+    // removed from the model and deleted in the meantime
+    QReadLocker readLocker( &d->m_lock );
+    if ( !d->hasPendingChanges() ) {
+        return d->find( prefix, preferred );
+    }
+
+    readLocker.unlock();
+    QWriteLocker writeLocker( &d->m_lock );
+    if ( d->hasPendingChanges() ) {
+        d->applyPendingChanges();
+    }
+    return d->find( prefix, preferred );
+}
+
+QString PlacemarkSearchIndex::normalized( const QString &name )
+{
+    return GeoString::deaccent( name.toLower() );
+}
+
+}
+
+#include "moc_PlacemarkSearchIndex.cpp"
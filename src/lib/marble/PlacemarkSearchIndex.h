@@ -0,0 +1,91 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_PLACEMARKSEARCHINDEX_H
+#define MARBLE_PLACEMARKSEARCHINDEX_H
+
+#include "marble_export.h"
+
+#include <QObject>
+#include <QVector>
+
+class QAbstractItemModel;
+class QModelIndex;
+class QString;
+
+namespace Marble
+{
+
+class GeoDataLatLonBox;
+class GeoDataPlacemark;
+
+/**
+ * @short A name index over the placemarks of a model.
+ *
+ * The index keeps the normalized display names of all placemarks of the
+ * source model in sorted order, which turns a prefix search into a binary
+ * search. It follows row insertions and removals of the source model, so
+ * it doesn't need to be rebuilt when files are opened or closed.
+ *
+ * The source model has to provide the placemarks through
+ * MarblePlacemarkModel::ObjectPointerRole, like MarbleModel::placemarkModel() does.
+ *
+ * Searching is safe from any thread, the index itself is maintained in the
+ * thread of the source model.
+ */
+class MARBLE_EXPORT PlacemarkSearchIndex : public QObject
+{
+    Q_OBJECT
+
+ public:
+    explicit PlacemarkSearchIndex( QObject *parent = 0 );
+
+    ~PlacemarkSearchIndex();
+
+    /**
+     * Indexes the placemarks of @p model and follows its changes from now on.
+     */
+    void setSourceModel( const QAbstractItemModel *model );
+
+    /**
+     * Returns the number of indexed placemarks.
+     */
+    int size() const;
+
+    /**
+     * Returns copies of all placemarks whose display name starts with
+     * @p searchTerm, ignoring case and accents. If @p preferred is not
+     * empty, only placemarks inside it are returned. The caller takes
+     * ownership of the returned placemarks.
+     */
+    QVector<GeoDataPlacemark*> findPlacemarks( const QString &searchTerm,
+                                               const GeoDataLatLonBox &preferred ) const;
+
+    /**
+     * Returns @p name in the form used for comparisons: lower case, without accents.
+     */
+    static QString normalized( const QString &name );
+
+ private:
+    Q_PRIVATE_SLOT( d, void addRows( const QModelIndex &parent, int first, int last ) )
+
+    Q_PRIVATE_SLOT( d, void removeRows( const QModelIndex &parent, int first, int last ) )
+
+    Q_PRIVATE_SLOT( d, void updateRows( const QModelIndex &topLeft, const QModelIndex &bottomRight ) )
+
+    Q_PRIVATE_SLOT( d, void rebuild() )
+
+    Q_DISABLE_COPY( PlacemarkSearchIndex )
+
+    class Private;
+    Private * const d;
+};
+
+}
+
+#endif
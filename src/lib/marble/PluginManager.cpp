@@ -16,9 +16,11 @@
 // Qt
 #include <QList>
 #include <QPluginLoader>
+#include <QSet>
 #include <QTime>
 
 // Local dir
+#include "DiscoveryCache.h"
 #include "MarbleDirs.h"
 #include "MarbleDebug.h"
 #include "RenderPlugin.h"
@@ -36,16 +38,33 @@ namespace Marble
 class PluginManagerPrivate
 {
  public:
+    /**
+     * The kinds of plugins a plugin library can provide. The kinds of each
+     * library are kept in the discovery cache, so that later sessions only
+     * need to load the libraries of the requested kinds.
+     */
+    enum PluginType {
+        NoPlugin = 0x0,
+        RenderPluginType = 0x1,
+        PositionProviderPluginType = 0x2,
+        SearchRunnerPluginType = 0x4,
+        ReverseGeocodingRunnerPluginType = 0x8,
+        RoutingRunnerPluginType = 0x10,
+        ParseRunnerPluginType = 0x20
+    };
+    Q_DECLARE_FLAGS( PluginTypes, PluginType )
+
     PluginManagerPrivate()
-            : m_pluginsLoaded(false)
+            : m_loadedTypes( NoPlugin )
     {
     }
 
     ~PluginManagerPrivate();
 
-    void loadPlugins();
+    void loadPlugins( PluginTypes types );
 
-    bool m_pluginsLoaded;
+    PluginTypes m_loadedTypes;
+    QSet<QString> m_loadedPaths;
     QList<const RenderPlugin *> m_renderPluginTemplates;
     QList<const PositionProviderPlugin *> m_positionProviderPluginTemplates;
     QList<const SearchRunnerPlugin *> m_searchRunnerPlugins;
@@ -60,6 +79,8 @@ class PluginManagerPrivate
 #endif
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS( PluginManagerPrivate::PluginTypes )
+
 QStringList PluginManagerPrivate::m_blacklist;
 QStringList PluginManagerPrivate::m_whitelist;
 
@@ -84,78 +105,78 @@ PluginManager::~PluginManager()
 
 QList<const RenderPlugin *> PluginManager::renderPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RenderPluginType );
     return d->m_renderPluginTemplates;
 }
 
 void PluginManager::addRenderPlugin( const RenderPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RenderPluginType );
     d->m_renderPluginTemplates << plugin;
     emit renderPluginsChanged();
 }
 
 QList<const PositionProviderPlugin *> PluginManager::positionProviderPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::PositionProviderPluginType );
     return d->m_positionProviderPluginTemplates;
 }
 
 void PluginManager::addPositionProviderPlugin( const PositionProviderPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::PositionProviderPluginType );
     d->m_positionProviderPluginTemplates << plugin;
     emit positionProviderPluginsChanged();
 }
 
 QList<const SearchRunnerPlugin *> PluginManager::searchRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::SearchRunnerPluginType );
     return d->m_searchRunnerPlugins;
 }
 
 void PluginManager::addSearchRunnerPlugin( const SearchRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::SearchRunnerPluginType );
     d->m_searchRunnerPlugins << plugin;
     emit searchRunnerPluginsChanged();
 }
 
 QList<const ReverseGeocodingRunnerPlugin *> PluginManager::reverseGeocodingRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ReverseGeocodingRunnerPluginType );
     return d->m_reverseGeocodingRunnerPlugins;
 }
 
 void PluginManager::addReverseGeocodingRunnerPlugin( const ReverseGeocodingRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ReverseGeocodingRunnerPluginType );
     d->m_reverseGeocodingRunnerPlugins << plugin;
     emit reverseGeocodingRunnerPluginsChanged();
 }
 
 QList<RoutingRunnerPlugin *> PluginManager::routingRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RoutingRunnerPluginType );
     return d->m_routingRunnerPlugins;
 }
 
 void PluginManager::addRoutingRunnerPlugin( RoutingRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RoutingRunnerPluginType );
     d->m_routingRunnerPlugins << plugin;
     emit routingRunnerPluginsChanged();
 }
 
 QList<const ParseRunnerPlugin *> PluginManager::parsingRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ParseRunnerPluginType );
     return d->m_parsingRunnerPlugins;
 }
 
 void PluginManager::addParseRunnerPlugin( const ParseRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ParseRunnerPluginType );
     d->m_parsingRunnerPlugins << plugin;
     emit parseRunnerPluginsChanged();
 }
@@ -204,9 +225,9 @@ bool appendPlugin( QObject * obj, QPluginLoader* &loader, QList<const T*> &plugi
     return false;
 }
 
-void PluginManagerPrivate::loadPlugins()
+void PluginManagerPrivate::loadPlugins( PluginTypes types )
 {
-    if (m_pluginsLoaded)
+    if ( ( m_loadedTypes & types ) == types )
     {
         return;
     }
@@ -219,12 +240,7 @@ void PluginManagerPrivate::loadPlugins()
 
     MarbleDirs::debug();
 
-    Q_ASSERT( m_renderPluginTemplates.isEmpty() );
-    Q_ASSERT( m_positionProviderPluginTemplates.isEmpty() );
-    Q_ASSERT( m_searchRunnerPlugins.isEmpty() );
-    Q_ASSERT( m_reverseGeocodingRunnerPlugins.isEmpty() );
-    Q_ASSERT( m_routingRunnerPlugins.isEmpty() );
-    Q_ASSERT( m_parsingRunnerPlugins.isEmpty() );
+    DiscoveryCache discoveryCache( MarbleDirs::localPath() + "/discovery/plugins.cache" );
 
     foreach( const QString &fileName, pluginFileNameList ) {
         QString const baseName = QFileInfo(fileName).baseName();
@@ -247,37 +263,64 @@ void PluginManagerPrivate::loadPlugins()
             continue;
         }
 #endif
+        if ( m_loadedPaths.contains( path ) ) {
+            continue;
+        }
+
+        // Don't load libraries known to provide none of the requested plugins
+        QVariantMap const cached = discoveryCache.value( path );
+        if ( !cached.isEmpty() && !( PluginTypes( QFlag( cached.value( "types" ).toInt() ) ) & types ) ) {
+            continue;
+        }
+
         QPluginLoader* loader = new QPluginLoader( path );
 
         QObject * obj = loader->instance();
 
         if ( obj ) {
-            bool isPlugin = appendPlugin<RenderPlugin, RenderPluginInterface>
-                       ( obj, loader, m_renderPluginTemplates );
-            isPlugin = isPlugin || appendPlugin<PositionProviderPlugin, PositionProviderPluginInterface>
-                       ( obj, loader, m_positionProviderPluginTemplates );
-            isPlugin = isPlugin || appendPlugin<SearchRunnerPlugin, SearchRunnerPlugin>
-                       ( obj, loader, m_searchRunnerPlugins ); // intentionally T==U
-            isPlugin = isPlugin || appendPlugin<ReverseGeocodingRunnerPlugin, ReverseGeocodingRunnerPlugin>
-                       ( obj, loader, m_reverseGeocodingRunnerPlugins ); // intentionally T==U
-            isPlugin = isPlugin || appendPlugin<RoutingRunnerPlugin, RoutingRunnerPlugin>
-                       ( obj, loader, m_routingRunnerPlugins ); // intentionally T==U
-            isPlugin = isPlugin || appendPlugin<ParseRunnerPlugin, ParseRunnerPlugin>
-                       ( obj, loader, m_parsingRunnerPlugins ); // intentionally T==U
-            if ( !isPlugin ) {
+            PluginType pluginType = NoPlugin;
+            if ( appendPlugin<RenderPlugin, RenderPluginInterface>
+                       ( obj, loader, m_renderPluginTemplates ) ) {
+                pluginType = RenderPluginType;
+            } else if ( appendPlugin<PositionProviderPlugin, PositionProviderPluginInterface>
+                       ( obj, loader, m_positionProviderPluginTemplates ) ) {
+                pluginType = PositionProviderPluginType;
+            } else if ( appendPlugin<SearchRunnerPlugin, SearchRunnerPlugin>
+                       ( obj, loader, m_searchRunnerPlugins ) ) { // intentionally T==U
+                pluginType = SearchRunnerPluginType;
+            } else if ( appendPlugin<ReverseGeocodingRunnerPlugin, ReverseGeocodingRunnerPlugin>
+                       ( obj, loader, m_reverseGeocodingRunnerPlugins ) ) { // intentionally T==U
+                pluginType = ReverseGeocodingRunnerPluginType;
+            } else if ( appendPlugin<RoutingRunnerPlugin, RoutingRunnerPlugin>
+                       ( obj, loader, m_routingRunnerPlugins ) ) { // intentionally T==U
+                pluginType = RoutingRunnerPluginType;
+            } else if ( appendPlugin<ParseRunnerPlugin, ParseRunnerPlugin>
+                       ( obj, loader, m_parsingRunnerPlugins ) ) { // intentionally T==U
+                pluginType = ParseRunnerPluginType;
+            }
+
+            if ( pluginType == NoPlugin ) {
                 qWarning() << "Ignoring the following plugin since it couldn't be loaded:" << path;
                 mDebug() << "Plugin failure:" << path << "is a plugin, but it does not implement the "
                         << "right interfaces or it was compiled against an old version of Marble. Ignoring it.";
                 delete loader;
+            } else {
+                m_loadedPaths << path;
             }
+
+            QVariantMap entry;
+            entry.insert( "types", int( pluginType ) );
+            discoveryCache.insert( path, entry );
         } else {
+            // Not cached, the library may load fine once missing dependencies are installed
             qWarning() << "Ignoring to load the following file since it doesn't look like a valid Marble plugin:" << path << endl
                        << "Reason:" << loader->errorString();
             delete loader;
         }
     }
 
-    m_pluginsLoaded = true;
+    m_loadedTypes |= types;
+    discoveryCache.save();
 
     mDebug() << Q_FUNC_INFO << "Time elapsed:" << t.elapsed() << "ms";
 }
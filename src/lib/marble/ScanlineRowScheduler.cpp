@@ -0,0 +1,33 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "ScanlineRowScheduler.h"
+
+#include <QtGlobal>
+
+using namespace Marble;
+
+ScanlineRowScheduler::ScanlineRowScheduler( int yTop, int yBottom, int chunkSize ) :
+    m_yBottom( yBottom ),
+    m_chunkSize( qMax( 1, chunkSize ) ),
+    m_nextRow( yTop )
+{
+}
+
+bool ScanlineRowScheduler::nextChunk( int &yStart, int &yEnd )
+{
+    const int start = m_nextRow.fetchAndAddRelaxed( m_chunkSize );
+    if ( start >= m_yBottom ) {
+        return false;
+    }
+
+    yStart = start;
+    yEnd = qMin( start + m_chunkSize, m_yBottom );
+
+    return true;
+}
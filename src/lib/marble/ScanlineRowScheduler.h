@@ -0,0 +1,52 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_SCANLINEROWSCHEDULER_H
+#define MARBLE_SCANLINEROWSCHEDULER_H
+
+#include <QAtomicInt>
+
+namespace Marble
+{
+
+/**
+ * @short Hands out chunks of canvas rows to the render jobs of a texture mapper.
+ *
+ * The cost of a scanline varies a lot across the canvas (tile misses, the
+ * pole correction area, the rim of the globe), so splitting the canvas into
+ * one static band per thread lets the slowest band dictate the frame time.
+ * Instead each render job repeatedly fetches the next small chunk of rows
+ * until the whole range is covered.
+ *
+ * The chunk size should be even, such that interlaced rendering (which
+ * copies each painted row to the row below) keeps its row parity.
+ */
+class ScanlineRowScheduler
+{
+public:
+    ScanlineRowScheduler( int yTop, int yBottom, int chunkSize = 16 );
+
+    /**
+     * Fetches the next chunk of rows [yStart, yEnd).
+     * This method is thread-safe.
+     *
+     * @return false if all rows have been handed out already.
+     */
+    bool nextChunk( int &yStart, int &yEnd );
+
+private:
+    Q_DISABLE_COPY( ScanlineRowScheduler )
+
+    const int m_yBottom;
+    const int m_chunkSize;
+    QAtomicInt m_nextRow;
+};
+
+}
+
+#endif
@@ -12,6 +12,9 @@
 #include "ScanlineTextureMapperContext.h"
 
 #include <QImage>
+#include <qmath.h>
+
+#include <cstring>
 
 #include "MarbleDebug.h"
 #include "StackedTile.h"
@@ -167,23 +170,30 @@ void ScanlineTextureMapperContext::pixelValueApproxF( const qreal lon, const qre
 
         const bool alwaysCheckTileRange =
                 isOutOfTileRangeF( itLon, itLat, itStepLon, itStepLat, n );
-        
+
+        // If all positions are located on the current tile let the tile
+        // interpolate the whole run at once, which uses SIMD if available.
+        if ( !alwaysCheckTileRange ) {
+            m_tile->pixelsF( itLon + itStepLon, itLat + itStepLat, itStepLon, itStepLat,
+                             scanLine, n - 1 );
+            return;
+        }
+
         for ( int j=1; j < n; ++j ) {
             qreal posX = itLon + itStepLon * j;
             qreal posY = itLat + itStepLat * j;
-            if ( alwaysCheckTileRange )
-                if ( posX >= tileWidth
-                    || posX < 0.0
-                    || posY >= tileHeight
-                    || posY < 0.0 )
-                {
-                    nextTile( posX, posY );
-                    itLon = m_prevPixelX + m_toTileCoordinatesLon;
-                    itLat = m_prevPixelY + m_toTileCoordinatesLat;
-                    posX = qBound <qreal>( 0.0, (itLon + itStepLon * j), tileWidth-1.0 );
-                    posY = qBound <qreal>( 0.0, (itLat + itStepLat * j), tileHeight-1.0 );
-                    oldPosX = -1;
-                }
+            if ( posX >= tileWidth
+                || posX < 0.0
+                || posY >= tileHeight
+                || posY < 0.0 )
+            {
+                nextTile( posX, posY );
+                itLon = m_prevPixelX + m_toTileCoordinatesLon;
+                itLat = m_prevPixelY + m_toTileCoordinatesLat;
+                posX = qBound <qreal>( 0.0, (itLon + itStepLon * j), tileWidth-1.0 );
+                posY = qBound <qreal>( 0.0, (itLat + itStepLat * j), tileHeight-1.0 );
+                oldPosX = -1;
+            }
 
             *scanLine = m_tile->pixelF( posX, posY );
 
@@ -427,6 +437,59 @@ QImage::Format ScanlineTextureMapperContext::optimalCanvasImageFormat( const Vie
 }
 
 
+void ScanlineTextureMapperContext::scrollCanvas( QImage *canvasImage, int dx, int dy )
+{
+    const int width = canvasImage->width();
+    const int height = canvasImage->height();
+
+    if ( qAbs( dx ) >= width || qAbs( dy ) >= height ) {
+        return;
+    }
+
+    const int pixelByteSize = sizeof( QRgb );
+    const int sourceX = qMax( 0, -dx );
+    const int targetX = qMax( 0,  dx );
+    const int rowLength = ( width - qAbs( dx ) ) * pixelByteSize;
+
+    // Walk against the direction of the movement so that no row is
+    // overwritten before it got copied.
+    if ( dy > 0 ) {
+        for ( int y = height - 1; y >= dy; --y ) {
+            memmove( canvasImage->scanLine( y ) + targetX * pixelByteSize,
+                     canvasImage->scanLine( y - dy ) + sourceX * pixelByteSize,
+                     rowLength );
+        }
+    }
+    else {
+        for ( int y = 0; y < height + dy; ++y ) {
+            memmove( canvasImage->scanLine( y ) + targetX * pixelByteSize,
+                     canvasImage->scanLine( y - dy ) + sourceX * pixelByteSize,
+                     rowLength );
+        }
+    }
+}
+
+void ScanlineTextureMapperContext::loadTiles( qreal west, qreal north, qreal east, qreal south )
+{
+    const int columnCount = m_tileLoader->tileColumnCount( m_tileLevel );
+    const int rowCount = m_tileLoader->tileRowCount( m_tileLevel );
+
+    // Tile columns and rows in global texture coordinates ( origin upper
+    // left ). Columns left of the dateline wrap around to the right.
+    const int firstColumn = qFloor( ( rad2PixelX( west ) + 0.5 * m_globalWidth ) / m_tileSize.width() );
+    const int lastColumn  = qMin( qFloor( ( rad2PixelX( east ) + 0.5 * m_globalWidth ) / m_tileSize.width() ),
+                                  firstColumn + columnCount - 1 );
+    const int firstRow = qBound( 0, qFloor( ( rad2PixelY( north ) + 0.5 * m_globalHeight ) / m_tileSize.height() ), rowCount - 1 );
+    const int lastRow  = qBound( 0, qFloor( ( rad2PixelY( south ) + 0.5 * m_globalHeight ) / m_tileSize.height() ), rowCount - 1 );
+
+    for ( int column = firstColumn; column <= lastColumn; ++column ) {
+        const int tileCol = ( column % columnCount + columnCount ) % columnCount;
+        for ( int tileRow = firstRow; tileRow <= lastRow; ++tileRow ) {
+            m_tileLoader->loadTile( TileId( 0, m_tileLevel, tileCol, tileRow ) );
+        }
+    }
+}
+
 void ScanlineTextureMapperContext::nextTile( int &posX, int &posY )
 {
     // Move from tile coordinates to global texture coordinates 
@@ -46,6 +46,19 @@ public:
 
     static QImage::Format optimalCanvasImageFormat( const ViewportParams *viewport );
 
+    /**
+     * Moves the content of the 32 bit @p canvasImage by @p dx pixels to the right
+     * and @p dy pixels downwards. The exposed areas keep their previous content.
+     */
+    static void scrollCanvas( QImage *canvasImage, int dx, int dy );
+
+    /**
+     * Loads the tiles covering the texture from the longitude @p west eastwards
+     * to @p east and from the latitude @p north to @p south, without mapping
+     * any pixel. This keeps the tiles under scrolled content marked as used.
+     */
+    void loadTiles( qreal west, qreal north, qreal east, qreal south );
+
     int globalWidth() const;
     int globalHeight() const;
 
@@ -16,9 +16,11 @@
 #include "TextureMapperInterface.h"
 
 #include "MarbleGlobal.h"
+#include "Quaternion.h"
 
 #include <QThreadPool>
 #include <QImage>
+#include <QVector>
 
 
 namespace Marble
@@ -56,6 +58,14 @@ class SphericalScanlineTextureMapper : public TextureMapperInterface
     int m_radius;
     QImage m_canvasImage;
     QThreadPool m_threadPool;
+
+    // lon/lat pairs of all pixels evaluated exactly in the previous
+    // repaint, one vector per scanline
+    QVector<QVector<qreal> > m_coordinateCache;
+    Quaternion m_cachedPlanetAxis;
+    int m_cachedRadius;
+    QSize m_cachedSize;
+    MapQuality m_cachedMapQuality;
 };
 
 }
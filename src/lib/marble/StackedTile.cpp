@@ -16,8 +16,31 @@
 #include "MarbleDebug.h"
 #include "TextureTile.h"
 
+#include "StackedTile_p.h"
+
 using namespace Marble;
 
+typedef void (*InterpolateLineFunction)( const uint *bits, int stride,
+                                         qreal x, qreal y, qreal stepX, qreal stepY,
+                                         uint *result, int count );
+
+static InterpolateLineFunction selectInterpolateLine()
+{
+#ifdef MARBLE_HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        return interpolateLineAvx2;
+    }
+#endif
+#ifdef MARBLE_HAVE_SSE2
+    return interpolateLineSse2;
+#else
+    return interpolateLineGeneric;
+#endif
+}
+
+static const InterpolateLineFunction interpolateLine = selectInterpolateLine();
+
 static const uint **jumpTableFromQImage32( const QImage &img )
 {
     if ( img.depth() != 48 && img.depth() != 32 )
@@ -67,8 +90,6 @@ StackedTile::StackedTile( const TileId &id, const QImage &resultImage, QVector<Q
       m_byteCount( calcByteCount( resultImage, tiles ) ),
       m_isUsed( false )
 {
-    Q_ASSERT( !tiles.isEmpty() );
-
     if ( jumpTable32 == 0 && jumpTable8 == 0 ) {
         qWarning() << "Color depth" << m_depth << " is not supported.";
     }
@@ -212,6 +233,32 @@ uint StackedTile::pixelF( qreal x, qreal y, const QRgb& topLeftValue ) const
     return topLeftValue;
 }
 
+void StackedTile::pixelsF( qreal x, qreal y, qreal stepX, qreal stepY, QRgb *result, int count ) const
+{
+    if ( count <= 0 ) {
+        return;
+    }
+
+    const qreal lastX = x + stepX * ( count - 1 );
+    const qreal lastY = y + stepY * ( count - 1 );
+
+    // The kernels read the texels right of and below each position without
+    // any checks. Keep a small margin to absorb single precision rounding.
+    const bool insideInterpolationRange = m_depth == 32
+            && qMin( x, lastX ) >= 0.0 && qMax( x, lastX ) < m_resultImage.width() - 1.01
+            && qMin( y, lastY ) >= 0.0 && qMax( y, lastY ) < m_resultImage.height() - 1.01;
+
+    if ( insideInterpolationRange ) {
+        interpolateLine( jumpTable32[0], m_resultImage.bytesPerLine() / 4,
+                         x, y, stepX, stepY, result, count );
+        return;
+    }
+
+    for ( int i = 0; i < count; ++i ) {
+        result[i] = pixelF( x + stepX * i, y + stepY * i );
+    }
+}
+
 int StackedTile::calcByteCount( const QImage &resultImage, const QVector<QSharedPointer<TextureTile> > &tiles )
 {
     int byteCount = resultImage.byteCount();
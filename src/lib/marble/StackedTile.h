@@ -55,6 +55,10 @@ class TextureTile;
 class StackedTile : public Tile
 {
  public:
+    /**
+     * @p tiles are the texture tiles @p resultImage was blended from. They are
+     * empty for placeholders, which are scaled from another stacked tile.
+     */
     explicit StackedTile( TileId const &id, QImage const &resultImage, QVector<QSharedPointer<TextureTile> > const &tiles );
     virtual ~StackedTile();
 
@@ -98,6 +102,16 @@ class StackedTile : public Tile
     // This method passes the top left pixel (if known already) for better performance
     uint pixelF( qreal x, qreal y, const QRgb& pixel ) const; 
 
+/*!
+    \brief Computes the color values of @p count subsequent positions along a line.
+
+    The positions start at (@p x, @p y) and advance by (@p stepX, @p stepY).
+    Subpixel calculation is done via bilinear interpolation. For 32 bit images
+    whose positions stay inside the tile the values are computed several at a
+    time using SSE2 or AVX2, depending on what the CPU supports.
+*/
+    void pixelsF( qreal x, qreal y, qreal stepX, qreal stepY, QRgb *result, int count ) const;
+
  private:
     Q_DISABLE_COPY( StackedTile )
 
@@ -27,42 +27,137 @@
 #include "MarbleDebug.h"
 #include "MergedLayerDecorator.h"
 #include "StackedTile.h"
+#include "TextureTile.h"
 #include "TileLoader.h"
 #include "TileLoaderHelper.h"
 #include "MarbleGlobal.h"
 
 #include <QCache>
+#include <QCoreApplication>
 #include <QHash>
 #include <QReadWriteLock>
 #include <QImage>
+#include <QSet>
+#include <QThreadPool>
 
 
 namespace Marble
 {
 
+StackedTileRunner::StackedTileRunner( MergedLayerDecorator *layerDecorator, const TileId &stackedTileId, int generation ) :
+    m_layerDecorator( layerDecorator ),
+    m_sunLocator( layerDecorator->sunLocator() ),
+    m_stackedTileId( stackedTileId ),
+    m_generation( generation )
+{
+}
+
+void StackedTileRunner::run()
+{
+    StackedTile *const stackedTile = m_layerDecorator->loadTile( m_stackedTileId, &m_sunLocator );
+    Q_ASSERT( stackedTile );
+
+    emit tileDecoded( m_stackedTileId, stackedTile, m_generation );
+}
+
 class StackedTileLoaderPrivate
 {
 public:
     explicit StackedTileLoaderPrivate( MergedLayerDecorator *mergedLayerDecorator )
-        : m_layerDecorator( mergedLayerDecorator )
+        : m_layerDecorator( mergedLayerDecorator ),
+          m_parent( 0 ),
+          m_asynchronousLoading( false ),
+          m_generation( 0 )
     {
         m_tileCache.setMaxCost( 20000 * 1024 ); // Cache size measured in bytes
     }
 
+    StackedTile *createPlaceholderTile( const TileId &stackedTileId ) const;
+    void startTileRunner( const TileId &stackedTileId );
+
     MergedLayerDecorator *const m_layerDecorator;
     QHash <TileId, StackedTile*>  m_tilesOnDisplay;
     QCache <TileId, StackedTile>  m_tileCache;
     QReadWriteLock m_cacheLock;
+
+    StackedTileLoader *m_parent;
+    QThreadPool m_threadPool;
+    bool m_asynchronousLoading;
+    // tiles which are represented by a placeholder until their runner finishes
+    QSet<TileId> m_pendingTiles;
+    // pending tiles whose texture tiles got updated while they were decoded
+    QSet<TileId> m_outdatedTiles;
+    // incremented by clear() in order to discard results of outdated runners
+    int m_generation;
 };
 
+StackedTile *StackedTileLoaderPrivate::createPlaceholderTile( const TileId &stackedTileId ) const
+{
+    for ( int level = stackedTileId.zoomLevel() - 1; level >= 0; --level ) {
+        const int deltaLevel = stackedTileId.zoomLevel() - level;
+        const TileId ancestorId( 0, level, stackedTileId.x() >> deltaLevel, stackedTileId.y() >> deltaLevel );
+
+        const StackedTile *ancestor = m_tilesOnDisplay.value( ancestorId, 0 );
+        if ( !ancestor ) {
+            ancestor = m_tileCache.object( ancestorId );
+        }
+        if ( !ancestor ) {
+            continue;
+        }
+
+        // scale the part of the ancestor which covers the requested tile
+        const QImage *const ancestorImage = ancestor->resultImage();
+        const int restTileX = stackedTileId.x() % ( 1 << deltaLevel );
+        const int restTileY = stackedTileId.y() % ( 1 << deltaLevel );
+        const int partWidth = qMax( 1, ancestorImage->width() >> deltaLevel );
+        const int partHeight = qMax( 1, ancestorImage->height() >> deltaLevel );
+        const QImage part = ancestorImage->copy( restTileX * partWidth, restTileY * partHeight,
+                                                 partWidth, partHeight );
+
+        // Without texture tiles, updates of the ancestor's texture tiles don't
+        // apply to the placeholder, see updateTile()
+        return new StackedTile( stackedTileId, part.scaled( ancestorImage->size() ),
+                                QVector<QSharedPointer<TextureTile> >() );
+    }
+
+    return 0;
+}
+
+// The runners call MergedLayerDecorator::loadTile() without holding m_cacheLock,
+// which only protects the tile hash and cache. This relies on the decorator
+// not being modified and its texture datasets not being freed while runners
+// are pending: TextureLayer waits for them before it changes or deletes its
+// custom textures, and MarbleModel deletes the previous map theme only after
+// emitting themeChanged(), whose receivers switch the texture layers.
+void StackedTileLoaderPrivate::startTileRunner( const TileId &stackedTileId )
+{
+    m_pendingTiles.insert( stackedTileId );
+
+    StackedTileRunner *const runner = new StackedTileRunner( m_layerDecorator, stackedTileId, m_generation );
+    QObject::connect( runner, SIGNAL(tileDecoded(TileId,StackedTile*,int)),
+                      m_parent, SLOT(finishTileLoading(TileId,StackedTile*,int)) );
+    m_threadPool.start( runner );
+}
+
 StackedTileLoader::StackedTileLoader( MergedLayerDecorator *mergedLayerDecorator, QObject *parent )
     : QObject( parent ),
       d( new StackedTileLoaderPrivate( mergedLayerDecorator ) )
 {
+    qRegisterMetaType<TileId>( "TileId" );
+    qRegisterMetaType<StackedTile*>( "StackedTile*" );
+
+    d->m_parent = this;
 }
 
 StackedTileLoader::~StackedTileLoader()
 {
+    d->m_threadPool.waitForDone();
+
+    // The results of the runners are queued for finishTileLoading(), which
+    // deletes them as outdated now instead of leaving them in the event queue
+    ++d->m_generation;
+    QCoreApplication::sendPostedEvents( this, QEvent::MetaCall );
+
     qDeleteAll( d->m_tilesOnDisplay );
     delete d;
 }
@@ -147,8 +242,23 @@ const StackedTile* StackedTileLoader::loadTile( TileId const & stackedTileId )
         return stackedTile;
     }
 
-    // tile (valid) has not been found in hash or cache, so load it from disk
-    // and place it in the hash from where it will get transferred to the cache
+    // tile (valid) has not been found in hash or cache. In asynchronous mode
+    // display a scaled ancestor for now and decode the tile in the background.
+    if ( d->m_asynchronousLoading ) {
+        stackedTile = d->createPlaceholderTile( stackedTileId );
+        if ( stackedTile ) {
+            stackedTile->setUsed( true );
+            d->m_tilesOnDisplay[ stackedTileId ] = stackedTile;
+            if ( !d->m_pendingTiles.contains( stackedTileId ) ) {
+                d->startTileRunner( stackedTileId );
+            }
+            d->m_cacheLock.unlock();
+            return stackedTile;
+        }
+    }
+
+    // Otherwise load it from disk and place it in the hash from where
+    // it will get transferred to the cache
 
     mDebug() << "load tile from disk:" << stackedTileId;
 
@@ -164,6 +274,59 @@ const StackedTile* StackedTileLoader::loadTile( TileId const & stackedTileId )
     return stackedTile;
 }
 
+void StackedTileLoader::setAsynchronousLoading( bool enabled )
+{
+    d->m_asynchronousLoading = enabled;
+}
+
+bool StackedTileLoader::asynchronousLoading() const
+{
+    return d->m_asynchronousLoading;
+}
+
+void StackedTileLoader::waitForPendingTiles()
+{
+    d->m_threadPool.waitForDone();
+}
+
+void StackedTileLoader::finishTileLoading( const TileId &stackedTileId, StackedTile *stackedTile, int generation )
+{
+    if ( generation != d->m_generation ) {
+        // the tile hash has been cleared in the meantime
+        delete stackedTile;
+        return;
+    }
+
+    d->m_cacheLock.lockForWrite();
+
+    d->m_pendingTiles.remove( stackedTileId );
+
+    if ( d->m_outdatedTiles.remove( stackedTileId ) ) {
+        // one of the texture tiles changed while decoding, so decode again
+        delete stackedTile;
+        d->startTileRunner( stackedTileId );
+        d->m_cacheLock.unlock();
+        return;
+    }
+
+    StackedTile *const placeholder = d->m_tilesOnDisplay.take( stackedTileId );
+    if ( placeholder ) {
+        stackedTile->setUsed( true );
+        d->m_tilesOnDisplay.insert( stackedTileId, stackedTile );
+        delete placeholder;
+    } else {
+        // the placeholder has already been moved to (or dropped from) the cache
+        d->m_tileCache.insert( stackedTileId, stackedTile, stackedTile->byteCount() );
+    }
+
+    d->m_cacheLock.unlock();
+
+    if ( placeholder ) {
+        emit tileLoaded( stackedTileId );
+        emit placeholderReplaced( stackedTileId );
+    }
+}
+
 quint64 StackedTileLoader::volatileCacheLimit() const
 {
     return d->m_tileCache.maxCost() / 1024;
@@ -189,6 +352,12 @@ void StackedTileLoader::updateTile( TileId const &tileId, QImage const &tileImag
 {
     const TileId stackedTileId( 0, tileId.zoomLevel(), tileId.x(), tileId.y() );
 
+    if ( d->m_pendingTiles.contains( stackedTileId ) ) {
+        // the displayed tile is just a placeholder, the runner takes care of it
+        d->m_outdatedTiles.insert( stackedTileId );
+        return;
+    }
+
     StackedTile * displayedTile = d->m_tilesOnDisplay.take( stackedTileId );
     if ( displayedTile ) {
         Q_ASSERT( !d->m_tileCache.contains( stackedTileId ) );
@@ -225,6 +394,11 @@ void StackedTileLoader::clear()
     d->m_tilesOnDisplay.clear();
     d->m_tileCache.clear(); // clear the tile cache in physical memory
 
+    // results of runners still in flight are discarded
+    d->m_pendingTiles.clear();
+    d->m_outdatedTiles.clear();
+    ++d->m_generation;
+
     emit cleared();
 }
 
@@ -26,8 +26,10 @@
 #define MARBLE_STACKEDTILELOADER_H
 
 #include <QObject>
+#include <QRunnable>
 
 #include "GeoSceneTileDataset.h"
+#include "SunLocator.h"
 #include "TileId.h"
 #include "RenderState.h"
 
@@ -43,6 +45,30 @@ class StackedTile;
 
 class StackedTileLoaderPrivate;
 
+/**
+ * @short Decodes and blends a stacked tile in a worker thread.
+ *
+ * The tile is shaded with the sun position at the time the runner was created,
+ * the SunLocator of the model keeps moving in the GUI thread meanwhile.
+ */
+class StackedTileRunner : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    StackedTileRunner( MergedLayerDecorator *layerDecorator, const TileId &stackedTileId, int generation );
+    void run();
+
+Q_SIGNALS:
+    void tileDecoded( const TileId &stackedTileId, StackedTile *stackedTile, int generation );
+
+private:
+    MergedLayerDecorator *const m_layerDecorator;
+    const SunLocator m_sunLocator;
+    const TileId m_stackedTileId;
+    const int m_generation;
+};
+
 /**
  * @short Tile loading from a quad tree
  *
@@ -81,11 +107,33 @@ class StackedTileLoader : public QObject
         /**
          * Loads a tile and returns it.
          *
+         * In asynchronous mode a tile which is neither on display nor in the cache
+         * is not decoded in the calling thread. Instead a placeholder scaled from
+         * the best cached ancestor tile is returned right away, the real tile
+         * is decoded in a worker thread and placeholderReplaced() is emitted once
+         * it replaced the placeholder.
+         *
          * @param stackedTileId The Id of the requested tile, containing the x and y coordinate
          *                      and the zoom level.
          */
         const StackedTile* loadTile( TileId const &stackedTileId );
 
+        /**
+         * @brief Enables or disables decoding of missing tiles in worker threads.
+         * @see loadTile()
+         */
+        void setAsynchronousLoading( bool enabled );
+        bool asynchronousLoading() const;
+
+        /**
+         * @brief Blocks until all tiles queued for asynchronous decoding are decoded.
+         *
+         * Must be called before the MergedLayerDecorator gets modified, and
+         * before the texture datasets and ground overlays it refers to get
+         * freed, since the worker threads access them while decoding.
+         */
+        void waitForPendingTiles();
+
         /**
          * Resets the internal tile hash.
          */
@@ -135,8 +183,19 @@ class StackedTileLoader : public QObject
 
     Q_SIGNALS:
         void tileLoaded( TileId const &tileId );
+
+        /**
+         * Emitted when a tile decoded in the background replaced its placeholder.
+         * Unlike tileLoaded(), this is never emitted while loadTile() is called
+         * for painting.
+         */
+        void placeholderReplaced( TileId const &tileId );
+
         void cleared();
 
+    private Q_SLOTS:
+        void finishTileLoading( const TileId &stackedTileId, StackedTile *stackedTile, int generation );
+
     private:
         Q_DISABLE_COPY( StackedTileLoader )
 
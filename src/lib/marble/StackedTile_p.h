@@ -0,0 +1,233 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_STACKEDTILEPRIVATE_H
+#define MARBLE_STACKEDTILEPRIVATE_H
+
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define MARBLE_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(MARBLE_HAVE_SSE2) && defined(__GNUC__) && !defined(__clang__) \
+    && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define MARBLE_HAVE_AVX2_DISPATCH
+#elif defined(MARBLE_HAVE_SSE2) && defined(__clang__) \
+    && ( __clang_major__ > 3 || ( __clang_major__ == 3 && __clang_minor__ >= 8 ) )
+#define MARBLE_HAVE_AVX2_DISPATCH
+#endif
+
+#ifdef MARBLE_HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace Marble
+{
+
+// Bilinear interpolation of 32 bit texels along a line of sample positions.
+//
+// All kernels use the same 8 bit fixed point weights, so their results only
+// differ by the rounding of the sample positions. The caller has to make sure
+// that the texel to the right of and below each sample position is still
+// inside the image.
+
+inline uint interpolateChannels( uint topLeft, uint topRight, uint bottomLeft, uint bottomRight,
+                                 uint weightX, uint weightY )
+{
+    uint result = 0xff000000;
+
+    for ( int shift = 0; shift < 24; shift += 8 ) {
+        const uint top    = ( ( ( topLeft    >> shift ) & 0xff ) * ( 256 - weightX )
+                            + ( ( topRight   >> shift ) & 0xff ) * weightX ) >> 8;
+        const uint bottom = ( ( ( bottomLeft >> shift ) & 0xff ) * ( 256 - weightX )
+                            + ( ( bottomRight >> shift ) & 0xff ) * weightX ) >> 8;
+        result |= ( ( top * ( 256 - weightY ) + bottom * weightY ) >> 8 ) << shift;
+    }
+
+    return result;
+}
+
+inline void interpolateLineGeneric( const uint *bits, int stride,
+                                    qreal x, qreal y, qreal stepX, qreal stepY,
+                                    uint *result, int count )
+{
+    for ( int i = 0; i < count; ++i ) {
+        const qreal posX = x + stepX * i;
+        const qreal posY = y + stepY * i;
+        const int iX = (int)posX;
+        const int iY = (int)posY;
+        const uint *const top = bits + iY * stride + iX;
+        const uint *const bottom = top + stride;
+
+        result[i] = interpolateChannels( top[0], top[1], bottom[0], bottom[1],
+                                         (uint)( ( posX - iX ) * 256 ), (uint)( ( posY - iY ) * 256 ) );
+    }
+}
+
+#ifdef MARBLE_HAVE_SSE2
+
+// Interpolates between two vectors of 16 bit channels with weights in the range [0, 256].
+inline __m128i interpolate16Sse2( __m128i a, __m128i b, __m128i weight )
+{
+    const __m128i full = _mm_set1_epi16( 256 );
+    return _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( a, _mm_sub_epi16( full, weight ) ),
+                                          _mm_mullo_epi16( b, weight ) ), 8 );
+}
+
+inline __m128i interpolatePixelsSse2( __m128i topLeft, __m128i topRight,
+                                      __m128i bottomLeft, __m128i bottomRight,
+                                      __m128i weightX, __m128i weightY,
+                                      __m128i zero, bool high )
+{
+    if ( high ) {
+        const __m128i top = interpolate16Sse2( _mm_unpackhi_epi8( topLeft, zero ), _mm_unpackhi_epi8( topRight, zero ), weightX );
+        const __m128i bottom = interpolate16Sse2( _mm_unpackhi_epi8( bottomLeft, zero ), _mm_unpackhi_epi8( bottomRight, zero ), weightX );
+        return interpolate16Sse2( top, bottom, weightY );
+    }
+
+    const __m128i top = interpolate16Sse2( _mm_unpacklo_epi8( topLeft, zero ), _mm_unpacklo_epi8( topRight, zero ), weightX );
+    const __m128i bottom = interpolate16Sse2( _mm_unpacklo_epi8( bottomLeft, zero ), _mm_unpacklo_epi8( bottomRight, zero ), weightX );
+    return interpolate16Sse2( top, bottom, weightY );
+}
+
+inline void interpolateLineSse2( const uint *bits, int stride,
+                                 qreal x, qreal y, qreal stepX, qreal stepY,
+                                 uint *result, int count )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32( 0xff000000 );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 ) {
+        uint topLeft[4];
+        uint topRight[4];
+        uint bottomLeft[4];
+        uint bottomRight[4];
+        int weights[8];
+
+        for ( int k = 0; k < 4; ++k ) {
+            const qreal posX = x + stepX * ( i + k );
+            const qreal posY = y + stepY * ( i + k );
+            const int iX = (int)posX;
+            const int iY = (int)posY;
+            const uint *const top = bits + iY * stride + iX;
+            const uint *const bottom = top + stride;
+
+            topLeft[k] = top[0];
+            topRight[k] = top[1];
+            bottomLeft[k] = bottom[0];
+            bottomRight[k] = bottom[1];
+            weights[k] = (int)( ( posX - iX ) * 256 );
+            weights[k + 4] = (int)( ( posY - iY ) * 256 );
+        }
+
+        // Each 32 bit lane holds the weight of one pixel in both 16 bit halves.
+        // Unpacking duplicates it for the four channels of the pixel, matching
+        // the order in which _mm_unpack{lo,hi}_epi8 spread the pixels.
+        const __m128i weightX = _mm_loadu_si128( reinterpret_cast<const __m128i *>( weights ) );
+        const __m128i weightY = _mm_loadu_si128( reinterpret_cast<const __m128i *>( weights + 4 ) );
+        const __m128i weightX2 = _mm_or_si128( weightX, _mm_slli_epi32( weightX, 16 ) );
+        const __m128i weightY2 = _mm_or_si128( weightY, _mm_slli_epi32( weightY, 16 ) );
+
+        const __m128i tl = _mm_loadu_si128( reinterpret_cast<const __m128i *>( topLeft ) );
+        const __m128i tr = _mm_loadu_si128( reinterpret_cast<const __m128i *>( topRight ) );
+        const __m128i bl = _mm_loadu_si128( reinterpret_cast<const __m128i *>( bottomLeft ) );
+        const __m128i br = _mm_loadu_si128( reinterpret_cast<const __m128i *>( bottomRight ) );
+
+        const __m128i low = interpolatePixelsSse2( tl, tr, bl, br,
+                                                   _mm_unpacklo_epi32( weightX2, weightX2 ),
+                                                   _mm_unpacklo_epi32( weightY2, weightY2 ),
+                                                   zero, false );
+        const __m128i high = interpolatePixelsSse2( tl, tr, bl, br,
+                                                    _mm_unpackhi_epi32( weightX2, weightX2 ),
+                                                    _mm_unpackhi_epi32( weightY2, weightY2 ),
+                                                    zero, true );
+
+        _mm_storeu_si128( reinterpret_cast<__m128i *>( result + i ),
+                          _mm_or_si128( _mm_packus_epi16( low, high ), alpha ) );
+    }
+
+    interpolateLineGeneric( bits, stride, x + stepX * i, y + stepY * i, stepX, stepY,
+                            result + i, count - i );
+}
+
+#endif // MARBLE_HAVE_SSE2
+
+#ifdef MARBLE_HAVE_AVX2_DISPATCH
+
+__attribute__(( target( "avx2" ) ))
+inline __m256i interpolate16Avx2( __m256i a, __m256i b, __m256i weight )
+{
+    const __m256i full = _mm256_set1_epi16( 256 );
+    return _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( a, _mm256_sub_epi16( full, weight ) ),
+                                                _mm256_mullo_epi16( b, weight ) ), 8 );
+}
+
+__attribute__(( target( "avx2" ) ))
+inline void interpolateLineAvx2( const uint *bits, int stride,
+                                 qreal x, qreal y, qreal stepX, qreal stepY,
+                                 uint *result, int count )
+{
+    const int *const base = reinterpret_cast<const int *>( bits );
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi32( 0xff000000 );
+    const __m256i one = _mm256_set1_epi32( 1 );
+    const __m256i rowOffset = _mm256_set1_epi32( stride );
+    const __m256 scale = _mm256_set1_ps( 256.0f );
+    const __m256 offsets = _mm256_set_ps( 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f );
+    const __m256 vStepX = _mm256_set1_ps( stepX );
+    const __m256 vStepY = _mm256_set1_ps( stepY );
+
+    int i = 0;
+    for ( ; i + 8 <= count; i += 8 ) {
+        const __m256 posX = _mm256_add_ps( _mm256_set1_ps( x + stepX * i ), _mm256_mul_ps( vStepX, offsets ) );
+        const __m256 posY = _mm256_add_ps( _mm256_set1_ps( y + stepY * i ), _mm256_mul_ps( vStepY, offsets ) );
+        const __m256i iX = _mm256_cvttps_epi32( posX );
+        const __m256i iY = _mm256_cvttps_epi32( posY );
+
+        const __m256i weightX = _mm256_cvttps_epi32( _mm256_mul_ps( _mm256_sub_ps( posX, _mm256_cvtepi32_ps( iX ) ), scale ) );
+        const __m256i weightY = _mm256_cvttps_epi32( _mm256_mul_ps( _mm256_sub_ps( posY, _mm256_cvtepi32_ps( iY ) ), scale ) );
+        const __m256i weightX2 = _mm256_or_si256( weightX, _mm256_slli_epi32( weightX, 16 ) );
+        const __m256i weightY2 = _mm256_or_si256( weightY, _mm256_slli_epi32( weightY, 16 ) );
+
+        const __m256i index = _mm256_add_epi32( _mm256_mullo_epi32( iY, rowOffset ), iX );
+        const __m256i belowIndex = _mm256_add_epi32( index, rowOffset );
+        const __m256i tl = _mm256_i32gather_epi32( base, index, 4 );
+        const __m256i tr = _mm256_i32gather_epi32( base, _mm256_add_epi32( index, one ), 4 );
+        const __m256i bl = _mm256_i32gather_epi32( base, belowIndex, 4 );
+        const __m256i br = _mm256_i32gather_epi32( base, _mm256_add_epi32( belowIndex, one ), 4 );
+
+        // the unpack instructions work per 128 bit lane, the weights follow the same pattern
+        const __m256i weightXLow = _mm256_unpacklo_epi32( weightX2, weightX2 );
+        const __m256i weightXHigh = _mm256_unpackhi_epi32( weightX2, weightX2 );
+        const __m256i weightYLow = _mm256_unpacklo_epi32( weightY2, weightY2 );
+        const __m256i weightYHigh = _mm256_unpackhi_epi32( weightY2, weightY2 );
+
+        const __m256i topLow = interpolate16Avx2( _mm256_unpacklo_epi8( tl, zero ), _mm256_unpacklo_epi8( tr, zero ), weightXLow );
+        const __m256i bottomLow = interpolate16Avx2( _mm256_unpacklo_epi8( bl, zero ), _mm256_unpacklo_epi8( br, zero ), weightXLow );
+        const __m256i topHigh = interpolate16Avx2( _mm256_unpackhi_epi8( tl, zero ), _mm256_unpackhi_epi8( tr, zero ), weightXHigh );
+        const __m256i bottomHigh = interpolate16Avx2( _mm256_unpackhi_epi8( bl, zero ), _mm256_unpackhi_epi8( br, zero ), weightXHigh );
+
+        const __m256i low = interpolate16Avx2( topLow, bottomLow, weightYLow );
+        const __m256i high = interpolate16Avx2( topHigh, bottomHigh, weightYHigh );
+
+        _mm256_storeu_si256( reinterpret_cast<__m256i *>( result + i ),
+                             _mm256_or_si256( _mm256_packus_epi16( low, high ), alpha ) );
+    }
+
+    interpolateLineSse2( bits, stride, x + stepX * i, y + stepY * i, stepX, stepY,
+                         result + i, count - i );
+}
+
+#endif // MARBLE_HAVE_AVX2_DISPATCH
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "StringPool.h"
+
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QWriteLocker>
+
+namespace Marble
+{
+
+namespace
+{
+
+struct Pool
+{
+    QReadWriteLock lock;
+    QSet<QString> strings;
+};
+
+Q_GLOBAL_STATIC( Pool, s_pool )
+
+}
+
+QString StringPool::intern( const QString &string )
+{
+    if ( string.isEmpty() ) {
+        return QString();
+    }
+
+    Pool *pool = s_pool();
+
+    // Almost all lookups find an existing string, so parser threads
+    // interning at the same time mostly share the read lock
+    {
+        QReadLocker locker( &pool->lock );
+        QSet<QString>::const_iterator it = pool->strings.constFind( string );
+        if ( it != pool->strings.constEnd() ) {
+            return *it;
+        }
+    }
+
+    QWriteLocker locker( &pool->lock );
+    QSet<QString>::const_iterator it = pool->strings.constFind( string );
+    if ( it == pool->strings.constEnd() ) {
+        it = pool->strings.insert( string );
+    }
+    return *it;
+}
+
+int StringPool::size()
+{
+    Pool *pool = s_pool();
+    QReadLocker locker( &pool->lock );
+    return pool->strings.size();
+}
+
+}
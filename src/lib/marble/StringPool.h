@@ -0,0 +1,46 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_STRINGPOOL_H
+#define MARBLE_STRINGPOOL_H
+
+#include "marble_export.h"
+
+#include <QString>
+
+namespace Marble
+{
+
+/**
+ * @short A process wide table of interned strings.
+ *
+ * Values like style urls, roles, country codes or OSM tag keys are repeated
+ * in many thousands of features. Interning them makes all equal values share
+ * the data of a single QString instead of keeping a copy in every feature.
+ *
+ * The pool only grows, so it should only be used for values of low
+ * cardinality. It is safe to use from several threads at once.
+ */
+class MARBLE_EXPORT StringPool
+{
+ public:
+    /**
+     * Returns a string equal to @p string which shares its data with all
+     * other strings of the same value that were interned before.
+     */
+    static QString intern( const QString &string );
+
+    /**
+     * Returns the number of distinct strings in the pool.
+     */
+    static int size();
+};
+
+}
+
+#endif
@@ -20,6 +20,7 @@
 
 #include <QApplication>
 #include <QFont>
+#include <QHash>
 #include <QImage>
 #include <QDate>
 #include <QSet>
@@ -27,6 +28,76 @@
 
 namespace Marble {
 
+namespace {
+
+enum StyleGeometry {
+    PointGeometry,
+    RingGeometry,
+    LineGeometry
+};
+
+enum StyleFlag {
+    SaltWater = 0x1,
+    Maritime = 0x2,
+    Disputed = 0x4,
+    OneWay = 0x8,
+    RestrictedAccess = 0x10,
+    Tunnel = 0x20
+};
+
+enum Season {
+    Autumn = 1,
+    Winter
+};
+
+enum Religion {
+    Jewish = 1,
+    Christian,
+    GenericReligion
+};
+
+/**
+ * Everything createStyle() derives the style of a placemark from. Placemarks
+ * with equal keys get the same style, so fields not relevant for a visual
+ * category are left at their defaults.
+ */
+struct StyleKey
+{
+    StyleKey() :
+        visualCategory(GeoDataFeature::None),
+        geometry(PointGeometry),
+        level(0),
+        variant(0),
+        flags(0),
+        iconCategory(GeoDataFeature::None),
+        width(0.0f)
+    {}
+
+    int visualCategory;
+    int geometry;
+    int level;          // tile level range, for categories whose style depends on it
+    int variant;        // season of trees, religion of graveyards
+    int flags;
+    int iconCategory;   // category providing the icon of areas without one
+    float width;        // physical width of waterways
+};
+
+bool operator==(const StyleKey &a, const StyleKey &b)
+{
+    return a.visualCategory == b.visualCategory && a.geometry == b.geometry
+            && a.level == b.level && a.variant == b.variant && a.flags == b.flags
+            && a.iconCategory == b.iconCategory && a.width == b.width;
+}
+
+uint qHash(const StyleKey &key, uint seed = 0)
+{
+    uint const fields = uint(key.visualCategory) ^ (uint(key.geometry) << 10) ^ (uint(key.level) << 12)
+            ^ (uint(key.variant) << 15) ^ (uint(key.flags) << 18) ^ (uint(key.iconCategory) << 24);
+    return ::qHash(fields, seed) ^ ::qHash(key.width, seed);
+}
+
+}
+
 class StyleBuilder::Private
 {
 public:
@@ -57,6 +128,21 @@ public:
 
     void initializeDefaultStyles();
 
+    GeoDataStyle::ConstPtr presetStyle(GeoDataFeature::GeoDataVisualCategory visualCategory);
+
+    /**
+     * Fills @p key with the inputs of the style of @p placemark.
+     * Returns false if the preset style of the placemark applies unchanged.
+     */
+    bool styleKey(const GeoDataPlacemark *placemark, int tileLevel, StyleKey &key);
+
+    GeoDataStyle::ConstPtr createPlacemarkStyle(const StyleKey &key);
+
+    /**
+     * Returns the category of the first tag of @p osmData whose preset style has an icon.
+     */
+    GeoDataFeature::GeoDataVisualCategory iconCategory(const OsmPlacemarkData &osmData);
+
     static QString createPaintLayerItem(const QString &itemType, GeoDataFeature::GeoDataVisualCategory visualCategory, const QString &subType = QString());
 
     int m_defaultMinZoomLevels[GeoDataFeature::LastIndex];
@@ -65,6 +151,11 @@ public:
     QFont m_defaultFont;
     GeoDataStyle::Ptr m_defaultStyle[GeoDataFeature::LastIndex];
     bool m_defaultStyleInitialized;
+
+    /** Styles shared by all placemarks with the same style key, until reset() */
+    QHash<StyleKey, GeoDataStyle::ConstPtr> m_styleCache;
+    /** Whether the preset style of a category has an icon: -1 unknown, 0 no, 1 yes */
+    QVector<int> m_hasIcon;
 };
 
 StyleBuilder::Private::Private() :
@@ -72,7 +163,8 @@ StyleBuilder::Private::Private() :
     m_defaultLabelColor(Qt::black),
     m_defaultFont(QStringLiteral("Sans Serif")),
     m_defaultStyle(),
-    m_defaultStyleInitialized(false)
+    m_defaultStyleInitialized(false),
+    m_hasIcon(GeoDataFeature::LastIndex, -1)
 {
     for ( int i = 0; i < GeoDataFeature::LastIndex; i++ )
         m_defaultMinZoomLevels[i] = m_maximumZoomLevel;
@@ -827,71 +919,178 @@ GeoDataStyle::ConstPtr StyleBuilder::createStyle(const StyleParameters &paramete
     }
 
     auto const visualCategory = parameters.feature->visualCategory();
-    GeoDataStyle::ConstPtr style = presetStyle(visualCategory);
     if (parameters.feature->nodeType() != GeoDataTypes::GeoDataPlacemarkType) {
-        return style;
+        return presetStyle(visualCategory);
     }
 
     GeoDataPlacemark const * placemark = static_cast<GeoDataPlacemark const *>(parameters.feature);
+    StyleKey key;
+    if (!d->styleKey(placemark, parameters.tileLevel, key)) {
+        return presetStyle(visualCategory);
+    }
+
+    auto const iter = d->m_styleCache.constFind(key);
+    if (iter != d->m_styleCache.constEnd()) {
+        return *iter;
+    }
+
+    GeoDataStyle::ConstPtr const style = d->createPlacemarkStyle(key);
+    d->m_styleCache.insert(key, style);
+    return style;
+}
+
+bool StyleBuilder::Private::styleKey(const GeoDataPlacemark *placemark, int tileLevel, StyleKey &key)
+{
+    auto const visualCategory = placemark->visualCategory();
     OsmPlacemarkData const & osmData = placemark->osmData();
+    key.visualCategory = visualCategory;
+
     if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataPointType) {
-        if (visualCategory == GeoDataFeature::NaturalTree) {
-            GeoDataCoordinates const coordinates = placemark->coordinate();
-            qreal const lat = coordinates.latitude(GeoDataCoordinates::Degree);
-            if (qAbs(lat) > 15) {
-                /** @todo Should maybe auto-adjust to MarbleClock at some point */
-                int const month = QDate::currentDate().month();
-                QString season;
-                bool const southernHemisphere = lat < 0;
-                if (southernHemisphere) {
-                    if (month >= 3 && month <= 5) {
-                        season = "autumn";
-                    } else if (month >= 6 && month <= 8) {
-                        season = "winter";
-                    }
-                } else {
-                    if (month >= 9 && month <= 11) {
-                        season = "autumn";
-                    } else if (month == 12 || month == 1 || month == 2) {
-                        season = "winter";
-                    }
-                }
+        if (visualCategory != GeoDataFeature::NaturalTree) {
+            return false;
+        }
 
-                if (!season.isEmpty()) {
-                    GeoDataIconStyle iconStyle = style->iconStyle();
-                    QString const image = QString("svg/osmcarto/svg/individual/tree-29-%1.svg").arg(season);
-                    iconStyle.setIconPath(MarbleDirs::path(image));
+        GeoDataCoordinates const coordinates = placemark->coordinate();
+        qreal const lat = coordinates.latitude(GeoDataCoordinates::Degree);
+        if (qAbs(lat) <= 15) {
+            return false;
+        }
 
-                    GeoDataStyle::Ptr newStyle(new GeoDataStyle(*style));
-                    newStyle->setIconStyle(iconStyle);
-                    style = newStyle;
-                }
+        /** @todo Should maybe auto-adjust to MarbleClock at some point */
+        int const month = QDate::currentDate().month();
+        bool const southernHemisphere = lat < 0;
+        if (southernHemisphere) {
+            if (month >= 3 && month <= 5) {
+                key.variant = Autumn;
+            } else if (month >= 6 && month <= 8) {
+                key.variant = Winter;
+            }
+        } else {
+            if (month >= 9 && month <= 11) {
+                key.variant = Autumn;
+            } else if (month == 12 || month == 1 || month == 2) {
+                key.variant = Winter;
             }
         }
-    } else if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataLinearRingType) {
-        bool adjustStyle = false;
 
-        GeoDataPolyStyle polyStyle = style->polyStyle();
-        GeoDataLineStyle lineStyle = style->lineStyle();
-        if (visualCategory == GeoDataFeature::NaturalWater) {
-            if( osmData.containsTag("salt","yes") ){
-                polyStyle.setColor("#ffff80");
-                lineStyle.setPenStyle(Qt::DashLine);
-                lineStyle.setWidth(2);
-                adjustStyle = true;
-            }
+        key.geometry = PointGeometry;
+        return key.variant != 0;
+    } else if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataLinearRingType) {
+        key.geometry = RingGeometry;
+        if (visualCategory == GeoDataFeature::NaturalWater && osmData.containsTag("salt","yes")) {
+            key.flags |= SaltWater;
         }
         if(visualCategory == GeoDataFeature::AmenityGraveyard || visualCategory == GeoDataFeature::LanduseCemetery) {
             if( osmData.containsTag("religion","jewish") ){
-                polyStyle.setTexturePath(MarbleDirs::path("bitmaps/osmcarto/patterns/grave_yard_jewish.png"));
-                adjustStyle = true;
+                key.variant = Jewish;
             } else if( osmData.containsTag("religion","christian") ){
-                polyStyle.setTexturePath(MarbleDirs::path("bitmaps/osmcarto/patterns/grave_yard_christian.png"));
-                adjustStyle = true;
+                key.variant = Christian;
             } else if( osmData.containsTag("religion","INT-generic") ){
-                polyStyle.setTexturePath(MarbleDirs::path("bitmaps/osmcarto/patterns/grave_yard_generic.png"));
-                adjustStyle = true;
+                key.variant = GenericReligion;
+            }
+        }
+        if (presetStyle(visualCategory)->iconStyle().iconPath().isEmpty()) {
+            key.iconCategory = iconCategory(osmData);
+        }
+        return true;
+    } else if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataLineStringType) {
+        key.geometry = LineGeometry;
+        if (visualCategory == GeoDataFeature::AdminLevel2) {
+            if (osmData.containsTag("maritime", "yes")) {
+                key.flags |= Maritime;
+                if (osmData.containsTag("marble:disputed", "yes")) {
+                    key.flags |= Disputed;
+                }
             }
+        } else if (visualCategory >= GeoDataFeature::HighwayService &&
+                   visualCategory <= GeoDataFeature::HighwayMotorway) {
+            if (tileLevel >= 0 && tileLevel <= 7) {
+                key.level = 1;
+            } else if (tileLevel >= 0 && tileLevel <= 9) {
+                key.level = 2;
+            } else {
+                key.level = 3;
+                if (osmData.containsTag("oneway", "yes") || osmData.containsTag("oneway", "-1")) {
+                    key.flags |= OneWay;
+                }
+            }
+
+            QString const accessValue = osmData.tagValue("access");
+            if (accessValue == "private" || accessValue == "no" || accessValue == "agricultural" || accessValue == "delivery" || accessValue == "forestry") {
+                key.flags |= RestrictedAccess;
+            }
+            if (osmData.containsTag("tunnel", "yes")) {
+                key.flags |= Tunnel;
+            }
+        } else if (visualCategory == GeoDataFeature::NaturalWater) {
+            if (tileLevel >= 0 && tileLevel <= 7) {
+                key.level = tileLevel <= 3 ? 1 : 2;
+            } else {
+                key.level = 3;
+                QString const widthValue = osmData.tagValue("width").remove(QStringLiteral(" meters")).remove(QStringLiteral(" m"));
+                bool ok;
+                float const width = widthValue.toFloat(&ok);
+                key.width = ok ? qBound(0.1f, width, 200.0f) : 0.0f;
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+GeoDataFeature::GeoDataVisualCategory StyleBuilder::Private::iconCategory(const OsmPlacemarkData &osmData)
+{
+    for (auto iter = osmData.tagsBegin(), end = osmData.tagsEnd(); iter != end; ++iter) {
+        const GeoDataFeature::GeoDataVisualCategory category = OsmPresetLibrary::osmVisualCategory(OsmPresetLibrary::OsmTag(iter.key(), iter.value()));
+        if (category == GeoDataFeature::None) {
+            continue;
+        }
+        if (m_hasIcon[category] < 0) {
+            m_hasIcon[category] = presetStyle(category)->iconStyle().icon().isNull() ? 0 : 1;
+        }
+        if (m_hasIcon[category] > 0) {
+            return category;
+        }
+    }
+
+    return GeoDataFeature::None;
+}
+
+GeoDataStyle::ConstPtr StyleBuilder::Private::createPlacemarkStyle(const StyleKey &key)
+{
+    auto const visualCategory = GeoDataFeature::GeoDataVisualCategory(key.visualCategory);
+    GeoDataStyle::ConstPtr style = presetStyle(visualCategory);
+
+    if (key.geometry == PointGeometry) {
+        GeoDataIconStyle iconStyle = style->iconStyle();
+        QString const season = key.variant == Autumn ? "autumn" : "winter";
+        QString const image = QString("svg/osmcarto/svg/individual/tree-29-%1.svg").arg(season);
+        iconStyle.setIconPath(MarbleDirs::path(image));
+
+        GeoDataStyle::Ptr newStyle(new GeoDataStyle(*style));
+        newStyle->setIconStyle(iconStyle);
+        style = newStyle;
+    } else if (key.geometry == RingGeometry) {
+        bool adjustStyle = false;
+
+        GeoDataPolyStyle polyStyle = style->polyStyle();
+        GeoDataLineStyle lineStyle = style->lineStyle();
+        if (key.flags & SaltWater) {
+            polyStyle.setColor("#ffff80");
+            lineStyle.setPenStyle(Qt::DashLine);
+            lineStyle.setWidth(2);
+            adjustStyle = true;
+        }
+        if (key.variant == Jewish) {
+            polyStyle.setTexturePath(MarbleDirs::path("bitmaps/osmcarto/patterns/grave_yard_jewish.png"));
+            adjustStyle = true;
+        } else if (key.variant == Christian) {
+            polyStyle.setTexturePath(MarbleDirs::path("bitmaps/osmcarto/patterns/grave_yard_christian.png"));
+            adjustStyle = true;
+        } else if (key.variant == GenericReligion) {
+            polyStyle.setTexturePath(MarbleDirs::path("bitmaps/osmcarto/patterns/grave_yard_generic.png"));
+            adjustStyle = true;
         }
         if (adjustStyle) {
             GeoDataStyle::Ptr newStyle(new GeoDataStyle(*style));
@@ -900,29 +1099,22 @@ GeoDataStyle::ConstPtr StyleBuilder::createStyle(const StyleParameters &paramete
             style = newStyle;
         }
 
-        if (style->iconStyle().iconPath().isEmpty()) {
-            for (auto iter = osmData.tagsBegin(), end = osmData.tagsEnd(); iter != end; ++iter) {
-                const QString keyValue = QString("%1=%2").arg(iter.key()).arg(iter.value());
-                const GeoDataFeature::GeoDataVisualCategory category = OsmPresetLibrary::osmVisualCategory(keyValue);
-                const GeoDataStyle::ConstPtr categoryStyle = presetStyle(category);
-                if (category != GeoDataFeature::None && !categoryStyle->iconStyle().icon().isNull()) {
-                    GeoDataStyle::Ptr newStyle(new GeoDataStyle(*style));
-                    newStyle->setIconStyle(categoryStyle->iconStyle());
-                    style = newStyle;
-                    break;
-                }
-            }
+        if (key.iconCategory != GeoDataFeature::None) {
+            const GeoDataStyle::ConstPtr categoryStyle = presetStyle(GeoDataFeature::GeoDataVisualCategory(key.iconCategory));
+            GeoDataStyle::Ptr newStyle(new GeoDataStyle(*style));
+            newStyle->setIconStyle(categoryStyle->iconStyle());
+            style = newStyle;
         }
-    } else if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataLineStringType) {
+    } else if (key.geometry == LineGeometry) {
         GeoDataPolyStyle polyStyle = style->polyStyle();
         GeoDataLineStyle lineStyle = style->lineStyle();
         lineStyle.setCosmeticOutline(true);
 
         if(visualCategory == GeoDataFeature::AdminLevel2){
-            if (osmData.containsTag("maritime", "yes") ) {
+            if (key.flags & Maritime) {
                 lineStyle.setColor("#88b3bf");
                 polyStyle.setColor("#88b3bf");
-                if( osmData.containsTag("marble:disputed", "yes") ){
+                if (key.flags & Disputed) {
                     lineStyle.setPenStyle( Qt::DashLine );
                 }
             }
@@ -930,16 +1122,16 @@ GeoDataStyle::ConstPtr StyleBuilder::createStyle(const StyleParameters &paramete
         else if (visualCategory >= GeoDataFeature::HighwayService &&
                 visualCategory <= GeoDataFeature::HighwayMotorway) {
 
-            if (parameters.tileLevel >= 0 && parameters.tileLevel <= 7) {
+            if (key.level == 1) {
                 /** @todo: Dummy implementation for dynamic style changes based on tile level, replace with sane values */
                 lineStyle.setPhysicalWidth(0.0);
                 lineStyle.setWidth(3.0);
-            } else if (parameters.tileLevel >= 0 && parameters.tileLevel <= 9) {
+            } else if (key.level == 2) {
                 /** @todo: Dummy implementation for dynamic style changes based on tile level, replace with sane values */
                 lineStyle.setPhysicalWidth(0.0);
                 lineStyle.setWidth(4.0);
             } else {
-                bool const isOneWay = osmData.containsTag("oneway", "yes") || osmData.containsTag("oneway", "-1");
+                bool const isOneWay = key.flags & OneWay;
                 int const lanes = isOneWay ? 1 : 2; // also for motorway which implicitly is one way, but has two lanes and each direction has its own highway
                 double const laneWidth = 3.0;
                 double const margins = visualCategory == GeoDataFeature::HighwayMotorway ? 2.0 : (isOneWay ? 1.0 : 0.0);
@@ -947,8 +1139,7 @@ GeoDataStyle::ConstPtr StyleBuilder::createStyle(const StyleParameters &paramete
                 lineStyle.setPhysicalWidth(physicalWidth);
             }
 
-            QString const accessValue = osmData.tagValue("access");
-            if (accessValue == "private" || accessValue == "no" || accessValue == "agricultural" || accessValue == "delivery" || accessValue == "forestry") {
+            if (key.flags & RestrictedAccess) {
                 QColor polyColor = polyStyle.color();
                 qreal hue, sat, val;
                 polyColor.getHsvF(&hue, &sat, &val);
@@ -957,7 +1148,7 @@ GeoDataStyle::ConstPtr StyleBuilder::createStyle(const StyleParameters &paramete
                 lineStyle.setColor(lineStyle.color().darker(150));
             }
 
-            if (osmData.containsTag("tunnel", "yes") ) {
+            if (key.flags & Tunnel) {
                 QColor polyColor = polyStyle.color();
                 qreal hue, sat, val;
                 polyColor.getHsvF(&hue, &sat, &val);
@@ -967,14 +1158,11 @@ GeoDataStyle::ConstPtr StyleBuilder::createStyle(const StyleParameters &paramete
             }
 
         } else if (visualCategory == GeoDataFeature::NaturalWater) {
-            if (parameters.tileLevel >= 0 && parameters.tileLevel <= 7) {
-                lineStyle.setWidth(parameters.tileLevel <= 3 ? 1 : 2);
+            if (key.level == 1 || key.level == 2) {
+                lineStyle.setWidth(key.level == 1 ? 1 : 2);
                 lineStyle.setPhysicalWidth(0.0);
             } else {
-                QString const widthValue = osmData.tagValue("width").remove(QStringLiteral(" meters")).remove(QStringLiteral(" m"));
-                bool ok;
-                float const width = widthValue.toFloat(&ok);
-                lineStyle.setPhysicalWidth(ok ? qBound(0.1f, width, 200.0f) : 0.0f);
+                lineStyle.setPhysicalWidth(key.width);
             }
         }
         GeoDataStyle::Ptr newStyle(new GeoDataStyle(*style));
@@ -995,14 +1183,19 @@ GeoDataStyle::ConstPtr StyleBuilder::createStyle(const StyleParameters &paramete
 
 GeoDataStyle::ConstPtr StyleBuilder::presetStyle(GeoDataFeature::GeoDataVisualCategory visualCategory) const
 {
-    if (!d->m_defaultStyleInitialized) {
-        d->initializeDefaultStyles();
+    return d->presetStyle(visualCategory);
+}
+
+GeoDataStyle::ConstPtr StyleBuilder::Private::presetStyle(GeoDataFeature::GeoDataVisualCategory visualCategory)
+{
+    if (!m_defaultStyleInitialized) {
+        initializeDefaultStyles();
     }
 
-    if (visualCategory != GeoDataFeature::None && d->m_defaultStyle[visualCategory] ) {
-        return d->m_defaultStyle[visualCategory];
+    if (visualCategory != GeoDataFeature::None && m_defaultStyle[visualCategory] ) {
+        return m_defaultStyle[visualCategory];
     } else {
-        return d->m_defaultStyle[GeoDataFeature::Default];
+        return m_defaultStyle[GeoDataFeature::Default];
     }
 }
 
@@ -1130,6 +1323,8 @@ QStringList StyleBuilder::renderOrder() const
 void StyleBuilder::reset()
 {
     d->m_defaultStyleInitialized = false;
+    d->m_styleCache.clear();
+    d->m_hasIcon.fill(-1);
 }
 
 int StyleBuilder::minimumZoomLevel(GeoDataFeature::GeoDataVisualCategory category) const
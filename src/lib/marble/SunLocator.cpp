@@ -46,25 +46,52 @@ public:
     SunLocatorPrivate( const MarbleClock *clock, const Planet *planet )
         : m_lon( 0.0 ),
           m_lat( 0.0 ),
+          m_twilightZone( twilightZone( planet ) ),
           m_clock( clock ),
           m_planet( planet )
     {
     }
 
+    static qreal twilightZone( const Planet *planet );
+
     qreal m_lon;
     qreal m_lat;
+    // Kept with the position, shading() must not look at the planet
+    qreal m_twilightZone;
 
     const MarbleClock *const m_clock;
     const Planet *m_planet;
 };
 
 
+qreal SunLocatorPrivate::twilightZone( const Planet *planet )
+{
+    const QString planetId = planet ? planet->id() : QString();
+    if ( planetId == "earth" || planetId == "venus") {
+        return 0.1; // this equals 18 deg astronomical twilight.
+    }
+    else if ( planetId == "mars" ) {
+        return 0.05;
+    }
+
+    return 0.0;
+}
+
 SunLocator::SunLocator( const MarbleClock *clock, const Planet *planet )
   : QObject(),
     d( new SunLocatorPrivate( clock, planet ))
 {
 }
 
+SunLocator::SunLocator( const SunLocator *other )
+  : QObject(),
+    d( new SunLocatorPrivate( other->d->m_clock, 0 ) )
+{
+    d->m_lon = other->d->m_lon;
+    d->m_lat = other->d->m_lat;
+    d->m_twilightZone = other->d->m_twilightZone;
+}
+
 SunLocator::~SunLocator()
 {
     delete d;
@@ -110,15 +137,7 @@ qreal SunLocator::shading(qreal lon, qreal a, qreal c) const
       theta = 2*asin(sqrt(h))
     */
 
-    qreal twilightZone = 0.0;
-
-    QString planetId = d->m_planet->id();
-    if ( planetId == "earth" || planetId == "venus") {
-        twilightZone = 0.1; // this equals 18 deg astronomical twilight.
-    }
-    else if ( planetId == "mars" ) {
-        twilightZone = 0.05;
-    }
+    qreal const twilightZone = d->m_twilightZone;
 
     qreal brightness;
     if ( h <= 0.5 - twilightZone / 2.0 )
@@ -202,6 +221,7 @@ void SunLocator::setPlanet( const Planet *planet )
 
     mDebug() << "SunLocator::setPlanet(Planet*)";
     d->m_planet = planet;
+    d->m_twilightZone = SunLocatorPrivate::twilightZone( planet );
     updatePosition();
 
     // Initially there might be no planet set.
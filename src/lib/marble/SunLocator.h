@@ -35,6 +35,13 @@ class MARBLE_EXPORT SunLocator : public QObject
 
  public:
     SunLocator( const MarbleClock *clock, const Planet *planet );
+
+    /**
+     * Creates a locator with the current sun position of @p other, for shading
+     * tiles in worker threads. It neither follows the clock nor a planet change.
+     */
+    explicit SunLocator( const SunLocator *other );
+
     virtual ~SunLocator();
 
     qreal shading(qreal lon, qreal a, qreal c) const;
@@ -38,6 +38,14 @@ public:
 
     void setRepaintNeeded();
 
+    /**
+     * Notifies the mapper that the center of the viewport moved.
+     *
+     * By default this schedules a full repaint. Mappers which are able to
+     * shift their previous canvas only re-map the newly exposed areas instead.
+     */
+    virtual void setCenterChanged();
+
 protected:
     bool m_repaintNeeded;
 };
@@ -13,23 +13,54 @@
 #include "TileCreator.h"
 
 #include <cmath>
+#include <cstring>
 
+#include <QAtomicInt>
 #include <QDir>
 #include <QRect>
+#include <QSemaphore>
 #include <QSize>
 #include <QVector>
 #include <QApplication>
 #include <QImage>
-#include <QPainter>
+#include <QImageReader>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "MarbleGlobal.h"
 #include "MarbleDirs.h"
 #include "MarbleDebug.h"
 #include "TileLoaderHelper.h"
+#include "TileCreator_p.h"
 
 namespace Marble
 {
 
+/**
+ * Box filters the scanlines @p topY of @p top and @p bottomY of @p bottom, both
+ * twice as wide as @p destination, into the scanline @p destY of @p destination.
+ */
+static void downsampleScanLine( const QImage &top, int topY, const QImage &bottom, int bottomY,
+                                QImage &destination, int destY )
+{
+    const int pairs = destination.width();
+
+    if ( destination.format() == QImage::Format_Indexed8 ) {
+        const uchar *topLine = top.constScanLine( topY );
+        const uchar *bottomLine = bottom.constScanLine( bottomY );
+        uchar *result = destination.scanLine( destY );
+        for ( int x = 0; x < pairs; ++x ) {
+            result[x] = ( topLine[2 * x] + topLine[2 * x + 1]
+                          + bottomLine[2 * x] + bottomLine[2 * x + 1] + 2 ) >> 2;
+        }
+    } else {
+        downsampleLine( reinterpret_cast<const uint*>( top.constScanLine( topY ) ),
+                        reinterpret_cast<const uint*>( bottom.constScanLine( bottomY ) ),
+                        reinterpret_cast<uint*>( destination.scanLine( destY ) ),
+                        pairs );
+    }
+}
+
 class TileCreatorPrivate
 {
  public:
@@ -41,20 +72,32 @@ class TileCreatorPrivate
          m_tileFormat( "jpg" ),
          m_resume( false ),
          m_verify( false ),
-         m_source( source )
+         m_source( source ),
+         m_pendingSaves( 4 * QThread::idealThreadCount() )
      {
         if ( m_dem == "true" ) {
             m_tileQuality = 70;
         } else {
             m_tileQuality = 85;
         }
+
+        for ( int cnt = 0; cnt <= 255; ++cnt ) {
+            m_grayScalePalette.insert(cnt, qRgb(cnt, cnt, cnt));
+        }
     }
 
     ~TileCreatorPrivate()
     {
+        m_threadPool.waitForDone();
         delete m_source;
     }
 
+    QString tileName( int level, int n, int m ) const;
+
+    void saveTile( const QImage &tile, const QString &tileName );
+
+    void createRow( int level, int n, const QImage &row );
+
  public:
     QString  m_dem;
     QString  m_targetDir;
@@ -65,24 +108,162 @@ class TileCreatorPrivate
     bool     m_verify;
 
     TileCreatorSource  *m_source;
+
+    QVector<QRgb> m_grayScalePalette;
+
+    // Encoding and writing tiles runs on the pool, at most as many tiles
+    // are kept in memory for that as the semaphore has resources.
+    QThreadPool  m_threadPool;
+    QSemaphore   m_pendingSaves;
+    QAtomicInt   m_savedTilesCount;
+
+    // The upper half of the next row of each lower level, built from an
+    // even row of the level above and completed by the following odd row,
+    // and the last scanline of that even row.
+    QVector<QImage>  m_lowerLevelRows;
+    QVector<QImage>  m_lastEvenLines;
+};
+
+class TileCreatorSaveJob : public QRunnable
+{
+ public:
+    TileCreatorSaveJob( TileCreatorPrivate *d, const QImage &tile, const QString &tileName )
+        : m_d( d ),
+          m_tile( tile ),
+          m_tileName( tileName )
+    {
+    }
+
+    virtual void run()
+    {
+        m_d->saveTile( m_tile, m_tileName );
+        m_d->m_savedTilesCount.ref();
+        m_d->m_pendingSaves.release();
+    }
+
+ private:
+    TileCreatorPrivate *const m_d;
+    const QImage  m_tile;
+    const QString m_tileName;
 };
 
+QString TileCreatorPrivate::tileName( int level, int n, int m ) const
+{
+    return m_targetDir + ( QString("%1/%2/%2_%3.%4")
+                           .arg( level )
+                           .arg( n, tileDigits, 10, QChar('0') )
+                           .arg( m, tileDigits, 10, QChar('0') ) )
+                           .arg( m_tileFormat );
+}
+
+void TileCreatorPrivate::saveTile( const QImage &tile, const QString &tileName )
+{
+    bool  ok = tile.save( tileName, m_tileFormat.toLatin1().data(), m_tileQuality );
+    if ( !ok )
+        mDebug() << "Error while writing Tile: " << tileName;
+
+    if ( m_verify ) {
+        QImage writtenTile(tileName);
+        Q_ASSERT( writtenTile.size() == tile.size() );
+        for ( int i=0; i < writtenTile.size().width(); ++i) {
+            for ( int j=0; j < writtenTile.size().height(); ++j) {
+                if ( writtenTile.pixel( i, j ) != tile.pixel( i, j ) ) {
+                    unsigned int  pixel = tile.pixel( i, j);
+                    unsigned int  writtenPixel = writtenTile.pixel( i, j);
+                    qWarning() << "***** pixel" << i << j << "is off by" << (pixel - writtenPixel) << "pixel" << pixel << "writtenPixel" << writtenPixel;
+                    QByteArray baPixel((char*)&pixel, sizeof(unsigned int));
+                    qWarning() << "pixel" << baPixel.size() << "0x" << baPixel.toHex();
+                    QByteArray baWrittenPixel((char*)&writtenPixel, sizeof(unsigned int));
+                    qWarning() << "writtenPixel" << baWrittenPixel.size() << "0x" << baWrittenPixel.toHex();
+                    Q_ASSERT(false);
+                }
+            }
+        }
+    }
+}
+
+void TileCreatorPrivate::createRow( int level, int n, const QImage &row )
+{
+    const int tileSize = c_defaultTileSize;
+    const int mmax = TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, level );
+
+    for ( int m = 0; m < mmax; ++m ) {
+        const QString name = tileName( level, n, m );
+        if ( m_resume && QFile::exists( name ) ) {
+            m_savedTilesCount.ref();
+            continue;
+        }
+
+        m_pendingSaves.acquire();
+        m_threadPool.start( new TileCreatorSaveJob( this, row.copy( m * tileSize, 0, tileSize, tileSize ), name ) );
+    }
+
+    if ( level == 0 ) {
+        return;
+    }
+
+    // Each row of the level below is made of two rows of this level, which
+    // are box filtered as one image of twice the width and height. As the tile
+    // size is odd, the last scanline of the even row is paired with the first
+    // one of the odd row.
+    QImage &lowerRow = m_lowerLevelRows[level - 1];
+    QImage &lastEvenLine = m_lastEvenLines[level - 1];
+    if ( n % 2 == 0 ) {
+        lowerRow = QImage( row.width() / 2, tileSize, row.format() );
+        if ( row.format() == QImage::Format_Indexed8 ) {
+            lowerRow.setColorTable( m_grayScalePalette );
+        }
+
+        for ( int y = 0; 2 * y + 1 < tileSize; ++y ) {
+            downsampleScanLine( row, 2 * y, row, 2 * y + 1, lowerRow, y );
+        }
+        lastEvenLine = row.copy( 0, tileSize - 1, row.width(), 1 );
+    } else {
+        for ( int y = tileSize / 2; y < tileSize; ++y ) {
+            const int topY = 2 * y - tileSize;
+            if ( topY < 0 ) {
+                downsampleScanLine( lastEvenLine, 0, row, 0, lowerRow, y );
+            } else {
+                downsampleScanLine( row, topY, row, topY + 1, lowerRow, y );
+            }
+        }
+        lastEvenLine = QImage();
+    }
+
+    if ( n % 2 == 1 ) {
+        const QImage completedRow = lowerRow;
+        lowerRow = QImage();
+        createRow( level - 1, n / 2, completedRow );
+    }
+}
+
+// The source image is read in bands of rows of tiles no larger than this
+static const qint64 maximumBandBytes = 128 * 1024 * 1024;
+
 class TileCreatorSourceImage : public TileCreatorSource
 {
 public:
     explicit TileCreatorSourceImage( const QString &sourcePath )
-        : m_sourceImage( QImage( sourcePath ) ),
-          m_cachedRowNum( -1 )
+        : m_sourcePath( sourcePath ),
+          m_cachedRowNum( -1 ),
+          m_bandFirstRow( -1 ),
+          m_bandRowCount( 0 )
     {
+        QImageReader reader( sourcePath );
+        m_sourceSize = reader.size();
+
+        // Not every image format can tell its size without decoding it, and
+        // without clipping support each band would decode the whole image.
+        // Such images have to be loaded completely, once.
+        if ( !m_sourceSize.isValid() || !reader.supportsOption( QImageIOHandler::ClipRect ) ) {
+            m_sourceImage = reader.read();
+            m_sourceSize = m_sourceImage.size();
+        }
     }
 
     virtual QSize fullImageSize() const
     {
-        if ( m_sourceImage.size().width() > 21600 || m_sourceImage.height() > 10800 ) {
-            qDebug("Install map too large!");
-            return QSize();
-        }
-        return m_sourceImage.size();
+        return m_sourceSize;
     }
 
     virtual QImage tile(int n, int m, int maxTileLevel)
@@ -90,8 +271,8 @@ public:
         int  mmax = TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, maxTileLevel );
         int  nmax = TileLoaderHelper::levelToRow( defaultLevelZeroRows, maxTileLevel );
 
-        int imageHeight = m_sourceImage.height();
-        int imageWidth = m_sourceImage.width();
+        int imageHeight = m_sourceSize.height();
+        int imageWidth = m_sourceSize.width();
 
         // If the image size of the image source does not match the expected
         // geometry we need to smooth-scale the image in advance to match
@@ -99,19 +280,10 @@ public:
         bool needsScaling = ( imageWidth != 2 * nmax * (int)( c_defaultTileSize )
                             ||  imageHeight != nmax * (int)( c_defaultTileSize ) );
 
-        if ( needsScaling )
-            mDebug() << "Image Size doesn't match 2*n*TILEWIDTH x n*TILEHEIGHT geometry. Scaling ...";
-
         int  stdImageWidth  = 2 * nmax * c_defaultTileSize;
         if ( stdImageWidth == 0 )
             stdImageWidth = 2 * c_defaultTileSize;
 
-        int  stdImageHeight  = nmax * c_defaultTileSize;
-        if ( stdImageWidth != imageWidth ) {
-            mDebug() <<
-            QString( "TileCreator::createTiles() The size of the final image will measure  %1 x %2 pixels").arg(stdImageWidth).arg(stdImageHeight);
-        }
-
         QImage row;
 
         if ( m_cachedRowNum == n ) {
@@ -120,13 +292,34 @@ public:
 
         } else {
 
-            QRect   sourceRowRect( 0, (int)( (qreal)( n * imageHeight ) / (qreal)( nmax )),
-                                imageWidth,(int)( (qreal)( imageHeight ) / (qreal)( nmax ) ) );
-
-
-            row = m_sourceImage.copy( sourceRowRect );
+            if ( needsScaling )
+                mDebug() << "Image Size doesn't match 2*n*TILEWIDTH x n*TILEHEIGHT geometry. Scaling ...";
+
+            QRect   sourceRowRect( 0, rowTop( n, nmax ), imageWidth, (int)( (qreal)( imageHeight ) / (qreal)( nmax ) ) );
+
+            if ( m_sourceImage.isNull() ) {
+                // Only a band of rows is read from the source file, so the
+                // whole source image never needs to be held in memory. Rows
+                // are requested top to bottom, and decoders like the JPEG one
+                // have to decode everything above the band, so the bands are
+                // made as large as the memory limit allows.
+                if ( n < m_bandFirstRow || n >= m_bandFirstRow + m_bandRowCount ) {
+                    const qint64 rowBytes = qMax<qint64>( 1, qint64( imageWidth ) * sourceRowRect.height() * 4 );
+                    m_bandFirstRow = n;
+                    m_bandRowCount = int( qBound<qint64>( 1, maximumBandBytes / rowBytes, nmax - n ) );
+                    const int bandTop = rowTop( n, nmax );
+                    const int bandBottom = rowTop( n + m_bandRowCount - 1, nmax ) + sourceRowRect.height();
+
+                    QImageReader reader( m_sourcePath );
+                    reader.setClipRect( QRect( 0, bandTop, imageWidth, bandBottom - bandTop ) );
+                    m_band = reader.read();
+                }
+                row = m_band.copy( sourceRowRect.translated( 0, -rowTop( m_bandFirstRow, nmax ) ) );
+            } else {
+                row = m_sourceImage.copy( sourceRowRect );
+            }
 
-            if ( needsScaling ) {
+            if ( needsScaling && !row.isNull() ) {
                 // Pick the current row and smooth scale it
                 // to make it match the expected size
                 QSize destSize( stdImageWidth, c_defaultTileSize );
@@ -150,10 +343,21 @@ public:
     }
 
 private:
+    int rowTop( int n, int nmax ) const
+    {
+        return (int)( (qreal)( n * m_sourceSize.height() ) / (qreal)( nmax ) );
+    }
+
+    const QString m_sourcePath;
+    QSize m_sourceSize;
     QImage m_sourceImage;
 
     QImage m_rowCache;
     int m_cachedRowNum;
+
+    QImage m_band;
+    int m_bandFirstRow;
+    int m_bandRowCount;
 };
 
 
@@ -221,11 +425,6 @@ void TileCreator::run()
 
     mDebug() << "Installing tiles to: " << d->m_targetDir;
 
-    QVector<QRgb> grayScalePalette;
-    for ( int cnt = 0; cnt <= 255; ++cnt ) {
-        grayScalePalette.insert(cnt, qRgb(cnt, cnt, cnt));
-    }
-
     QSize fullImageSize = d->m_source->fullImageSize();
     int  imageWidth  = fullImageSize.width();
     int  imageHeight = fullImageSize.height();
@@ -250,22 +449,24 @@ void TileCreator::run()
         mDebug() 
         << QString( "TileCreator::createTiles(): Invalid Maximum Tile Level: %1" )
         .arg( maxTileLevel );
+        maxTileLevel = 0;
     }
     mDebug() << "Maximum Tile Level: " << maxTileLevel;
 
-
-    if ( !QDir( d->m_targetDir ).exists() )
-        ( QDir::root() ).mkpath( d->m_targetDir );
-
-    // Counting total amount of tiles to be generated for the progressbar
-    // to prevent compiler warnings this var should
-    // match the type of maxTileLevel
+    // Creating the directory structure for all levels up front, as the
+    // tiles of different levels are written in parallel
     int  tileLevel      = 0;
     int  totalTileCount = 0;
 
     while ( tileLevel <= maxTileLevel ) {
-        totalTileCount += ( TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel )
-                            * TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel ) );
+        int  nmaxit = TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel );
+        for ( int n = 0; n < nmaxit; ++n ) {
+            QString dirName( d->m_targetDir
+                             + QString("%1/%2").arg( tileLevel ).arg( n, tileDigits, 10, QChar('0') ) );
+            if ( !QDir( dirName ).exists() )
+                ( QDir::root() ).mkpath( dirName );
+        }
+        totalTileCount += nmaxit * TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel );
         tileLevel++;
     }
 
@@ -274,307 +475,86 @@ void TileCreator::run()
     int  mmax = TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, maxTileLevel );
     int  nmax = TileLoaderHelper::levelToRow( defaultLevelZeroRows, maxTileLevel );
 
-    // Loading each row at highest spatial resolution and cropping tiles
-    int      percentCompleted = 0;
-    int      createdTilesCount = 0;
-    QString  tileName;
+    // The source is read one row of tiles at the highest level at a time.
+    // Each row is saved and box filtered into the rows of the lower levels
+    // right away, so no tile is read back from disk and only a few rows per
+    // level are held in memory.
+    const QImage::Format format = d->m_dem == "true" ? QImage::Format_Indexed8 : QImage::Format_ARGB32;
+    const int  bytesPerPixel = d->m_dem == "true" ? 1 : 4;
+    const QSize tileSize( c_defaultTileSize, c_defaultTileSize );
 
-    // Creating directory structure for the highest level
-    QString  dirName( d->m_targetDir
-                      + QString("%1").arg(maxTileLevel) );
-    if ( !QDir( dirName ).exists() ) 
-        ( QDir::root() ).mkpath( dirName );
+    d->m_lowerLevelRows.fill( QImage(), maxTileLevel );
+    d->m_lastEvenLines.fill( QImage(), maxTileLevel );
+    d->m_savedTilesCount.store( 0 );
 
     for ( int n = 0; n < nmax; ++n ) {
-        QString dirName( d->m_targetDir
-                         + QString("%1/%2").arg(maxTileLevel).arg( n, tileDigits, 10, QChar('0') ) );
-        if ( !QDir( dirName ).exists() ) 
-            ( QDir::root() ).mkpath( dirName );
-    }
 
-    for ( int n = 0; n < nmax; ++n ) {
+        QImage row( mmax * c_defaultTileSize, c_defaultTileSize, format );
+        if ( format == QImage::Format_Indexed8 ) {
+            row.setColorTable( d->m_grayScalePalette );
+        }
 
         for ( int m = 0; m < mmax; ++m ) {
 
             mDebug() << "** tile" << m << "x" << n;
 
-            if ( d->m_cancelled ) 
+            if ( d->m_cancelled ) {
+                d->m_threadPool.waitForDone();
                 return;
-
-            tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                       .arg( maxTileLevel )
-                                       .arg( n, tileDigits, 10, QChar('0') )
-                                       .arg( m, tileDigits, 10, QChar('0') ) )
-                                       .arg( d->m_tileFormat );
-
-            if ( QFile::exists( tileName ) && d->m_resume ) {
-
-                //mDebug() << tileName << "exists already";
-
-            } else {
-
-                QImage tile = d->m_source->tile( n, m, maxTileLevel );
-
-                if ( tile.isNull() ) {
-                    mDebug() << "Read-Error! Null QImage!";
-                    return;
-                }
-
-                if ( d->m_dem == "true" ) {
-                    tile = tile.convertToFormat(QImage::Format_Indexed8,
-                                                grayScalePalette,
-                                                Qt::ThresholdDither);
-                }
-
-                bool  ok = tile.save( tileName, d->m_tileFormat.toLatin1().data(), d->m_tileFormat == "jpg" ? 100 : d->m_tileQuality );
-                if ( !ok )
-                    mDebug() << "Error while writing Tile: " << tileName;
-
-                mDebug() << tileName << "size" << QFile( tileName ).size();
-
-                if ( d->m_verify ) {
-                    QImage writtenTile(tileName);
-                    Q_ASSERT( writtenTile.size() == tile.size() );
-                    for ( int i=0; i < writtenTile.size().width(); ++i) {
-                        for ( int j=0; j < writtenTile.size().height(); ++j) {
-                            if ( writtenTile.pixel( i, j ) != tile.pixel( i, j ) ) {
-                                unsigned int  pixel = tile.pixel( i, j);
-                                unsigned int  writtenPixel = writtenTile.pixel( i, j);
-                                qWarning() << "***** pixel" << i << j << "is off by" << (pixel - writtenPixel) << "pixel" << pixel << "writtenPixel" << writtenPixel;
-                                QByteArray baPixel((char*)&pixel, sizeof(unsigned int));
-                                qWarning() << "pixel" << baPixel.size() << "0x" << baPixel.toHex();
-                                QByteArray baWrittenPixel((char*)&writtenPixel, sizeof(unsigned int));
-                                qWarning() << "writtenPixel" << baWrittenPixel.size() << "0x" << baWrittenPixel.toHex();
-                                Q_ASSERT(false);
-                            }
-                        }
-                    }
-                }
-
             }
 
-            percentCompleted =  (int) ( 90 * (qreal)(createdTilesCount) 
-                                        / (qreal)(totalTileCount) );	
-            createdTilesCount++;
+            QImage tile;
 
-            mDebug() << "percentCompleted" << percentCompleted;
-            emit progress( percentCompleted );
-        }
-    }
-
-    mDebug() << "tileLevel: " << maxTileLevel << " successfully created.";
-
-    tileLevel = maxTileLevel;
-
-    // Now that we have the tiles at the highest resolution lets build
-    // them together four by four.
-
-    while( tileLevel > 0 ) {
-        tileLevel--;
+            // Existing tiles are still needed to create the lower levels
+            const QString tileName = d->tileName( maxTileLevel, n, m );
+            if ( d->m_resume && QFile::exists( tileName ) ) {
+                tile = QImage( tileName );
+            }
 
-        int  nmaxit =  TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel );
+            if ( tile.isNull() ) {
+                tile = d->m_source->tile( n, m, maxTileLevel );
+            }
 
-        for ( int n = 0; n < nmaxit; ++n ) {
-            QString  dirName( d->m_targetDir
-                              + ( QString("%1/%2")
-                                  .arg(tileLevel)
-                                  .arg( n, tileDigits, 10, QChar('0') ) ) );
+            if ( tile.isNull() ) {
+                mDebug() << "Read-Error! Null QImage!";
+                d->m_threadPool.waitForDone();
+                return;
+            }
 
-            // mDebug() << "dirName: " << dirName;
-            if ( !QDir( dirName ).exists() ) 
-                ( QDir::root() ).mkpath( dirName );
+            if ( tile.size() != tileSize ) {
+                tile = tile.scaled( tileSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+            }
 
-            int   mmaxit = TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel );
-            for ( int m = 0; m < mmaxit; ++m ) {
-
-                if ( d->m_cancelled )
-                    return;
-
-                QString newTileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                           .arg( tileLevel )
-                                           .arg( n, tileDigits, 10, QChar('0') )
-                                           .arg( m, tileDigits, 10, QChar('0') ) )
-                                           .arg( d->m_tileFormat );
-
-                if ( QFile::exists( newTileName ) && d->m_resume ) {
-                    //mDebug() << newTileName << "exists already";
-                } else {
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_topleft( tileName );
-
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m+1, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_topright( tileName );
-
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n+1, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_bottomleft( tileName );
-
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n+1, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m+1, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_bottomright( tileName );
-
-                    QSize const expectedSize( c_defaultTileSize, c_defaultTileSize );
-                    if ( img_topleft.size() != expectedSize ||
-                         img_topright.size() != expectedSize ||
-                         img_bottomleft.size() != expectedSize ||
-                         img_bottomright.size() != expectedSize ) {
-                        mDebug() << "Tile write failure. Missing write permissions?";
-                        emit progress( 100 );
-                        return;
-                    }
-                    QImage  tile = img_topleft;
-
-                    if ( d->m_dem == "true" ) {
-
-                        tile.setColorTable( grayScalePalette );
-                        uchar* destLine;
-
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_topleft.scanLine( 2 * y );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[x] = srcLine[ 2*x ];
-                        }
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_topright.scanLine( 2 * y );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2 * ( x - c_defaultTileSize / 2 ) ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_bottomleft.scanLine( 2 * ( y - c_defaultTileSize / 2 ) );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[ x ] = srcLine[ 2 * x ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_bottomright.scanLine( 2 * ( y - c_defaultTileSize/2 ) );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2 * ( x - c_defaultTileSize / 2 ) ];
-                        }
-                    }
-                    else {
-
-                        // tile.depth() != 8
-
-                        img_topleft = img_topleft.convertToFormat( QImage::Format_ARGB32 );
-                        img_topright = img_topright.convertToFormat( QImage::Format_ARGB32 );
-                        img_bottomleft = img_bottomleft.convertToFormat( QImage::Format_ARGB32 );
-                        img_bottomright = img_bottomright.convertToFormat( QImage::Format_ARGB32 );
-                        tile = img_topleft;
-
-                        QRgb* destLine;
-
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_topleft.scanLine( 2 * y );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[x] = srcLine[ 2 * x ];
-                        }
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_topright.scanLine( 2 * y );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2 * ( x - c_defaultTileSize / 2 ) ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_bottomleft.scanLine( 2 * ( y-c_defaultTileSize/2 ) );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[x] = srcLine[ 2 * x ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_bottomright.scanLine( 2 * ( y-c_defaultTileSize / 2 ) );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2*( x-c_defaultTileSize / 2 ) ];
-                        }
-                    }
-
-                    mDebug() << newTileName;
-
-                    // Saving at 100% JPEG quality to have a high-quality
-                    // version to create the remaining needed tiles from.
-                    bool  ok = tile.save( newTileName, d->m_tileFormat.toLatin1().data(), d->m_tileFormat == "jpg" ? 100 : d->m_tileQuality );
-                    if ( ! ok )
-                        mDebug() << "Error while writing Tile: " << newTileName;
-                }
+            if ( format == QImage::Format_Indexed8 ) {
+                tile = tile.convertToFormat( QImage::Format_Indexed8,
+                                             d->m_grayScalePalette,
+                                             Qt::ThresholdDither );
+            } else {
+                tile = tile.convertToFormat( QImage::Format_ARGB32 );
+            }
 
-                percentCompleted =  (int) ( 90 * (qreal)(createdTilesCount)
-                                            / (qreal)(totalTileCount) );	
-                createdTilesCount++;
-						
-                emit progress( percentCompleted );
-                mDebug() << "percentCompleted" << percentCompleted;
+            for ( int y = 0; y < c_defaultTileSize; ++y ) {
+                memcpy( row.scanLine( y ) + m * c_defaultTileSize * bytesPerPixel,
+                        tile.constScanLine( y ), c_defaultTileSize * bytesPerPixel );
             }
         }
-        mDebug() << "tileLevel: " << tileLevel << " successfully created.";
-    }
-    mDebug() << "Tile creation completed.";
-
-    if ( d->m_tileFormat == "jpg" && d->m_tileQuality != 100 ) {
-
-        // Applying correct lower JPEG compression now that we created all tiles
-        int savedTilesCount = 0;
-
-        tileLevel = 0;
-        while ( tileLevel <= maxTileLevel ) {
-            int nmaxit =  TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel );
-            for ( int n = 0; n < nmaxit; ++n) {
-                int mmaxit =  TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel );
-                for ( int m = 0; m < mmaxit; ++m) {
-
-                    if ( d->m_cancelled )
-                        return;
 
-                    savedTilesCount++;
+        d->createRow( maxTileLevel, n, row );
 
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel )
-                                            .arg( n, tileDigits, 10, QChar('0') )
-                                            .arg( m, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage tile( tileName );
-
-                    bool ok;
+        // Don't exceed 99% as this would cancel the thread unexpectedly
+        int  percentCompleted = (int)( 99 * (qreal)( d->m_savedTilesCount.load() )
+                                       / (qreal)( totalTileCount ) );
+        mDebug() << "percentCompleted" << percentCompleted;
+        emit progress( percentCompleted );
+    }
 
-                    ok = tile.save( tileName, d->m_tileFormat.toLatin1().data(), d->m_tileQuality );
+    d->m_threadPool.waitForDone();
 
-                    if ( !ok )
-                        mDebug() << "Error while writing Tile: " << tileName;
-                    // Don't exceed 99% as this would cancel the thread unexpectedly
-                    percentCompleted = 90 + (int)( 9 * (qreal)(savedTilesCount)
-                                                / (qreal)(totalTileCount) );
-                    emit progress( percentCompleted );
-                    mDebug() << "percentCompleted" << percentCompleted;
-                    //mDebug() << "Saving Tile #" << savedTilesCount
-                    //         << " of " << totalTileCount
-                    //         << " Percent: " << percentCompleted;
-                }
-            }
-            tileLevel++;
-        }
-    }
+    mDebug() << "Tile creation completed.";
 
-    percentCompleted = 100;
-    emit progress( percentCompleted );
+    emit progress( 100 );
 
-    mDebug() << "percentCompleted: " << percentCompleted;
+    mDebug() << "percentCompleted: " << 100;
 }
 
 void TileCreator::setTileFormat(const QString& format)
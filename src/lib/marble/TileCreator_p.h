@@ -0,0 +1,94 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_TILECREATORPRIVATE_H
+#define MARBLE_TILECREATORPRIVATE_H
+
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define MARBLE_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Marble
+{
+
+// Box filtering of 2x2 blocks of 32 bit pixels, used to create each tile level
+// from the level above. All kernels round to nearest and give the same results.
+
+inline uint averagePixels( uint topLeft, uint topRight, uint bottomLeft, uint bottomRight )
+{
+    // Sums up two channels at once, each in a 16 bit half of the word
+    const uint redBlue = ( ( topLeft & 0x00ff00ff ) + ( topRight & 0x00ff00ff )
+                         + ( bottomLeft & 0x00ff00ff ) + ( bottomRight & 0x00ff00ff ) + 0x00020002 ) >> 2;
+    const uint alphaGreen = ( ( ( topLeft >> 8 ) & 0x00ff00ff ) + ( ( topRight >> 8 ) & 0x00ff00ff )
+                            + ( ( bottomLeft >> 8 ) & 0x00ff00ff ) + ( ( bottomRight >> 8 ) & 0x00ff00ff ) + 0x00020002 ) >> 2;
+    return ( redBlue & 0x00ff00ff ) | ( ( alphaGreen & 0x00ff00ff ) << 8 );
+}
+
+/**
+ * Averages the 2x2 blocks of @p count pixel pairs of the lines @p top and
+ * @p bottom into @p result, one pixel at a time.
+ */
+inline void downsampleLinePortable( const uint *top, const uint *bottom, uint *result, int count )
+{
+    for ( int i = 0; i < count; ++i ) {
+        result[i] = averagePixels( top[2 * i], top[2 * i + 1], bottom[2 * i], bottom[2 * i + 1] );
+    }
+}
+
+#ifdef MARBLE_HAVE_SSE2
+
+/**
+ * Same as downsampleLinePortable(), four result pixels at a time.
+ */
+inline void downsampleLineSse2( const uint *top, const uint *bottom, uint *result, int count )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16( 2 );
+
+    int i = 0;
+    for ( ; i + 4 <= count; i += 4 ) {
+        const __m128i top0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( top + 2 * i ) );
+        const __m128i top1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( top + 2 * i + 4 ) );
+        const __m128i bottom0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( bottom + 2 * i ) );
+        const __m128i bottom1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( bottom + 2 * i + 4 ) );
+
+        // Vertical sums of the 16 bit channels, two source pixels per register
+        const __m128i sum01 = _mm_add_epi16( _mm_unpacklo_epi8( top0, zero ), _mm_unpacklo_epi8( bottom0, zero ) );
+        const __m128i sum23 = _mm_add_epi16( _mm_unpackhi_epi8( top0, zero ), _mm_unpackhi_epi8( bottom0, zero ) );
+        const __m128i sum45 = _mm_add_epi16( _mm_unpacklo_epi8( top1, zero ), _mm_unpacklo_epi8( bottom1, zero ) );
+        const __m128i sum67 = _mm_add_epi16( _mm_unpackhi_epi8( top1, zero ), _mm_unpackhi_epi8( bottom1, zero ) );
+
+        // Adding the even to the odd source pixels gives two result pixels per register
+        const __m128i block01 = _mm_add_epi16( _mm_unpacklo_epi64( sum01, sum23 ), _mm_unpackhi_epi64( sum01, sum23 ) );
+        const __m128i block23 = _mm_add_epi16( _mm_unpacklo_epi64( sum45, sum67 ), _mm_unpackhi_epi64( sum45, sum67 ) );
+
+        const __m128i result01 = _mm_srli_epi16( _mm_add_epi16( block01, two ), 2 );
+        const __m128i result23 = _mm_srli_epi16( _mm_add_epi16( block23, two ), 2 );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( result + i ), _mm_packus_epi16( result01, result23 ) );
+    }
+
+    downsampleLinePortable( top + 2 * i, bottom + 2 * i, result + i, count - i );
+}
+
+#endif
+
+inline void downsampleLine( const uint *top, const uint *bottom, uint *result, int count )
+{
+#ifdef MARBLE_HAVE_SSE2
+    downsampleLineSse2( top, bottom, result, count );
+#else
+    downsampleLinePortable( top, bottom, result, count );
+#endif
+}
+
+}
+
+#endif
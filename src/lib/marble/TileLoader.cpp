@@ -35,6 +35,7 @@
 #include "HttpDownloadManager.h"
 #include "MarbleDebug.h"
 #include "MarbleDirs.h"
+#include "PackedStoragePolicy.h"
 #include "TileLoaderHelper.h"
 #include "ParseRunnerPlugin.h"
 #include "ParsingRunner.h"
@@ -45,7 +46,8 @@ namespace Marble
 {
 
 TileLoader::TileLoader(HttpDownloadManager * const downloadManager, const PluginManager *pluginManager) :
-    m_pluginManager(pluginManager)
+    m_pluginManager(pluginManager),
+    m_tileStore( qobject_cast<PackedStoragePolicy *>( downloadManager->storagePolicy() ) )
 {
     qRegisterMetaType<DownloadUsage>( "DownloadUsage" );
     connect( this, SIGNAL(downloadTile(QUrl,QString,QString,DownloadUsage)),
@@ -66,8 +68,6 @@ TileLoader::~TileLoader()
 //     - if expired: create TextureTile, state is set to Expired by default, trigger dl,
 QImage TileLoader::loadTileImage( GeoSceneTextureTileDataset const *textureLayer, TileId const & tileId, DownloadUsage const usage )
 {
-    QString const fileName = tileFileName( textureLayer, tileId );
-
     TileStatus status = tileStatus( textureLayer, tileId );
     if ( status != Missing ) {
         // check if an update should be triggered
@@ -80,7 +80,7 @@ QImage TileLoader::loadTileImage( GeoSceneTextureTileDataset const *textureLayer
             triggerDownload( textureLayer, tileId, usage );
         }
 
-        QImage const image( fileName );
+        QImage const image = tileImage( textureLayer, tileId );
         if ( !image.isNull() ) {
             // file is there, so create and return a tile object in any case
             return image;
@@ -197,15 +197,24 @@ bool TileLoader::baseTilesAvailable( GeoSceneTileDataset const & tileData )
     return result;
 }
 
-TileLoader::TileStatus TileLoader::tileStatus( GeoSceneTileDataset const *tileData, const TileId &tileId )
+TileLoader::TileStatus TileLoader::tileStatus( GeoSceneTileDataset const *tileData, const TileId &tileId ) const
 {
-    QString const fileName = tileFileName( tileData, tileId );
-    QFileInfo fileInfo( fileName );
-    if ( !fileInfo.exists() ) {
-        return Missing;
+    // Packed tiles are looked up in the in-memory index, without touching the file system
+    QDateTime lastModified;
+    if ( m_tileStore ) {
+        lastModified = m_tileStore->lastModified( tileData->relativeTileFileName( tileId ) );
+    }
+
+    if ( !lastModified.isValid() ) {
+        QString const fileName = tileFileName( tileData, tileId );
+        QFileInfo fileInfo( fileName );
+        if ( !fileInfo.exists() ) {
+            return Missing;
+        }
+
+        lastModified = fileInfo.lastModified();
     }
 
-    const QDateTime lastModified = fileInfo.lastModified();
     const int expireSecs = tileData->expire();
     const bool isExpired = lastModified.secsTo( QDateTime::currentDateTime() ) >= expireSecs;
     return isExpired ? Expired : Available;
@@ -276,7 +285,20 @@ void TileLoader::triggerDownload( GeoSceneTileDataset const *tileData, TileId co
     emit downloadTile( sourceUrl, destFileName, idStr, usage );
 }
 
-QImage TileLoader::scaledLowerLevelTile( const GeoSceneTextureTileDataset * textureData, TileId const & id )
+QImage TileLoader::tileImage( GeoSceneTileDataset const * tileData, TileId const & tileId ) const
+{
+    if ( m_tileStore ) {
+        QByteArray const data = m_tileStore->data( tileData->relativeTileFileName( tileId ) );
+        if ( !data.isEmpty() ) {
+            return QImage::fromData( data );
+        }
+    }
+
+    QString const fileName = tileFileName( tileData, tileId );
+    return QFile::exists( fileName ) ? QImage( fileName ) : QImage();
+}
+
+QImage TileLoader::scaledLowerLevelTile( const GeoSceneTextureTileDataset * textureData, TileId const & id ) const
 {
     mDebug() << Q_FUNC_INFO << id;
 
@@ -289,9 +311,8 @@ QImage TileLoader::scaledLowerLevelTile( const GeoSceneTextureTileDataset * text
 
         TileId const replacementTileId( id.mapThemeIdHash(), level,
                                         id.x() >> deltaLevel, id.y() >> deltaLevel );
-        QString const fileName = tileFileName( textureData, replacementTileId );
-        mDebug() << "TileLoader::scaledLowerLevelTile" << "trying" << fileName;
-        QImage toScale = QFile::exists(fileName) ? QImage(fileName) : QImage();
+        mDebug() << "TileLoader::scaledLowerLevelTile" << "trying" << textureData->relativeTileFileName( replacementTileId );
+        QImage toScale = tileImage( textureData, replacementTileId );
 
         if ( level == 0 && toScale.isNull() ) {
             mDebug() << "No level zero tile installed in map theme dir. Falling back to a transparent image for now.";
@@ -39,6 +39,7 @@ class GeoDataDocument;
 class GeoSceneTileDataset;
 class GeoSceneTextureTileDataset;
 class GeoSceneVectorTileDataset;
+class PackedStoragePolicy;
 class ParsingRunnerManager;
 
 class TileLoader: public QObject
@@ -73,7 +74,7 @@ class TileLoader: public QObject
       * - Expired when it has been downloaded, but is too old (as per .dgml expiration time)
       * - Available when it has been downloaded and is not expired
       */
-    static TileStatus tileStatus( GeoSceneTileDataset const *tileData, const TileId &tileId );
+    TileStatus tileStatus( GeoSceneTileDataset const *tileData, const TileId &tileId ) const;
 
  private Q_SLOTS:
     void updateTile( QByteArray const & imageData, QString const & tileId );
@@ -90,11 +91,15 @@ class TileLoader: public QObject
  private:
     static QString tileFileName( GeoSceneTileDataset const * tileData, TileId const & );
     void triggerDownload( GeoSceneTileDataset const *tileData, TileId const &, DownloadUsage const );
-    static QImage scaledLowerLevelTile( GeoSceneTextureTileDataset const * textureData, TileId const & );
+    QImage scaledLowerLevelTile( GeoSceneTextureTileDataset const * textureData, TileId const & ) const;
+    QImage tileImage( GeoSceneTileDataset const * tileData, TileId const & ) const;
     GeoDataDocument* openVectorFile(const QString &filename) const;
 
     // For vectorTile parsing
     PluginManager const * m_pluginManager;
+
+    // Tiles packed by the storage policy of the download manager, if any
+    PackedStoragePolicy const * m_tileStore;
 };
 
 }
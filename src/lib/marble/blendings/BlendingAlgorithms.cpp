@@ -20,11 +20,100 @@
 #include <cmath>
 
 #include <QImage>
+#include <QMutexLocker>
 #include <QPainter>
 
 namespace Marble
 {
 
+namespace
+{
+
+// Applies pixelBlend to all pixels of two 32 bit images of the same size,
+// writing the results to bottom. Being a template, the pixel operation gets
+// inlined into the scanline loop.
+template <typename PixelBlend>
+void blendScanlines( QImage * const bottom, QImage const & top, PixelBlend const & pixelBlend )
+{
+    int const width = bottom->width();
+    int const height = bottom->height();
+
+    for ( int y = 0; y < height; ++y ) {
+        QRgb * const bottomLine = reinterpret_cast<QRgb *>( bottom->scanLine( y ) );
+        QRgb const * const topLine = reinterpret_cast<QRgb const *>( top.constScanLine( y ) );
+        for ( int x = 0; x < width; ++x ) {
+            bottomLine[x] = pixelBlend( bottomLine[x], topLine[x] );
+        }
+    }
+}
+
+// Blends the red, green and blue channels by looking up the results
+// in a table indexed by bottom * 256 + top.
+class TableChannelBlend
+{
+ public:
+    explicit TableChannelBlend( uchar const * const table )
+        : m_table( table )
+    {
+    }
+
+    QRgb operator()( QRgb const bottomPixel, QRgb const topPixel ) const
+    {
+        return qRgb( m_table[ ( qRed( bottomPixel ) << 8 ) | qRed( topPixel ) ],
+                     m_table[ ( qGreen( bottomPixel ) << 8 ) | qGreen( topPixel ) ],
+                     m_table[ ( qBlue( bottomPixel ) << 8 ) | qBlue( topPixel ) ] );
+    }
+
+ private:
+    uchar const * const m_table;
+};
+
+// Uses the red channel of the top pixel as the intensity of all channels.
+class CloudsChannelBlend
+{
+ public:
+    explicit CloudsChannelBlend( uchar const * const table )
+        : m_table( table )
+    {
+    }
+
+    QRgb operator()( QRgb const bottomPixel, QRgb const topPixel ) const
+    {
+        int const cloud = qRed( topPixel );
+        return qRgb( m_table[ ( qRed( bottomPixel ) << 8 ) | cloud ],
+                     m_table[ ( qGreen( bottomPixel ) << 8 ) | cloud ],
+                     m_table[ ( qBlue( bottomPixel ) << 8 ) | cloud ] );
+    }
+
+ private:
+    uchar const * const m_table;
+};
+
+class GrayscaleBlend
+{
+ public:
+    QRgb operator()( QRgb const bottomPixel, QRgb const topPixel ) const
+    {
+        Q_UNUSED( bottomPixel );
+        int const gray = qGray( topPixel );
+        return qRgb( gray, gray, gray );
+    }
+};
+
+// Converts a blended intensity in the range 0..1 to a channel value the same
+// way qRgb() truncates it, mapping values without an integer representation to 0.
+uchar channelValue( qreal const intensity )
+{
+    qreal const value = intensity * 255.0;
+    if ( !( value > -2147483648.0 && value < 2147483648.0 ) ) {
+        return 0;
+    }
+
+    return int( value ) & 0xff;
+}
+
+}
+
 void OverpaintBlending::blend( QImage * const bottom, TextureTile const * const top ) const
 {
     Q_ASSERT( bottom );
@@ -48,18 +137,17 @@ void GrayscaleBlending::blend( QImage * const bottom, TextureTile const * const
     QImage const topImagePremult = top->image()->convertToFormat( QImage::Format_ARGB32_Premultiplied );
 
     // Draw a grayscale version of the bottom image
-    int const width = bottom->width();
-    int const height = bottom->height();
+    blendScanlines( bottom, topImagePremult, GrayscaleBlend() );
+}
 
-    for ( int y = 0; y < height; ++y ) {
-        for ( int x = 0; x < width; ++x ) {
-            QRgb const topPixel = topImagePremult.pixel( x, y );
-            int const gray = qGray( topPixel );
-            QRgb const grayPixel = qRgb( gray, gray, gray );
-            bottom->setPixel( x, y,grayPixel );
-        }
-    }
+IndependentChannelBlending::IndependentChannelBlending()
+    : m_blendTable( 0 )
+{
+}
 
+IndependentChannelBlending::~IndependentChannelBlending()
+{
+    delete[] m_blendTable.load();
 }
 
 // pre-conditions:
@@ -73,24 +161,32 @@ void IndependentChannelBlending::blend( QImage * const bottom,
     Q_ASSERT( bottom->size() == topImage->size() );
     Q_ASSERT( bottom->format() == QImage::Format_ARGB32_Premultiplied );
 
-    int const width = bottom->width();
-    int const height = bottom->height();
     QImage const topImagePremult = topImage->convertToFormat( QImage::Format_ARGB32_Premultiplied );
-    for ( int y = 0; y < height; ++y ) {
-        for ( int x = 0; x < width; ++x ) {
-            QRgb const bottomPixel = bottom->pixel( x, y );
-            QRgb const topPixel = topImagePremult.pixel( x, y );
-            qreal const resultRed = blendChannel( qRed( bottomPixel ) / 255.0,
-                                                  qRed( topPixel ) / 255.0 );
-            qreal const resultGreen = blendChannel( qGreen( bottomPixel ) / 255.0,
-                                                    qGreen( topPixel ) / 255.0 );
-            qreal const resultBlue = blendChannel( qBlue( bottomPixel ) / 255.0,
-                                                   qBlue( topPixel ) / 255.0 );
-            bottom->setPixel( x, y, qRgb( resultRed * 255.0,
-                                          resultGreen * 255.0,
-                                          resultBlue * 255.0 ));
+    blendScanlines( bottom, topImagePremult, TableChannelBlend( blendTable() ) );
+}
+
+// There are only 256 * 256 different pairs of channel intensities, so
+// evaluating blendChannel() once for each of them is far cheaper than
+// calling it three times per pixel for every tile being blended.
+uchar const * IndependentChannelBlending::blendTable() const
+{
+    uchar const * table = m_blendTable.loadAcquire();
+    if ( table ) {
+        return table;
+    }
+
+    QMutexLocker locker( &m_blendTableMutex );
+    if ( !m_blendTable.load() ) {
+        uchar * const newTable = new uchar[256 * 256];
+        for ( int bottom = 0; bottom < 256; ++bottom ) {
+            for ( int top = 0; top < 256; ++top ) {
+                newTable[ ( bottom << 8 ) | top ] = channelValue( blendChannel( bottom / 255.0, top / 255.0 ) );
+            }
         }
+        m_blendTable.storeRelease( newTable );
     }
+
+    return m_blendTable.load();
 }
 
 
@@ -320,24 +416,33 @@ qreal HalfDifferenceBlending::blendChannel( qreal const bottomColorIntensity,
 
 // Special purpose blendings
 
+CloudsBlending::CloudsBlending()
+{
+    for ( int bottom = 0; bottom < 256; ++bottom ) {
+        for ( int cloud = 0; cloud < 256; ++cloud ) {
+            qreal const c = cloud / 255.0;
+            m_blendTable[ ( bottom << 8 ) | cloud ] = ( int )( bottom + ( 255 - bottom ) * c );
+        }
+    }
+}
+
 void CloudsBlending::blend( QImage * const bottom, TextureTile const * const top ) const
 {
     QImage const * const topImage = top->image();
     Q_ASSERT( topImage );
     Q_ASSERT( bottom->size() == topImage->size() );
-    int const width = bottom->width();
-    int const height = bottom->height();
-    for ( int y = 0; y < height; ++y ) {
-        for ( int x = 0; x < width; ++x ) {
-            qreal const c = qRed( topImage->pixel( x, y )) / 255.0;
-            QRgb const bottomPixel = bottom->pixel( x, y );
-            int const bottomRed = qRed( bottomPixel );
-            int const bottomGreen = qGreen( bottomPixel );
-            int const bottomBlue = qBlue( bottomPixel );
-            bottom->setPixel( x, y, qRgb(( int )( bottomRed + ( 255 - bottomRed ) * c ),
-                                         ( int )( bottomGreen + ( 255 - bottomGreen ) * c ),
-                                         ( int )( bottomBlue + ( 255 - bottomBlue ) * c )));
-        }
+    Q_ASSERT( bottom->format() == QImage::Format_ARGB32_Premultiplied );
+
+    // Only the red channel of the cloud image is used, which is the same
+    // for all 32 bit formats. Convert anything else (e.g. indexed images).
+    if ( topImage->format() == QImage::Format_RGB32
+         || topImage->format() == QImage::Format_ARGB32
+         || topImage->format() == QImage::Format_ARGB32_Premultiplied ) {
+        blendScanlines( bottom, *topImage, CloudsChannelBlend( m_blendTable ) );
+    }
+    else {
+        QImage const topImage32 = topImage->convertToFormat( QImage::Format_ARGB32 );
+        blendScanlines( bottom, topImage32, CloudsChannelBlend( m_blendTable ) );
     }
 }
 
@@ -17,6 +17,8 @@
 #define MARBLE_BLENDING_ALGORITHMS_H
 
 #include <QtGlobal>
+#include <QAtomicPointer>
+#include <QMutex>
 
 #include "Blending.h"
 
@@ -32,14 +34,23 @@ class OverpaintBlending: public Blending
 class IndependentChannelBlending: public Blending
 {
  public:
+    IndependentChannelBlending();
+    virtual ~IndependentChannelBlending();
     virtual void blend( QImage * const bottom, TextureTile const * const top ) const;
  private:
+    // returns the results of blendChannel() for all pairs of 8 bit channel
+    // intensities, indexed by bottom * 256 + top; built on first use
+    uchar const * blendTable() const;
+
     // bottomColorIntensity: intensity of one color channel (of one pixel) of the bottom image
     // topColorIntensity: intensity of one color channel (of one pixel) of the top image
     // return: intensity of the color channel (of a given pixel) of the result image
     // all color intensity values are in the range 0..1
     virtual qreal blendChannel( qreal const bottomColorIntensity,
                                 qreal const topColorIntensity ) const = 0;
+
+    mutable QAtomicPointer<uchar> m_blendTable;
+    mutable QMutex m_blendTableMutex;
 };
 
 
@@ -244,7 +255,11 @@ class HalfDifferenceBlending: public IndependentChannelBlending
 class CloudsBlending: public Blending
 {
  public:
+    CloudsBlending();
     virtual void blend( QImage * const bottom, TextureTile const * const top ) const;
+ private:
+    // blended channel intensities indexed by bottom * 256 + cloud intensity
+    uchar m_blendTable[256 * 256];
 };
 
 class GrayscaleBlending: public Blending
@@ -18,6 +18,7 @@
 
 #include "MarbleDirs.h"
 #include "MarbleDebug.h"
+#include "StringPool.h"
 
 #include "GeoDataStyle.h"
 #include "GeoDataStyleMap.h"
@@ -88,20 +89,20 @@ bool GeoDataFeature::equals( const GeoDataFeature &other ) const
 {
     if ( !GeoDataObject::equals(other) ||
          p()->m_name != other.p()->m_name ||
-         p()->m_snippet != other.p()->m_snippet ||
-         p()->m_description != other.p()->m_description ||
-         p()->m_descriptionCDATA != other.p()->m_descriptionCDATA ||
-         p()->m_address != other.p()->m_address ||
-         p()->m_phoneNumber != other.p()->m_phoneNumber ||
+         p()->extra().m_snippet != other.p()->extra().m_snippet ||
+         p()->extra().m_description != other.p()->extra().m_description ||
+         p()->extra().m_descriptionCDATA != other.p()->extra().m_descriptionCDATA ||
+         p()->extra().m_address != other.p()->extra().m_address ||
+         p()->extra().m_phoneNumber != other.p()->extra().m_phoneNumber ||
          p()->m_styleUrl != other.p()->m_styleUrl ||
          p()->m_popularity != other.p()->m_popularity ||
          p()->m_zoomLevel != other.p()->m_zoomLevel ||
          p()->m_visible != other.p()->m_visible ||
          p()->m_role != other.p()->m_role ||
-         p()->m_extendedData != other.p()->m_extendedData ||
-         p()->m_timeSpan != other.p()->m_timeSpan ||
-         p()->m_timeStamp != other.p()->m_timeStamp ||
-         p()->m_region != other.p()->m_region ||
+         p()->extra().m_extendedData != other.p()->extra().m_extendedData ||
+         p()->extra().m_timeSpan != other.p()->extra().m_timeSpan ||
+         p()->extra().m_timeStamp != other.p()->extra().m_timeStamp ||
+         p()->extra().m_region != other.p()->extra().m_region ||
          *style() != *other.style() ) {
         return false;
     }
@@ -171,57 +172,57 @@ void GeoDataFeature::setName( const QString &value )
 
 GeoDataSnippet GeoDataFeature::snippet() const
 {
-    return d->m_snippet;
+    return d->extra().m_snippet;
 }
 
 void GeoDataFeature::setSnippet( const GeoDataSnippet &snippet )
 {
     detach();
-    d->m_snippet = snippet;
+    d->editableExtra().m_snippet = snippet;
 }
 
 QString GeoDataFeature::address() const
 {
-    return d->m_address;
+    return d->extra().m_address;
 }
 
 void GeoDataFeature::setAddress( const QString &value)
 {
     detach();
-    d->m_address = value;
+    d->editableExtra().m_address = value;
 }
 
 QString GeoDataFeature::phoneNumber() const
 {
-    return d->m_phoneNumber;
+    return d->extra().m_phoneNumber;
 }
 
 void GeoDataFeature::setPhoneNumber( const QString &value)
 {
     detach();
-    d->m_phoneNumber = value;
+    d->editableExtra().m_phoneNumber = value;
 }
 
 QString GeoDataFeature::description() const
 {
-    return d->m_description;
+    return d->extra().m_description;
 }
 
 void GeoDataFeature::setDescription( const QString &value)
 {
     detach();
-    d->m_description = value;
+    d->editableExtra().m_description = value;
 }
 
 bool GeoDataFeature::descriptionIsCDATA() const
 {
-    return d->m_descriptionCDATA;
+    return d->extra().m_descriptionCDATA;
 }
 
 void GeoDataFeature::setDescriptionCDATA( bool cdata )
 {
     detach();
-    d->m_descriptionCDATA = cdata;
+    d->editableExtra().m_descriptionCDATA = cdata;
 }
 
 const GeoDataAbstractView* GeoDataFeature::abstractView() const
@@ -252,7 +253,7 @@ void GeoDataFeature::setStyleUrl( const QString &value )
 {
     detach();
 
-    d->m_styleUrl = value;
+    d->m_styleUrl = StringPool::intern( value );
 
     if ( value.isEmpty() ) {
         d->m_style = GeoDataStyle::Ptr();
@@ -303,36 +304,36 @@ bool GeoDataFeature::isGloballyVisible() const
 
 const GeoDataTimeSpan &GeoDataFeature::timeSpan() const
 {
-    return d->m_timeSpan;
+    return d->extra().m_timeSpan;
 }
 
 GeoDataTimeSpan &GeoDataFeature::timeSpan()
 {
     detach();
-    return d->m_timeSpan;
+    return d->editableExtra().m_timeSpan;
 }
 
 void GeoDataFeature::setTimeSpan( const GeoDataTimeSpan &timeSpan )
 {
     detach();
-    d->m_timeSpan = timeSpan;
+    d->editableExtra().m_timeSpan = timeSpan;
 }
 
 const GeoDataTimeStamp &GeoDataFeature::timeStamp() const
 {
-    return d->m_timeStamp;
+    return d->extra().m_timeStamp;
 }
 
 GeoDataTimeStamp &GeoDataFeature::timeStamp()
 {
     detach();
-    return d->m_timeStamp;
+    return d->editableExtra().m_timeStamp;
 }
 
 void GeoDataFeature::setTimeStamp( const GeoDataTimeStamp &timeStamp )
 {
     detach();
-    d->m_timeStamp = timeStamp;
+    d->editableExtra().m_timeStamp = timeStamp;
 }
 
 GeoDataStyle::ConstPtr GeoDataFeature::style() const
@@ -360,25 +361,25 @@ void GeoDataFeature::setStyle( const GeoDataStyle::Ptr &style )
 GeoDataExtendedData& GeoDataFeature::extendedData() const
 {
     // FIXME: Should call detach(). Maybe don't return reference.
-    return d->m_extendedData;
+    return d->editableExtra().m_extendedData;
 }
 
 void GeoDataFeature::setExtendedData( const GeoDataExtendedData& extendedData )
 {
     detach();
-    d->m_extendedData = extendedData;
+    d->editableExtra().m_extendedData = extendedData;
 }
 
 GeoDataRegion& GeoDataFeature::region() const
 {
     // FIXME: Should call detach(). Maybe don't return reference.
-    return d->m_region;
+    return d->editableExtra().m_region;
 }
 
 void GeoDataFeature::setRegion( const GeoDataRegion& region )
 {
     detach();
-    d->m_region = region;
+    d->editableExtra().m_region = region;
 }
 
 GeoDataFeature::GeoDataVisualCategory GeoDataFeature::visualCategory() const
@@ -400,7 +401,7 @@ const QString GeoDataFeature::role() const
 void GeoDataFeature::setRole( const QString &role )
 {
     detach();
-    d->m_role = role;
+    d->m_role = StringPool::intern( role );
 }
 
 const GeoDataStyleMap* GeoDataFeature::styleMap() const
@@ -457,9 +458,9 @@ void GeoDataFeature::pack( QDataStream& stream ) const
     GeoDataObject::pack( stream );
 
     stream << d->m_name;
-    stream << d->m_address;
-    stream << d->m_phoneNumber;
-    stream << d->m_description;
+    stream << d->extra().m_address;
+    stream << d->extra().m_phoneNumber;
+    stream << d->extra().m_description;
     stream << d->m_visible;
 //    stream << d->m_visualCategory;
     stream << d->m_role;
@@ -473,12 +474,21 @@ void GeoDataFeature::unpack( QDataStream& stream )
     GeoDataObject::unpack( stream );
 
     stream >> d->m_name;
-    stream >> d->m_address;
-    stream >> d->m_phoneNumber;
-    stream >> d->m_description;
+    QString address;
+    QString phoneNumber;
+    QString description;
+    stream >> address;
+    stream >> phoneNumber;
+    stream >> description;
+    if ( !address.isEmpty() || !phoneNumber.isEmpty() || !description.isEmpty() ) {
+        d->editableExtra().m_address = address;
+        d->editableExtra().m_phoneNumber = phoneNumber;
+        d->editableExtra().m_description = description;
+    }
     stream >> d->m_visible;
 //    stream >> (int)d->m_visualCategory;
     stream >> d->m_role;
+    d->m_role = StringPool::intern( d->m_role );
     stream >> d->m_popularity;
     stream >> d->m_zoomLevel;
 }
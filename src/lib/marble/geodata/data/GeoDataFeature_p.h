@@ -28,40 +28,53 @@
 namespace Marble
 {
 
+/**
+ * Properties of a feature that most features don't have. They are allocated
+ * on first use, so features without any of them don't pay for them.
+ */
+class GeoDataFeatureExtras
+{
+  public:
+    GeoDataFeatureExtras() :
+        m_descriptionCDATA( false )
+    {
+    }
+
+    GeoDataSnippet      m_snippet;      // Snippet of the feature.
+    QString             m_description;  // A longer textual description
+    bool                m_descriptionCDATA; // True if description should be considered CDATA
+    QString             m_address;      // The address.  Optional
+    QString             m_phoneNumber;  // Phone         Optional
+
+    GeoDataExtendedData m_extendedData;
+
+    GeoDataTimeSpan  m_timeSpan;
+    GeoDataTimeStamp m_timeStamp;
+
+    GeoDataRegion m_region;
+};
+
 class GeoDataFeaturePrivate
 {
   public:
     GeoDataFeaturePrivate() :
         m_name(),
-        m_snippet(),
-        m_description(),
-        m_descriptionCDATA(),
-        m_address(),
-        m_phoneNumber(),
         m_styleUrl(),
         m_abstractView( 0 ),
         m_popularity( 0 ),
         m_zoomLevel( 1 ),
         m_visible( true ),
         m_visualCategory( GeoDataFeature::Default ),
-        m_role(" "),
+        m_role( QStringLiteral( " " ) ),
         m_style( 0 ),
         m_styleMap( 0 ),
-        m_extendedData(),
-        m_timeSpan(),
-        m_timeStamp(),
-        m_region(),
+        m_extra( 0 ),
         ref( 0 )
     {
     }
 
     GeoDataFeaturePrivate( const GeoDataFeaturePrivate& other ) :
         m_name( other.m_name ),
-        m_snippet( other.m_snippet ),
-        m_description( other.m_description ),
-        m_descriptionCDATA( other.m_descriptionCDATA),
-        m_address( other.m_address ),
-        m_phoneNumber( other.m_phoneNumber ),
         m_styleUrl( other.m_styleUrl ),
         m_abstractView( other.m_abstractView ),
         m_popularity( other.m_popularity ),
@@ -71,10 +84,7 @@ class GeoDataFeaturePrivate
         m_role( other.m_role ),
         m_style( other.m_style ),               //FIXME: both style and stylemap need to be reworked internally!!!!
         m_styleMap( other.m_styleMap ),
-        m_extendedData( other.m_extendedData ),
-        m_timeSpan( other.m_timeSpan ),
-        m_timeStamp( other.m_timeStamp ),
-        m_region( other.m_region ),
+        m_extra( other.m_extra ? new GeoDataFeatureExtras( *other.m_extra ) : 0 ),
         ref( 0 )
     {
     }
@@ -82,11 +92,6 @@ class GeoDataFeaturePrivate
     GeoDataFeaturePrivate& operator=( const GeoDataFeaturePrivate& other )
     {
         m_name = other.m_name;
-        m_snippet = other.m_snippet;
-        m_description = other.m_description;
-        m_descriptionCDATA = other.m_descriptionCDATA;
-        m_address = other.m_address;
-        m_phoneNumber = other.m_phoneNumber;
         m_styleUrl = other.m_styleUrl;
         m_abstractView = other.m_abstractView;
         m_popularity = other.m_popularity;
@@ -95,14 +100,35 @@ class GeoDataFeaturePrivate
         m_role = other.m_role;
         m_style = other.m_style;
         m_styleMap = other.m_styleMap;
-        m_timeSpan = other.m_timeSpan;
-        m_timeStamp = other.m_timeStamp;
         m_visualCategory = other.m_visualCategory;
-        m_extendedData = other.m_extendedData;
-        m_region = other.m_region;
+        if ( this != &other ) {
+            delete m_extra;
+            m_extra = other.m_extra ? new GeoDataFeatureExtras( *other.m_extra ) : 0;
+        }
         return *this;
     }
-    
+
+    /**
+     * Returns the rarely used properties for reading. Features without
+     * any of them share a single empty instance.
+     */
+    const GeoDataFeatureExtras &extra() const
+    {
+        static const GeoDataFeatureExtras empty;
+        return m_extra ? *m_extra : empty;
+    }
+
+    /**
+     * Returns the rarely used properties for writing, allocating them if needed.
+     */
+    GeoDataFeatureExtras &editableExtra()
+    {
+        if ( !m_extra ) {
+            m_extra = new GeoDataFeatureExtras;
+        }
+        return *m_extra;
+    }
+
     virtual GeoDataFeaturePrivate* copy()
     { 
         GeoDataFeaturePrivate* copy = new GeoDataFeaturePrivate;
@@ -117,6 +143,7 @@ class GeoDataFeaturePrivate
 
     virtual ~GeoDataFeaturePrivate()
     {
+        delete m_extra;
     }
 
     virtual const char* nodeType() const
@@ -125,11 +152,6 @@ class GeoDataFeaturePrivate
     }
 
     QString             m_name;         // Name of the feature. Is shown on screen
-    GeoDataSnippet      m_snippet;      // Snippet of the feature.
-    QString             m_description;  // A longer textual description
-    bool                m_descriptionCDATA; // True if description should be considered CDATA
-    QString             m_address;      // The address.  Optional
-    QString             m_phoneNumber;  // Phone         Optional
     QString             m_styleUrl;     // styleUrl     Url#tag to a document wide style
     GeoDataAbstractView* m_abstractView; // AbstractView  Optional
     qint64              m_popularity;   // Population/Area/Altitude depending on placemark(!)
@@ -144,13 +166,8 @@ class GeoDataFeaturePrivate
     GeoDataStyle::Ptr m_style;
     const GeoDataStyleMap* m_styleMap;
 
-    GeoDataExtendedData m_extendedData;
+    GeoDataFeatureExtras *m_extra;
 
-    GeoDataTimeSpan  m_timeSpan;
-    GeoDataTimeStamp m_timeStamp;
-
-    GeoDataRegion m_region;
-    
     QAtomicInt  ref;
 
     // Static members
@@ -19,6 +19,8 @@
 #include "MarbleDebug.h"
 
 #include <QDataStream>
+#include <QMutex>
+#include <QMutexLocker>
 
 
 namespace Marble
@@ -132,164 +134,287 @@ GeoDataCoordinates GeoDataLineStringPrivate::findDateLine( const GeoDataCoordina
     return findDateLine( previousCoords, interpolatedCoords, recursionCounter );
 }
 
-quint8 GeoDataLineStringPrivate::levelForResolution(qreal resolution) const {
-    if (m_previousResolution == resolution) return m_level;
-
-    m_previousResolution = resolution;
-
-    if (resolution < 0.0000005) m_level = 17;
-    else if (resolution < 0.0000010) m_level = 16;
-    else if (resolution < 0.0000020) m_level = 15;
-    else if (resolution < 0.0000040) m_level = 14;
-    else if (resolution < 0.0000080) m_level = 13;
-    else if (resolution < 0.0000160) m_level = 12;
-    else if (resolution < 0.0000320) m_level = 11;
-    else if (resolution < 0.0000640) m_level = 10;
-    else if (resolution < 0.0001280) m_level = 9;
-    else if (resolution < 0.0002560) m_level = 8;
-    else if (resolution < 0.0005120) m_level = 7;
-    else if (resolution < 0.0010240) m_level = 6;
-    else if (resolution < 0.0020480) m_level = 5;
-    else if (resolution < 0.0040960) m_level = 4;
-    else if (resolution < 0.0081920) m_level = 3;
-    else if (resolution < 0.0163840) m_level = 2;
-    else m_level =  1;
-
-    return m_level;
-}
-
-qreal GeoDataLineStringPrivate::resolutionForLevel(int level) const {
-    switch (level) {
-        case 0:
-            return 0.0655360;
-            break;
-        case 1:
-            return 0.0327680;
-            break;
-        case 2:
-            return 0.0163840;
-            break;
-        case 3:
-            return 0.0081920;
-            break;
-        case 4:
-            return 0.0040960;
-            break;
-        case 5:
-            return 0.0020480;
-            break;
-        case 6:
-            return 0.0010240;
-            break;
-        case 7:
-            return 0.0005120;
-            break;
-        case 8:
-            return 0.0002560;
-            break;
-        case 9:
-            return 0.0001280;
-            break;
-        case 10:
-            return 0.0000640;
-            break;
-        case 11:
-            return 0.0000320;
-            break;
-        case 12:
-            return 0.0000160;
-            break;
-        case 13:
-            return 0.0000080;
-            break;
-        case 14:
-            return 0.0000040;
-            break;
-        case 15:
-            return 0.0000020;
-            break;
-        case 16:
-            return 0.0000010;
-            break;
-        default:
-        case 17:
-            return 0.0000005;
-            break;
+quint8 GeoDataLineStringPrivate::levelForResolution(qreal resolution) {
+    if (resolution < 0.0000005) return 17;
+    else if (resolution < 0.0000010) return 16;
+    else if (resolution < 0.0000020) return 15;
+    else if (resolution < 0.0000040) return 14;
+    else if (resolution < 0.0000080) return 13;
+    else if (resolution < 0.0000160) return 12;
+    else if (resolution < 0.0000320) return 11;
+    else if (resolution < 0.0000640) return 10;
+    else if (resolution < 0.0001280) return 9;
+    else if (resolution < 0.0002560) return 8;
+    else if (resolution < 0.0005120) return 7;
+    else if (resolution < 0.0010240) return 6;
+    else if (resolution < 0.0020480) return 5;
+    else if (resolution < 0.0040960) return 4;
+    else if (resolution < 0.0081920) return 3;
+    else if (resolution < 0.0163840) return 2;
+    else return 1;
+}
+
+namespace
+{
+
+struct Vector3
+{
+    qreal x;
+    qreal y;
+    qreal z;
+};
+
+Vector3 unitVector( const GeoDataCoordinates &coordinates )
+{
+    qreal lon, lat;
+    coordinates.geoCoordinates( lon, lat );
+    Vector3 const result = { cos( lat ) * cos( lon ), cos( lat ) * sin( lon ), sin( lat ) };
+    return result;
+}
+
+Vector3 crossProduct( const Vector3 &a, const Vector3 &b )
+{
+    Vector3 const result = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    return result;
+}
+
+qreal dotProduct( const Vector3 &a, const Vector3 &b )
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// The angle between two unit vectors, precise for small angles as well
+qreal angle( const Vector3 &a, const Vector3 &b )
+{
+    Vector3 const normal = crossProduct( a, b );
+    return atan2( sqrt( dotProduct( normal, normal ) ), dotProduct( a, b ) );
+}
+
+/**
+ * Returns the angular distance of @p point from the great circle arc
+ * between @p first and @p last.
+ */
+qreal distanceFromArc( const Vector3 &point, const Vector3 &first, const Vector3 &last )
+{
+    Vector3 const normal = crossProduct( first, last );
+    qreal const normalLength = sqrt( dotProduct( normal, normal ) );
+    if ( normalLength < 1e-15 ) {
+        // first and last coincide, e.g. in a closed ring
+        return angle( first, point );
+    }
+
+    // The closest point of the great circle is part of the arc if the point
+    // is on the inner side of both the great circles through first and last
+    // which are perpendicular to the arc
+    if ( dotProduct( crossProduct( first, point ), normal ) >= 0.0
+         && dotProduct( crossProduct( point, last ), normal ) >= 0.0 ) {
+        return fabs( asin( qBound<qreal>( -1.0, dotProduct( point, normal ) / normalLength, 1.0 ) ) );
     }
+
+    return qMin( angle( first, point ), angle( last, point ) );
 }
 
-void GeoDataLineStringPrivate::optimize (GeoDataLineString& lineString) const
+struct Section
 {
+    int first;
+    int last;
+    qreal significance;
+};
 
-    QVector<GeoDataCoordinates>::iterator itCoords = lineString.begin();
-    QVector<GeoDataCoordinates>::const_iterator itEnd = lineString.constEnd();
+}
 
-    if (lineString.size() < 2) return;
+void GeoDataLineStringPrivate::optimize (GeoDataLineString& lineString) const
+{
+    int const size = lineString.size();
+    if (size < 2) return;
 
     // Calculate the least non-zero detail-level by checking the bounding box
-    quint8 startLevel = levelForResolution( ( lineString.latLonAltBox().width() + lineString.latLonAltBox().height() ) / 2 );
+    quint8 const startLevel = levelForResolution( ( lineString.latLonAltBox().width() + lineString.latLonAltBox().height() ) / 2 );
 
-    quint8 currentLevel = startLevel;
-    quint8 maxLevel = startLevel;
-    GeoDataCoordinates currentCoords;
-    lineString.first().setDetail(startLevel);
-
-    // Iterate through the linestring to assign different detail levels to the nodes.
-    // In general the first and last node should have the start level assigned as
-    // a detail level.
-    // Starting from the first node the algorithm picks those nodes which
-    // have a distance from each other that is just above the resolution that is
-    // associated with the start level (which we use as a "current level").
-    // Each of those nodes get the current level assigned as the detail level.
-    // After iterating through the linestring we increment the current level value
-    // and starting again with the first node we assign detail values in a similar way
-    // to the remaining nodes which have no final detail level assigned yet.
-    // We do as many iterations through the lineString as needed and bump up the
-    // current level until all nodes have a non-zero detail level assigned.
-
-    while ( currentLevel  < 16 && currentLevel <= maxLevel + 1 ) {
-        itCoords = lineString.begin();
-
-        currentCoords = *itCoords;
-        ++itCoords;
-
-        for( ; itCoords != itEnd; ++itCoords) {
-            if (itCoords->detail() != 0 && itCoords->detail() < currentLevel) continue;
-
-            if ( currentLevel == startLevel && (itCoords->longitude() == -M_PI || itCoords->longitude() == M_PI
-                || itCoords->latitude() < -89 * DEG2RAD || itCoords->latitude() > 89 * DEG2RAD)) {
-                itCoords->setDetail(startLevel);
-                currentCoords = *itCoords;
-                maxLevel = currentLevel;
-                continue;
-            }
-            if (distanceSphere( currentCoords, *itCoords ) < resolutionForLevel(currentLevel + 1)) {
-                itCoords->setDetail(currentLevel + 1);
+    QVector<GeoDataCoordinates>::iterator const nodes = lineString.begin();
+
+    QVector<Vector3> vectors( size );
+    for ( int i = 0; i < size; ++i ) {
+        vectors[i] = unitVector( nodes[i] );
+    }
+
+    // Calculate the significance of each node (Douglas-Peucker): Starting
+    // with the section between the first and the last node, the node farthest
+    // from the arc of a section splits it into two sections, which get split
+    // in turn. The significance of a node is its distance from the arc of the
+    // section it splits, but never more than the significance of the node
+    // which created that section. This way the nodes of any significance or
+    // more are the result of simplifying the linestring with that tolerance.
+    QVector<qreal> significance( size, 0.0 );
+    QVector<Section> sections;
+    Section const whole = { 0, size - 1, M_PI };
+    sections.append( whole );
+    while ( !sections.isEmpty() ) {
+        Section const section = sections.last();
+        sections.removeLast();
+        if ( section.last - section.first < 2 ) {
+            continue;
+        }
+
+        int farthest = section.first + 1;
+        qreal maximumDistance = -1.0;
+        for ( int i = section.first + 1; i < section.last; ++i ) {
+            qreal const distance = distanceFromArc( vectors[i], vectors[section.first], vectors[section.last] );
+            if ( distance > maximumDistance ) {
+                maximumDistance = distance;
+                farthest = i;
             }
-            else {
-                itCoords->setDetail(currentLevel);
-                currentCoords = *itCoords;
-                maxLevel = currentLevel;
+        }
+
+        significance[farthest] = qMin( maximumDistance, section.significance );
+        Section const before = { section.first, farthest, significance[farthest] };
+        Section const after = { farthest, section.last, significance[farthest] };
+        sections << before << after;
+    }
+
+    // The first and the last node as well as nodes on the date line or close
+    // to the poles get the start level, which is the least non-zero detail level.
+    for ( int i = 0; i < size; ++i ) {
+        GeoDataCoordinates &coordinates = nodes[i];
+        if ( i == 0 || i == size - 1
+             || coordinates.longitude() == -M_PI || coordinates.longitude() == M_PI
+             || coordinates.latitude() < -89 * DEG2RAD || coordinates.latitude() > 89 * DEG2RAD ) {
+            coordinates.setDetail( startLevel );
+        } else {
+            coordinates.setDetail( qMax( startLevel, levelForResolution( significance[i] ) ) );
+        }
+    }
+}
+
+void GeoDataLineStringPrivate::updateLevelIndices()
+{
+    // Reads the packed details directly, so that optimizing doesn't create the nodes
+    QVector<quint8> details;
+    if ( m_packed ) {
+        details = m_packedDetails;
+        if ( details.isEmpty() ) {
+            details.fill( 0, m_packedLongitudes.size() );
+        }
+    } else {
+        details.reserve( m_vector.size() );
+        foreach ( const GeoDataCoordinates &coordinates, m_vector ) {
+            details.append( coordinates.detail() );
+        }
+    }
+    int const size = details.size();
+
+    // Nodes without detail value belong to every level
+    QVector<int> levelSizes( 18, 0 );
+    for ( int i = 0; i < size; ++i ) {
+        ++levelSizes[qMin<int>( details[i], 17 )];
+    }
+
+    m_levelIndices.clear();
+    m_levelIndices.reserve( 17 );
+    int levelSize = levelSizes[0];
+    for ( int level = 1; level <= 17; ++level ) {
+        if ( level > 1 && levelSizes[level] == 0 ) {
+            m_levelIndices.append( m_levelIndices.last() );
+            continue;
+        }
+
+        levelSize += levelSizes[level];
+        QVector<int> indices;
+        indices.reserve( levelSize );
+        for ( int i = 0; i < size; ++i ) {
+            if ( details[i] <= level ) {
+                indices.append( i );
             }
         }
-        ++currentLevel;
+        m_levelIndices.append( indices );
     }
-    lineString.last().setDetail(startLevel);
+}
+
+const QVector<GeoDataCoordinates> &GeoDataLineStringPrivate::nodes() const
+{
+    if ( m_packed && !m_nodesCached.loadAcquire() ) {
+        static QMutex mutex;
+        QMutexLocker locker( &mutex );
+        if ( m_nodesCached.load() ) {
+            return m_vector;
+        }
+
+        int const size = m_packedLongitudes.size();
+        bool const hasAltitudes = !m_packedAltitudes.isEmpty();
+        bool const hasDetails = !m_packedDetails.isEmpty();
+        m_vector.clear();
+        m_vector.reserve( size );
+        for ( int i = 0; i < size; ++i ) {
+            m_vector.append( GeoDataCoordinates( m_packedLongitudes[i], m_packedLatitudes[i],
+                                                 hasAltitudes ? m_packedAltitudes[i] : 0.0,
+                                                 GeoDataCoordinates::Radian,
+                                                 hasDetails ? m_packedDetails[i] : 0 ) );
+        }
+        m_nodesCached.storeRelease( 1 );
+    }
+
+    return m_vector;
+}
+
+void GeoDataLineStringPrivate::unpackNodes()
+{
+    // The nodes are about to be modified
+    m_levelIndices.clear();
+
+    if ( !m_packed ) {
+        return;
+    }
+
+    nodes();
+    m_packedLongitudes.clear();
+    m_packedLatitudes.clear();
+    m_packedAltitudes.clear();
+    m_packedDetails.clear();
+    m_packed = false;
+    m_nodesCached.store( 0 );
+}
+
+void GeoDataLineStringPrivate::appendPacked( const GeoDataCoordinates &coordinates )
+{
+    qreal lon, lat;
+    coordinates.geoCoordinates( lon, lat );
+    qreal const altitude = coordinates.altitude();
+    quint8 const detail = coordinates.detail();
+
+    if ( altitude != 0.0 && m_packedAltitudes.isEmpty() ) {
+        m_packedAltitudes.fill( 0.0, m_packedLongitudes.size() );
+    }
+    if ( detail != 0 && m_packedDetails.isEmpty() ) {
+        m_packedDetails.fill( 0, m_packedLongitudes.size() );
+    }
+
+    m_packedLongitudes.append( lon );
+    m_packedLatitudes.append( lat );
+    if ( !m_packedAltitudes.isEmpty() ) {
+        m_packedAltitudes.append( altitude );
+    }
+    if ( !m_packedDetails.isEmpty() ) {
+        m_packedDetails.append( detail );
+    }
+
+    m_vector.clear();
+    m_nodesCached.store( 0 );
 }
 
 bool GeoDataLineString::isEmpty() const
 {
-    return p()->m_vector.isEmpty();
+    return size() == 0;
 }
 
 int GeoDataLineString::size() const
 {
-    return p()->m_vector.size();
+    return p()->m_packed ? p()->m_packedLongitudes.size() : p()->m_vector.size();
 }
 
 GeoDataCoordinates& GeoDataLineString::at( int pos )
 {
     GeoDataGeometry::detach();
+    p()->unpackNodes();
     p()->m_dirtyRange = true;
     p()->m_dirtyBox = true;
     return p()->m_vector[ pos ];
@@ -297,12 +422,13 @@ GeoDataCoordinates& GeoDataLineString::at( int pos )
 
 const GeoDataCoordinates& GeoDataLineString::at( int pos ) const
 {
-    return p()->m_vector.at( pos );
+    return p()->nodes().at( pos );
 }
 
 GeoDataCoordinates& GeoDataLineString::operator[]( int pos )
 {
     GeoDataGeometry::detach();
+    p()->unpackNodes();
     p()->m_dirtyRange = true;
     p()->m_dirtyBox = true;
     return p()->m_vector[ pos ];
@@ -310,12 +436,13 @@ GeoDataCoordinates& GeoDataLineString::operator[]( int pos )
 
 const GeoDataCoordinates& GeoDataLineString::operator[]( int pos ) const
 {
-    return p()->m_vector[ pos ];
+    return p()->nodes()[ pos ];
 }
 
 GeoDataCoordinates& GeoDataLineString::last()
 {
     GeoDataGeometry::detach();
+    p()->unpackNodes();
     p()->m_dirtyRange = true;
     p()->m_dirtyBox = true;
     return p()->m_vector.last();
@@ -324,49 +451,52 @@ GeoDataCoordinates& GeoDataLineString::last()
 GeoDataCoordinates& GeoDataLineString::first()
 {
     GeoDataGeometry::detach();
+    p()->unpackNodes();
     return p()->m_vector.first();
 }
 
 const GeoDataCoordinates& GeoDataLineString::last() const
 {
-    return p()->m_vector.last();
+    return p()->nodes().last();
 }
 
 const GeoDataCoordinates& GeoDataLineString::first() const
 {
-    return p()->m_vector.first();
+    return p()->nodes().first();
 }
 
 QVector<GeoDataCoordinates>::Iterator GeoDataLineString::begin()
 {
     GeoDataGeometry::detach();
+    p()->unpackNodes();
     return p()->m_vector.begin();
 }
 
 QVector<GeoDataCoordinates>::ConstIterator GeoDataLineString::begin() const
 {
-    return p()->m_vector.constBegin();
+    return p()->nodes().constBegin();
 }
 
 QVector<GeoDataCoordinates>::Iterator GeoDataLineString::end()
 {
     GeoDataGeometry::detach();
+    p()->unpackNodes();
     return p()->m_vector.end();
 }
 
 QVector<GeoDataCoordinates>::ConstIterator GeoDataLineString::end() const
 {
-    return p()->m_vector.constEnd();
+    return p()->nodes().constEnd();
 }
 
 QVector<GeoDataCoordinates>::ConstIterator GeoDataLineString::constBegin() const
 {
-    return p()->m_vector.constBegin();
+    return p()->nodes().constBegin();
 }
 
 QVector<GeoDataCoordinates>::ConstIterator GeoDataLineString::constEnd() const
 {
-    return p()->m_vector.constEnd();
+    return p()->nodes().constEnd();
 }
 
 void GeoDataLineString::insert( int index, const GeoDataCoordinates& value )
@@ -377,6 +507,7 @@ void GeoDataLineString::insert( int index, const GeoDataCoordinates& value )
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->unpackNodes();
     d->m_vector.insert( index, value );
 }
 
@@ -388,7 +519,12 @@ void GeoDataLineString::append ( const GeoDataCoordinates& value )
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
-    d->m_vector.append( value );
+    d->m_levelIndices.clear();
+    if ( d->m_packed ) {
+        d->appendPacked( value );
+    } else {
+        d->m_vector.append( value );
+    }
 }
 
 void GeoDataLineString::append(const QVector<GeoDataCoordinates>& values)
@@ -399,6 +535,7 @@ void GeoDataLineString::append(const QVector<GeoDataCoordinates>& values)
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->unpackNodes();
 
 #if QT_VERSION >= 0x050500
     d->m_vector.append(values);
@@ -410,6 +547,18 @@ void GeoDataLineString::append(const QVector<GeoDataCoordinates>& values)
 #endif
 }
 
+void GeoDataLineString::reserve( int size )
+{
+    GeoDataGeometry::detach();
+    GeoDataLineStringPrivate* d = p();
+    if ( d->m_packed ) {
+        d->m_packedLongitudes.reserve( size );
+        d->m_packedLatitudes.reserve( size );
+    } else {
+        d->m_vector.reserve( size );
+    }
+}
+
 GeoDataLineString& GeoDataLineString::operator << ( const GeoDataCoordinates& value )
 {
     GeoDataGeometry::detach();
@@ -418,7 +567,12 @@ GeoDataLineString& GeoDataLineString::operator << ( const GeoDataCoordinates& va
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
-    d->m_vector.append( value );
+    d->m_levelIndices.clear();
+    if ( d->m_packed ) {
+        d->appendPacked( value );
+    } else {
+        d->m_vector.append( value );
+    }
     return *this;
 }
 
@@ -430,6 +584,7 @@ GeoDataLineString& GeoDataLineString::operator << ( const GeoDataLineString& val
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->unpackNodes();
 
     QVector<GeoDataCoordinates>::const_iterator itCoords = value.constBegin();
     QVector<GeoDataCoordinates>::const_iterator itEnd = value.constEnd();
@@ -453,10 +608,10 @@ bool GeoDataLineString::operator==( const GeoDataLineString &other ) const
     const GeoDataLineStringPrivate* d = p();
     const GeoDataLineStringPrivate* other_d = other.p();
 
-    QVector<GeoDataCoordinates>::const_iterator itCoords = d->m_vector.constBegin();
-    QVector<GeoDataCoordinates>::const_iterator otherItCoords = other_d->m_vector.constBegin();
-    QVector<GeoDataCoordinates>::const_iterator itEnd = d->m_vector.constEnd();
-    QVector<GeoDataCoordinates>::const_iterator otherItEnd = other_d->m_vector.constEnd();
+    QVector<GeoDataCoordinates>::const_iterator itCoords = d->nodes().constBegin();
+    QVector<GeoDataCoordinates>::const_iterator otherItCoords = other_d->nodes().constBegin();
+    QVector<GeoDataCoordinates>::const_iterator itEnd = d->nodes().constEnd();
+    QVector<GeoDataCoordinates>::const_iterator otherItEnd = other_d->nodes().constEnd();
 
     for ( ; itCoords != itEnd && otherItCoords != otherItEnd; ++itCoords, ++otherItCoords ) {
         if ( *itCoords != *otherItCoords ) {
@@ -483,6 +638,12 @@ void GeoDataLineString::clear()
     d->m_dirtyBox = true;
 
     d->m_vector.clear();
+    d->m_packedLongitudes.clear();
+    d->m_packedLatitudes.clear();
+    d->m_packedAltitudes.clear();
+    d->m_packedDetails.clear();
+    d->m_nodesCached.store( 0 );
+    d->m_levelIndices.clear();
 }
 
 bool GeoDataLineString::isClosed() const
@@ -533,9 +694,9 @@ GeoDataLineString GeoDataLineString::toNormalized() const
 
     // FIXME: Think about how we can avoid unnecessary copies
     //        if the linestring stays the same.
-    QVector<GeoDataCoordinates>::const_iterator end = p()->m_vector.constEnd();
+    QVector<GeoDataCoordinates>::const_iterator end = p()->nodes().constEnd();
     for( QVector<GeoDataCoordinates>::const_iterator itCoords
-          = p()->m_vector.constBegin();
+          = p()->nodes().constBegin();
          itCoords != end;
          ++itCoords ) {
 
@@ -594,27 +755,29 @@ void GeoDataLineStringPrivate::toPoleCorrected( const GeoDataLineString& q, GeoD
 {
     poleCorrected.setTessellationFlags( q.tessellationFlags() );
 
+    const QVector<GeoDataCoordinates> &vector = nodes();
+
     GeoDataCoordinates previousCoords;
     GeoDataCoordinates currentCoords;
 
     if ( q.isClosed() ) {
-        if ( !( m_vector.first().isPole() ) &&
-              ( m_vector.last().isPole() ) ) {
-                qreal firstLongitude = ( m_vector.first() ).longitude();
-                GeoDataCoordinates modifiedCoords( m_vector.last() );
+        if ( !( vector.first().isPole() ) &&
+              ( vector.last().isPole() ) ) {
+                qreal firstLongitude = ( vector.first() ).longitude();
+                GeoDataCoordinates modifiedCoords( vector.last() );
                 modifiedCoords.setLongitude( firstLongitude );
                 poleCorrected << modifiedCoords;
         }
     }
 
-    QVector<GeoDataCoordinates>::const_iterator itCoords = m_vector.constBegin();
-    QVector<GeoDataCoordinates>::const_iterator itEnd = m_vector.constEnd();
+    QVector<GeoDataCoordinates>::const_iterator itCoords = vector.constBegin();
+    QVector<GeoDataCoordinates>::const_iterator itEnd = vector.constEnd();
 
     for( ; itCoords != itEnd; ++itCoords ) {
 
         currentCoords  = *itCoords;
 
-        if ( itCoords == m_vector.constBegin() ) {
+        if ( itCoords == vector.constBegin() ) {
             previousCoords = currentCoords;
         }
 
@@ -646,10 +809,10 @@ void GeoDataLineStringPrivate::toPoleCorrected( const GeoDataLineString& q, GeoD
     }
 
     if ( q.isClosed() ) {
-        if (  ( m_vector.first().isPole() ) &&
-             !( m_vector.last().isPole() ) ) {
-                qreal lastLongitude = ( m_vector.last() ).longitude();
-                GeoDataCoordinates modifiedCoords( m_vector.first() );
+        if (  ( vector.first().isPole() ) &&
+             !( vector.last().isPole() ) ) {
+                qreal lastLongitude = ( vector.last() ).longitude();
+                GeoDataCoordinates modifiedCoords( vector.first() );
                 modifiedCoords.setLongitude( lastLongitude );
                 poleCorrected << modifiedCoords;
         }
@@ -776,12 +939,21 @@ qreal GeoDataLineString::length( qreal planetRadius, int offset ) const
     }
 
     qreal length = 0.0;
-    QVector<GeoDataCoordinates> const & vector = p()->m_vector;
     int const start = qMax(offset+1, 1);
-    int const end = p()->m_vector.size();
-    for( int i=start; i<end; ++i )
-    {
-        length += distanceSphere( vector[i-1], vector[i] );
+    int const end = size();
+    if ( p()->m_packed ) {
+        QVector<qreal> const & longitudes = p()->m_packedLongitudes;
+        QVector<qreal> const & latitudes = p()->m_packedLatitudes;
+        for( int i=start; i<end; ++i )
+        {
+            length += distanceSphere( longitudes[i-1], latitudes[i-1], longitudes[i], latitudes[i] );
+        }
+    } else {
+        QVector<GeoDataCoordinates> const & vector = p()->m_vector;
+        for( int i=start; i<end; ++i )
+        {
+            length += distanceSphere( vector[i-1], vector[i] );
+        }
     }
 
     return planetRadius * length;
@@ -795,6 +967,7 @@ QVector<GeoDataCoordinates>::Iterator GeoDataLineString::erase ( QVector<GeoData
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->unpackNodes();
     return d->m_vector.erase( pos );
 }
 
@@ -807,6 +980,7 @@ QVector<GeoDataCoordinates>::Iterator GeoDataLineString::erase ( QVector<GeoData
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->unpackNodes();
     return d->m_vector.erase( begin, end );
 }
 
@@ -816,6 +990,7 @@ void GeoDataLineString::remove ( int i )
     GeoDataLineStringPrivate* d = p();
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->unpackNodes();
     d->m_vector.remove( i );
 }
 
@@ -824,14 +999,107 @@ GeoDataLineString GeoDataLineString::optimized () const
     if( isClosed() ) {
         GeoDataLinearRing linearRing(*this);
         p()->optimize(linearRing);
+        static_cast<GeoDataLineString&>(linearRing).p()->updateLevelIndices();
         return linearRing;
     } else {
         GeoDataLineString lineString(*this);
         p()->optimize(lineString);
+        lineString.p()->updateLevelIndices();
         return lineString;
     }
 }
 
+void GeoDataLineString::setPackedStorage( bool packed )
+{
+    if ( packed == p()->m_packed ) {
+        return;
+    }
+
+    GeoDataGeometry::detach();
+    GeoDataLineStringPrivate* d = p();
+
+    if ( !packed ) {
+        // Unpacking keeps the nodes as they are
+        QVector<QVector<int> > const levelIndices = d->m_levelIndices;
+        d->unpackNodes();
+        d->m_levelIndices = levelIndices;
+        return;
+    }
+
+    // The bounding box is needed for culling, calculate it while the nodes are still around
+    latLonAltBox();
+
+    int const size = d->m_vector.size();
+    d->m_packedLongitudes.resize( size );
+    d->m_packedLatitudes.resize( size );
+    for ( int i = 0; i < size; ++i ) {
+        GeoDataCoordinates const &coordinates = d->m_vector.at( i );
+        coordinates.geoCoordinates( d->m_packedLongitudes[i], d->m_packedLatitudes[i] );
+        if ( coordinates.altitude() != 0.0 ) {
+            if ( d->m_packedAltitudes.isEmpty() ) {
+                d->m_packedAltitudes.fill( 0.0, size );
+            }
+            d->m_packedAltitudes[i] = coordinates.altitude();
+        }
+        if ( coordinates.detail() != 0 ) {
+            if ( d->m_packedDetails.isEmpty() ) {
+                d->m_packedDetails.fill( 0, size );
+            }
+            d->m_packedDetails[i] = coordinates.detail();
+        }
+    }
+
+    d->m_vector = QVector<GeoDataCoordinates>();
+    d->m_packed = true;
+    d->m_nodesCached.store( 0 );
+}
+
+bool GeoDataLineString::hasLevelIndices() const
+{
+    return !p()->m_levelIndices.isEmpty();
+}
+
+QVector<int> GeoDataLineString::levelIndices( int level ) const
+{
+    const QVector<QVector<int> > &levelIndices = p()->m_levelIndices;
+    if ( levelIndices.isEmpty() ) {
+        return QVector<int>();
+    }
+
+    return levelIndices.at( qBound( 1, level, levelIndices.size() ) - 1 );
+}
+
+void GeoDataLineString::restoreLevelIndices()
+{
+    GeoDataGeometry::detach();
+    p()->updateLevelIndices();
+}
+
+bool GeoDataLineString::hasPackedStorage() const
+{
+    return p()->m_packed;
+}
+
+const QVector<qreal>& GeoDataLineString::packedLongitudes() const
+{
+    return p()->m_packedLongitudes;
+}
+
+const QVector<qreal>& GeoDataLineString::packedLatitudes() const
+{
+    return p()->m_packedLatitudes;
+}
+
+const QVector<qreal>& GeoDataLineString::packedAltitudes() const
+{
+    return p()->m_packedAltitudes;
+}
+
+const QVector<quint8>& GeoDataLineString::packedDetails() const
+{
+    return p()->m_packedDetails;
+}
+
 void GeoDataLineString::pack( QDataStream& stream ) const
 {
     GeoDataGeometry::pack( stream );
@@ -840,10 +1108,10 @@ void GeoDataLineString::pack( QDataStream& stream ) const
     stream << (qint32)(p()->m_tessellationFlags);
 
     for( QVector<GeoDataCoordinates>::const_iterator iterator
-          = p()->m_vector.constBegin();
-         iterator != p()->m_vector.constEnd();
+          = p()->nodes().constBegin();
+         iterator != p()->nodes().constEnd();
          ++iterator ) {
-        mDebug() << "innerRing: size" << p()->m_vector.size();
+        mDebug() << "innerRing: size" << size();
         GeoDataCoordinates coord = ( *iterator );
         coord.pack( stream );
     }
@@ -861,6 +1129,7 @@ void GeoDataLineString::unpack( QDataStream& stream )
     stream >> tessellationFlags;
 
     p()->m_tessellationFlags = (TessellationFlags)(tessellationFlags);
+    p()->unpackNodes();
 
     p()->m_vector.reserve(p()->m_vector.size() + size);
 
@@ -290,6 +290,15 @@ class GEODATA_EXPORT GeoDataLineString : public GeoDataGeometry
     void append(const QVector<GeoDataCoordinates>& values);
 
 
+/*!
+    \brief Reserves memory for at least @p size nodes.
+
+    Saves reallocations when many nodes are appended one by one and their
+    number is known, or can be estimated, in advance.
+*/
+    void reserve( int size );
+
+
 /*!
     \brief Appends a given geodesic position as a new node to the LineString.
 */
@@ -361,9 +370,89 @@ class GEODATA_EXPORT GeoDataLineString : public GeoDataGeometry
 
     /*!
         \brief Returns a linestring with detail values assigned to each node.
+
+        The detail value of a node is derived from its significance for the
+        shape of the linestring (Douglas-Peucker). The returned linestring
+        also carries the indices of the nodes to draw on each detail level,
+        see levelIndices().
     */
     GeoDataLineString optimized() const;
 
+/*!
+    \brief Returns whether levelIndices() is available.
+
+    The indices are created by optimized() and dropped again as soon as
+    the nodes get modified.
+*/
+    bool hasLevelIndices() const;
+
+
+/*!
+    \brief Returns the indices of the nodes with a detail value of at most @p level.
+
+    The indices are in ascending order. The nodes of a level are a
+    simplification of the linestring that contains the nodes of all lower
+    levels. The first and the last node are part of all levels from the
+    detail value of the first node on, lower levels are empty. Levels below
+    1 are treated as 1, levels above 17 as 17. The vector is empty unless
+    hasLevelIndices() returns true.
+*/
+    QVector<int> levelIndices( int level ) const;
+
+/*!
+    \brief Creates levelIndices() from the detail values of the nodes.
+
+    Restores a linestring that was optimized() before, e.g. when reading it
+    from a cache, without computing the detail values again.
+*/
+    void restoreLevelIndices();
+
+/*!
+    \brief Sets whether the nodes are stored in packed arrays.
+
+    Packed storage keeps the longitudes, latitudes, altitudes and detail levels
+    of the nodes in contiguous arrays instead of one GeoDataCoordinates object
+    per node, which needs a fraction of the memory. The QVector like API keeps
+    working: Read access creates the GeoDataCoordinates objects on first use.
+    Appending nodes keeps the storage packed, any other modification converts
+    the LineString back to unpacked storage.
+*/
+    void setPackedStorage( bool packed );
+
+
+/*!
+    \brief Returns whether the nodes are stored in packed arrays.
+*/
+    bool hasPackedStorage() const;
+
+
+/*!
+    \brief Returns the longitudes of the nodes in radians.
+    The vector is empty unless packed storage is used.
+*/
+    const QVector<qreal>& packedLongitudes() const;
+
+
+/*!
+    \brief Returns the latitudes of the nodes in radians.
+    The vector is empty unless packed storage is used.
+*/
+    const QVector<qreal>& packedLatitudes() const;
+
+
+/*!
+    \brief Returns the altitudes of the nodes.
+    The vector is empty unless packed storage is used and a node has a non-zero altitude.
+*/
+    const QVector<qreal>& packedAltitudes() const;
+
+
+/*!
+    \brief Returns the detail levels of the nodes.
+    The vector is empty unless packed storage is used and a node has a non-zero detail level.
+*/
+    const QVector<quint8>& packedDetails() const;
+
     // Serialization
 /*!
     \brief Serialize the LineString to a stream.
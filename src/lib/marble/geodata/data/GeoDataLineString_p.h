@@ -15,6 +15,8 @@
 
 #include "GeoDataTypes.h"
 
+#include <QAtomicInt>
+
 namespace Marble
 {
 
@@ -26,15 +28,17 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
            m_dirtyRange( true ),
            m_dirtyBox( true ),
            m_tessellationFlags( f ),
-           m_previousResolution( -1 ),
-           m_level( -1 )
+           m_packed( false ),
+           m_nodesCached( 0 )
     {
     }
 
     GeoDataLineStringPrivate()
          : m_rangeCorrected( 0 ),
            m_dirtyRange( true ),
-           m_dirtyBox( true )
+           m_dirtyBox( true ),
+           m_packed( false ),
+           m_nodesCached( 0 )
     {
     }
 
@@ -51,6 +55,13 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
         m_dirtyRange = true;
         m_dirtyBox = other.m_dirtyBox;
         m_tessellationFlags = other.m_tessellationFlags;
+        m_packedLongitudes = other.m_packedLongitudes;
+        m_packedLatitudes = other.m_packedLatitudes;
+        m_packedAltitudes = other.m_packedAltitudes;
+        m_packedDetails = other.m_packedDetails;
+        m_packed = other.m_packed;
+        m_nodesCached.store( other.m_nodesCached.load() );
+        m_levelIndices = other.m_levelIndices;
         return *this;
     }
 
@@ -87,11 +98,33 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
                        const GeoDataCoordinates & currentCoords,
                        int recursionCounter ) const;
 
-    quint8 levelForResolution(qreal resolution) const;
-    qreal resolutionForLevel(int level) const;
+    static quint8 levelForResolution(qreal resolution);
     void optimize(GeoDataLineString& lineString) const;
 
-    QVector<GeoDataCoordinates> m_vector;
+    /**
+     * Collects the indices of the nodes of each detail level from the detail
+     * values of the nodes, see GeoDataLineString::levelIndices().
+     */
+    void updateLevelIndices();
+
+    /**
+     * Returns the nodes. With packed storage they are created on first use
+     * and kept until the line string gets modified. Only the API that hands
+     * out references or iterators needs them, rendering, clipping and
+     * updateLevelIndices() read the packed arrays instead.
+     */
+    const QVector<GeoDataCoordinates> &nodes() const;
+
+    /**
+     * Converts packed storage back to one GeoDataCoordinates object per node.
+     * Needs to be called before the nodes get modified through references.
+     */
+    void unpackNodes();
+
+    void appendPacked( const GeoDataCoordinates &coordinates );
+
+    // With packed storage this only caches the nodes, see nodes()
+    mutable QVector<GeoDataCoordinates> m_vector;
 
     mutable GeoDataLineString*  m_rangeCorrected;
     mutable bool                m_dirtyRange;
@@ -100,8 +133,18 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
                                             // GeoDataPoints since the LatLonAltBox has 
                                             // been calculated. Saves performance. 
     TessellationFlags           m_tessellationFlags;
-    mutable qreal  m_previousResolution;
-    mutable quint8 m_level;
+
+    QVector<qreal>              m_packedLongitudes;
+    QVector<qreal>              m_packedLatitudes;
+    QVector<qreal>              m_packedAltitudes;  // empty if all altitudes are 0
+    QVector<quint8>             m_packedDetails;    // empty if all details are 0
+    bool                        m_packed;
+    // Atomic, since nodes() may be called from several threads at once through the const API
+    mutable QAtomicInt          m_nodesCached;
+
+    // The node indices of the detail levels 1 to 17, empty unless optimized.
+    // Levels with the same nodes share their vector.
+    QVector<QVector<int> >      m_levelIndices;
 
 };
 
@@ -24,6 +24,7 @@
 // Qt
 #include <QDataStream>
 #include "MarbleDebug.h"
+#include "StringPool.h"
 #include "GeoDataTrack.h"
 #include "GeoDataModel.h"
 #include <QString>
@@ -178,14 +179,18 @@ const GeoDataGeometry* GeoDataPlacemark::geometry() const
 
 const OsmPlacemarkData& GeoDataPlacemark::osmData() const
 {
-    QVariant &placemarkVariantData = extendedData().valueRef( OsmPlacemarkData::osmHashKey() ).valueRef();
-    if ( !placemarkVariantData.canConvert<OsmPlacemarkData>() ) {
-        extendedData().addValue( GeoDataData( OsmPlacemarkData::osmHashKey(), QVariant::fromValue( OsmPlacemarkData() ) ) );
-        placemarkVariantData = extendedData().valueRef( OsmPlacemarkData::osmHashKey() ).valueRef();
+    // Reading doesn't insert any data, so that placemarks without OSM data
+    // don't need to allocate their rarely used properties
+    const GeoDataExtendedData &extendedData = p()->extra().m_extendedData;
+    if ( extendedData.contains( OsmPlacemarkData::osmHashKey() ) ) {
+        const QVariant &placemarkVariantData = extendedData.valueRef( OsmPlacemarkData::osmHashKey() ).valueRef();
+        if ( placemarkVariantData.canConvert<OsmPlacemarkData>() ) {
+            return *reinterpret_cast<const OsmPlacemarkData*>( placemarkVariantData.constData() );
+        }
     }
 
-    OsmPlacemarkData &osmData = *reinterpret_cast<OsmPlacemarkData*>( placemarkVariantData.data() );
-    return osmData;
+    static const OsmPlacemarkData empty;
+    return empty;
 }
 
 void GeoDataPlacemark::setOsmData( const OsmPlacemarkData &osmData )
@@ -195,13 +200,21 @@ void GeoDataPlacemark::setOsmData( const OsmPlacemarkData &osmData )
 
 OsmPlacemarkData& GeoDataPlacemark::osmData()
 {
-    return const_cast<OsmPlacemarkData&>( (static_cast<const GeoDataPlacemark*>(this) )->osmData() );
+    QVariant &placemarkVariantData = extendedData().valueRef( OsmPlacemarkData::osmHashKey() ).valueRef();
+    if ( !placemarkVariantData.canConvert<OsmPlacemarkData>() ) {
+        extendedData().addValue( GeoDataData( OsmPlacemarkData::osmHashKey(), QVariant::fromValue( OsmPlacemarkData() ) ) );
+        placemarkVariantData = extendedData().valueRef( OsmPlacemarkData::osmHashKey() ).valueRef();
+    }
+
+    OsmPlacemarkData &osmData = *reinterpret_cast<OsmPlacemarkData*>( placemarkVariantData.data() );
+    return osmData;
 }
 
 bool GeoDataPlacemark::hasOsmData() const
 {
-    QVariant &placemarkVariantData = extendedData().valueRef( OsmPlacemarkData::osmHashKey() ).valueRef();
-    return placemarkVariantData.canConvert<OsmPlacemarkData>();
+    const GeoDataExtendedData &extendedData = p()->extra().m_extendedData;
+    return extendedData.contains( OsmPlacemarkData::osmHashKey() ) &&
+           extendedData.valueRef( OsmPlacemarkData::osmHashKey() ).valueRef().canConvert<OsmPlacemarkData>();
 }
 
 const GeoDataLookAt *GeoDataPlacemark::lookAt() const
@@ -344,7 +357,7 @@ void GeoDataPlacemark::setState( const QString &state )
 {
     detach();
     p()->m_geometry->setParent( this );
-    p()->m_state = state;
+    p()->m_state = StringPool::intern( state );
 }
 
 const QString GeoDataPlacemark::countryCode() const
@@ -356,7 +369,7 @@ void GeoDataPlacemark::setCountryCode( const QString &countrycode )
 {
     detach();
     p()->m_geometry->setParent( this );
-    p()->m_countrycode = countrycode;
+    p()->m_countrycode = StringPool::intern( countrycode );
 }
 
 bool GeoDataPlacemark::isBalloonVisible() const
@@ -410,6 +423,7 @@ void GeoDataPlacemark::unpack( QDataStream& stream )
     GeoDataFeature::unpack( stream );
 
     stream >> p()->m_countrycode;
+    p()->m_countrycode = StringPool::intern( p()->m_countrycode );
     stream >> p()->m_area;
     stream >> p()->m_population;
     int geometryId;
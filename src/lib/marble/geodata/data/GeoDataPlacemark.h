@@ -121,6 +121,7 @@ class GEODATA_EXPORT GeoDataPlacemark: public GeoDataFeature
       * Quick, safe accessor to the placemark's OsmPlacemarkData stored within it's
       * ExtendedData. If the extendedData does not contain osmData, the function
       * inserts a default-constructed one, and returns a reference to it.
+      * The const version returns a shared empty OsmPlacemarkData instead.
       */
     OsmPlacemarkData &osmData();
     const OsmPlacemarkData &osmData() const;
@@ -20,6 +20,7 @@
 #include "MarbleDebug.h"
 
 #include <qmath.h>
+#include <QPolygonF>
 
 namespace Marble
 {
@@ -27,7 +28,11 @@ namespace Marble
 GeoLineStringGraphicsItem::GeoLineStringGraphicsItem( const GeoDataFeature *feature,
                                                       const GeoDataLineString* lineString )
         : GeoGraphicsItem( feature ),
-          m_lineString( lineString )
+          m_lineString( lineString ),
+          m_cachedProjection( Spherical ),
+          m_cachedRadius( -1 ),
+          m_cachedCenterLongitude( 0.0 ),
+          m_cachedCenterLatitude( 0.0 )
 {
     QString const category = StyleBuilder::visualCategoryName(feature->visualCategory());
     QStringList paintLayers;
@@ -37,10 +42,16 @@ GeoLineStringGraphicsItem::GeoLineStringGraphicsItem( const GeoDataFeature *feat
     setPaintLayers(paintLayers);
 }
 
+GeoLineStringGraphicsItem::~GeoLineStringGraphicsItem()
+{
+    qDeleteAll( m_screenPolygons );
+}
 
 void GeoLineStringGraphicsItem::setLineString( const GeoDataLineString* lineString )
 {
     m_lineString = lineString;
+    // The line string may have changed even if the pointer is the same
+    clearScreenPolygons();
 }
 
 const GeoDataLatLonAltBox& GeoLineStringGraphicsItem::latLonAltBox() const
@@ -62,10 +73,20 @@ void GeoLineStringGraphicsItem::paint(GeoPainter* painter, const ViewportParams*
     } else if (layer.endsWith(QLatin1String("/inline"))) {
         paintInline(painter, viewport);
     } else {
-        painter->drawPolyline(*m_lineString);
+        painter->drawPolyline( screenPolygons( viewport ) );
     }
 }
 
+void GeoLineStringGraphicsItem::project( const ViewportParams *viewport )
+{
+    screenPolygons( viewport );
+}
+
+void GeoLineStringGraphicsItem::releaseProjection()
+{
+    clearScreenPolygons();
+}
+
 void GeoLineStringGraphicsItem::paintInline(GeoPainter* painter, const ViewportParams* viewport)
 {
     if ( ( !viewport->resolves( m_lineString->latLonAltBox(), 2) ) ) {
@@ -84,10 +105,8 @@ void GeoLineStringGraphicsItem::paintInline(GeoPainter* painter, const ViewportP
         }
         currentPen.setColor( style()->polyStyle().paintedColor() );
         painter->setPen( currentPen );
-        painter->drawPolyline(*m_lineString);
-    } else {
-        painter->drawPolyline(*m_lineString);
     }
+    painter->drawPolyline( screenPolygons( viewport ) );
     
 
     painter->restore();
@@ -103,7 +122,7 @@ void GeoLineStringGraphicsItem::paintOutline(GeoPainter *painter, const Viewport
     LabelPositionFlags labelPositionFlags = NoLabel;
     QPen currentPen = configurePainter(painter, viewport, labelPositionFlags);
     if (!( currentPen.widthF() < 2.5f )) {
-        painter->drawPolyline(*m_lineString);
+        painter->drawPolyline( screenPolygons( viewport ) );
     }
     painter->restore();
 }
@@ -128,7 +147,7 @@ void GeoLineStringGraphicsItem::paintLabel(GeoPainter *painter, const ViewportPa
         //QColor const color = style()->polyStyle().paintedColor();
         //painter->setBackground(QBrush(color));
         //painter->setBackgroundMode(Qt::OpaqueMode);
-        painter->drawPolyline( *m_lineString, feature()->name(), FollowLine,
+        painter->drawPolyline( screenPolygons( viewport ), feature()->name(), FollowLine,
                                style()->labelStyle().paintedColor(),
                                style()->labelStyle().font());
     }
@@ -205,4 +224,36 @@ QPen GeoLineStringGraphicsItem::configurePainter(GeoPainter *painter, const View
     return currentPen;
 }
 
+const QVector<QPolygonF*> &GeoLineStringGraphicsItem::screenPolygons( const ViewportParams *viewport )
+{
+    if ( m_cachedRadius != viewport->radius() ||
+         m_cachedProjection != viewport->projection() ||
+         m_cachedCenterLongitude != viewport->centerLongitude() ||
+         m_cachedCenterLatitude != viewport->centerLatitude() ||
+         m_cachedSize != viewport->size() ) {
+        clearScreenPolygons();
+        m_cachedProjection = viewport->projection();
+        m_cachedRadius = viewport->radius();
+        m_cachedCenterLongitude = viewport->centerLongitude();
+        m_cachedCenterLatitude = viewport->centerLatitude();
+        m_cachedSize = viewport->size();
+
+        // Same as GeoPainter::drawPolyline( GeoDataLineString ): skip line strings
+        // outside of the viewport or below its resolution
+        if ( viewport->viewLatLonAltBox().intersects( m_lineString->latLonAltBox() ) &&
+             viewport->resolves( m_lineString->latLonAltBox() ) ) {
+            viewport->screenCoordinates( *m_lineString, m_screenPolygons );
+        }
+    }
+
+    return m_screenPolygons;
+}
+
+void GeoLineStringGraphicsItem::clearScreenPolygons()
+{
+    qDeleteAll( m_screenPolygons );
+    m_screenPolygons.clear();
+    m_cachedRadius = -1;
+}
+
 }
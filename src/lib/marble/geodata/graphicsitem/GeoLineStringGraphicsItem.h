@@ -12,8 +12,14 @@
 #define MARBLE_GEOLINESTRINGGRAPHICSITEM_H
 
 #include "GeoGraphicsItem.h"
+#include "MarbleGlobal.h"
 #include "marble_export.h"
 
+#include <QSize>
+#include <QVector>
+
+class QPolygonF;
+
 namespace Marble
 {
 
@@ -25,6 +31,8 @@ class MARBLE_EXPORT GeoLineStringGraphicsItem : public GeoGraphicsItem
 public:
     explicit GeoLineStringGraphicsItem( const GeoDataFeature *feature, const GeoDataLineString *lineString );
 
+    ~GeoLineStringGraphicsItem();
+
     void setLineString( const GeoDataLineString* lineString );
 
     virtual const GeoDataLatLonAltBox& latLonAltBox() const;
@@ -32,6 +40,10 @@ public:
 
     void paint(GeoPainter* painter, const ViewportParams *viewport, const QString &layer);
 
+    void project( const ViewportParams *viewport );
+
+    void releaseProjection();
+
 protected:
     const GeoDataLineString *m_lineString;
 
@@ -41,6 +53,25 @@ private:
     void paintLabel(GeoPainter *painter, const ViewportParams *viewport);
 
     QPen configurePainter(GeoPainter* painter, const ViewportParams *viewport, LabelPositionFlags &labelPositionFlags) const;
+
+    /**
+     * Returns the line string projected to the screen coordinates of @p viewport.
+     * The outline, inline and label passes share the projection, and it is kept
+     * for the next frame unless the projection, radius, center or size changes,
+     * or the item isn't painted in a frame.
+     */
+    const QVector<QPolygonF*> &screenPolygons( const ViewportParams *viewport );
+
+    void clearScreenPolygons();
+
+    QVector<QPolygonF*> m_screenPolygons;
+
+    // The viewport state m_screenPolygons was projected for
+    Projection m_cachedProjection;
+    int m_cachedRadius;
+    qreal m_cachedCenterLongitude;
+    qreal m_cachedCenterLatitude;
+    QSize m_cachedSize;
 };
 
 }
@@ -41,6 +41,11 @@ void GeoTrackGraphicsItem::paint(GeoPainter *painter, const ViewportParams *view
     GeoLineStringGraphicsItem::paint(painter, viewport, layer);
 }
 
+void GeoTrackGraphicsItem::project( const ViewportParams *viewport )
+{
+    Q_UNUSED( viewport );
+}
+
 void GeoTrackGraphicsItem::update()
 {
     setLineString( m_track->lineString() );
@@ -28,6 +28,12 @@ public:
 
     virtual void paint(GeoPainter *painter, const ViewportParams *viewport, const QString &layer);
 
+    /**
+     * Does nothing: the track may change between frames, so it is updated
+     * and projected in paint().
+     */
+    virtual void project( const ViewportParams *viewport );
+
 private:
     const GeoDataTrack *m_track;
     void update();
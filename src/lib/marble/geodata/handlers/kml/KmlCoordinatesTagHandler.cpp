@@ -21,8 +21,8 @@
 
 #include "KmlCoordinatesTagHandler.h"
 
-#include <QStringList>
-#include <QRegExp>
+#include <QString>
+#include <QVarLengthArray>
 
 #include "MarbleDebug.h"
 #include "KmlElementDictionary.h"
@@ -51,144 +51,349 @@ static const bool kmlStrictSpecs = false;
 static GeoTagHandlerRegistrar s_handlercoordkmlTag_nameSpaceGx22(GeoParser::QualifiedName(kmlTag_coord, kmlTag_nameSpaceGx22 ),
                                                                  new KmlcoordinatesTagHandler());
 
-GeoNode* KmlcoordinatesTagHandler::parse( GeoParser& parser ) const
+namespace
 {
-    Q_ASSERT( parser.isStartElement()
-             && ( parser.isValidElement( kmlTag_coordinates )
-                  || parser.isValidElement( kmlTag_coord ) ) );
 
-    GeoStackItem parentItem = parser.parentElement();
+inline bool isSpace( QChar c )
+{
+    ushort const u = c.unicode();
+    return u == ' ' || u == '\n' || u == '\t' || u == '\r' || ( u > 127 && c.isSpace() );
+}
 
-    if( parentItem.represents( kmlTag_Point )
-     || parentItem.represents( kmlTag_LineString )
-     || parentItem.represents( kmlTag_MultiGeometry )
-     || parentItem.represents( kmlTag_LinearRing )
-     || parentItem.represents( kmlTag_LatLonQuad ) ) {
-        QStringList  coordinatesLines;// = parser.readElementText().trimmed().split( QRegExp("\\s"), QString::SkipEmptyParts );
-        // Splitting using the "\\s" regexp is slow, split manually instead.
-        QString text = parser.readElementText().trimmed();
-
-        if ( !kmlStrictSpecs ) {
-            // Removing spaces before and after commas
-            for ( int i = 1; i < text.size() - 1; ++i ) {
-                if ( text[i] == ',' ) {
-                    // Before
-                    int l = i - 1;
-                    while ( l > 0 && text[l].isSpace() ) {
-                        --l;
-                    }
+/**
+ * Parses a decimal number like strtod() in the C locale would. Numbers that
+ * can't be converted exactly with a single multiplication or division by a
+ * power of ten are left to QString::toDouble(), which is slower but rounds
+ * correctly in all cases.
+ */
+qreal parseNumber( const char *begin, const char *end )
+{
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    int const maximumPowerOfTen = 22;
+    int const maximumDigits = 19;
+    quint64 const maximumExactMantissa = Q_UINT64_C( 1 ) << 53;
 
-                    // After
-                    int r = i + 1;
-                    while ( r < text.size() && text[r].isSpace() ) {
-                        ++r;
-                    }
+    const char *pos = begin;
+    bool const negative = pos != end && *pos == '-';
+    if ( pos != end && ( *pos == '-' || *pos == '+' ) ) {
+        ++pos;
+    }
 
-                    text.remove( l + 1, r - l - 1 ).insert( l + 1, ',' );
-                }
-            }
+    quint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    bool exact = true;
+    for ( ; pos != end && *pos >= '0' && *pos <= '9'; ++pos ) {
+        hasDigits = true;
+        mantissa = mantissa * 10 + ( *pos - '0' );
+        digits += mantissa != 0 ? 1 : 0;
+        exact = exact && digits <= maximumDigits;
+    }
+    if ( pos != end && *pos == '.' ) {
+        for ( ++pos; pos != end && *pos >= '0' && *pos <= '9'; ++pos ) {
+            hasDigits = true;
+            mantissa = mantissa * 10 + ( *pos - '0' );
+            digits += mantissa != 0 ? 1 : 0;
+            exact = exact && digits <= maximumDigits;
+            --exponent;
+        }
+    }
+    if ( hasDigits && pos != end && ( *pos == 'e' || *pos == 'E' ) ) {
+        ++pos;
+        bool const negativeExponent = pos != end && *pos == '-';
+        if ( pos != end && ( *pos == '-' || *pos == '+' ) ) {
+            ++pos;
+        }
+        int value = 0;
+        hasDigits = pos != end;
+        for ( ; pos != end && *pos >= '0' && *pos <= '9' && value < 10000; ++pos ) {
+            value = value * 10 + ( *pos - '0' );
         }
+        exponent += negativeExponent ? -value : value;
+    }
 
-        int index = 0;
-        bool inside = true;
-        int const size = text.size();
-        for ( int i=0; i<size; ++i ) {
-            if ( text[i].isSpace() ) {
-                if ( inside ) {
-                    coordinatesLines.append( text.mid( index, i-index ) );
-                    inside = false;
-                }
-                index = i+1;
-            } else {
-                inside = true;
+    if ( hasDigits && pos == end && exact && mantissa <= maximumExactMantissa
+         && exponent >= -maximumPowerOfTen && exponent <= maximumPowerOfTen ) {
+        double const result = exponent < 0 ? mantissa / powersOfTen[-exponent]
+                                            : mantissa * powersOfTen[exponent];
+        return negative ? -result : result;
+    }
+
+    return QString::fromLatin1( begin, end - begin ).toDouble();
+}
+
+/**
+ * Splits the text of a coordinates element into tuples of numbers while it is
+ * read. The text may arrive in several chunks, numbers and tuples can span them.
+ *
+ * The numbers of a tuple are separated by commas, tuples by whitespace. For
+ * gx:coord, whitespace separates the numbers of the only tuple instead.
+ */
+class CoordinatesTokenizer
+{
+public:
+    explicit CoordinatesTokenizer( bool whitespaceSeparatesTuples ) :
+        m_whitespaceSeparatesTuples( whitespaceSeparatesTuples ),
+        m_valueIndex( 0 ),
+        m_inTuple( false ),
+        m_afterSpace( false ),
+        m_afterComma( false )
+    {
+        resetValues();
+    }
+
+    /**
+     * Returns an upper bound for the number of tuples starting in the given text.
+     */
+    static int estimateTupleCount( const QChar *begin, const QChar *end )
+    {
+        int count = 1;
+        for ( const QChar *pos = begin; pos + 1 < end; ++pos ) {
+            if ( isSpace( *pos ) && !isSpace( *( pos + 1 ) ) ) {
+                ++count;
             }
         }
-        coordinatesLines.append( text.mid( index ) );
-        int coordinatesIndex = 0;
-        Q_FOREACH( const QString& line, coordinatesLines ) {
-            QStringList coordinates = line.trimmed().split( ',' );
-            if ( parentItem.represents( kmlTag_Point ) && parentItem.is<GeoDataFeature>() ) {
-                GeoDataCoordinates coord;
-                if ( coordinates.size() == 2 ) {
-                    coord.set( coordinates.at( 0 ).toDouble(),
-                              coordinates.at( 1 ).toDouble(), 0.0, GeoDataCoordinates::Degree );
-                } else if( coordinates.size() == 3 ) {
-                    coord.set( coordinates.at( 0 ).toDouble(),
-                               coordinates.at( 1 ).toDouble(),
-                               coordinates.at( 2 ).toDouble(),
-                               GeoDataCoordinates::Degree );
+        return count;
+    }
+
+    /**
+     * Tokenizes the given text and passes each complete tuple to @p sink.
+     */
+    template<class Sink>
+    void addText( const QChar *begin, const QChar *end, Sink &sink )
+    {
+        for ( const QChar *pos = begin; pos != end; ++pos ) {
+            if ( isSpace( *pos ) ) {
+                finishNumber();
+                m_afterSpace = true;
+                if ( kmlStrictSpecs && m_whitespaceSeparatesTuples ) {
+                    finishTuple( sink );
                 }
-                parentItem.nodeAs<GeoDataPlacemark>()->setCoordinate( coord );
+            } else if ( pos->unicode() == ',' ) {
+                finishNumber();
+                // Spaces around commas don't separate tuples
+                m_afterSpace = false;
+                m_afterComma = true;
+                m_inTuple = true;
+                ++m_valueIndex;
             } else {
-                GeoDataCoordinates coord;
-                if ( coordinates.size() == 2 ) {
-                    coord.set( DEG2RAD * coordinates.at( 0 ).toDouble(),
-                              DEG2RAD * coordinates.at( 1 ).toDouble() );
-                } else if( coordinates.size() == 3 ) {
-                    coord.set( DEG2RAD * coordinates.at( 0 ).toDouble(),
-                              DEG2RAD * coordinates.at( 1 ).toDouble(),
-                              coordinates.at( 2 ).toDouble() );
-                }
-
-                if ( parentItem.represents( kmlTag_LineString ) ) {
-                    parentItem.nodeAs<GeoDataLineString>()->append( coord );
-                } else if ( parentItem.represents( kmlTag_LinearRing ) ) {
-                    parentItem.nodeAs<GeoDataLinearRing>()->append( coord );
-                } else if ( parentItem.represents( kmlTag_MultiGeometry ) ) {
-                    GeoDataPoint *point = new GeoDataPoint( coord );
-                    parentItem.nodeAs<GeoDataMultiGeometry>()->append( point );
-                } else if ( parentItem.represents( kmlTag_Model) ) {
-                    parentItem.nodeAs<GeoDataModel>()->setCoordinates( coord);
-                } else if ( parentItem.represents( kmlTag_Point ) ) {
-                    // photo overlay
-                    parentItem.nodeAs<GeoDataPoint>()->setCoordinates( coord );
-                } else if ( parentItem.represents( kmlTag_LatLonQuad ) ) {
-                    switch ( coordinatesIndex ) {
-                    case 0:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomLeft( coord );
-                        break;
-                    case 1:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomRight( coord );
-                        break;
-                    case 2:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setTopRight( coord );
-                        break;
-                    case 3:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setTopLeft( coord );
-                        break;
-                    case 4:
-                        mDebug() << "Ignoring excessive coordinates in LatLonQuad (must not have more than 4 pairs)";
-                        break;
-                    default:
-                        // Silently ignore any more coordinates
-                        break;
+                if ( m_afterSpace && !m_afterComma && m_inTuple ) {
+                    if ( m_whitespaceSeparatesTuples ) {
+                        finishTuple( sink );
+                    } else {
+                        ++m_valueIndex;
                     }
-                } else {
-                    // raise warning as coordinates out of valid parents found
                 }
+                m_afterSpace = false;
+                m_afterComma = false;
+                m_inTuple = true;
+                m_number.append( pos->toLatin1() );
             }
+        }
+    }
 
-            ++coordinatesIndex;
+    /**
+     * Passes the last tuple to @p sink, to be called at the end of the text.
+     */
+    template<class Sink>
+    void finish( Sink &sink )
+    {
+        finishNumber();
+        finishTuple( sink );
+    }
+
+private:
+    void resetValues()
+    {
+        m_values[0] = 0.0;
+        m_values[1] = 0.0;
+        m_values[2] = 0.0;
+    }
+
+    void finishNumber()
+    {
+        if ( !m_number.isEmpty() ) {
+            if ( m_valueIndex < 3 ) {
+                m_values[m_valueIndex] = parseNumber( m_number.constData(), m_number.constData() + m_number.size() );
+            }
+            m_number.clear();
         }
     }
 
-    if( parentItem.represents( kmlTag_Track ) ) {
-        QString input = parser.readElementText().trimmed();
-        if ( !kmlStrictSpecs ) {
-            input = input.replace( QRegExp( "\\s*,\\s*" ), "," );
+    template<class Sink>
+    void finishTuple( Sink &sink )
+    {
+        if ( m_inTuple ) {
+            sink( m_values, m_valueIndex + 1 );
+            resetValues();
+            m_valueIndex = 0;
+            m_inTuple = false;
+            m_afterComma = false;
         }
-        QStringList coordinates = input.split( ' ' );
-
-        GeoDataCoordinates coord;
-        if ( coordinates.size() == 2 ) {
-            coord.set( DEG2RAD * coordinates.at( 0 ).toDouble(),
-                       DEG2RAD * coordinates.at( 1 ).toDouble() );
-        } else if( coordinates.size() == 3 ) {
-            coord.set( DEG2RAD * coordinates.at( 0 ).toDouble(),
-                       DEG2RAD * coordinates.at( 1 ).toDouble(),
-                       coordinates.at( 2 ).toDouble() );
+    }
+
+    bool const m_whitespaceSeparatesTuples;
+    QVarLengthArray<char, 32> m_number;
+    qreal m_values[3];
+    int m_valueIndex;
+    bool m_inTuple;
+    bool m_afterSpace;
+    bool m_afterComma;
+};
+
+/**
+ * Stores the parsed tuples in the parent element of the coordinates.
+ */
+class CoordinatesSink
+{
+public:
+    explicit CoordinatesSink( const GeoStackItem &parentItem ) :
+        m_parentItem( parentItem ),
+        m_lineString( 0 ),
+        m_reserved( 0 ),
+        m_coordinatesIndex( 0 )
+    {
+        if ( m_parentItem.represents( kmlTag_LineString ) ) {
+            m_lineString = m_parentItem.nodeAs<GeoDataLineString>();
+        } else if ( m_parentItem.represents( kmlTag_LinearRing ) ) {
+            m_lineString = m_parentItem.nodeAs<GeoDataLinearRing>();
+        }
+    }
+
+    /**
+     * Makes room for the tuples of the next chunk of text.
+     */
+    void reserve( const QChar *begin, const QChar *end )
+    {
+        if ( m_lineString ) {
+            int const required = m_lineString->size() + CoordinatesTokenizer::estimateTupleCount( begin, end );
+            if ( required > m_reserved ) {
+                m_reserved = qMax( required, 2 * m_reserved );
+                m_lineString->reserve( m_reserved );
+            }
+        }
+    }
+
+    void operator()( const qreal *values, int count )
+    {
+        if ( m_parentItem.represents( kmlTag_Point ) && m_parentItem.is<GeoDataFeature>() ) {
+            GeoDataCoordinates coord;
+            if ( count == 2 ) {
+                coord.set( values[0], values[1], 0.0, GeoDataCoordinates::Degree );
+            } else if( count == 3 ) {
+                coord.set( values[0], values[1], values[2], GeoDataCoordinates::Degree );
+            }
+            m_parentItem.nodeAs<GeoDataPlacemark>()->setCoordinate( coord );
+        } else {
+            GeoDataCoordinates coord;
+            if ( count == 2 ) {
+                coord.set( DEG2RAD * values[0], DEG2RAD * values[1] );
+            } else if( count == 3 ) {
+                coord.set( DEG2RAD * values[0], DEG2RAD * values[1], values[2] );
+            }
+
+            if ( m_lineString ) {
+                m_lineString->append( coord );
+            } else if ( m_parentItem.represents( kmlTag_MultiGeometry ) ) {
+                GeoDataPoint *point = new GeoDataPoint( coord );
+                m_parentItem.nodeAs<GeoDataMultiGeometry>()->append( point );
+            } else if ( m_parentItem.represents( kmlTag_Model) ) {
+                m_parentItem.nodeAs<GeoDataModel>()->setCoordinates( coord);
+            } else if ( m_parentItem.represents( kmlTag_Point ) ) {
+                // photo overlay
+                m_parentItem.nodeAs<GeoDataPoint>()->setCoordinates( coord );
+            } else if ( m_parentItem.represents( kmlTag_LatLonQuad ) ) {
+                switch ( m_coordinatesIndex ) {
+                case 0:
+                    m_parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomLeft( coord );
+                    break;
+                case 1:
+                    m_parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomRight( coord );
+                    break;
+                case 2:
+                    m_parentItem.nodeAs<GeoDataLatLonQuad>()->setTopRight( coord );
+                    break;
+                case 3:
+                    m_parentItem.nodeAs<GeoDataLatLonQuad>()->setTopLeft( coord );
+                    break;
+                case 4:
+                    mDebug() << "Ignoring excessive coordinates in LatLonQuad (must not have more than 4 pairs)";
+                    break;
+                default:
+                    // Silently ignore any more coordinates
+                    break;
+                }
+            } else if ( m_parentItem.represents( kmlTag_Track ) ) {
+                m_parentItem.nodeAs<GeoDataTrack>()->appendCoordinates( coord );
+            } else {
+                // raise warning as coordinates out of valid parents found
+            }
+        }
+
+        ++m_coordinatesIndex;
+    }
+
+    /**
+     * Returns the number of tuples stored so far.
+     */
+    int count() const
+    {
+        return m_coordinatesIndex;
+    }
+
+private:
+    GeoStackItem m_parentItem;
+    GeoDataLineString *m_lineString;
+    int m_reserved;
+    int m_coordinatesIndex;
+};
+
+}
+
+GeoNode* KmlcoordinatesTagHandler::parse( GeoParser& parser ) const
+{
+    Q_ASSERT( parser.isStartElement()
+             && ( parser.isValidElement( kmlTag_coordinates )
+                  || parser.isValidElement( kmlTag_coord ) ) );
+
+    GeoStackItem parentItem = parser.parentElement();
+
+    if( parentItem.represents( kmlTag_Point )
+     || parentItem.represents( kmlTag_LineString )
+     || parentItem.represents( kmlTag_MultiGeometry )
+     || parentItem.represents( kmlTag_LinearRing )
+     || parentItem.represents( kmlTag_LatLonQuad )
+     || parentItem.represents( kmlTag_Track ) ) {
+        // The text is tokenized straight from the buffer of the reader instead of
+        // copying it with readElementText(). Like the latter, this stops at the end element.
+        CoordinatesSink sink( parentItem );
+        CoordinatesTokenizer tokenizer( !parentItem.represents( kmlTag_Track ) );
+        while ( !parser.atEnd() ) {
+            parser.readNext();
+            if ( parser.isCharacters() ) {
+                QStringRef const text = parser.text();
+                const QChar *const begin = text.constData();
+                const QChar *const end = begin + text.size();
+                sink.reserve( begin, end );
+                tokenizer.addText( begin, end, sink );
+            } else if ( parser.isEndElement() ) {
+                break;
+            } else if ( parser.isStartElement() ) {
+                parser.raiseError( "Expected character data." );
+                break;
+            }
+        }
+        tokenizer.finish( sink );
+
+        // Each gx:coord adds one position to the track, so that they keep matching the when elements
+        if ( parentItem.represents( kmlTag_Track ) && sink.count() == 0 ) {
+            qreal const values[] = { 0.0, 0.0, 0.0 };
+            sink( values, 0 );
         }
-        parentItem.nodeAs<GeoDataTrack>()->appendCoordinates( coord );
     }
 
     return 0;
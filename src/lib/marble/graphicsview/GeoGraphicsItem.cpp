@@ -128,6 +128,15 @@ bool GeoGraphicsItem::isHighlighted() const
     return d->m_highlighted;
 }
 
+void GeoGraphicsItem::project( const ViewportParams *viewport )
+{
+    Q_UNUSED( viewport );
+}
+
+void GeoGraphicsItem::releaseProjection()
+{
+}
+
 QStringList GeoGraphicsItem::paintLayers() const
 {
     return d->m_paintLayers;
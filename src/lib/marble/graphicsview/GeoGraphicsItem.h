@@ -142,6 +142,20 @@ class MARBLE_EXPORT GeoGraphicsItem
      */
     virtual void paint(GeoPainter *painter, const ViewportParams *viewport, const QString &layer) = 0;
 
+    /**
+     * Projects the geometry of the item for @p viewport ahead of paint(), so that
+     * paint() can reuse the result. GeometryLayer calls this for all visible items
+     * concurrently from worker threads, so implementations may only change the
+     * state of the item itself. The default implementation does nothing.
+     */
+    virtual void project( const ViewportParams *viewport );
+
+    /**
+     * Frees what project() keeps for the next frame. GeometryLayer calls this
+     * once the item is no longer painted. The default implementation does nothing.
+     */
+    virtual void releaseProjection();
+
     void setHighlighted( bool highlight );
 
     bool isHighlighted() const;
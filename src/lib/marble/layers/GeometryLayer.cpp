@@ -50,9 +50,47 @@
 #include <qmath.h>
 #include <QAbstractItemModel>
 #include <QModelIndex>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
 
 namespace Marble
 {
+
+namespace
+{
+
+/**
+ * Projects every n-th of the given items, starting at the given offset,
+ * so that the items are spread evenly over the workers.
+ */
+class ProjectionJob : public QRunnable
+{
+public:
+    ProjectionJob( const QVector<GeoGraphicsItem*> &items, const ViewportParams *viewport, int offset, int stride ) :
+        m_items( items ),
+        m_viewport( viewport ),
+        m_offset( offset ),
+        m_stride( stride )
+    {
+    }
+
+    void run()
+    {
+        for ( int i = m_offset; i < m_items.size(); i += m_stride ) {
+            m_items[i]->project( m_viewport );
+        }
+    }
+
+private:
+    const QVector<GeoGraphicsItem*> &m_items;
+    const ViewportParams *const m_viewport;
+    const int m_offset;
+    const int m_stride;
+};
+
+}
+
 class GeometryLayerPrivate
 {
 public:
@@ -64,6 +102,9 @@ public:
     void createGraphicsItemFromGeometry( const GeoDataGeometry *object, const GeoDataPlacemark *placemark, bool avoidOsmDuplicates );
     void createGraphicsItemFromOverlay( const GeoDataOverlay *overlay );
     void removeGraphicsItems( const GeoDataFeature *feature );
+    void projectItems( const QVector<GeoGraphicsItem*> &items, const ViewportParams *viewport );
+    void releaseProjections( const QVector<GeoGraphicsItem*> &paintedItems );
+    void releaseProjections();
 
     const QAbstractItemModel *const m_model;
     const StyleBuilder *const m_styleBuilder;
@@ -73,6 +114,12 @@ public:
 
     QMap<qint64,OsmQueue> m_osmWayItems;
     QMap<qint64,OsmQueue> m_osmRelationItems;
+
+    // Not the global thread pool, which may be busy with parsing files
+    QThreadPool m_projectionPool;
+
+    // The items painted in the last frame, which may keep their projection
+    QSet<GeoGraphicsItem*> m_projectedItems;
 };
 
 GeometryLayerPrivate::GeometryLayerPrivate(const QAbstractItemModel *model, const StyleBuilder *styleBuilder) :
@@ -81,6 +128,54 @@ GeometryLayerPrivate::GeometryLayerPrivate(const QAbstractItemModel *model, cons
 {
 }
 
+void GeometryLayerPrivate::projectItems( const QVector<GeoGraphicsItem*> &items, const ViewportParams *viewport )
+{
+    // Below that, starting the jobs costs more than it saves
+    int const minimumItemsPerJob = 32;
+    int const jobCount = qMin( m_projectionPool.maxThreadCount(), items.size() / minimumItemsPerJob );
+
+    if ( jobCount < 2 ) {
+        foreach ( GeoGraphicsItem *item, items ) {
+            item->project( viewport );
+        }
+        return;
+    }
+
+    for ( int i = 1; i < jobCount; ++i ) {
+        m_projectionPool.start( new ProjectionJob( items, viewport, i, jobCount ) );
+    }
+    // The GUI thread takes its share instead of waiting idly
+    ProjectionJob( items, viewport, 0, jobCount ).run();
+    m_projectionPool.waitForDone();
+}
+
+void GeometryLayerPrivate::releaseProjections( const QVector<GeoGraphicsItem*> &paintedItems )
+{
+    // Only the items on display keep their projection, so panning across
+    // the map doesn't accumulate the projections of everything passed by
+    QSet<GeoGraphicsItem*> projectedItems;
+    projectedItems.reserve( paintedItems.size() );
+    foreach ( GeoGraphicsItem *item, paintedItems ) {
+        projectedItems.insert( item );
+    }
+
+    foreach ( GeoGraphicsItem *item, m_projectedItems ) {
+        if ( !projectedItems.contains( item ) ) {
+            item->releaseProjection();
+        }
+    }
+    m_projectedItems.swap( projectedItems );
+}
+
+void GeometryLayerPrivate::releaseProjections()
+{
+    // Called before the scene deletes items, which must not be released afterwards
+    foreach ( GeoGraphicsItem *item, m_projectedItems ) {
+        item->releaseProjection();
+    }
+    m_projectedItems.clear();
+}
+
 GeometryLayer::GeometryLayer(const QAbstractItemModel *model, const StyleBuilder *styleBuilder) :
     d(new GeometryLayerPrivate(model, styleBuilder))
 {
@@ -126,7 +221,7 @@ bool GeometryLayer::render( GeoPainter *painter, ViewportParams *viewport,
 
     typedef QPair<QString, GeoGraphicsItem*> LayerItem;
     QList<LayerItem> defaultLayer;
-    int paintedItems = 0;
+    QVector<GeoGraphicsItem*> paintedItems;
     QHash<QString, QList<GeoGraphicsItem*> > paintedFragments;
     foreach( GeoGraphicsItem* item, items )
     {
@@ -148,10 +243,14 @@ bool GeometryLayer::render( GeoPainter *painter, ViewportParams *viewport,
                     }
                 }
             }
-            ++paintedItems;
+            paintedItems << item;
         }
     }
 
+    // Project the items in parallel first, so that painting them in render
+    // order, which has to happen in this thread, reuses the projections
+    d->projectItems( paintedItems, viewport );
+
     foreach (const QString &layer, d->m_styleBuilder->renderOrder()) {
         QList<GeoGraphicsItem*> & layerItems = paintedFragments[layer];
         qStableSort(layerItems.begin(), layerItems.end(), GeoGraphicsItem::zValueLessThan);
@@ -167,10 +266,12 @@ bool GeometryLayer::render( GeoPainter *painter, ViewportParams *viewport,
         item->paintEvent( painter, viewport );
     }
 
+    d->releaseProjections( paintedItems );
+
     painter->restore();
     d->m_runtimeTrace = QString( "Geometries: %1 Drawn: %2 Zoom: %3")
                 .arg( items.size() )
-                .arg( paintedItems )
+                .arg( paintedItems.size() )
                 .arg( maxZoomLevel );
     return true;
 }
@@ -361,6 +462,7 @@ void GeometryLayer::addPlacemarks( const QModelIndex& parent, int first, int las
 void GeometryLayer::removePlacemarks( const QModelIndex& parent, int first, int last )
 {
     Q_ASSERT( last < d->m_model->rowCount( parent ) );
+    d->releaseProjections();
     bool isRepaintNeeded = false;
     for( int i=first; i<=last; ++i ) {
         QModelIndex index = d->m_model->index( i, 0, parent );
@@ -380,6 +482,7 @@ void GeometryLayer::removePlacemarks( const QModelIndex& parent, int first, int
 
 void GeometryLayer::resetCacheData()
 {
+    d->releaseProjections();
     d->m_scene.clear();
     qDeleteAll( d->m_items );
     d->m_items.clear();
@@ -153,6 +153,7 @@ void TextureLayer::Private::updateTextureLayers()
 
     updateGroundOverlays();
 
+    m_tileLoader.waitForPendingTiles();
     m_layerDecorator.setTextureLayers( result );
     m_tileLoader.clear();
 
@@ -222,6 +223,8 @@ void TextureLayer::Private::resetGroundOverlaysCache()
 
 void TextureLayer::Private::updateGroundOverlays()
 {
+    m_tileLoader.waitForPendingTiles();
+
     if ( !m_texcolorizer ) {
         m_layerDecorator.updateGroundOverlays( m_groundOverlayCache );
     }
@@ -249,6 +252,12 @@ TextureLayer::TextureLayer( HttpDownloadManager *downloadManager,
     connect( &d->m_loader, SIGNAL(tileCompleted(TileId,QImage)),
              this, SLOT(updateTile(TileId,QImage)) );
 
+    // Decode missing tiles in the background while rendering scaled ancestors.
+    // The decoded tiles arrive one by one, repaint at most once per interval.
+    d->m_tileLoader.setAsynchronousLoading( true );
+    connect( &d->m_tileLoader, SIGNAL(placeholderReplaced(TileId)),
+             this, SLOT(requestDelayedRepaint()) );
+
     // Repaint timer
     d->m_repaintTimer.setSingleShot( true );
     d->m_repaintTimer.setInterval( REPAINT_SCHEDULING_INTERVAL );
@@ -258,6 +267,8 @@ TextureLayer::TextureLayer( HttpDownloadManager *downloadManager,
 
 TextureLayer::~TextureLayer()
 {
+    // the tiles still being decoded may refer to the custom textures
+    d->m_tileLoader.waitForPendingTiles();
     qDeleteAll(d->m_customTextures);
     delete d->m_texmapper;
     delete d->m_texcolorizer;
@@ -323,7 +334,7 @@ bool TextureLayer::render( GeoPainter *painter, ViewportParams *viewport,
          d->m_centerCoordinates.latitude() != viewport->centerLatitude() ) {
         d->m_centerCoordinates.setLongitude( viewport->centerLongitude() );
         d->m_centerCoordinates.setLatitude( viewport->centerLatitude() );
-        d->m_texmapper->setRepaintNeeded();
+        d->m_texmapper->setCenterChanged();
     }
 
     // choose the smaller dimension for selecting the tile level, leading to higher-resolution results
@@ -376,6 +387,7 @@ void TextureLayer::setShowSunShading( bool show )
                  this,       SLOT(reset()) );
     }
 
+    d->m_tileLoader.waitForPendingTiles();
     d->m_layerDecorator.setShowSunShading( show );
 
     reset();
@@ -383,6 +395,7 @@ void TextureLayer::setShowSunShading( bool show )
 
 void TextureLayer::setShowCityLights( bool show )
 {
+    d->m_tileLoader.waitForPendingTiles();
     d->m_layerDecorator.setShowCityLights( show );
 
     reset();
@@ -390,6 +403,7 @@ void TextureLayer::setShowCityLights( bool show )
 
 void TextureLayer::setShowTileId( bool show )
 {
+    d->m_tileLoader.waitForPendingTiles();
     d->m_layerDecorator.setShowTileId( show );
 
     reset();
@@ -580,6 +594,7 @@ void TextureLayer::removeTextureLayer(const QString &key)
         GeoSceneTextureTileDataset *texture = d->m_customTextures.value(key);
         d->m_customTextures.remove(key);
         d->m_textures.remove(d->m_textures.indexOf(texture));
+        d->m_tileLoader.waitForPendingTiles();
         delete texture;
         d->updateTextureLayers();
     }
@@ -18,7 +18,7 @@
 
 namespace Marble {
 
-qint64 OsmObjectManager::m_minId = -1;
+QAtomicInteger<qint64> OsmObjectManager::m_minId( -1 );
 
 void OsmObjectManager::initializeOsmData( GeoDataPlacemark* placemark )
 {
@@ -119,7 +119,10 @@ void OsmObjectManager::initializeOsmData( GeoDataPlacemark* placemark )
 
 void OsmObjectManager::registerId( qint64 id )
 {
-    m_minId = qMin( id, m_minId );
+    qint64 minId = m_minId.load();
+    while ( id < minId && !m_minId.testAndSetOrdered( minId, id, minId ) ) {
+        // minId was changed by another thread and holds its current value now
+    }
 }
 
 }
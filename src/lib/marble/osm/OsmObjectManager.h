@@ -12,7 +12,7 @@
 #define MARBLE_OSMOBJECTMANAGER_H
 
 #include <marble_export.h>
-#include <QtGlobal>
+#include <QAtomicInteger>
 
 namespace Marble
 {
@@ -44,9 +44,9 @@ private:
     /**
      * @brief newly created placemarks are assigned negative unique IDs.
      * In order to assure there are no duplicate IDs, they are assigned the
-     * minId - 1 id.
+     * minId - 1 id. Placemarks may be written from several threads at once.
      */
-    static qint64 m_minId;
+    static QAtomicInteger<qint64> m_minId;
 };
 
 }
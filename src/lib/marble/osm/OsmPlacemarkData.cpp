@@ -14,7 +14,9 @@
 // Marble
 #include "GeoDataPlacemark.h"
 #include "GeoDataExtendedData.h"
+#include "StringPool.h"
 
+#include <QSet>
 #include <QXmlStreamAttributes>
 
 namespace Marble
@@ -76,7 +78,7 @@ void OsmPlacemarkData::setId( qint64 id )
 
 void OsmPlacemarkData::setVersion( const QString& version )
 {
-    m_version = version;
+    m_version = StringPool::intern( version );
 }
 
 void OsmPlacemarkData::setChangeset( const QString& changeset )
@@ -91,7 +93,7 @@ void OsmPlacemarkData::setUid( const QString& uid )
 
 void OsmPlacemarkData::setVisible( const QString& visible )
 {
-    m_visible = visible;
+    m_visible = StringPool::intern( visible );
 }
 
 void OsmPlacemarkData::setUser( const QString& user )
@@ -106,7 +108,7 @@ void OsmPlacemarkData::setTimestamp( const QString& timestamp )
 
 void OsmPlacemarkData::setAction( const QString& action )
 {
-    m_action = action;
+    m_action = StringPool::intern( action );
 }
 
 
@@ -118,7 +120,18 @@ QString OsmPlacemarkData::tagValue( const QString& key ) const
 
 void OsmPlacemarkData::addTag( const QString& key, const QString& value )
 {
-    m_tags.insert( key, value );
+    // Keys come from a small vocabulary and are repeated in many placemarks.
+    // So are the values of a few keys, the values of all other keys (names,
+    // addresses, references, heights, ...) are mostly unique and not interned
+    // to keep the pool from growing with every loaded document.
+    static const QSet<QString> internedValueKeys = QSet<QString>()
+        << "access" << "admin_level" << "amenity" << "area" << "barrier"
+        << "boundary" << "bridge" << "building" << "highway" << "landuse"
+        << "layer" << "leisure" << "man_made" << "marble_land" << "natural"
+        << "oneway" << "place" << "power" << "railway" << "route" << "service"
+        << "shop" << "surface" << "tourism" << "tunnel" << "type" << "water"
+        << "waterway";
+    m_tags.insert( StringPool::intern( key ), internedValueKeys.contains( key ) ? StringPool::intern( value ) : value );
 }
 
 void OsmPlacemarkData::removeTag( const QString &key )
@@ -245,7 +258,7 @@ QHash< int, OsmPlacemarkData >::const_iterator OsmPlacemarkData::memberReference
 
 void OsmPlacemarkData::addRelation( qint64 id, const QString &role )
 {
-    m_relationReferences.insert( id, role );
+    m_relationReferences.insert( id, StringPool::intern( role ) );
 }
 
 void OsmPlacemarkData::removeRelation( qint64 id )
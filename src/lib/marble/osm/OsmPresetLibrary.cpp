@@ -470,7 +470,7 @@ GeoDataStyle::ConstPtr OsmPresetLibrary::presetStyle( const OsmTag &tag )
 {
     static const StyleBuilder styleBuilder;
 
-    const GeoDataFeature::GeoDataVisualCategory category = osmVisualCategory(tag.first + '=' + tag.second);
+    const GeoDataFeature::GeoDataVisualCategory category = osmVisualCategory(tag);
 
     return styleBuilder.presetStyle(category);
 }
@@ -496,6 +496,12 @@ GeoDataFeature::GeoDataVisualCategory OsmPresetLibrary::osmVisualCategory( const
     return s_visualCategories.value( OsmTag( key, value ) );
 }
 
+GeoDataFeature::GeoDataVisualCategory OsmPresetLibrary::osmVisualCategory( const OsmTag &tag )
+{
+    initializeOsmVisualCategories();
+    return s_visualCategories.value( tag );
+}
+
 QMap<OsmPresetLibrary::OsmTag, GeoDataFeature::GeoDataVisualCategory>::const_iterator OsmPresetLibrary::begin()
 {
     initializeOsmVisualCategories();
@@ -572,10 +578,9 @@ GeoDataFeature::GeoDataVisualCategory OsmPresetLibrary::determineVisualCategory(
     }
 
     for (auto iter = osmData.tagsBegin(), end=osmData.tagsEnd(); iter != end; ++iter) {
-        QString const keyValue = QString("%1=%2").arg(iter.key()).arg(iter.value());
-        GeoDataFeature::GeoDataVisualCategory category = osmVisualCategory(keyValue);
+        GeoDataFeature::GeoDataVisualCategory category = osmVisualCategory(OsmTag(iter.key(), iter.value()));
         if (category != GeoDataFeature::None) {
-            return osmVisualCategory(keyValue);
+            return category;
         }
     }
 
@@ -42,6 +42,11 @@ public:
      */
     static GeoDataFeature::GeoDataVisualCategory osmVisualCategory(const QString &keyValue );
 
+    /**
+     * @brief Convenience categorization of placemarks for the Osm @p tag
+     */
+    static GeoDataFeature::GeoDataVisualCategory osmVisualCategory( const OsmTag &tag );
+
     /**
      * @brief hasVisualCategory returns true if there is a visual category associated with
      * @p tag
@@ -16,6 +16,8 @@ namespace Marble
 {
 
 class AbstractProjection;
+class GeoDataCoordinates;
+class GeoDataLineString;
 
 class AbstractProjectionPrivate
 {
@@ -24,12 +26,18 @@ class AbstractProjectionPrivate
 
     virtual ~AbstractProjectionPrivate() { };
 
-    int levelForResolution(qreal resolution) const;
+    // Stateless, since line strings get projected from several threads at once
+    static int levelForResolution(qreal resolution);
+
+    /**
+     * Sets @p coordinates to the node at @p index of @p lineString. Unlike
+     * GeoDataLineString::at() this reads packed storage directly, so the
+     * line string doesn't need to create its nodes.
+     */
+    static void readNode( const GeoDataLineString &lineString, int index, GeoDataCoordinates &coordinates );
 
     qreal  m_maxLat;
     qreal  m_minLat;
-    mutable qreal  m_previousResolution;
-    mutable qreal  m_level;
 
     AbstractProjection * const q_ptr;
     Q_DECLARE_PUBLIC( AbstractProjection )
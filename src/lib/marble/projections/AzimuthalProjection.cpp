@@ -347,8 +347,15 @@ bool AzimuthalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
 
     polygons.append( new QPolygonF );
 
-    GeoDataLineString::ConstIterator itCoords = lineString.constBegin();
-    GeoDataLineString::ConstIterator itPreviousCoords = lineString.constBegin();
+    // The nodes are read by index into two reused objects, so that line
+    // strings with packed storage don't create an object for each node.
+    const int size = lineString.size();
+    GeoDataCoordinates nodes[2];
+    if ( size > 0 ) {
+        readNode( lineString, 0, nodes[0] );
+    }
+    const GeoDataCoordinates *previousCoords = &nodes[0];
+    int currentNode = 1;
 
     // Some projections display the earth in a way so that there is a
     // foreside and a backside.
@@ -371,35 +378,44 @@ bool AzimuthalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
     bool horizonOrphan = false;
     GeoDataCoordinates horizonOrphanCoords;
 
-    GeoDataLineString::ConstIterator itBegin = lineString.constBegin();
-    GeoDataLineString::ConstIterator itEnd = lineString.constEnd();
-
     bool processingLastNode = false;
 
     // We use a while loop to be able to cover linestrings as well as linear rings:
     // Linear rings require to tessellate the path from the last node to the first node
     // which isn't really convenient to achieve with a for loop ...
 
-    const bool isLong = lineString.size() > 10;
+    const bool isLong = size > 10;
     const int maximumDetail = levelForResolution(viewport->angularResolution());
     // The first node of optimized linestrings has a non-zero detail value.
-    const bool hasDetail = itBegin->detail() != 0;
+    const bool hasDetail = nodes[0].detail() != 0;
+    // Optimized linestrings also know which nodes belong to each detail level,
+    // so the nodes that would be skipped don't need to be visited at all.
+    const bool hasLevelIndices = lineString.hasLevelIndices();
+    const QVector<int> levelIndices = lineString.levelIndices( maximumDetail );
+    int levelIndex = 0;
+    int index = 0;
+    if ( hasLevelIndices ) {
+        index = levelIndices.isEmpty() ? size : levelIndices.first();
+    }
 
-    while ( itCoords != itEnd )
+    while ( index != size )
     {
+        GeoDataCoordinates &coords = nodes[currentNode];
+        readNode( lineString, index, coords );
+
         // Optimization for line strings with a big amount of nodes
-        bool skipNode = (hasDetail ? itCoords->detail() > maximumDetail
-                : itCoords != itBegin && isLong && !processingLastNode &&
-                !viewport->resolves( *itPreviousCoords, *itCoords ) );
+        bool skipNode = (hasDetail ? coords.detail() > maximumDetail
+                : index != 0 && isLong && !processingLastNode &&
+                !viewport->resolves( *previousCoords, coords ) );
 
         if ( !skipNode ) {
 
-            q->screenCoordinates( *itCoords, viewport, x, y, globeHidesPoint );
+            q->screenCoordinates( coords, viewport, x, y, globeHidesPoint );
 
             // Initializing variables that store the values of the previous iteration
-            if ( !processingLastNode && itCoords == itBegin ) {
+            if ( !processingLastNode && index == 0 ) {
                 previousGlobeHidesPoint = globeHidesPoint;
-                itPreviousCoords = itCoords;
+                previousCoords = &coords;
                 previousX = x;
                 previousY = y;
             }
@@ -410,7 +426,7 @@ bool AzimuthalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
 
             if ( isAtHorizon ) {
                 // Handle the "horizon case"
-                horizonCoords = findHorizon( *itPreviousCoords, *itCoords, viewport, f );
+                horizonCoords = findHorizon( *previousCoords, coords, viewport, f );
 
                 if ( lineString.isClosed() ) {
                     if ( horizonPair ) {
@@ -446,8 +462,8 @@ bool AzimuthalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
 
                 if ( !isAtHorizon ) {
 
-                    tessellateLineSegment( *itPreviousCoords, previousX, previousY,
-                                           *itCoords, x, y,
+                    tessellateLineSegment( *previousCoords, previousX, previousY,
+                                           coords, x, y,
                                            polygons, viewport,
                                            f, !lineString.isClosed() );
 
@@ -457,12 +473,12 @@ bool AzimuthalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
                     // current or previous point in the line.
                     if ( previousGlobeHidesPoint ) {
                         tessellateLineSegment( horizonCoords, horizonX, horizonY,
-                                               *itCoords, x, y,
+                                               coords, x, y,
                                                polygons, viewport,
                                                f, !lineString.isClosed() );
                     }
                     else {
-                        tessellateLineSegment( *itPreviousCoords, previousX, previousY,
+                        tessellateLineSegment( *previousCoords, previousX, previousY,
                                                horizonCoords, horizonX, horizonY,
                                                polygons, viewport,
                                                f, !lineString.isClosed() );
@@ -489,7 +505,8 @@ bool AzimuthalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
             }
 
             previousGlobeHidesPoint = globeHidesPoint;
-            itPreviousCoords = itCoords;
+            previousCoords = &coords;
+            currentNode = 1 - currentNode;
             previousX = x;
             previousY = y;
         }
@@ -500,10 +517,15 @@ bool AzimuthalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
         if ( processingLastNode ) {
             break;
         }
-        ++itCoords;
+        if ( hasLevelIndices ) {
+            ++levelIndex;
+            index = levelIndex < levelIndices.size() ? levelIndices[levelIndex] : size;
+        } else {
+            ++index;
+        }
 
-        if ( itCoords == itEnd  && lineString.isClosed() ) {
-            itCoords = itBegin;
+        if ( index == size  && lineString.isClosed() ) {
+            index = 0;
             processingLastNode = true;
         }
     }
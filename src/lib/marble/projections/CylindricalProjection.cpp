@@ -246,10 +246,19 @@ int CylindricalProjectionPrivate::crossDateLine( const GeoDataCoordinates & aCoo
                                                  int mirrorCount,
                                                  qreal repeatDistance )
 {
-    qreal aLon = aCoord.longitude();
+    return crossDateLine( aCoord.longitude(), bCoord.longitude(), bx, by, polygons, mirrorCount, repeatDistance );
+}
+
+int CylindricalProjectionPrivate::crossDateLine( qreal aLon,
+                                                 qreal bLon,
+                                                 qreal bx,
+                                                 qreal by,
+                                                 QVector<QPolygonF*> &polygons,
+                                                 int mirrorCount,
+                                                 qreal repeatDistance )
+{
     qreal aSign = aLon > 0 ? 1 : -1;
 
-    qreal bLon = bCoord.longitude();
     qreal bSign = bLon > 0 ? 1 : -1;
 
     qreal delta = 0;
@@ -269,6 +278,12 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
 {
     const TessellationFlags f = lineString.tessellationFlags();
 
+    bool isStraight = lineString.latLonAltBox().height() == 0 || lineString.latLonAltBox().width() == 0;
+
+    if ( lineString.hasPackedStorage() && !( lineString.tessellate() && !isStraight ) ) {
+        return packedLineStringToPolygon( lineString, viewport, polygons );
+    }
+
     qreal x = 0;
     qreal y = 0;
 
@@ -280,11 +295,15 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
 
     polygons.append( new QPolygonF );
 
-    GeoDataLineString::ConstIterator itCoords = lineString.constBegin();
-    GeoDataLineString::ConstIterator itPreviousCoords = lineString.constBegin();
-
-    GeoDataLineString::ConstIterator itBegin = lineString.constBegin();
-    GeoDataLineString::ConstIterator itEnd = lineString.constEnd();
+    // The nodes are read by index into two reused objects, so that line
+    // strings with packed storage don't create an object for each node.
+    const int size = lineString.size();
+    GeoDataCoordinates nodes[2];
+    if ( size > 0 ) {
+        readNode( lineString, 0, nodes[0] );
+    }
+    const GeoDataCoordinates *previousCoords = &nodes[0];
+    int currentNode = 1;
 
     bool processingLastNode = false;
 
@@ -292,30 +311,40 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
     // Linear rings require to tessellate the path from the last node to the first node
     // which isn't really convenient to achieve with a for loop ...
 
-    const bool isLong = lineString.size() > 10;
+    const bool isLong = size > 10;
     const int maximumDetail = levelForResolution(viewport->angularResolution());
     // The first node of optimized linestrings has a non-zero detail value.
-    const bool hasDetail = itBegin->detail() != 0;
-
-    bool isStraight = lineString.latLonAltBox().height() == 0 || lineString.latLonAltBox().width() == 0;
+    const bool hasDetail = nodes[0].detail() != 0;
+    // Optimized linestrings also know which nodes belong to each detail level,
+    // so the nodes that would be skipped don't need to be visited at all.
+    const bool hasLevelIndices = lineString.hasLevelIndices();
+    const QVector<int> levelIndices = lineString.levelIndices( maximumDetail );
+    int levelIndex = 0;
+    int index = 0;
+    if ( hasLevelIndices ) {
+        index = levelIndices.isEmpty() ? size : levelIndices.first();
+    }
 
-    while ( itCoords != itEnd )
+    while ( index != size )
     {
+        GeoDataCoordinates &coords = nodes[currentNode];
+        readNode( lineString, index, coords );
+
         // Optimization for line strings with a big amount of nodes
-        bool skipNode = (hasDetail ? itCoords->detail() > maximumDetail
-                : itCoords != itBegin && isLong && !processingLastNode &&
-                !viewport->resolves( *itPreviousCoords, *itCoords ) );
+        bool skipNode = (hasDetail ? coords.detail() > maximumDetail
+                : index != 0 && isLong && !processingLastNode &&
+                !viewport->resolves( *previousCoords, coords ) );
 
         if ( !skipNode ) {
 
 
             Q_Q( const CylindricalProjection );
 
-            q->screenCoordinates( *itCoords, viewport, x, y );
+            q->screenCoordinates( coords, viewport, x, y );
 
             // Initializing variables that store the values of the previous iteration
-            if ( !processingLastNode && itCoords == itBegin ) {
-                itPreviousCoords = itCoords;
+            if ( !processingLastNode && index == 0 ) {
+                previousCoords = &coords;
                 previousX = x;
                 previousY = y;
             }
@@ -326,8 +355,8 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
 
             if ( lineString.tessellate() && !isStraight) {
 
-                mirrorCount = tessellateLineSegment( *itPreviousCoords, previousX, previousY,
-                                           *itCoords, x, y,
+                mirrorCount = tessellateLineSegment( *previousCoords, previousX, previousY,
+                                           coords, x, y,
                                            polygons, viewport,
                                            f, mirrorCount, distance );
             }
@@ -336,10 +365,11 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
                 // special case for polys which cross dateline but have no Tesselation Flag
                 // the expected rendering is a screen coordinates straight line between
                 // points, but in projections with repeatX things are not smooth
-                mirrorCount = crossDateLine( *itPreviousCoords, *itCoords, x, y, polygons, mirrorCount, distance );
+                mirrorCount = crossDateLine( *previousCoords, coords, x, y, polygons, mirrorCount, distance );
             }
 
-            itPreviousCoords = itCoords;
+            previousCoords = &coords;
+            currentNode = 1 - currentNode;
             previousX = x;
             previousY = y;
         }
@@ -350,10 +380,15 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
         if ( processingLastNode ) {
             break;
         }
-        ++itCoords;
+        if ( hasLevelIndices ) {
+            ++levelIndex;
+            index = levelIndex < levelIndices.size() ? levelIndices[levelIndex] : size;
+        } else {
+            ++index;
+        }
 
-        if ( itCoords == itEnd  && lineString.isClosed() ) {
-            itCoords = itBegin;
+        if ( index == size  && lineString.isClosed() ) {
+            index = 0;
             processingLastNode = true;
         }
     }
@@ -388,6 +423,77 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
     return polygons.isEmpty();
 }
 
+bool CylindricalProjectionPrivate::packedLineStringToPolygon( const GeoDataLineString &lineString,
+                                                             const ViewportParams *viewport,
+                                                             QVector<QPolygonF *> &polygons ) const
+{
+    Q_Q( const CylindricalProjection );
+
+    const QVector<qreal> &longitudes = lineString.packedLongitudes();
+    const QVector<qreal> &latitudes = lineString.packedLatitudes();
+    const QVector<quint8> &details = lineString.packedDetails();
+    const int size = longitudes.size();
+
+    qreal x = 0;
+    qreal y = 0;
+
+    int mirrorCount = 0;
+    qreal distance = repeatDistance( viewport );
+
+    polygons.append( new QPolygonF );
+    polygons.last()->reserve( size );
+
+    if ( size == 0 ) {
+        return false;
+    }
+
+    const bool isLong = size > 10;
+    const int maximumDetail = levelForResolution(viewport->angularResolution());
+    const qreal angularResolution = viewport->angularResolution();
+    // The first node of optimized linestrings has a non-zero detail value.
+    const bool hasDetail = !details.isEmpty() && details[0] != 0;
+    // Optimized linestrings also know which nodes belong to each detail level
+    const bool hasLevelIndices = lineString.hasLevelIndices();
+    const QVector<int> levelIndices = lineString.levelIndices( maximumDetail );
+    const int nodeCount = hasLevelIndices ? levelIndices.size() : size;
+
+    // A single node object is reused for all nodes to feed the projection,
+    // which avoids creating a GeoDataCoordinates object per node
+    GeoDataCoordinates coordinates;
+    int previous = 0;
+
+    // Linear rings process the first node again after the last node
+    const int count = lineString.isClosed() ? nodeCount + 1 : nodeCount;
+    for ( int j = 0; j < count; ++j ) {
+        const bool processingLastNode = j == nodeCount;
+        const int i = processingLastNode ? 0 : ( hasLevelIndices ? levelIndices[j] : j );
+
+        // Optimization for line strings with a big amount of nodes,
+        // see ViewportParams::resolves()
+        bool skipNode = (hasDetail ? details[i] > maximumDetail
+                : j != 0 && isLong && !processingLastNode &&
+                fabs( longitudes[i] - longitudes[previous] ) + fabs( latitudes[i] - latitudes[previous] ) <= angularResolution );
+
+        if ( skipNode ) {
+            continue;
+        }
+
+        coordinates.set( longitudes[i], latitudes[i] );
+        q->screenCoordinates( coordinates, viewport, x, y );
+
+        // special case for polys which cross dateline but have no Tesselation Flag
+        // the expected rendering is a screen coordinates straight line between
+        // points, but in projections with repeatX things are not smooth
+        mirrorCount = crossDateLine( longitudes[previous], longitudes[i], x, y, polygons, mirrorCount, distance );
+
+        previous = i;
+    }
+
+    repeatPolygons( viewport, polygons );
+
+    return polygons.isEmpty();
+}
+
 void CylindricalProjectionPrivate::translatePolygons( const QVector<QPolygonF *> &polygons,
                                                       QVector<QPolygonF *> &translatedPolygons,
                                                       qreal xOffset )
@@ -58,10 +58,24 @@ class CylindricalProjectionPrivate : public AbstractProjectionPrivate
                               int mirrorCount = 0,
                               qreal repeatDistance = 0 );
 
+    static int crossDateLine( qreal aLon,
+                              qreal bLon,
+                              qreal bx,
+                              qreal by,
+                              QVector<QPolygonF*> &polygons,
+                              int mirrorCount = 0,
+                              qreal repeatDistance = 0 );
+
     bool lineStringToPolygon( const GeoDataLineString &lineString,
                               const ViewportParams *viewport,
                               QVector<QPolygonF*> &polygons ) const;
 
+    // Same as lineStringToPolygon() for line strings with packed storage
+    // which don't get tessellated. Reads the packed arrays directly.
+    bool packedLineStringToPolygon( const GeoDataLineString &lineString,
+                                    const ViewportParams *viewport,
+                                    QVector<QPolygonF*> &polygons ) const;
+
     static void translatePolygons( const QVector<QPolygonF *> &polygons,
                                    QVector<QPolygonF *> &translatedPolygons,
                                    qreal xOffset );
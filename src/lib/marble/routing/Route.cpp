@@ -10,9 +10,245 @@
 
 #include "Route.h"
 
+#include "MarbleMath.h"
+
+#include <QPair>
+#include <QtAlgorithms>
+
 namespace Marble
 {
 
+/**
+  * A uniform grid over the edges of a route path. Each cell references the
+  * edges passing through it, which limits the distance calculations of a
+  * position update to the neighborhood of the position.
+  */
+class RouteIndex
+{
+public:
+    explicit RouteIndex( const QVector<RouteSegment> &segments );
+
+    /**
+      * Determines the segment which is closest to @p position, using the same
+      * metric as RouteSegment::distanceTo(). Ties are resolved in favor of
+      * @p preferredSegment. Returns the distance or -1.0 if there are no edges.
+      */
+    qreal closestSegment( const QVector<RouteSegment> &segments, const GeoDataCoordinates &position,
+                          int preferredSegment, int &segment,
+                          GeoDataCoordinates &closest, GeoDataCoordinates &interpolated ) const;
+
+private:
+    /** The edge ending at path()[point] of a segment, or the single point of a segment if point is 0 */
+    struct Edge
+    {
+        int segment;
+        int point;
+    };
+
+    void addCells( int edge, const GeoDataCoordinates &a, const GeoDataCoordinates &b,
+                   QVector<QPair<int, int> > &cells ) const;
+
+    static qreal distanceTo( const GeoDataLineString &path, int point, const GeoDataCoordinates &position );
+
+    QVector<Edge> m_edges;
+
+    /** The edges of cell i are m_cellEdges[m_cellOffsets[i]] ... m_cellEdges[m_cellOffsets[i+1]-1] */
+    QVector<int> m_cellOffsets;
+
+    QVector<int> m_cellEdges;
+
+    qreal m_west;
+
+    qreal m_south;
+
+    qreal m_north;
+
+    qreal m_cellSize;
+
+    int m_columns;
+
+    int m_rows;
+};
+
+RouteIndex::RouteIndex( const QVector<RouteSegment> &segments ) :
+    m_west( 0.0 ),
+    m_south( 0.0 ),
+    m_north( 0.0 ),
+    m_cellSize( 1.0 ),
+    m_columns( 0 ),
+    m_rows( 0 )
+{
+    qreal east = 0.0;
+    for ( int i=0; i<segments.size(); ++i ) {
+        const GeoDataLineString &path = segments[i].path();
+        for ( int j=0; j<path.size(); ++j ) {
+            if ( j > 0 || path.size() == 1 ) {
+                Edge const edge = { i, j };
+                m_edges << edge;
+            }
+
+            qreal const lon = path[j].longitude();
+            qreal const lat = path[j].latitude();
+            if ( i == 0 && j == 0 ) {
+                m_west = east = lon;
+                m_south = m_north = lat;
+            } else {
+                m_west = qMin( m_west, lon );
+                east = qMax( east, lon );
+                m_south = qMin( m_south, lat );
+                m_north = qMax( m_north, lat );
+            }
+        }
+    }
+
+    if ( m_edges.isEmpty() ) {
+        return;
+    }
+
+    // Square cells, roughly one per edge and at most 1024 in each direction
+    qreal const width = east - m_west;
+    qreal const height = m_north - m_south;
+    m_cellSize = qMax( qMax( width, height ) / 1024.0, sqrt( width * height / m_edges.size() ) );
+    m_cellSize = qMax<qreal>( m_cellSize, 1e-6 );
+    m_columns = int( width / m_cellSize ) + 1;
+    m_rows = int( height / m_cellSize ) + 1;
+
+    QVector<QPair<int, int> > cells;
+    cells.reserve( 2 * m_edges.size() );
+    for ( int i=0; i<m_edges.size(); ++i ) {
+        const GeoDataLineString &path = segments[m_edges[i].segment].path();
+        int const point = m_edges[i].point;
+        addCells( i, path[point == 0 ? 0 : point-1], path[point], cells );
+    }
+    qSort( cells.begin(), cells.end() );
+
+    m_cellOffsets.fill( 0, m_columns * m_rows + 1 );
+    m_cellEdges.reserve( cells.size() );
+    for ( int i=0; i<cells.size(); ++i ) {
+        if ( i > 0 && cells[i] == cells[i-1] ) {
+            continue;
+        }
+        ++m_cellOffsets[cells[i].first+1];
+        m_cellEdges << cells[i].second;
+    }
+    for ( int i=1; i<m_cellOffsets.size(); ++i ) {
+        m_cellOffsets[i] += m_cellOffsets[i-1];
+    }
+}
+
+void RouteIndex::addCells( int edge, const GeoDataCoordinates &a, const GeoDataCoordinates &b,
+                           QVector<QPair<int, int> > &cells ) const
+{
+    // Walk along the edge in pieces no longer than a cell, so that long
+    // diagonal edges don't fill their whole bounding box
+    qreal const lonA = a.longitude() - m_west;
+    qreal const latA = a.latitude() - m_south;
+    qreal const deltaLon = b.longitude() - a.longitude();
+    qreal const deltaLat = b.latitude() - a.latitude();
+    int const pieces = qMax( 1, int( qMax( qAbs( deltaLon ), qAbs( deltaLat ) ) / m_cellSize ) + 1 );
+
+    for ( int i=0; i<pieces; ++i ) {
+        qreal const lon1 = lonA + deltaLon * i / pieces;
+        qreal const lon2 = lonA + deltaLon * ( i + 1 ) / pieces;
+        qreal const lat1 = latA + deltaLat * i / pieces;
+        qreal const lat2 = latA + deltaLat * ( i + 1 ) / pieces;
+        int const left = qBound( 0, int( qMin( lon1, lon2 ) / m_cellSize ), m_columns - 1 );
+        int const right = qBound( 0, int( qMax( lon1, lon2 ) / m_cellSize ), m_columns - 1 );
+        int const bottom = qBound( 0, int( qMin( lat1, lat2 ) / m_cellSize ), m_rows - 1 );
+        int const top = qBound( 0, int( qMax( lat1, lat2 ) / m_cellSize ), m_rows - 1 );
+        for ( int row = bottom; row <= top; ++row ) {
+            for ( int column = left; column <= right; ++column ) {
+                cells << qMakePair( row * m_columns + column, edge );
+            }
+        }
+    }
+}
+
+qreal RouteIndex::distanceTo( const GeoDataLineString &path, int point, const GeoDataCoordinates &position )
+{
+    GeoDataCoordinates const &b = path[point];
+    if ( point == 0 ) {
+        return EARTH_RADIUS * distanceSphere( b, position );
+    }
+
+    GeoDataCoordinates const &a = path[point-1];
+    if ( a.longitude() == b.longitude() && a.latitude() == b.latitude() ) {
+        return EARTH_RADIUS * distanceSphere( b, position );
+    }
+
+    return RouteSegment::distancePointToLine( position, a, b );
+}
+
+qreal RouteIndex::closestSegment( const QVector<RouteSegment> &segments, const GeoDataCoordinates &position,
+                                  int preferredSegment, int &segment,
+                                  GeoDataCoordinates &closest, GeoDataCoordinates &interpolated ) const
+{
+    if ( m_edges.isEmpty() ) {
+        return -1.0;
+    }
+
+    qreal const lon = position.longitude() - m_west;
+    qreal const lat = position.latitude() - m_south;
+    int const column = lon < 0.0 ? 0 : int( qMin<qreal>( lon / m_cellSize, m_columns - 1 ) );
+    int const row = lat < 0.0 ? 0 : int( qMin<qreal>( lat / m_cellSize, m_rows - 1 ) );
+    int const maxRing = qMax( qMax( column, m_columns - 1 - column ), qMax( row, m_rows - 1 - row ) );
+
+    // Cells in ring r are at least (r-1) cells away in longitude or latitude.
+    // A latitude difference is a lower bound for the distance. The great
+    // circle distance across a longitude difference shrinks towards the poles
+    // and is bounded from below by 2/pi * cos(latitude) of the difference.
+    qreal const maxLatitude = qMin( qMax( qMax( qAbs( m_north ), qAbs( m_south ) ), qAbs( position.latitude() ) ), 89.0 * DEG2RAD );
+    qreal const ringDistance = EARTH_RADIUS * m_cellSize * 2.0 / M_PI * cos( maxLatitude );
+
+    qreal minDistance = -1.0;
+    int minEdge = -1;
+    for ( int ring = 0; ring <= maxRing; ++ring ) {
+        if ( minDistance >= 0.0 && ( ring - 1 ) * ringDistance > minDistance ) {
+            break;
+        }
+
+        for ( int y = qMax( 0, row - ring ); y <= qMin( m_rows - 1, row + ring ); ++y ) {
+            bool const fullRow = qAbs( y - row ) == ring;
+            int const step = fullRow ? 1 : qMax( 1, 2 * ring );
+            for ( int x = column - ring; x <= column + ring; x += step ) {
+                if ( x < 0 || x >= m_columns ) {
+                    continue;
+                }
+
+                int const cell = y * m_columns + x;
+                for ( int i = m_cellOffsets[cell]; i < m_cellOffsets[cell+1]; ++i ) {
+                    int const edge = m_cellEdges[i];
+                    Edge const &candidate = m_edges[edge];
+                    qreal const distance = distanceTo( segments[candidate.segment].path(), candidate.point, position );
+                    bool better = minDistance < 0.0 || distance < minDistance;
+                    if ( !better && distance == minDistance ) {
+                        // prefer the current segment, otherwise the first edge along the route
+                        bool const preferred = candidate.segment == preferredSegment;
+                        bool const minPreferred = m_edges[minEdge].segment == preferredSegment;
+                        better = preferred != minPreferred ? preferred : edge < minEdge;
+                    }
+                    if ( better ) {
+                        minDistance = distance;
+                        minEdge = edge;
+                    }
+                }
+            }
+        }
+    }
+
+    Edge const &edge = m_edges[minEdge];
+    const GeoDataLineString &path = segments[edge.segment].path();
+    segment = edge.segment;
+    closest = path[edge.point];
+    if ( edge.point == 0 || ( path[edge.point-1].longitude() == closest.longitude() && path[edge.point-1].latitude() == closest.latitude() ) ) {
+        interpolated = closest;
+    } else {
+        interpolated = RouteSegment::projected( position, path[edge.point-1], closest );
+    }
+
+    return minDistance;
+}
+
 Route::Route() :
     m_distance( 0.0 ),
     m_travelTime( 0 ),
@@ -36,6 +272,7 @@ void Route::addRouteSegment( const RouteSegment &segment )
         }
         m_segments.push_back( segment );
         m_positionDirty = true;
+        m_index.clear();
 
         for ( int i=1; i<m_segments.size(); ++i ) {
             m_segments[i-1].setNextRouteSegment(&m_segments[i]);
@@ -99,9 +336,23 @@ GeoDataCoordinates Route::position() const
     return m_position;
 }
 
+void Route::buildIndex()
+{
+    m_index = QSharedPointer<const RouteIndex>( new RouteIndex( m_segments ) );
+    m_positionDirty = true;
+}
+
 void Route::updatePosition() const
 {
-    if ( !m_segments.isEmpty() ) {
+    if ( m_index ) {
+        int segment = -1;
+        GeoDataCoordinates closest, interpolated;
+        if ( m_index->closestSegment( m_segments, m_position, m_closestSegmentIndex, segment, closest, interpolated ) >= 0.0 ) {
+            m_closestSegmentIndex = segment;
+            m_currentWaypoint = closest;
+            m_positionOnRoute = interpolated;
+        }
+    } else if ( !m_segments.isEmpty() ) {
         if ( m_closestSegmentIndex < 0 || m_closestSegmentIndex >= m_segments.size() ) {
             m_closestSegmentIndex = 0;
         }
@@ -14,9 +14,13 @@
 #include "RouteSegment.h"
 #include "GeoDataLatLonBox.h"
 
+#include <QSharedPointer>
+
 namespace Marble
 {
 
+class RouteIndex;
+
 class MARBLE_EXPORT Route
 {
 public:
@@ -52,6 +56,14 @@ public:
 
     GeoDataCoordinates positionOnRoute() const;
 
+    /**
+      * Builds a spatial index over the route path that is used to look up
+      * the current segment and the position on the route. Without it, each
+      * position update compares the position with all points of the route.
+      * Adding segments discards the index.
+      */
+    void buildIndex();
+
 private:
     void updatePosition() const;
 
@@ -78,6 +90,8 @@ private:
     mutable GeoDataCoordinates m_currentWaypoint;
 
     GeoDataCoordinates m_position;
+
+    QSharedPointer<const RouteIndex> m_index;
 };
 
 }
@@ -58,6 +58,8 @@ public:
     bool operator!=( const RouteSegment &other ) const;
 
 private:
+    friend class RouteIndex;
+
     static qreal distancePointToLine(const GeoDataCoordinates &p, const GeoDataCoordinates &a, const GeoDataCoordinates &b);
 
     static GeoDataCoordinates projected(const GeoDataCoordinates &p, const GeoDataCoordinates &a, const GeoDataCoordinates &b);
@@ -162,6 +162,7 @@ QHash<int, QByteArray> RoutingModel::roleNames() const
 void RoutingModel::setRoute( const Route &route )
 {
     d->m_route = route;
+    d->m_route.buildIndex();
     d->m_deviation = RoutingModelPrivate::Unknown;
 
     beginResetModel();
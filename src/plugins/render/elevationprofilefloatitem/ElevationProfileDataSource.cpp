@@ -41,10 +41,11 @@ QList<QPointF> ElevationProfileDataSource::calculateElevationData( const GeoData
     // TODO: Don't re-calculate the whole route if only a small part of it was changed
     QList<QPointF> result;
     qreal distance = 0;
+    const QVector<qreal> elevations = getElevations( lineString );
 
     //GeoDataLineString path;
     for ( int i = 0; i < lineString.size(); i++ ) {
-        const qreal ele = getElevation( lineString[i] );
+        const qreal ele = elevations[i];
 
         if ( i ) {
             distance += EARTH_RADIUS * distanceSphere( lineString[i-1], lineString[i] );
@@ -107,9 +108,14 @@ bool ElevationProfileTrackDataSource::isDataAvailable() const
     return !m_trackHash.isEmpty();
 }
 
-qreal ElevationProfileTrackDataSource::getElevation(const GeoDataCoordinates &coordinates) const
+QVector<qreal> ElevationProfileTrackDataSource::getElevations(const GeoDataLineString &lineString) const
 {
-    return coordinates.altitude();
+    QVector<qreal> result;
+    result.reserve( lineString.size() );
+    for ( int i = 0; i < lineString.size(); ++i ) {
+        result << lineString[i].altitude();
+    }
+    return result;
 }
 
 void ElevationProfileTrackDataSource::handleObjectAdded(GeoDataObject *object)
@@ -235,12 +241,11 @@ bool ElevationProfileRouteDataSource::isDataAvailable() const
     return m_routingModel && m_routingModel->rowCount() > 0;
 }
 
-qreal ElevationProfileRouteDataSource::getElevation(const GeoDataCoordinates &coordinates) const
+QVector<qreal> ElevationProfileRouteDataSource::getElevations(const GeoDataLineString &lineString) const
 {
-    const qreal lat = coordinates.latitude ( GeoDataCoordinates::Degree );
-    const qreal lon = coordinates.longitude( GeoDataCoordinates::Degree );
-    qreal ele = m_elevationModel->height( lon, lat );
-    return ele;
+    // Missing elevation tiles are loaded in the background, the profile gets
+    // updated through ElevationModel::updateAvailable() once they are there
+    return m_elevationModel->heights( lineString );
 }
 // end of impl of ElevationProfileRouteDataSource
 
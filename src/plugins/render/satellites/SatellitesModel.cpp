@@ -33,7 +33,47 @@ SatellitesModel::SatellitesModel( GeoDataTreeModel *treeModel,
       m_currentColorIndex( 0 )
 {
     setupColors();
-    connect(m_clock, SIGNAL(timeChanged()), this, SLOT(update()));
+    connect(m_clock, SIGNAL(timeChanged()), this, SLOT(updateSatellites()));
+}
+
+void SatellitesModel::clear()
+{
+    TrackerPluginModel::clear();
+    m_propagator.clear();
+}
+
+void SatellitesModel::updateSatellites()
+{
+    QVector<SatellitesTLEItem *> tleItems;
+    foreach( TrackerPluginItem *item, items() ) {
+        SatellitesTLEItem *tleItem = dynamic_cast<SatellitesTLEItem*>( item );
+        if( tleItem != NULL ) {
+            tleItems << tleItem;
+        } else {
+            item->update();
+        }
+    }
+
+    updateTLEItems( tleItems );
+}
+
+void SatellitesModel::updateTLEItems( const QVector<SatellitesTLEItem *> &items )
+{
+    QVector<SatellitesTLEPropagator::Position> positions;
+    QVector<int> offsets;
+    offsets.reserve( items.size() + 1 );
+    foreach( SatellitesTLEItem *item, items ) {
+        offsets << positions.size();
+        item->requestPositions( positions );
+    }
+    offsets << positions.size();
+
+    m_propagator.propagate( positions );
+
+    const SatellitesTLEPropagator::Position *data = positions.constData();
+    for( int i = 0; i < items.size(); ++i ) {
+        items[i]->addPositions( data + offsets[i], data + offsets[i + 1] );
+    }
 }
 
 void SatellitesModel::setupColors()
@@ -90,6 +130,8 @@ void SatellitesModel::updateVisibility()
 {
     beginUpdateItems();
 
+    QVector<SatellitesTLEItem *> tleItems;
+
     foreach( TrackerPluginItem *obj, items() ) {
         SatellitesMSCItem *oItem = dynamic_cast<SatellitesMSCItem*>(obj);
         if( oItem != NULL ) {
@@ -109,11 +151,13 @@ void SatellitesModel::updateVisibility()
             eItem->setEnabled( enabled );
 
             if( enabled ) {
-                eItem->update();
+                tleItems << eItem;
             }
         }
     }
 
+    updateTLEItems( tleItems );
+
     endUpdateItems();
 }
 
@@ -248,7 +292,8 @@ void SatellitesModel::parseTLE( const QString &id,
             return;
         }
 
-        SatellitesTLEItem *item = new SatellitesTLEItem( satelliteName, satrec, m_clock );
+        const int satellite = m_propagator.addSatellite( satrec );
+        SatellitesTLEItem *item = new SatellitesTLEItem( satelliteName, &m_propagator, satellite, m_clock );
         GeoDataStyle::Ptr style(new GeoDataStyle( *item->placemark()->style() ));
         style->lineStyle().setPenStyle( Qt::SolidLine );
         style->lineStyle().setColor( nextColor() );
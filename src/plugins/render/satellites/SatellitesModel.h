@@ -15,12 +15,14 @@
 #include <QVector>
 
 #include "TrackerPluginModel.h"
+#include "SatellitesTLEPropagator.h"
 
 class QVariant;
 
 namespace Marble {
 
 class MarbleClock;
+class SatellitesTLEItem;
 
 /**
  * The model for satellites.
@@ -38,6 +40,8 @@ public:
 
     void parseFile( const QString &id, const QByteArray &file );
 
+    void clear();
+
 protected:
     /**
      * Parse the Marble Satellite Catalog @p id with content @p data.
@@ -50,12 +54,21 @@ protected:
      */
     void parseTLE( const QString &id, const QByteArray &data );
 
+private Q_SLOTS:
+    void updateSatellites();
+
 private:
     void setupColors();
     QColor nextColor();
 
+    /**
+     * Updates the TLE @p items, calculating the positions of all of them in one batch.
+     */
+    void updateTLEItems( const QVector<SatellitesTLEItem *> &items );
+
 private:
     const MarbleClock *m_clock;
+    SatellitesTLEPropagator m_propagator;
     QStringList m_enabledIds;
     QString m_lcPlanet;
     QVector<QColor> m_colorList;
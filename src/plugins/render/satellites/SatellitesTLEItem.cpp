@@ -19,8 +19,6 @@
 #include "GeoDataStyle.h"
 #include "GeoDataTrack.h"
 
-#include <sgp4ext.h>
-
 #include <QFile>
 #include <QDateTime>
 #include <QAction>
@@ -33,18 +31,15 @@ namespace Marble {
 #include "GeoDataPoint.h"
 
 SatellitesTLEItem::SatellitesTLEItem( const QString &name,
-                                      elsetrec satrec,
+                                      SatellitesTLEPropagator *propagator,
+                                      int satellite,
                                       const MarbleClock *clock )
     : TrackerPluginItem( name ),
-      m_satrec( satrec ),
+      m_propagator( propagator ),
+      m_satellite( satellite ),
       m_track( new GeoDataTrack() ),
       m_clock( clock )
 {
-    double tumin, mu, xke, j2, j3, j4, j3oj2;
-    double radiusearthkm;
-    getgravconst( wgs84, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2 );
-    m_earthSemiMajorAxis = radiusearthkm;
-
     setDescription();
 
     placemark()->setVisualCategory( GeoDataFeature::Satellite );
@@ -64,7 +59,7 @@ void SatellitesTLEItem::setDescription()
     QString html = templateFile.readAll();
 
     html.replace("%name%", name());
-    html.replace("%noradId%", QString::number(m_satrec.satnum));
+    html.replace("%noradId%", QString::number(satrec().satnum));
     html.replace("%perigee%", QString::number(perigee(), 'f', 2));
     html.replace("%apogee%", QString::number(apogee(), 'f', 2));
     html.replace("%inclination%", QString::number(inclination(), 'f', 2));
@@ -75,12 +70,21 @@ void SatellitesTLEItem::setDescription()
 }
 
 void SatellitesTLEItem::update()
+{
+    QVector<SatellitesTLEPropagator::Position> positions;
+    requestPositions( positions );
+    m_propagator->propagate( positions );
+    addPositions( positions.constData(), positions.constData() + positions.size() );
+}
+
+void SatellitesTLEItem::requestPositions( QVector<SatellitesTLEPropagator::Position> &positions )
 {
     if( !isEnabled() ) {
         return;
     }
 
-    QDateTime startTime = m_clock->dateTime();
+    const QDateTime now = m_clock->dateTime();
+    QDateTime startTime = now;
     QDateTime endTime = startTime;
     if( isTrackVisible() ) {
         startTime = startTime.addSecs( -2 * 60 );
@@ -90,122 +94,80 @@ void SatellitesTLEItem::update()
     m_track->removeBefore( startTime );
     m_track->removeAfter( endTime );
 
-    addPointAt( m_clock->dateTime() );
+    SatellitesTLEPropagator::Position position;
+    position.satellite = m_satellite;
+    position.valid = false;
+    position.time = now.toTime_t();
+    positions.append( position );
+
+    // The interval covered by the track, including the current position
+    double first = position.time;
+    double last = position.time;
+    if ( m_track->size() > 0 ) {
+        first = qMin<double>( first, m_track->firstWhen().toTime_t() );
+        last = qMax<double>( last, m_track->lastWhen().toTime_t() );
+    }
 
     // time interval between each point in the track, in seconds
     double step = period() / 100.0;
+    double end = endTime.toTime_t();
+    bool skipped = false;
 
-    for ( double i = startTime.toTime_t(); i < endTime.toTime_t(); i += step ) {
+    for ( double i = startTime.toTime_t(); i < end; i += step ) {
         // No need to add points in this interval
-        if ( i >= m_track->firstWhen().toTime_t() ) {
-            i = m_track->lastWhen().toTime_t() + step;
+        if ( !skipped && i >= first ) {
+            i = last + step;
+            skipped = true;
+            if ( i >= end ) {
+                break;
+            }
         }
 
-        addPointAt( QDateTime::fromTime_t( i ) );
+        position.time = i;
+        positions.append( position );
     }
 }
 
-void SatellitesTLEItem::addPointAt( const QDateTime &dateTime )
+void SatellitesTLEItem::addPositions( const SatellitesTLEPropagator::Position *begin,
+                                      const SatellitesTLEPropagator::Position *end )
 {
-    // in minutes
-    double timeSinceEpoch = (double)( dateTime.toTime_t() -
-        timeAtEpoch().toTime_t() ) / 60.0;
-
-    double r[3], v[3];
-    sgp4( wgs84, m_satrec, timeSinceEpoch, r, v );
-
-    GeoDataCoordinates coordinates = fromTEME(
-        r[0], r[1], r[2], gmst( timeSinceEpoch ) );
-    if ( m_satrec.error != 0 ) {
-        return;
+    for ( const SatellitesTLEPropagator::Position *position = begin; position != end; ++position ) {
+        if ( position->valid ) {
+            m_track->addPoint( QDateTime::fromTime_t( position->time ), position->coordinates );
+        }
     }
-
-    m_track->addPoint( dateTime, coordinates);
 }
 
-QDateTime SatellitesTLEItem::timeAtEpoch() const
+const elsetrec &SatellitesTLEItem::satrec() const
 {
-    int year = m_satrec.epochyr + ( m_satrec.epochyr < 57 ? 2000 : 1900 );
-
-    int month, day, hours, minutes;
-    double seconds;
-    days2mdhms( year, m_satrec.epochdays, month, day, hours , minutes, seconds );
-
-    int ms = fmod(seconds * 1000.0, 1000.0);
-
-    return QDateTime( QDate( year, month, day ),
-                      QTime( hours, minutes, (int)seconds, ms ),
-                      Qt::UTC );
+    return m_propagator->satrec( m_satellite );
 }
 
 double SatellitesTLEItem::period() const
 {
     // no := mean motion (rad / min)
-    return 60 * (2 * M_PI / m_satrec.no);
+    return 60 * (2 * M_PI / satrec().no);
 }
 
 double SatellitesTLEItem::apogee() const
 {
-    return m_satrec.alta * m_earthSemiMajorAxis;
+    return satrec().alta * m_propagator->earthSemiMajorAxis();
 }
 
 double SatellitesTLEItem::perigee() const
 {
-    return m_satrec.altp * m_earthSemiMajorAxis;
+    return satrec().altp * m_propagator->earthSemiMajorAxis();
 }
 
 double SatellitesTLEItem::semiMajorAxis() const
 {
 
-    return m_satrec.a * m_earthSemiMajorAxis;
+    return satrec().a * m_propagator->earthSemiMajorAxis();
 }
 
 double SatellitesTLEItem::inclination() const
 {
-    return m_satrec.inclo / M_PI * 180;
-}
-
-GeoDataCoordinates SatellitesTLEItem::fromTEME( double x,
-                                                double y,
-                                                double z,
-                                                double gmst ) const
-{
-    double lon = atan2( y, x );
-    // Rotate the angle by gmst (the origin goes from the vernal equinox
-    // point to the Greenwich Meridian)
-    lon = GeoDataCoordinates::normalizeLon( fmod(lon - gmst, 2 * M_PI) );
-
-    double lat = atan2( z, sqrt( x*x + y*y ) );
-
-    //TODO: determine if this is worth the extra precision
-    // Algorithm from http://celestrak.com/columns/v02n03/
-    //TODO: demonstrate it.
-    double a = m_earthSemiMajorAxis;
-    double planetRadius = sqrt( x*x + y*y );
-    double latp = lat;
-    double C;
-    for ( int i = 0; i < 3; i++ ) {
-        C = 1 / sqrt( 1 - square( m_satrec.ecco * sin( latp ) ) );
-        lat = atan2( z + a * C * square( m_satrec.ecco ) * sin( latp ), planetRadius );
-    }
-
-    double alt = planetRadius / cos( lat ) - a * C;
-
-    lat = GeoDataCoordinates::normalizeLat( lat );
-
-    return GeoDataCoordinates( lon, lat, alt * 1000 );
-}
-
-double SatellitesTLEItem::gmst( double minutesP ) const
-{
-    // Earth rotation rate in rad/min, from sgp4io.cpp
-    double rptim = 4.37526908801129966e-3;
-    return fmod( m_satrec.gsto + rptim * minutesP, 2 * M_PI );
-}
-
-double SatellitesTLEItem::square( double x )
-{
-    return x * x;
+    return satrec().inclo / M_PI * 180;
 }
 
 } // namespace Marble
@@ -13,12 +13,10 @@
 
 #include "TrackerPluginItem.h"
 
-#include "GeoDataCoordinates.h"
-#include "GeoDataTrack.h"
-
-#include <sgp4unit.h>
+#include "SatellitesTLEPropagator.h"
 
 class QColor;
+class QDateTime;
 
 namespace Marble {
 
@@ -32,15 +30,33 @@ class MarbleClock;
 class SatellitesTLEItem : public TrackerPluginItem
 {
 public:
+    /**
+     * Creates the item of @p satellite of @p propagator.
+     */
     SatellitesTLEItem( const QString &name,
-                       elsetrec satrec,
+                       SatellitesTLEPropagator *propagator,
+                       int satellite,
                        const MarbleClock *clock );
 
     void update();
 
+    /**
+     * Removes the points outside of the current time window from the track
+     * and appends the positions needed to complete it to @p positions.
+     * Existing points are kept, so usually only the newest time step is
+     * missing.
+     */
+    void requestPositions( QVector<SatellitesTLEPropagator::Position> &positions );
+
+    /**
+     * Adds the calculated positions @p begin to @p end to the track.
+     */
+    void addPositions( const SatellitesTLEPropagator::Position *begin,
+                       const SatellitesTLEPropagator::Position *end );
+
 private:
-    double m_earthSemiMajorAxis; // in km
-    elsetrec m_satrec;
+    SatellitesTLEPropagator *const m_propagator;
+    const int m_satellite;
 
     GeoDataTrack *m_track;
 
@@ -49,23 +65,9 @@ private:
     void setDescription();
 
     /**
-     * Add a point in the GeoDataTrack geometry of the placemark with time
-     * dateTime and coordinates of the satellite determined from m_satrec.
+     * @return The orbital elements of the satellite
      */
-    void addPointAt( const QDateTime &dateTime );
-
-    /**
-     * Create a GeoDataCoordinates object from the cartesian coordinates
-     * @p x, @p y and @p z in km in the Earth-centered inertial frame known
-     * as TEME (True equator, Mean equinox) with Greenwich Mean Sidereal Time
-     * @p gmst in radians at time of observation.
-     */
-    GeoDataCoordinates fromTEME( double x, double y, double z, double gmst ) const;
-
-    /**
-     * @return The time at the satellite epoch determined from m_satrec
-     */
-    QDateTime timeAtEpoch() const;
+    const elsetrec &satrec() const;
 
     /**
      * @return The orbital period of the satellite in seconds
@@ -89,17 +91,6 @@ private:
      * @return The inclination in degrees
      */
     double inclination() const;
-
-    /**
-     * Returns the Greenwich Mean Sideral Time in radians, @p minutes
-     * after the epoch.
-     */
-    double gmst( double minutes ) const;
-
-    /**
-     * @return The square of @p x
-     */
-    static double square( double x );
 };
 
 } // namespace Marble
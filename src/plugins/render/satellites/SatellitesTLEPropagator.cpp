@@ -0,0 +1,181 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "SatellitesTLEPropagator.h"
+
+#include <sgp4ext.h>
+
+#include <QDateTime>
+#include <QRunnable>
+
+#include <cmath>
+
+namespace Marble {
+
+/**
+ * Propagates every n-th of the given positions, starting at the given offset.
+ */
+class SatellitesTLEPropagator::Job : public QRunnable
+{
+public:
+    Job( const SatellitesTLEPropagator *propagator, Position *positions, int size, int offset, int stride ) :
+        m_propagator( propagator ),
+        m_positions( positions ),
+        m_size( size ),
+        m_offset( offset ),
+        m_stride( stride )
+    {
+    }
+
+    void run()
+    {
+        for ( int i = m_offset; i < m_size; i += m_stride ) {
+            m_propagator->propagate( m_positions[i] );
+        }
+    }
+
+private:
+    const SatellitesTLEPropagator *const m_propagator;
+    Position *const m_positions;
+    const int m_size;
+    const int m_offset;
+    const int m_stride;
+};
+
+SatellitesTLEPropagator::SatellitesTLEPropagator()
+{
+    double tumin, mu, xke, j2, j3, j4, j3oj2;
+    double radiusearthkm;
+    getgravconst( wgs84, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2 );
+    m_earthSemiMajorAxis = radiusearthkm;
+}
+
+SatellitesTLEPropagator::~SatellitesTLEPropagator()
+{
+    m_threadPool.waitForDone();
+}
+
+int SatellitesTLEPropagator::addSatellite( const elsetrec &satrec )
+{
+    int year = satrec.epochyr + ( satrec.epochyr < 57 ? 2000 : 1900 );
+
+    int month, day, hours, minutes;
+    double seconds;
+    days2mdhms( year, satrec.epochdays, month, day, hours , minutes, seconds );
+
+    int ms = fmod(seconds * 1000.0, 1000.0);
+
+    const QDateTime epoch( QDate( year, month, day ),
+                           QTime( hours, minutes, (int)seconds, ms ),
+                           Qt::UTC );
+
+    m_satrecs.append( satrec );
+    m_epochs.append( epoch.toTime_t() );
+    return m_satrecs.size() - 1;
+}
+
+void SatellitesTLEPropagator::clear()
+{
+    m_satrecs.clear();
+    m_epochs.clear();
+}
+
+const elsetrec &SatellitesTLEPropagator::satrec( int satellite ) const
+{
+    return m_satrecs.at( satellite );
+}
+
+uint SatellitesTLEPropagator::epoch( int satellite ) const
+{
+    return m_epochs.at( satellite );
+}
+
+double SatellitesTLEPropagator::earthSemiMajorAxis() const
+{
+    return m_earthSemiMajorAxis;
+}
+
+void SatellitesTLEPropagator::propagate( QVector<Position> &positions )
+{
+    // Below that, starting the jobs costs more than it saves
+    int const minimumPositionsPerJob = 64;
+    int const jobCount = qMin( m_threadPool.maxThreadCount(), positions.size() / minimumPositionsPerJob );
+
+    Position *const data = positions.data();
+    if ( jobCount < 2 ) {
+        Job( this, data, positions.size(), 0, 1 ).run();
+        return;
+    }
+
+    for ( int i = 1; i < jobCount; ++i ) {
+        m_threadPool.start( new Job( this, data, positions.size(), i, jobCount ) );
+    }
+    // The calling thread takes its share instead of waiting idly
+    Job( this, data, positions.size(), 0, jobCount ).run();
+    m_threadPool.waitForDone();
+}
+
+void SatellitesTLEPropagator::propagate( Position &position ) const
+{
+    // sgp4() keeps intermediate results in the elements, so each
+    // calculation works on its own copy to be safe from other threads
+    elsetrec satrec = m_satrecs.at( position.satellite );
+
+    // in minutes
+    double timeSinceEpoch = (double)( (qint64)position.time -
+        (qint64)m_epochs.at( position.satellite ) ) / 60.0;
+
+    double r[3], v[3];
+    sgp4( wgs84, satrec, timeSinceEpoch, r, v );
+
+    position.valid = satrec.error == 0;
+    if ( !position.valid ) {
+        return;
+    }
+
+    // Earth rotation rate in rad/min, from sgp4io.cpp
+    double rptim = 4.37526908801129966e-3;
+    double gmst = fmod( satrec.gsto + rptim * timeSinceEpoch, 2 * M_PI );
+
+    position.coordinates = fromTEME( satrec, r[0], r[1], r[2], gmst );
+}
+
+GeoDataCoordinates SatellitesTLEPropagator::fromTEME( const elsetrec &satrec,
+                                                      double x,
+                                                      double y,
+                                                      double z,
+                                                      double gmst ) const
+{
+    double lon = atan2( y, x );
+    // Rotate the angle by gmst (the origin goes from the vernal equinox
+    // point to the Greenwich Meridian)
+    lon = GeoDataCoordinates::normalizeLon( fmod(lon - gmst, 2 * M_PI) );
+
+    double lat = atan2( z, sqrt( x*x + y*y ) );
+
+    //TODO: determine if this is worth the extra precision
+    // Algorithm from http://celestrak.com/columns/v02n03/
+    //TODO: demonstrate it.
+    double a = m_earthSemiMajorAxis;
+    double planetRadius = sqrt( x*x + y*y );
+    double latp = lat;
+    double eccentricitySquare = satrec.ecco * satrec.ecco;
+    double C;
+    for ( int i = 0; i < 3; i++ ) {
+        C = 1 / sqrt( 1 - eccentricitySquare * sin( latp ) * sin( latp ) );
+        lat = atan2( z + a * C * eccentricitySquare * sin( latp ), planetRadius );
+    }
+
+    double alt = planetRadius / cos( lat ) - a * C;
+
+    lat = GeoDataCoordinates::normalizeLat( lat );
+
+    return GeoDataCoordinates( lon, lat, alt * 1000 );
+}
+
+} // namespace Marble
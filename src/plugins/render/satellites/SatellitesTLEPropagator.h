@@ -0,0 +1,101 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_SATELLITESTLEPROPAGATOR_H
+#define MARBLE_SATELLITESTLEPROPAGATOR_H
+
+#include "GeoDataCoordinates.h"
+
+#include <QThreadPool>
+#include <QVector>
+
+#include <sgp4unit.h>
+
+namespace Marble {
+
+/**
+ * Calculates the positions of the satellites of a two-line-elements set
+ * catalog with SGP4. The orbital elements of all satellites are kept in
+ * one array, and large batches of positions are calculated in parallel.
+ */
+class SatellitesTLEPropagator
+{
+public:
+    /**
+     * A position to calculate: The @p coordinates of @p satellite at @p time,
+     * in seconds since 1970-01-01 UTC. @p valid is false if SGP4 failed,
+     * e.g. because the satellite has decayed.
+     */
+    struct Position
+    {
+        int satellite;
+        uint time;
+        GeoDataCoordinates coordinates;
+        bool valid;
+    };
+
+    SatellitesTLEPropagator();
+
+    ~SatellitesTLEPropagator();
+
+    /**
+     * Adds a satellite with the orbital elements @p satrec.
+     * @return the index of the satellite
+     */
+    int addSatellite( const elsetrec &satrec );
+
+    /**
+     * Removes all satellites.
+     */
+    void clear();
+
+    /**
+     * @return The orbital elements of @p satellite
+     */
+    const elsetrec &satrec( int satellite ) const;
+
+    /**
+     * @return The epoch of @p satellite in seconds since 1970-01-01 UTC
+     */
+    uint epoch( int satellite ) const;
+
+    /**
+     * @return The semi-major axis of the earth in km
+     */
+    double earthSemiMajorAxis() const;
+
+    /**
+     * Calculates the coordinates of all @p positions. Large batches are
+     * split among several threads.
+     */
+    void propagate( QVector<Position> &positions );
+
+private:
+    Q_DISABLE_COPY( SatellitesTLEPropagator )
+
+    class Job;
+
+    void propagate( Position &position ) const;
+
+    /**
+     * Create a GeoDataCoordinates object from the cartesian coordinates
+     * @p x, @p y and @p z in km in the Earth-centered inertial frame known
+     * as TEME (True equator, Mean equinox) with Greenwich Mean Sidereal Time
+     * @p gmst in radians at time of observation.
+     */
+    GeoDataCoordinates fromTEME( const elsetrec &satrec, double x, double y, double z, double gmst ) const;
+
+    QVector<elsetrec> m_satrecs;
+    QVector<uint> m_epochs;
+    double m_earthSemiMajorAxis; // in km
+    QThreadPool m_threadPool;
+};
+
+} // namespace Marble
+
+#endif // MARBLE_SATELLITESTLEPROPAGATOR_H
@@ -57,6 +57,7 @@ void OsmWay::create(GeoDataDocument *document, const OsmNodes &nodes) const
         }
 
         *linearRing = GeoDataLinearRing(linearRing->optimized());
+        linearRing->setPackedStorage(true);
     } else {
         GeoDataLineString* lineString = new GeoDataLineString;
         placemark->setGeometry(lineString);
@@ -74,6 +75,7 @@ void OsmWay::create(GeoDataDocument *document, const OsmNodes &nodes) const
         }
 
         *lineString = lineString->optimized();
+        lineString->setPackedStorage(true);
     }
 
     OsmObjectManager::registerId(m_osmData.id());
@@ -0,0 +1,70 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "SnapshotPlugin.h"
+#include "SnapshotRunner.h"
+
+#include "DocumentSnapshot.h"
+
+namespace Marble
+{
+
+SnapshotPlugin::SnapshotPlugin( QObject *parent ) :
+    ParseRunnerPlugin( parent )
+{
+}
+
+QString SnapshotPlugin::name() const
+{
+    return tr( "Snapshot File Parser" );
+}
+
+QString SnapshotPlugin::nameId() const
+{
+    return "Snapshot";
+}
+
+QString SnapshotPlugin::version() const
+{
+    return "1.0";
+}
+
+QString SnapshotPlugin::description() const
+{
+    return tr( "Create GeoDataDocument from binary document snapshots" );
+}
+
+QString SnapshotPlugin::copyrightYears() const
+{
+    return "2016";
+}
+
+QList<PluginAuthor> SnapshotPlugin::pluginAuthors() const
+{
+    return QList<PluginAuthor>()
+            << PluginAuthor( "Marble Developers", "marble-devel@kde.org" );
+}
+
+QString SnapshotPlugin::fileFormatDescription() const
+{
+    return tr( "Marble Document Snapshots" );
+}
+
+QStringList SnapshotPlugin::fileExtensions() const
+{
+    return QStringList() << DocumentSnapshot::fileExtension();
+}
+
+ParsingRunner* SnapshotPlugin::newRunner() const
+{
+    return new SnapshotRunner;
+}
+
+}
+
+#include "moc_SnapshotPlugin.cpp"
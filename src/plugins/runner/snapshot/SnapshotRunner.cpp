@@ -0,0 +1,37 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "SnapshotRunner.h"
+
+#include "DocumentSnapshot.h"
+#include "GeoDataDocument.h"
+
+namespace Marble
+{
+
+SnapshotRunner::SnapshotRunner(QObject *parent) :
+    ParsingRunner(parent)
+{
+}
+
+SnapshotRunner::~SnapshotRunner()
+{
+}
+
+GeoDataDocument* SnapshotRunner::parseFile( const QString &fileName, DocumentRole role, QString& error )
+{
+    GeoDataDocument *document = DocumentSnapshot::read( fileName, error );
+    if ( document ) {
+        document->setDocumentRole( role );
+    }
+    return document;
+}
+
+}
+
+#include "moc_SnapshotRunner.cpp"
@@ -0,0 +1,28 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLESNAPSHOTRUNNER_H
+#define MARBLESNAPSHOTRUNNER_H
+
+#include "ParsingRunner.h"
+
+namespace Marble
+{
+
+class SnapshotRunner : public ParsingRunner
+{
+    Q_OBJECT
+public:
+    explicit SnapshotRunner(QObject *parent = 0);
+    ~SnapshotRunner();
+    GeoDataDocument* parseFile( const QString &fileName, DocumentRole role, QString& error );
+
+};
+
+}
+#endif // MARBLESNAPSHOTRUNNER_H
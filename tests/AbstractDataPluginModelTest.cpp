@@ -13,6 +13,7 @@
 #include "AbstractDataPluginModel.h"
 
 #include "AbstractDataPluginItem.h"
+#include "GeoDataCoordinates.h"
 #include "MarbleModel.h"
 #include "ViewportParams.h"
 
@@ -92,6 +93,12 @@ private Q_SLOTS:
 
     void itemsVersusSetSticky();
 
+    void itemsVersusViewport();
+
+    void itemsVersusOrder();
+
+    void deleteItem();
+
  private:
     const MarbleModel m_marbleModel;
     static const ViewportParams fullViewport;
@@ -341,6 +348,75 @@ void AbstractDataPluginModelTest::itemsVersusSetSticky()
     QVERIFY( !model.items( &fullViewport, 1 ).contains( item ) );
 }
 
+void AbstractDataPluginModelTest::itemsVersusViewport()
+{
+    const ViewportParams zoomedViewport( Equirectangular, 0, 0, 10000, QSize( 230, 230 ) );
+
+    TestDataPluginItem *nearItem = new TestDataPluginItem;
+    nearItem->setId( "nearItem" );
+    nearItem->setInitialized( true );
+    nearItem->setCoordinate( GeoDataCoordinates( 0.1, 0.1, 0, GeoDataCoordinates::Degree ) );
+
+    TestDataPluginItem *farItem = new TestDataPluginItem;
+    farItem->setId( "farItem" );
+    farItem->setInitialized( true );
+    farItem->setCoordinate( GeoDataCoordinates( 120, 50, 0, GeoDataCoordinates::Degree ) );
+
+    TestDataPluginModel model( &m_marbleModel );
+    model.addItemToList( nearItem );
+    model.addItemToList( farItem );
+
+    QCOMPARE( model.items( &zoomedViewport, 10 ), QList<AbstractDataPluginItem*>() << nearItem );
+
+    // moving an item into the viewport has to be announced by updated()
+    farItem->setCoordinate( GeoDataCoordinates( -0.1, -0.1, 0, GeoDataCoordinates::Degree ) );
+    emit farItem->updated();
+
+    QCOMPARE( model.items( &zoomedViewport, 10 ).size(), 2 );
+    QVERIFY( model.items( &zoomedViewport, 10 ).contains( farItem ) );
+}
+
+void AbstractDataPluginModelTest::itemsVersusOrder()
+{
+    TestDataPluginModel model( &m_marbleModel );
+
+    QList<AbstractDataPluginItem*> items;
+    for ( int i = 0; i < 100; ++i ) {
+        TestDataPluginItem *item = new TestDataPluginItem;
+        item->setId( QString::number( i ) );
+        item->setInitialized( true );
+        item->setCoordinate( GeoDataCoordinates( i - 50.0, 0.5 * i - 25.0, 0, GeoDataCoordinates::Degree ) );
+        items << item;
+    }
+    model.addItemsToList( items );
+
+    for ( int i = 0; i < 100; ++i ) {
+        QCOMPARE( model.findItem( QString::number( i ) ), items[i] );
+    }
+
+    // the items are ordered by their address, see TestDataPluginItem::operator<
+    qSort( items );
+    QCOMPARE( model.items( &fullViewport, 5 ), items.mid( 0, 5 ) );
+}
+
+void AbstractDataPluginModelTest::deleteItem()
+{
+    TestDataPluginItem *item = new TestDataPluginItem;
+    item->setId( "foo" );
+    item->setInitialized( true );
+
+    TestDataPluginModel model( &m_marbleModel );
+    model.addItemToList( item );
+
+    QVERIFY( model.items( &fullViewport, 1 ).contains( item ) );
+
+    delete item;
+
+    QVERIFY( !model.itemExists( "foo" ) );
+    QVERIFY( model.items( &fullViewport, 1 ).isEmpty() );
+    QVERIFY( model.whichItemAt( QPoint( 115, 115 ) ).isEmpty() );
+}
+
 QTEST_MAIN( AbstractDataPluginModelTest )
 
 #include "AbstractDataPluginModelTest.moc"
@@ -0,0 +1,115 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "DiscoveryCache.h"
+
+namespace Marble
+{
+
+class DiscoveryCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void storeAndReload();
+    void changedFile();
+    void removedFile();
+};
+
+static bool writeFile( const QString &fileName, const QByteArray &data )
+{
+    QFile file( fileName );
+    return file.open( QIODevice::WriteOnly ) && file.write( data ) == data.size();
+}
+
+void DiscoveryCacheTest::storeAndReload()
+{
+    QTemporaryDir directory;
+    QVERIFY( directory.isValid() );
+    const QString cacheFile = directory.path() + "/discovery/test.cache";
+    const QString theme = directory.path() + "/theme.dgml";
+    QVERIFY( writeFile( theme, "<dgml/>" ) );
+
+    QVariantMap properties;
+    properties.insert( "name", "Atlas" );
+    properties.insert( "visible", true );
+
+    {
+        DiscoveryCache cache( cacheFile );
+        QVERIFY( cache.value( theme ).isEmpty() );
+        cache.insert( theme, properties );
+        QCOMPARE( cache.value( theme ), properties );
+        QVERIFY( cache.save() );
+    }
+
+    DiscoveryCache cache( cacheFile );
+    QCOMPARE( cache.value( theme ), properties );
+    QVERIFY( cache.value( directory.path() + "/other.dgml" ).isEmpty() );
+}
+
+void DiscoveryCacheTest::changedFile()
+{
+    QTemporaryDir directory;
+    QVERIFY( directory.isValid() );
+    const QString cacheFile = directory.path() + "/test.cache";
+    const QString plugin = directory.path() + "/plugin.so";
+    QVERIFY( writeFile( plugin, "first" ) );
+
+    QVariantMap properties;
+    properties.insert( "types", 1 );
+
+    DiscoveryCache cache( cacheFile );
+    cache.insert( plugin, properties );
+    QCOMPARE( cache.value( plugin ), properties );
+
+    QVERIFY( writeFile( plugin, "replaced" ) );
+    QVERIFY( cache.value( plugin ).isEmpty() );
+
+    cache.insert( plugin, properties );
+    QCOMPARE( cache.value( plugin ), properties );
+}
+
+void DiscoveryCacheTest::removedFile()
+{
+    QTemporaryDir directory;
+    QVERIFY( directory.isValid() );
+    const QString cacheFile = directory.path() + "/test.cache";
+    const QString theme = directory.path() + "/theme.dgml";
+    QVERIFY( writeFile( theme, "<dgml/>" ) );
+
+    QVariantMap properties;
+    properties.insert( "name", "Atlas" );
+
+    {
+        DiscoveryCache cache( cacheFile );
+        cache.insert( theme, properties );
+        QVERIFY( cache.save() );
+    }
+
+    QVERIFY( QFile::remove( theme ) );
+    {
+        DiscoveryCache cache( cacheFile );
+        QVERIFY( cache.value( theme ).isEmpty() );
+        QVERIFY( cache.save() );
+    }
+
+    // a file created again later must not get the stale entry
+    QVERIFY( writeFile( theme, "<dgml/>" ) );
+    DiscoveryCache cache( cacheFile );
+    QVERIFY( cache.value( theme ).isEmpty() );
+}
+
+}
+
+QTEST_MAIN( Marble::DiscoveryCacheTest )
+
+#include "DiscoveryCacheTest.moc"
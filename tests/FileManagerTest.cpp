@@ -0,0 +1,176 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "FileManager.h"
+#include "GeoDataDocument.h"
+#include "GeoDataTreeModel.h"
+#include "MarbleDirs.h"
+#include "MarbleModel.h"
+#include "MarblePlacemarkModel.h"
+
+#include <QSignalSpy>
+#include <QTest>
+
+namespace Marble
+{
+
+class FileManagerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void addInBatches();
+    void closeWhileAdding();
+    void removeFolderWhileAdding();
+
+private:
+    static QString kml( int folderPlacemarks, int placemarks );
+    static GeoDataDocument *document( GeoDataTreeModel *treeModel, const QString &name );
+    static int rowCount( GeoDataTreeModel *treeModel, const GeoDataObject *object );
+};
+
+void FileManagerTest::initTestCase()
+{
+    // The KML parser is part of the KML runner plugin
+    MarbleDirs::setMarbleDataPath( DATA_PATH );
+    MarbleDirs::setMarblePluginPath( PLUGIN_PATH );
+}
+
+QString FileManagerTest::kml( int folderPlacemarks, int placemarks )
+{
+    const QString placemark = "<Placemark><name>%1 %2</name><Point><coordinates>%3,%4</coordinates></Point></Placemark>\n";
+
+    QString result = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                     "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n"
+                     "<Document><name>test</name>\n"
+                     "<Folder><name>folder</name>\n";
+    for ( int i = 0; i < folderPlacemarks; ++i ) {
+        result += placemark.arg( "folder placemark" ).arg( i ).arg( i % 360 - 180 ).arg( i % 170 - 85 );
+    }
+    result += "</Folder>\n";
+    for ( int i = 0; i < placemarks; ++i ) {
+        result += placemark.arg( "placemark" ).arg( i ).arg( i % 360 - 180 ).arg( i % 170 - 85 );
+    }
+    result += "</Document>\n</kml>\n";
+
+    return result;
+}
+
+GeoDataDocument *FileManagerTest::document( GeoDataTreeModel *treeModel, const QString &name )
+{
+    for ( int row = 0; row < treeModel->rowCount(); ++row ) {
+        GeoDataObject *object = qvariant_cast<GeoDataObject*>( treeModel->index( row, 0 ).data( MarblePlacemarkModel::ObjectPointerRole ) );
+        GeoDataDocument *document = dynamic_cast<GeoDataDocument*>( object );
+        if ( document && document->name() == name ) {
+            return document;
+        }
+    }
+
+    return 0;
+}
+
+int FileManagerTest::rowCount( GeoDataTreeModel *treeModel, const GeoDataObject *object )
+{
+    return treeModel->rowCount( treeModel->index( const_cast<GeoDataObject*>( object ) ) );
+}
+
+void FileManagerTest::addInBatches()
+{
+    MarbleModel model;
+    GeoDataTreeModel *const treeModel = model.treeModel();
+    QSignalSpy fileAddedSpy( model.fileManager(), SIGNAL(fileAdded(QString)) );
+
+    // large documents are added empty and get their features in batches
+    int folderInsertions = 0;
+    connect( treeModel, &GeoDataTreeModel::rowsInserted, [&]( const QModelIndex &parent, int, int ) {
+        if ( parent.data( Qt::DisplayRole ).toString() == QLatin1String( "folder" ) ) {
+            ++folderInsertions;
+        }
+    } );
+
+    model.addGeoDataString( kml( 1200, 300 ), "test" );
+    QTRY_COMPARE( fileAddedSpy.count(), 1 );
+    QCOMPARE( fileAddedSpy.first().first().toString(), QString( "test" ) );
+
+    GeoDataDocument *const testDocument = document( treeModel, "test" );
+    QVERIFY( testDocument );
+    QCOMPARE( testDocument->size(), 301 );
+    QCOMPARE( rowCount( treeModel, testDocument ), 301 );
+    const GeoDataContainer *const folder = dynamic_cast<const GeoDataContainer*>( testDocument->child( 0 ) );
+    QVERIFY( folder );
+    QCOMPARE( folder->size(), 1200 );
+    QCOMPARE( rowCount( treeModel, folder ), 1200 );
+    QCOMPARE( folderInsertions, 3 );
+
+    // the file is announced once only
+    QTest::qWait( 100 );
+    QCOMPARE( fileAddedSpy.count(), 1 );
+}
+
+void FileManagerTest::closeWhileAdding()
+{
+    MarbleModel model;
+    GeoDataTreeModel *const treeModel = model.treeModel();
+    QSignalSpy fileAddedSpy( model.fileManager(), SIGNAL(fileAdded(QString)) );
+
+    // closing the file after the first batch drops the batches of the folder
+    bool closed = false;
+    connect( treeModel, &GeoDataTreeModel::added, [&]( GeoDataObject *object ) {
+        const GeoDataFeature *feature = dynamic_cast<const GeoDataFeature*>( object );
+        if ( feature && feature->name() == QLatin1String( "placemark 299" ) ) {
+            model.removeGeoData( "test" );
+            closed = true;
+        }
+    } );
+
+    model.addGeoDataString( kml( 1200, 300 ), "test" );
+    QTRY_VERIFY( closed );
+
+    QTest::qWait( 100 );
+    QCOMPARE( fileAddedSpy.count(), 0 );
+    QVERIFY( !document( treeModel, "test" ) );
+}
+
+void FileManagerTest::removeFolderWhileAdding()
+{
+    MarbleModel model;
+    GeoDataTreeModel *const treeModel = model.treeModel();
+    QSignalSpy fileAddedSpy( model.fileManager(), SIGNAL(fileAdded(QString)) );
+
+    // removing the folder after its first batch hands it the other batches
+    GeoDataContainer *folder = 0;
+    connect( treeModel, &GeoDataTreeModel::added, [&]( GeoDataObject *object ) {
+        const GeoDataFeature *feature = dynamic_cast<const GeoDataFeature*>( object );
+        if ( !folder && feature && feature->name() == QLatin1String( "folder placemark 0" ) ) {
+            folder = static_cast<GeoDataContainer*>( feature->parent() );
+            QVERIFY( treeModel->removeFeature( folder ) >= 0 );
+        }
+    } );
+
+    model.addGeoDataString( kml( 1200, 300 ), "test" );
+    QTRY_COMPARE( fileAddedSpy.count(), 1 );
+    QVERIFY( folder );
+    QCOMPARE( folder->size(), 1200 );
+
+    GeoDataDocument *const testDocument = document( treeModel, "test" );
+    QVERIFY( testDocument );
+    QCOMPARE( rowCount( treeModel, testDocument ), 300 );
+
+    QTest::qWait( 100 );
+    QCOMPARE( fileAddedSpy.count(), 1 );
+
+    delete folder;
+}
+
+}
+
+QTEST_MAIN( Marble::FileManagerTest )
+
+#include "FileManagerTest.moc"
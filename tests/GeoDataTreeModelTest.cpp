@@ -8,6 +8,7 @@
 // Copyright 2014      Bernhard Beschow <bbeschow@cs.tu-berlin.de>
 //
 
+#include <QSignalSpy>
 #include <QTest>
 
 #include "GeoDataTreeModel.h"
@@ -26,6 +27,7 @@ private Q_SLOTS:
     void defaultConstructor();
     void setRootDocument();
     void addDocument();
+    void addFeatures();
 };
 
 void GeoDataTreeModelTest::defaultConstructor()
@@ -73,6 +75,35 @@ void GeoDataTreeModelTest::addDocument()
     }
 }
 
+void GeoDataTreeModelTest::addFeatures()
+{
+    GeoDataDocument *document = new GeoDataDocument;
+    document->append( new GeoDataPlacemark );
+
+    GeoDataTreeModel model;
+    model.addDocument( document );
+    const QModelIndex documentIndex = model.index( document );
+
+    QSignalSpy insertedSpy( &model, SIGNAL(rowsInserted(QModelIndex,int,int)) );
+    QSignalSpy addedSpy( &model, SIGNAL(added(GeoDataObject*)) );
+
+    QVector<GeoDataFeature*> features;
+    for ( int i = 0; i < 3; ++i ) {
+        features << new GeoDataPlacemark;
+    }
+    QCOMPARE( model.addFeatures( document, features ), 1 );
+
+    QCOMPARE( model.rowCount( documentIndex ), 4 );
+    QCOMPARE( insertedSpy.count(), 1 );
+    QCOMPARE( insertedSpy.first().at( 1 ).toInt(), 1 );
+    QCOMPARE( insertedSpy.first().at( 2 ).toInt(), 3 );
+    QCOMPARE( addedSpy.count(), 3 );
+    QCOMPARE( features.last()->parent(), static_cast<GeoDataObject*>( document ) );
+
+    QCOMPARE( model.addFeatures( document, QVector<GeoDataFeature*>() ), -1 );
+    QCOMPARE( insertedSpy.count(), 1 );
+}
+
 }
 
 QTEST_MAIN( Marble::GeoDataTreeModelTest )
@@ -0,0 +1,199 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "GeoGraphicsScene.h"
+
+#include "GeoDataLatLonAltBox.h"
+#include "GeoDataPlacemark.h"
+#include "GeoGraphicsItem.h"
+
+#include <QSet>
+#include <QTest>
+
+namespace Marble
+{
+
+class TestItem : public GeoGraphicsItem
+{
+public:
+    TestItem( const GeoDataFeature *feature, const GeoDataLatLonBox &box, int minZoomLevel = 0 ) :
+        GeoGraphicsItem( feature )
+    {
+        setLatLonAltBox( GeoDataLatLonAltBox( box, 0, 0 ) );
+        setMinZoomLevel( minZoomLevel );
+    }
+
+    void paint( GeoPainter *, const ViewportParams *, const QString & ) {}
+};
+
+class GeoGraphicsSceneTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void boxQuery();
+    void dateLine();
+    void zoomLevelAndVisibility();
+    void removeItem();
+    void manyItems();
+};
+
+typedef QSet<GeoGraphicsItem*> ItemSet;
+
+static ItemSet toSet( const QList<GeoGraphicsItem*> &items )
+{
+    return items.toSet();
+}
+
+void GeoGraphicsSceneTest::boxQuery()
+{
+    GeoDataPlacemark placemark;
+    GeoGraphicsScene scene;
+    GeoGraphicsItem *berlin = new TestItem( &placemark, GeoDataLatLonBox( 52.7, 52.3, 13.8, 13.0, GeoDataCoordinates::Degree ) );
+    GeoGraphicsItem *europe = new TestItem( &placemark, GeoDataLatLonBox( 70.0, 35.0, 40.0, -10.0, GeoDataCoordinates::Degree ) );
+    GeoGraphicsItem *sydney = new TestItem( &placemark, GeoDataLatLonBox( -33.7, -34.1, 151.4, 150.8, GeoDataCoordinates::Degree ) );
+    scene.addItem( berlin );
+    scene.addItem( europe );
+    scene.addItem( sydney );
+
+    const GeoDataLatLonBox germany( 55.0, 47.0, 15.0, 6.0, GeoDataCoordinates::Degree );
+    QCOMPARE( toSet( scene.items( germany, 10 ) ), ItemSet() << berlin << europe );
+    QCOMPARE( scene.items( germany, 10 ).size(), 2 );
+
+    const GeoDataLatLonBox australia( -10.0, -45.0, 155.0, 110.0, GeoDataCoordinates::Degree );
+    QCOMPARE( toSet( scene.items( australia, 10 ) ), ItemSet() << sydney );
+
+    const GeoDataLatLonBox pacific( 10.0, -10.0, -120.0, 170.0, GeoDataCoordinates::Degree );
+    QVERIFY( scene.items( pacific, 10 ).isEmpty() );
+}
+
+void GeoGraphicsSceneTest::dateLine()
+{
+    GeoDataPlacemark placemark;
+    GeoGraphicsScene scene;
+    GeoGraphicsItem *fiji = new TestItem( &placemark, GeoDataLatLonBox( -15.0, -20.0, -178.0, 176.0, GeoDataCoordinates::Degree ) );
+    GeoGraphicsItem *equator = new TestItem( &placemark, GeoDataLatLonBox( 1.0, -1.0, 179.0, -179.0, GeoDataCoordinates::Degree ) );
+    GeoGraphicsItem *alaska = new TestItem( &placemark, GeoDataLatLonBox( 70.0, 55.0, -140.0, -170.0, GeoDataCoordinates::Degree ) );
+    scene.addItem( fiji );
+    scene.addItem( equator );
+    scene.addItem( alaska );
+
+    // query boxes on either side of the date line find the item crossing it
+    const GeoDataLatLonBox west( -10.0, -30.0, 180.0, 170.0, GeoDataCoordinates::Degree );
+    QCOMPARE( toSet( scene.items( west, 10 ) ), ItemSet() << fiji );
+    const GeoDataLatLonBox east( -10.0, -30.0, -170.0, -180.0, GeoDataCoordinates::Degree );
+    QCOMPARE( toSet( scene.items( east, 10 ) ), ItemSet() << fiji );
+
+    // a query box crossing the date line returns each item once
+    const GeoDataLatLonBox crossing( 80.0, -30.0, -130.0, 170.0, GeoDataCoordinates::Degree );
+    const QList<GeoGraphicsItem*> items = scene.items( crossing, 10 );
+    QCOMPARE( items.size(), 3 );
+    QCOMPARE( toSet( items ), ItemSet() << fiji << equator << alaska );
+}
+
+void GeoGraphicsSceneTest::zoomLevelAndVisibility()
+{
+    GeoDataPlacemark placemark;
+    GeoGraphicsScene scene;
+    GeoGraphicsItem *country = new TestItem( &placemark, GeoDataLatLonBox( 50.0, 40.0, 10.0, 0.0, GeoDataCoordinates::Degree ), 3 );
+    GeoGraphicsItem *street = new TestItem( &placemark, GeoDataLatLonBox( 45.1, 45.0, 5.1, 5.0, GeoDataCoordinates::Degree ), 15 );
+    scene.addItem( country );
+    scene.addItem( street );
+
+    const GeoDataLatLonBox box( 46.0, 44.0, 6.0, 4.0, GeoDataCoordinates::Degree );
+    QVERIFY( scene.items( box, 2 ).isEmpty() );
+    QCOMPARE( toSet( scene.items( box, 3 ) ), ItemSet() << country );
+    QCOMPARE( toSet( scene.items( box, 15 ) ), ItemSet() << country << street );
+
+    country->setVisible( false );
+    QCOMPARE( toSet( scene.items( box, 15 ) ), ItemSet() << street );
+}
+
+void GeoGraphicsSceneTest::removeItem()
+{
+    GeoDataPlacemark first;
+    GeoDataPlacemark second;
+    GeoGraphicsScene scene;
+    scene.addItem( new TestItem( &first, GeoDataLatLonBox( 10.0, 0.0, 10.0, 0.0, GeoDataCoordinates::Degree ) ) );
+    scene.addItem( new TestItem( &first, GeoDataLatLonBox( 10.0, 0.0, -170.0, 170.0, GeoDataCoordinates::Degree ) ) );
+    GeoGraphicsItem *remaining = new TestItem( &second, GeoDataLatLonBox( 10.0, 0.0, 10.0, 0.0, GeoDataCoordinates::Degree ) );
+    scene.addItem( remaining );
+
+    const GeoDataLatLonBox world( 90.0, -90.0, 180.0, -180.0, GeoDataCoordinates::Degree );
+    QCOMPARE( scene.items( world, 10 ).size(), 3 );
+
+    scene.removeItem( &first );
+    QCOMPARE( scene.items( world, 10 ), QList<GeoGraphicsItem*>() << remaining );
+
+    scene.clear();
+    QVERIFY( scene.items( world, 10 ).isEmpty() );
+}
+
+void GeoGraphicsSceneTest::manyItems()
+{
+    QList<GeoDataPlacemark*> placemarks;
+    QList<GeoGraphicsItem*> items;
+    GeoGraphicsScene scene;
+
+    qsrand( 42 );
+    for ( int i = 0; i < 2000; ++i ) {
+        // the first half is bulk loaded, the second half inserted one by one
+        if ( i == 1000 ) {
+            scene.items( GeoDataLatLonBox( 1.0, -1.0, 1.0, -1.0, GeoDataCoordinates::Degree ), 20 );
+        }
+        const qreal west = qrand() % 360 - 180.0;
+        const qreal south = qrand() % 170 - 85.0;
+        const qreal width = qrand() % 20 + 0.5;
+        const qreal height = qrand() % 5 + 0.5;
+        qreal east = west + width;
+        if ( east > 180.0 ) {
+            east -= 360.0;
+        }
+        placemarks << new GeoDataPlacemark;
+        items << new TestItem( placemarks.last(), GeoDataLatLonBox( south + height, south, east, west, GeoDataCoordinates::Degree ), i % 20 );
+        scene.addItem( items.last() );
+        if ( i > 1000 ) {
+            scene.items( GeoDataLatLonBox( 1.0, -1.0, 1.0, -1.0, GeoDataCoordinates::Degree ), 20 );
+        }
+    }
+
+    for ( int i = 0; i < 500; i += 2 ) {
+        scene.removeItem( placemarks[i] );
+        items[i] = 0;
+    }
+
+    for ( int query = 0; query < 200; ++query ) {
+        // not on integer degrees, so that no item touches the query box
+        const qreal west = qrand() % 359 - 179.75;
+        const qreal east = qrand() % 359 - 179.75;
+        const qreal south = qrand() % 89 - 89.75;
+        const qreal north = qrand() % 89 + 0.25;
+        const int zoomLevel = qrand() % 20;
+        const GeoDataLatLonBox box( north, south, east, west, GeoDataCoordinates::Degree );
+
+        ItemSet expected;
+        foreach ( GeoGraphicsItem *item, items ) {
+            if ( item && item->minZoomLevel() <= zoomLevel && item->latLonAltBox().intersects( box ) ) {
+                expected << item;
+            }
+        }
+
+        const QList<GeoGraphicsItem*> result = scene.items( box, zoomLevel );
+        QCOMPARE( result.size(), expected.size() );
+        QCOMPARE( toSet( result ), expected );
+    }
+
+    scene.clear();
+    qDeleteAll( placemarks );
+}
+
+}
+
+QTEST_MAIN( Marble::GeoGraphicsSceneTest )
+
+#include "GeoGraphicsSceneTest.moc"
@@ -0,0 +1,178 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QDateTime>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "PackedStoragePolicy.h"
+
+namespace Marble
+{
+
+class PackedStoragePolicyTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void packable_data();
+    void packable();
+    void storeAndReload();
+    void plainFiles();
+    void evictToCacheLimit();
+    void clearCache();
+    void containerInUse();
+};
+
+void PackedStoragePolicyTest::packable_data()
+{
+    QTest::addColumn<QString>( "fileName" );
+    QTest::addColumn<bool>( "packable" );
+
+    QTest::newRow( "osm layout" ) << "maps/earth/openstreetmap/5/10/12.png" << true;
+    QTest::newRow( "marble layout" ) << "maps/earth/bluemarble/3/000004/000004_000005.jpg" << true;
+    QTest::newRow( "vector tile" ) << "maps/earth/vectorosm/12/2148/1360.o5m" << false;
+    QTest::newRow( "theme file" ) << "maps/earth/openstreetmap/openstreetmap.dgml" << false;
+    QTest::newRow( "absolute" ) << "/maps/earth/openstreetmap/5/10/12.png" << false;
+}
+
+void PackedStoragePolicyTest::packable()
+{
+    QFETCH( QString, fileName );
+    QFETCH( bool, packable );
+
+    QCOMPARE( PackedStoragePolicy::isPackable( fileName ), packable );
+}
+
+void PackedStoragePolicyTest::storeAndReload()
+{
+    QTemporaryDir dataDirectory;
+    QVERIFY( dataDirectory.isValid() );
+
+    const QString fileName = "maps/earth/openstreetmap/5/10/12.png";
+    const QByteArray data( 1000, 'a' );
+    const QByteArray update( 500, 'b' );
+
+    {
+        PackedStoragePolicy policy( dataDirectory.path() );
+        QVERIFY( !policy.fileExists( fileName ) );
+        QVERIFY( !policy.lastModified( fileName ).isValid() );
+
+        QVERIFY( policy.updateFile( fileName, data ) );
+        QVERIFY( policy.fileExists( fileName ) );
+        QCOMPARE( policy.data( fileName ), data );
+        QVERIFY( policy.lastModified( fileName ).secsTo( QDateTime::currentDateTime() ) < 5 );
+
+        QVERIFY( policy.updateFile( fileName, update ) );
+        QCOMPARE( policy.data( fileName ), update );
+        QCOMPARE( policy.cacheSize(), quint64( update.size() ) );
+    }
+
+    // no file per tile
+    QVERIFY( !QFile::exists( dataDirectory.path() + '/' + fileName ) );
+
+    PackedStoragePolicy policy( dataDirectory.path() );
+    QVERIFY( policy.fileExists( fileName ) );
+    QCOMPARE( policy.data( fileName ), update );
+    QCOMPARE( policy.cacheSize(), quint64( update.size() ) );
+}
+
+void PackedStoragePolicyTest::plainFiles()
+{
+    QTemporaryDir dataDirectory;
+    QVERIFY( dataDirectory.isValid() );
+
+    const QString fileName = "maps/earth/vectorosm/12/2148/1360.o5m";
+
+    PackedStoragePolicy policy( dataDirectory.path() );
+    QVERIFY( policy.updateFile( fileName, QByteArray( "o5m" ) ) );
+    QVERIFY( policy.fileExists( fileName ) );
+    QVERIFY( QFile::exists( dataDirectory.path() + '/' + fileName ) );
+    QVERIFY( policy.data( fileName ).isEmpty() );
+    QCOMPARE( policy.cacheSize(), quint64( 0 ) );
+}
+
+void PackedStoragePolicyTest::evictToCacheLimit()
+{
+    QTemporaryDir dataDirectory;
+    QVERIFY( dataDirectory.isValid() );
+
+    PackedStoragePolicy policy( dataDirectory.path() );
+    policy.setCacheLimit( 3500 );
+
+    const QByteArray data( 1000, 'a' );
+    QVERIFY( policy.updateFile( "maps/earth/openstreetmap/8/1/1.png", data ) );
+    QVERIFY( policy.updateFile( "maps/earth/openstreetmap/8/1/2.png", data ) );
+    QVERIFY( policy.updateFile( "maps/earth/openstreetmap/8/1/3.png", data ) );
+    // tiles of the base levels are never evicted
+    QVERIFY( policy.updateFile( "maps/earth/openstreetmap/0/0/0.png", QByteArray( 100, 'b' ) ) );
+    QCOMPARE( policy.cacheSize(), quint64( 3100 ) );
+
+    // eviction happens in the background
+    QVERIFY( policy.updateFile( "maps/earth/openstreetmap/8/1/4.png", data ) );
+    QTRY_VERIFY( policy.cacheSize() <= 3500 );
+    QVERIFY( policy.fileExists( "maps/earth/openstreetmap/0/0/0.png" ) );
+}
+
+void PackedStoragePolicyTest::clearCache()
+{
+    QTemporaryDir dataDirectory;
+    QVERIFY( dataDirectory.isValid() );
+
+    {
+        PackedStoragePolicy policy( dataDirectory.path() );
+        QVERIFY( policy.updateFile( "maps/earth/openstreetmap/0/0/0.png", QByteArray( 100, 'a' ) ) );
+        QVERIFY( policy.updateFile( "maps/earth/openstreetmap/10/1/1.png", QByteArray( 100, 'a' ) ) );
+        QVERIFY( policy.updateFile( "maps/earth/bluemarble/10/000001/000001_000001.jpg", QByteArray( 100, 'a' ) ) );
+    }
+
+    PackedStoragePolicy policy( dataDirectory.path() );
+    policy.clearCache();
+
+    QVERIFY( policy.fileExists( "maps/earth/openstreetmap/0/0/0.png" ) );
+    QVERIFY( !policy.fileExists( "maps/earth/openstreetmap/10/1/1.png" ) );
+    QVERIFY( !policy.fileExists( "maps/earth/bluemarble/10/000001/000001_000001.jpg" ) );
+}
+
+void PackedStoragePolicyTest::containerInUse()
+{
+    QTemporaryDir dataDirectory;
+    QVERIFY( dataDirectory.isValid() );
+
+    const QString ownTile = "maps/earth/openstreetmap/5/10/12.png";
+    const QString otherTile = "maps/earth/openstreetmap/5/10/13.png";
+
+    {
+        PackedStoragePolicy policy( dataDirectory.path() );
+        QVERIFY( policy.updateFile( ownTile, QByteArray( 100, 'a' ) ) );
+
+        // behaves like a second Marble instance, which must neither see
+        // nor touch the packed tiles of the first one
+        PackedStoragePolicy other( dataDirectory.path() );
+        QVERIFY( !other.fileExists( ownTile ) );
+        QVERIFY( other.updateFile( otherTile, QByteArray( 100, 'b' ) ) );
+        QVERIFY( other.fileExists( otherTile ) );
+        QVERIFY( QFile::exists( dataDirectory.path() + '/' + otherTile ) );
+        QCOMPARE( other.cacheSize(), quint64( 0 ) );
+        other.clearCache();
+
+        QCOMPARE( policy.data( ownTile ), QByteArray( 100, 'a' ) );
+        QVERIFY( policy.data( otherTile ).isEmpty() );
+    }
+
+    PackedStoragePolicy policy( dataDirectory.path() );
+    QCOMPARE( policy.data( ownTile ), QByteArray( 100, 'a' ) );
+    QCOMPARE( policy.cacheSize(), quint64( 100 ) );
+}
+
+}
+
+QTEST_MAIN( Marble::PackedStoragePolicyTest )
+
+#include "PackedStoragePolicyTest.moc"
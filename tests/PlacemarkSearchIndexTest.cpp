@@ -0,0 +1,199 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "PlacemarkSearchIndex.h"
+
+#include "GeoDataLatLonBox.h"
+#include "GeoDataPlacemark.h"
+#include "MarblePlacemarkModel.h"
+
+#include <QStandardItemModel>
+#include <QStringList>
+#include <QTest>
+
+namespace Marble
+{
+
+class PlacemarkSearchIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void followsModelChanges();
+
+private:
+    void appendRows( int count );
+    void removeRows( int row, int count );
+    void rename( int row );
+    void reset();
+
+    static QString randomName();
+    static GeoDataPlacemark *placemark( const QStandardItem *item );
+
+    QStringList find( const PlacemarkSearchIndex &index, const QString &searchTerm, const GeoDataLatLonBox &preferred ) const;
+    QStringList scan( const QString &searchTerm, const GeoDataLatLonBox &preferred ) const;
+
+    QStandardItemModel m_model;
+    int m_nextId;
+};
+
+void PlacemarkSearchIndexTest::initTestCase()
+{
+    qsrand( 42 );
+    m_nextId = 0;
+}
+
+void PlacemarkSearchIndexTest::cleanup()
+{
+    removeRows( 0, m_model.rowCount() );
+}
+
+QString PlacemarkSearchIndexTest::randomName()
+{
+    // few letters, so that many names share their prefixes
+    static const QString letters = QString::fromUtf8( "abAéÉo" );
+    QString result;
+    const int length = 1 + qrand() % 3;
+    for ( int i = 0; i < length; ++i ) {
+        result += letters.at( qrand() % letters.size() );
+    }
+    return result;
+}
+
+GeoDataPlacemark *PlacemarkSearchIndexTest::placemark( const QStandardItem *item )
+{
+    GeoDataObject *object = qvariant_cast<GeoDataObject*>( item->data( MarblePlacemarkModel::ObjectPointerRole ) );
+    return static_cast<GeoDataPlacemark*>( object );
+}
+
+void PlacemarkSearchIndexTest::appendRows( int count )
+{
+    QList<QStandardItem*> items;
+    for ( int i = 0; i < count; ++i ) {
+        // the id keeps the names unique for comparing the results
+        const QString name = QString( "%1 %2" ).arg( randomName() ).arg( m_nextId++ );
+        GeoDataPlacemark *placemark = new GeoDataPlacemark( name );
+        placemark->setCoordinate( qrand() % 360 - 180, qrand() % 180 - 90, 0, GeoDataCoordinates::Degree );
+
+        QStandardItem *item = new QStandardItem( name );
+        item->setData( qVariantFromValue<GeoDataObject*>( placemark ), MarblePlacemarkModel::ObjectPointerRole );
+        items << item;
+    }
+
+    // all rows in one go, like a file being added
+    m_model.invisibleRootItem()->appendRows( items );
+}
+
+void PlacemarkSearchIndexTest::removeRows( int row, int count )
+{
+    QList<GeoDataPlacemark*> placemarks;
+    for ( int i = row; i < row + count; ++i ) {
+        placemarks << placemark( m_model.item( i ) );
+    }
+
+    // the index only gets to see the pointers of deleted placemarks
+    m_model.removeRows( row, count );
+    qDeleteAll( placemarks );
+}
+
+void PlacemarkSearchIndexTest::rename( int row )
+{
+    QStandardItem *const item = m_model.item( row );
+    const QString name = QString( "%1 %2" ).arg( randomName() ).arg( m_nextId++ );
+    placemark( item )->setName( name );
+    item->setText( name );
+}
+
+void PlacemarkSearchIndexTest::reset()
+{
+    QList<GeoDataPlacemark*> placemarks;
+    for ( int i = 0; i < m_model.rowCount(); ++i ) {
+        placemarks << placemark( m_model.item( i ) );
+    }
+
+    m_model.clear();
+    qDeleteAll( placemarks );
+}
+
+QStringList PlacemarkSearchIndexTest::find( const PlacemarkSearchIndex &index, const QString &searchTerm, const GeoDataLatLonBox &preferred ) const
+{
+    const QVector<GeoDataPlacemark*> placemarks = index.findPlacemarks( searchTerm, preferred );
+
+    QStringList result;
+    foreach ( const GeoDataPlacemark *placemark, placemarks ) {
+        result << placemark->name();
+    }
+    qDeleteAll( placemarks );
+
+    result.sort();
+    return result;
+}
+
+QStringList PlacemarkSearchIndexTest::scan( const QString &searchTerm, const GeoDataLatLonBox &preferred ) const
+{
+    const QString prefix = PlacemarkSearchIndex::normalized( searchTerm );
+
+    QStringList result;
+    for ( int i = 0; i < m_model.rowCount(); ++i ) {
+        const GeoDataPlacemark *placemark = this->placemark( m_model.item( i ) );
+        if ( PlacemarkSearchIndex::normalized( m_model.item( i )->text() ).startsWith( prefix )
+             && ( preferred.isEmpty() || preferred.contains( placemark->coordinate() ) ) ) {
+            result << placemark->name();
+        }
+    }
+
+    result.sort();
+    return result;
+}
+
+void PlacemarkSearchIndexTest::followsModelChanges()
+{
+    PlacemarkSearchIndex index;
+    appendRows( 200 );
+    index.setSourceModel( &m_model );
+    QCOMPARE( index.size(), 200 );
+
+    const QStringList searchTerms = QStringList() << "" << "a" << "A" << QString::fromUtf8( "é" ) << "ab" << "eo" << "oo" << "z";
+    const GeoDataLatLonBox everywhere;
+    // the boundaries lie between the integer coordinates of the placemarks
+    const GeoDataLatLonBox preferred( 45.5, -30.5, 100.5, -60.5, GeoDataCoordinates::Degree );
+
+    for ( int step = 0; step < 200; ++step ) {
+        // several changes between the searches, which merge them all at once
+        const int changes = 1 + qrand() % 4;
+        for ( int i = 0; i < changes; ++i ) {
+            const int rowCount = m_model.rowCount();
+            const int operation = qrand() % 20;
+            if ( operation == 0 ) {
+                reset();
+            } else if ( operation < 8 || rowCount == 0 ) {
+                appendRows( 1 + qrand() % 50 );
+            } else if ( operation < 15 ) {
+                const int row = qrand() % rowCount;
+                removeRows( row, 1 + qrand() % qMin( 30, rowCount - row ) );
+            } else {
+                rename( qrand() % rowCount );
+            }
+        }
+
+        QCOMPARE( index.size(), m_model.rowCount() );
+        foreach ( const QString &searchTerm, searchTerms ) {
+            QCOMPARE( find( index, searchTerm, everywhere ), scan( searchTerm, everywhere ) );
+            QCOMPARE( find( index, searchTerm, preferred ), scan( searchTerm, preferred ) );
+        }
+    }
+}
+
+}
+
+QTEST_MAIN( Marble::PlacemarkSearchIndexTest )
+
+#include "PlacemarkSearchIndexTest.moc"
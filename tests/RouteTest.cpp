@@ -0,0 +1,141 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "routing/Route.h"
+
+#include <QTest>
+#include <QVector>
+
+namespace Marble
+{
+
+class RouteTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void indexMatchesLinearSearch();
+
+private:
+    static qreal randomNumber( qreal min, qreal max );
+    static QVector<RouteSegment> randomSegments( int count );
+
+    void compare( const GeoDataCoordinates &position );
+
+    Route m_linear;
+    Route m_indexed;
+};
+
+void RouteTest::initTestCase()
+{
+    qsrand( 42 );
+}
+
+qreal RouteTest::randomNumber( qreal min, qreal max )
+{
+    return min + ( max - min ) * ( qrand() % 10001 ) / 10000.0;
+}
+
+QVector<RouteSegment> RouteTest::randomSegments( int count )
+{
+    // a random walk close to the equator, which may double back and cross itself
+    QVector<RouteSegment> result;
+    GeoDataCoordinates point( 10.0, 0.0, 0.0, GeoDataCoordinates::Degree );
+    for ( int i = 0; i < count; ++i ) {
+        // consecutive segments share their end and start points
+        GeoDataLineString path;
+        path << point;
+        const int size = 3 + qrand() % 6;
+        for ( int j = 1; j < size; ++j ) {
+            const qreal lon = point.longitude( GeoDataCoordinates::Degree ) + randomNumber( -0.05, 0.1 );
+            const qreal lat = qBound<qreal>( -1.0, point.latitude( GeoDataCoordinates::Degree ) + randomNumber( -0.05, 0.05 ), 1.0 );
+            point = GeoDataCoordinates( lon, lat, 0.0, GeoDataCoordinates::Degree );
+            path << point;
+        }
+
+        RouteSegment segment;
+        segment.setPath( path );
+        result << segment;
+    }
+
+    return result;
+}
+
+void RouteTest::compare( const GeoDataCoordinates &position )
+{
+    m_linear.setPosition( position );
+    m_indexed.setPosition( position );
+
+    QCOMPARE( m_indexed.indexOf( m_indexed.currentSegment() ), m_linear.indexOf( m_linear.currentSegment() ) );
+    QCOMPARE( m_indexed.currentWaypoint(), m_linear.currentWaypoint() );
+    QCOMPARE( m_indexed.positionOnRoute(), m_linear.positionOnRoute() );
+}
+
+void RouteTest::indexMatchesLinearSearch()
+{
+    const QVector<RouteSegment> segments = randomSegments( 60 );
+    foreach ( const RouteSegment &segment, segments ) {
+        m_linear.addRouteSegment( segment );
+        m_indexed.addRouteSegment( segment );
+    }
+    m_indexed.buildIndex();
+
+    qreal north, south, east, west;
+    m_linear.bounds().boundaries( north, south, east, west, GeoDataCoordinates::Degree );
+
+    for ( int step = 0; step < 2000; ++step ) {
+        const int operation = qrand() % 4;
+        if ( operation == 0 ) {
+            // close to a random point of the route
+            const GeoDataLineString &path = segments[qrand() % segments.size()].path();
+            const GeoDataCoordinates &point = path[qrand() % path.size()];
+            compare( GeoDataCoordinates( point.longitude( GeoDataCoordinates::Degree ) + randomNumber( -0.02, 0.02 ),
+                                         point.latitude( GeoDataCoordinates::Degree ) + randomNumber( -0.02, 0.02 ),
+                                         0.0, GeoDataCoordinates::Degree ) );
+        } else if ( operation == 1 ) {
+            // anywhere in the bounding box of the route
+            compare( GeoDataCoordinates( randomNumber( west, east ), randomNumber( south, north ),
+                                         0.0, GeoDataCoordinates::Degree ) );
+        } else if ( operation == 2 ) {
+            // outside of the bounding box, where the grid clamps the cell of the position
+            const qreal lon = qrand() % 2 ? west - randomNumber( 0.1, 20.0 ) : east + randomNumber( 0.1, 20.0 );
+            compare( GeoDataCoordinates( lon, randomNumber( -5.0, 5.0 ), 0.0, GeoDataCoordinates::Degree ) );
+            const qreal lat = qrand() % 2 ? south - randomNumber( 0.1, 4.0 ) : north + randomNumber( 0.1, 4.0 );
+            compare( GeoDataCoordinates( randomNumber( west - 1.0, east + 1.0 ), lat, 0.0, GeoDataCoordinates::Degree ) );
+        } else {
+            // The shared point of two segments is equally close to both. Each
+            // of them is kept when the position arrives from inside of it.
+            const int segment = qrand() % ( segments.size() - 1 );
+            const GeoDataLineString &path = segments[segment].path();
+            const GeoDataLineString &nextPath = segments[segment+1].path();
+            const GeoDataCoordinates shared = nextPath.first();
+
+            compare( path[1] );
+            QCOMPARE( m_indexed.indexOf( m_indexed.currentSegment() ), segment );
+            compare( shared );
+            QCOMPARE( m_indexed.indexOf( m_indexed.currentSegment() ), segment );
+
+            compare( nextPath[1] );
+            QCOMPARE( m_indexed.indexOf( m_indexed.currentSegment() ), segment + 1 );
+            compare( shared );
+            QCOMPARE( m_indexed.indexOf( m_indexed.currentSegment() ), segment + 1 );
+        }
+
+        if ( QTest::currentTestFailed() ) {
+            return;
+        }
+    }
+}
+
+}
+
+QTEST_MAIN( Marble::RouteTest )
+
+#include "RouteTest.moc"
@@ -0,0 +1,171 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "StackedTile.h"
+#include "StackedTile_p.h"
+#include "TextureTile.h"
+#include "TileId.h"
+
+#include <QImage>
+#include <QTest>
+#include <QVector>
+
+namespace Marble
+{
+
+class StackedTileTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void interpolateLine_data();
+    void interpolateLine();
+    void pixelsFAtEdges_data();
+    void pixelsFAtEdges();
+
+private:
+    static bool isClose( uint a, uint b, int tolerance );
+
+    QImage m_image;
+};
+
+void StackedTileTest::initTestCase()
+{
+    qsrand( 42 );
+
+    // the padding of each scan line is not part of the image
+    m_image = QImage( 61, 47, QImage::Format_ARGB32 );
+    for ( int y = 0; y < m_image.height(); ++y ) {
+        for ( int x = 0; x < m_image.width(); ++x ) {
+            m_image.setPixel( x, y, qRgb( qrand() % 256, qrand() % 256, qrand() % 256 ) );
+        }
+    }
+}
+
+bool StackedTileTest::isClose( uint a, uint b, int tolerance )
+{
+    for ( int shift = 0; shift < 32; shift += 8 ) {
+        if ( qAbs( int( ( a >> shift ) & 0xff ) - int( ( b >> shift ) & 0xff ) ) > tolerance ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void StackedTileTest::interpolateLine_data()
+{
+    QTest::addColumn<qreal>( "x" );
+    QTest::addColumn<qreal>( "y" );
+    QTest::addColumn<qreal>( "stepX" );
+    QTest::addColumn<qreal>( "stepY" );
+    QTest::addColumn<int>( "count" );
+
+    // the kernels handle four or eight pixels at a time plus a remainder
+    QTest::newRow( "one" ) << 3.25 << 7.75 << 0.5 << 0.0 << 1;
+    QTest::newRow( "three" ) << 0.0 << 0.0 << 1.3 << 0.7 << 3;
+    QTest::newRow( "four" ) << 10.1 << 20.9 << -0.9 << 0.4 << 4;
+    QTest::newRow( "five" ) << 50.5 << 40.5 << -1.7 << -1.1 << 5;
+    QTest::newRow( "seven" ) << 12.3 << 3.3 << 0.0 << 2.1 << 7;
+    QTest::newRow( "nine" ) << 2.01 << 44.9 << 1.03 << -0.31 << 9;
+    QTest::newRow( "fifteen" ) << 58.9 << 1.2 << -3.7 << 2.9 << 15;
+    QTest::newRow( "seventeen" ) << 0.999 << 0.001 << 0.999 << 0.333 << 17;
+    QTest::newRow( "integer positions" ) << 5.0 << 5.0 << 1.0 << 1.0 << 33;
+    QTest::newRow( "last texels" ) << 59.98 << 45.98 << -0.001 << -0.001 << 11;
+}
+
+void StackedTileTest::interpolateLine()
+{
+    QFETCH( qreal, x );
+    QFETCH( qreal, y );
+    QFETCH( qreal, stepX );
+    QFETCH( qreal, stepY );
+    QFETCH( int, count );
+
+    const StackedTile tile( TileId(), m_image, QVector<QSharedPointer<TextureTile> >() );
+    const uint *const bits = reinterpret_cast<const uint *>( m_image.constBits() );
+    const int stride = m_image.bytesPerLine() / 4;
+
+    QVector<uint> generic( count );
+    interpolateLineGeneric( bits, stride, x, y, stepX, stepY, generic.data(), count );
+
+    QVector<uint> pixels( count );
+    tile.pixelsF( x, y, stepX, stepY, pixels.data(), count );
+
+    // the kernels truncate 8 bit weights and each intermediate result,
+    // pixelF() interpolates in floating point and truncates once
+    for ( int i = 0; i < count; ++i ) {
+        const uint expected = tile.pixelF( x + stepX * i, y + stepY * i );
+        QVERIFY2( isClose( generic[i], expected, 4 ), qPrintable( QString::number( i ) ) );
+        QVERIFY2( isClose( pixels[i], expected, 4 ), qPrintable( QString::number( i ) ) );
+    }
+
+#ifdef MARBLE_HAVE_SSE2
+    // the remainder starts from a rebased position, which may round differently
+    QVector<uint> sse2( count );
+    interpolateLineSse2( bits, stride, x, y, stepX, stepY, sse2.data(), count );
+    for ( int i = 0; i < count; ++i ) {
+        QVERIFY2( isClose( sse2[i], generic[i], 1 ), qPrintable( QString::number( i ) ) );
+    }
+#endif
+
+#ifdef MARBLE_HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        // single precision positions may end up with slightly different weights
+        QVector<uint> avx2( count );
+        interpolateLineAvx2( bits, stride, x, y, stepX, stepY, avx2.data(), count );
+        for ( int i = 0; i < count; ++i ) {
+            QVERIFY2( isClose( avx2[i], generic[i], 2 ), qPrintable( QString::number( i ) ) );
+        }
+    }
+#endif
+}
+
+void StackedTileTest::pixelsFAtEdges_data()
+{
+    QTest::addColumn<qreal>( "x" );
+    QTest::addColumn<qreal>( "y" );
+    QTest::addColumn<qreal>( "stepX" );
+    QTest::addColumn<qreal>( "stepY" );
+    QTest::addColumn<int>( "count" );
+
+    // the lines reach the last column or row, where pixelF() clamps the texels
+    QTest::newRow( "right edge" ) << 40.5 << 10.25 << 1.0 << 0.5 << 21;
+    QTest::newRow( "bottom edge" ) << 3.75 << 30.5 << 0.25 << 1.0 << 17;
+    QTest::newRow( "bottom right corner" ) << 50.0 << 36.0 << 0.5 << 0.5 << 21;
+    QTest::newRow( "from the corner" ) << 60.0 << 46.0 << -1.3 << -0.9 << 9;
+    QTest::newRow( "along the last row" ) << 0.5 << 46.0 << 2.5 << 0.0 << 7;
+    QTest::newRow( "along the last column" ) << 60.0 << 0.25 << 0.0 << 3.0 << 15;
+}
+
+void StackedTileTest::pixelsFAtEdges()
+{
+    QFETCH( qreal, x );
+    QFETCH( qreal, y );
+    QFETCH( qreal, stepX );
+    QFETCH( qreal, stepY );
+    QFETCH( int, count );
+
+    const StackedTile tile( TileId(), m_image, QVector<QSharedPointer<TextureTile> >() );
+
+    QVector<uint> pixels( count );
+    tile.pixelsF( x, y, stepX, stepY, pixels.data(), count );
+
+    for ( int i = 0; i < count; ++i ) {
+        QCOMPARE( pixels[i], tile.pixelF( x + stepX * i, y + stepY * i ) );
+    }
+}
+
+}
+
+QTEST_MAIN( Marble::StackedTileTest )
+
+#include "StackedTileTest.moc"
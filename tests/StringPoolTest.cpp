@@ -0,0 +1,82 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "StringPool.h"
+
+#include "GeoDataPlacemark.h"
+#include "osm/OsmPlacemarkData.h"
+
+#include <QTest>
+
+namespace Marble
+{
+
+class StringPoolTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void intern();
+    void featureProperties();
+    void osmTags();
+};
+
+void StringPoolTest::intern()
+{
+    const QString first = StringPool::intern( QString( "highway" ) );
+    const int size = StringPool::size();
+    const QString second = StringPool::intern( QString( "high" ) + QString( "way" ) );
+
+    QCOMPARE( second, QString( "highway" ) );
+    QCOMPARE( second.constData(), first.constData() );
+    QCOMPARE( StringPool::size(), size );
+
+    QVERIFY( StringPool::intern( QString( "" ) ).isNull() );
+    QCOMPARE( StringPool::size(), size );
+}
+
+void StringPoolTest::featureProperties()
+{
+    GeoDataPlacemark first;
+    GeoDataPlacemark second;
+    first.setStyleUrl( QString( "#style" ) );
+    second.setStyleUrl( QString( "#st" ) + QString( "yle" ) );
+    first.setCountryCode( QString( "DE" ) );
+    second.setCountryCode( QString( "D" ) + QString( "E" ) );
+
+    QCOMPARE( first.styleUrl().constData(), second.styleUrl().constData() );
+    QCOMPARE( first.countryCode().constData(), second.countryCode().constData() );
+}
+
+void StringPoolTest::osmTags()
+{
+    OsmPlacemarkData first;
+    OsmPlacemarkData second;
+    first.addTag( QString( "building" ), QString( "yes" ) );
+    second.addTag( QString( "build" ) + QString( "ing" ), QString( "y" ) + QString( "es" ) );
+    QCOMPARE( first.tagValue( "building" ).constData(), second.tagValue( "building" ).constData() );
+    QCOMPARE( first.tagsBegin().key().constData(), second.tagsBegin().key().constData() );
+
+    // names are mostly unique and not kept in the pool
+    second.addTag( QString( "name" ), QString( "Another Name" ) );
+    const int size = StringPool::size();
+    first.addTag( QString( "name" ), QString( "Unique Name" ) );
+    QCOMPARE( StringPool::size(), size );
+    QCOMPARE( first.tagValue( "name" ), QString( "Unique Name" ) );
+
+    // neither are values of keys with many distinct values
+    first.addTag( QString( "addr:street" ), QString( "Main Street" ) );
+    first.addTag( QString( "ele" ), QString( "1234" ) );
+    QCOMPARE( StringPool::size(), size + 2 );
+}
+
+}
+
+QTEST_MAIN( Marble::StringPoolTest )
+
+#include "StringPoolTest.moc"
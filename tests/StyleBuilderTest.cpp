@@ -0,0 +1,100 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QScopedPointer>
+#include <QTest>
+
+#include "GeoDataLineString.h"
+#include "GeoDataLineStyle.h"
+#include "GeoDataPlacemark.h"
+#include "StyleBuilder.h"
+#include "osm/OsmPlacemarkData.h"
+
+namespace Marble
+{
+
+class StyleBuilderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void sharedStyles();
+    void tagsAndTileLevel();
+    void reset();
+};
+
+static GeoDataPlacemark *createHighway( GeoDataFeature::GeoDataVisualCategory category, const QString &name,
+                                        const QString &oneway = QString() )
+{
+    GeoDataPlacemark *placemark = new GeoDataPlacemark( name );
+    GeoDataLineString *lineString = new GeoDataLineString;
+    *lineString << GeoDataCoordinates( 0.1, 0.1 ) << GeoDataCoordinates( 0.2, 0.2 );
+    placemark->setGeometry( lineString );
+    placemark->setVisualCategory( category );
+    OsmPlacemarkData osmData;
+    osmData.addTag( "name", name );
+    if ( !oneway.isEmpty() ) {
+        osmData.addTag( "oneway", oneway );
+    }
+    placemark->setOsmData( osmData );
+    return placemark;
+}
+
+void StyleBuilderTest::sharedStyles()
+{
+    StyleBuilder styleBuilder;
+    QScopedPointer<GeoDataPlacemark> first( createHighway( GeoDataFeature::HighwayPrimary, "First Street" ) );
+    QScopedPointer<GeoDataPlacemark> second( createHighway( GeoDataFeature::HighwayPrimary, "Second Street" ) );
+
+    // tags not affecting the style, like the name, don't prevent sharing
+    const GeoDataStyle::ConstPtr style = styleBuilder.createStyle( StyleParameters( first.data(), 12 ) );
+    QVERIFY( style );
+    QCOMPARE( styleBuilder.createStyle( StyleParameters( second.data(), 12 ) ), style );
+    QCOMPARE( styleBuilder.createStyle( StyleParameters( first.data(), 14 ) ), style );
+    QVERIFY( style->lineStyle().cosmeticOutline() );
+}
+
+void StyleBuilderTest::tagsAndTileLevel()
+{
+    StyleBuilder styleBuilder;
+    QScopedPointer<GeoDataPlacemark> twoWay( createHighway( GeoDataFeature::HighwaySecondary, "Main Street" ) );
+    QScopedPointer<GeoDataPlacemark> oneWay( createHighway( GeoDataFeature::HighwaySecondary, "Main Street", "yes" ) );
+    QScopedPointer<GeoDataPlacemark> motorway( createHighway( GeoDataFeature::HighwayMotorway, "Main Street" ) );
+
+    const GeoDataStyle::ConstPtr twoWayStyle = styleBuilder.createStyle( StyleParameters( twoWay.data(), 12 ) );
+    const GeoDataStyle::ConstPtr oneWayStyle = styleBuilder.createStyle( StyleParameters( oneWay.data(), 12 ) );
+    QVERIFY( twoWayStyle != oneWayStyle );
+    QCOMPARE( twoWayStyle->lineStyle().physicalWidth(), float( 6.0 ) );
+    QCOMPARE( oneWayStyle->lineStyle().physicalWidth(), float( 4.0 ) );
+    QVERIFY( styleBuilder.createStyle( StyleParameters( motorway.data(), 12 ) ) != twoWayStyle );
+
+    // low tile levels ignore the lanes
+    const GeoDataStyle::ConstPtr lowStyle = styleBuilder.createStyle( StyleParameters( twoWay.data(), 5 ) );
+    QCOMPARE( styleBuilder.createStyle( StyleParameters( oneWay.data(), 5 ) ), lowStyle );
+    QCOMPARE( lowStyle->lineStyle().physicalWidth(), float( 0.0 ) );
+    QCOMPARE( lowStyle->lineStyle().width(), float( 3.0 ) );
+    QCOMPARE( styleBuilder.createStyle( StyleParameters( twoWay.data(), 8 ) )->lineStyle().width(), float( 4.0 ) );
+}
+
+void StyleBuilderTest::reset()
+{
+    StyleBuilder styleBuilder;
+    QScopedPointer<GeoDataPlacemark> placemark( createHighway( GeoDataFeature::HighwayResidential, "Side Street" ) );
+
+    const GeoDataStyle::ConstPtr style = styleBuilder.createStyle( StyleParameters( placemark.data(), 16 ) );
+    styleBuilder.reset();
+    const GeoDataStyle::ConstPtr newStyle = styleBuilder.createStyle( StyleParameters( placemark.data(), 16 ) );
+    QVERIFY( newStyle != style );
+    QCOMPARE( newStyle->lineStyle(), style->lineStyle() );
+}
+
+}
+
+QTEST_MAIN( Marble::StyleBuilderTest )
+
+#include "StyleBuilderTest.moc"
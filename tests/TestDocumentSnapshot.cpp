@@ -0,0 +1,272 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QObject>
+#include <QTemporaryFile>
+#include <qmath.h>
+
+#include "TestUtils.h"
+#include <DocumentSnapshot.h>
+#include <GeoDataBalloonStyle.h>
+#include <GeoDataDocument.h>
+#include <GeoDataExtendedData.h>
+#include <GeoDataFolder.h>
+#include <GeoDataLineStyle.h>
+#include <GeoDataLinearRing.h>
+#include <GeoDataMultiGeometry.h>
+#include <GeoDataPlacemark.h>
+#include <GeoDataPoint.h>
+#include <GeoDataPolygon.h>
+#include <GeoDataPolyStyle.h>
+#include <GeoDataSnippet.h>
+#include <GeoDataStyle.h>
+#include <GeoDataStyleMap.h>
+#include <GeoDataTimeStamp.h>
+
+using namespace Marble;
+
+class TestDocumentSnapshot : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void roundTrip();
+    void optimizedLineString();
+    void unsupportedData();
+    void invalidFiles();
+};
+
+static const char *const snapshotKml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+    "<kml xmlns=\"http://www.opengis.net/kml/2.2\">"
+    "<Document>"
+    "  <name>Snapshot</name>"
+    "  <Style id=\"river\"><LineStyle><color>ff0000ff</color><width>3</width></LineStyle></Style>"
+    "  <Style id=\"lake\"><PolyStyle><fill>0</fill></PolyStyle></Style>"
+    "  <StyleMap id=\"riverMap\"><Pair><key>normal</key><styleUrl>#river</styleUrl></Pair></StyleMap>"
+    "  <Folder>"
+    "    <name>Water</name>"
+    "    <Placemark>"
+    "      <name>River</name>"
+    "      <styleUrl>#riverMap</styleUrl>"
+    "      <ExtendedData><Data name=\"length\"><value>42</value></Data></ExtendedData>"
+    "      <LineString><coordinates>1,2 3,4,5 6,7</coordinates></LineString>"
+    "    </Placemark>"
+    "    <Placemark>"
+    "      <name>Lake</name>"
+    "      <description>With an island</description>"
+    "      <Snippet maxLines=\"2\">Lake with an island</Snippet>"
+    "      <styleUrl>#lake</styleUrl>"
+    "      <Polygon>"
+    "        <outerBoundaryIs><LinearRing><coordinates>0,0 10,0 10,10 0,10 0,0</coordinates></LinearRing></outerBoundaryIs>"
+    "        <innerBoundaryIs><LinearRing><coordinates>4,4 6,4 6,6 4,4</coordinates></LinearRing></innerBoundaryIs>"
+    "      </Polygon>"
+    "    </Placemark>"
+    "  </Folder>"
+    "  <Placemark>"
+    "    <name>Islands</name>"
+    "    <MultiGeometry>"
+    "      <Point><coordinates>20,30,100</coordinates></Point>"
+    "      <LineString><coordinates>21,31 22,32</coordinates></LineString>"
+    "    </MultiGeometry>"
+    "  </Placemark>"
+    "</Document>"
+    "</kml>";
+
+void TestDocumentSnapshot::roundTrip()
+{
+    GeoDataDocument *source = parseKml( snapshotKml );
+    QVERIFY( source != 0 );
+    GeoDataFeature *sourceLake = static_cast<GeoDataFolder*>( source->child( 0 ) )->child( 1 );
+    sourceLake->setAddress( "Lakeside 1" );
+    sourceLake->setPhoneNumber( "+1 555 0100" );
+
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+    file.close();
+
+    QString error;
+    QVERIFY( DocumentSnapshot::write( *source, file.fileName(), error ) );
+    GeoDataDocument *document = DocumentSnapshot::read( file.fileName(), error );
+    QVERIFY( document != 0 );
+    QVERIFY( error.isEmpty() );
+
+    QCOMPARE( document->name(), QString( "Snapshot" ) );
+    QCOMPARE( document->size(), 2 );
+    QCOMPARE( document->styles().size(), 2 );
+    QCOMPARE( document->style( "river" )->lineStyle().width(), float( 3 ) );
+    QCOMPARE( document->style( "river" )->lineStyle().color(), source->style( "river" )->lineStyle().color() );
+    QVERIFY( !document->style( "lake" )->polyStyle().fill() );
+    QCOMPARE( document->styleMap( "riverMap" ).value( "normal" ), QString( "#river" ) );
+
+    const GeoDataFolder *folder = dynamic_cast<const GeoDataFolder*>( document->child( 0 ) );
+    QVERIFY( folder != 0 );
+    QCOMPARE( folder->name(), QString( "Water" ) );
+    QCOMPARE( folder->size(), 2 );
+
+    const GeoDataPlacemark *river = dynamic_cast<const GeoDataPlacemark*>( folder->child( 0 ) );
+    QVERIFY( river != 0 );
+    QCOMPARE( river->styleUrl(), QString( "#riverMap" ) );
+    QCOMPARE( river->extendedData().value( "length" ).value().toString(), QString( "42" ) );
+    const GeoDataLineString *lineString = dynamic_cast<const GeoDataLineString*>( river->geometry() );
+    QVERIFY( lineString != 0 );
+    QCOMPARE( *lineString, *static_cast<const GeoDataLineString*>( static_cast<const GeoDataPlacemark*>(
+                  static_cast<const GeoDataFolder*>( source->child( 0 ) )->child( 0 ) )->geometry() ) );
+    QCOMPARE( lineString->at( 1 ).altitude(), 5.0 );
+
+    const GeoDataPlacemark *lake = dynamic_cast<const GeoDataPlacemark*>( folder->child( 1 ) );
+    QVERIFY( lake != 0 );
+    QCOMPARE( lake->description(), QString( "With an island" ) );
+    QCOMPARE( lake->snippet().text(), QString( "Lake with an island" ) );
+    QCOMPARE( lake->snippet().maxLines(), 2 );
+    QCOMPARE( lake->address(), QString( "Lakeside 1" ) );
+    QCOMPARE( lake->phoneNumber(), QString( "+1 555 0100" ) );
+    const GeoDataPolygon *polygon = dynamic_cast<const GeoDataPolygon*>( lake->geometry() );
+    QVERIFY( polygon != 0 );
+    QCOMPARE( polygon->outerBoundary().size(), 5 );
+    QCOMPARE( polygon->innerBoundaries().size(), 1 );
+    QCOMPARE( polygon->innerBoundaries().first().size(), 4 );
+    QFUZZYCOMPARE( polygon->innerBoundaries().first().at( 1 ).longitude( GeoDataCoordinates::Degree ), 6.0, 1e-9 );
+
+    const GeoDataPlacemark *islands = dynamic_cast<const GeoDataPlacemark*>( document->child( 1 ) );
+    QVERIFY( islands != 0 );
+    const GeoDataMultiGeometry *multiGeometry = dynamic_cast<const GeoDataMultiGeometry*>( islands->geometry() );
+    QVERIFY( multiGeometry != 0 );
+    QCOMPARE( multiGeometry->size(), 2 );
+    const GeoDataPoint *point = dynamic_cast<const GeoDataPoint*>( multiGeometry->child( 0 ) );
+    QVERIFY( point != 0 );
+    QFUZZYCOMPARE( point->coordinates().latitude( GeoDataCoordinates::Degree ), 30.0, 1e-9 );
+    QCOMPARE( point->coordinates().altitude(), 100.0 );
+    QVERIFY( dynamic_cast<const GeoDataLineString*>( multiGeometry->child( 1 ) ) != 0 );
+
+    delete document;
+    delete source;
+}
+
+void TestDocumentSnapshot::optimizedLineString()
+{
+    GeoDataLineString lineString;
+    for ( int i = 0; i <= 100; ++i ) {
+        lineString << GeoDataCoordinates( i * 0.1, qSin( i * 0.3 ) * ( i % 7 ) * 0.05, 0.0, GeoDataCoordinates::Degree );
+    }
+    GeoDataLineString const optimized = lineString.optimized();
+    QVERIFY( optimized.hasLevelIndices() );
+
+    GeoDataDocument source;
+    GeoDataPlacemark *placemark = new GeoDataPlacemark( "Coast" );
+    placemark->setGeometry( new GeoDataLineString( optimized ) );
+    source.append( placemark );
+
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+    file.close();
+
+    QString error;
+    QVERIFY( DocumentSnapshot::write( source, file.fileName(), error ) );
+    GeoDataDocument *document = DocumentSnapshot::read( file.fileName(), error );
+    QVERIFY( document != 0 );
+
+    const GeoDataPlacemark *coast = dynamic_cast<const GeoDataPlacemark*>( document->child( 0 ) );
+    QVERIFY( coast != 0 );
+    const GeoDataLineString *restored = dynamic_cast<const GeoDataLineString*>( coast->geometry() );
+    QVERIFY( restored != 0 );
+    QCOMPARE( restored->size(), optimized.size() );
+    for ( int i = 0; i < optimized.size(); ++i ) {
+        QCOMPARE( restored->at( i ).detail(), optimized.at( i ).detail() );
+    }
+
+    // the projections rely on the level indices
+    QVERIFY( restored->hasLevelIndices() );
+    for ( int level = 1; level <= 17; ++level ) {
+        QCOMPARE( restored->levelIndices( level ), optimized.levelIndices( level ) );
+    }
+
+    delete document;
+}
+
+void TestDocumentSnapshot::unsupportedData()
+{
+    // such documents are read from the source file instead of losing data
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+    file.close();
+
+    {
+        GeoDataDocument source;
+        GeoDataPlacemark *placemark = new GeoDataPlacemark( "Event" );
+        GeoDataTimeStamp timeStamp;
+        timeStamp.setWhen( QDateTime( QDate( 2015, 6, 1 ) ) );
+        placemark->setTimeStamp( timeStamp );
+        source.append( placemark );
+
+        QString error;
+        QVERIFY( !DocumentSnapshot::write( source, file.fileName(), error ) );
+        QVERIFY( !error.isEmpty() );
+    }
+
+    {
+        GeoDataDocument source;
+        GeoDataStyle::Ptr style( new GeoDataStyle );
+        style->setId( "balloon" );
+        style->balloonStyle().setText( "$[name]" );
+        source.addStyle( style );
+
+        QString error;
+        QVERIFY( !DocumentSnapshot::write( source, file.fileName(), error ) );
+        QVERIFY( !error.isEmpty() );
+    }
+}
+
+void TestDocumentSnapshot::invalidFiles()
+{
+    GeoDataDocument *source = parseKml( snapshotKml );
+    QVERIFY( source != 0 );
+
+    QTemporaryFile file;
+    QVERIFY( file.open() );
+    file.close();
+    QString error;
+    QVERIFY( DocumentSnapshot::write( *source, file.fileName(), error ) );
+    delete source;
+
+    QVERIFY( file.open() );
+    QByteArray const contents = file.readAll();
+    file.close();
+
+    // truncated
+    QTemporaryFile truncated;
+    QVERIFY( truncated.open() );
+    truncated.write( contents.left( contents.size() / 2 ) );
+    truncated.close();
+    error.clear();
+    QVERIFY( DocumentSnapshot::read( truncated.fileName(), error ) == 0 );
+    QVERIFY( !error.isEmpty() );
+
+    // a different format version
+    QByteArray otherVersion = contents;
+    otherVersion[4] = otherVersion[4] + 1;
+    QTemporaryFile newer;
+    QVERIFY( newer.open() );
+    newer.write( otherVersion );
+    newer.close();
+    error.clear();
+    QVERIFY( DocumentSnapshot::read( newer.fileName(), error ) == 0 );
+    QVERIFY( !error.isEmpty() );
+
+    // not a snapshot at all
+    QTemporaryFile kml;
+    QVERIFY( kml.open() );
+    kml.write( snapshotKml );
+    kml.close();
+    error.clear();
+    QVERIFY( DocumentSnapshot::read( kml.fileName(), error ) == 0 );
+    QVERIFY( !error.isEmpty() );
+}
+
+QTEST_MAIN( TestDocumentSnapshot )
+
+#include "TestDocumentSnapshot.moc"
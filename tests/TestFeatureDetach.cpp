@@ -11,11 +11,13 @@
 #include <QObject>
 
 #include "GeoDataContainer.h"
+#include "GeoDataData.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataCamera.h"
 #include "MarbleGlobal.h"
 #include "GeoDataPlaylist.h"
 #include "GeoDataTour.h"
+#include "osm/OsmPlacemarkData.h"
 #include "TestUtils.h"
 
 
@@ -67,6 +69,12 @@ private Q_SLOTS:
      */
     void testGeometryParentInPlacemark();
 
+    /**
+     * @brief testExtras shows that the rarely used properties, which are
+     * allocated on first use, are copied on detach and compare by value.
+     */
+    void testExtras();
+
 };
 
 void TestFeatureDetach::testFeature()
@@ -148,6 +156,31 @@ void TestFeatureDetach::testGeometryParentInPlacemark()
 
 }
 
+void TestFeatureDetach::testExtras()
+{
+    GeoDataFeature feat1;
+    feat1.setDescription("Description1");
+
+    GeoDataFeature feat2 = feat1;
+    feat2.setDescription("Description2");
+    feat2.extendedData().addValue(GeoDataData("key", QVariant("value")));
+    QVERIFY(feat1.description() == "Description1");
+    QVERIFY(feat1.extendedData().isEmpty());
+
+    // An allocated but unchanged set of properties equals a missing one
+    GeoDataPlacemark place1;
+    GeoDataPlacemark place2;
+    place2.setAddress(QString());
+    QVERIFY(place1 == place2);
+    QVERIFY(place1.snippet() == place2.snippet());
+
+    // Reading OSM data doesn't add any to the placemark
+    const GeoDataPlacemark place3;
+    QVERIFY(place3.osmData().isNull());
+    QVERIFY(!place3.hasOsmData());
+    QVERIFY(place3.extendedData().isEmpty());
+}
+
 QTEST_MAIN( Marble::TestFeatureDetach )
 
 #include "TestFeatureDetach.moc"
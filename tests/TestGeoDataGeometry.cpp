@@ -26,6 +26,9 @@ private Q_SLOTS:
     void deleteAndDetachTest1();
     void deleteAndDetachTest2();
     void deleteAndDetachTest3();
+    void packedStorageTest();
+    void packedStorageDetachTest();
+    void levelIndicesTest();
 };
 
 void TestGeoDataGeometry::downcastPointTest_data()
@@ -85,6 +88,110 @@ void TestGeoDataGeometry::deleteAndDetachTest3()
     line2 << GeoDataCoordinates();
 }
 
+void TestGeoDataGeometry::packedStorageTest()
+{
+    GeoDataLinearRing ring;
+    ring << GeoDataCoordinates( 0.1, 0.2 )
+         << GeoDataCoordinates( 0.3, 0.4, 100.0 )
+         << GeoDataCoordinates( 0.5, 0.6, 0.0, GeoDataCoordinates::Radian, 7 );
+    const GeoDataLinearRing original = ring;
+    const GeoDataLatLonAltBox box = ring.latLonAltBox();
+
+    ring.setPackedStorage( true );
+    QVERIFY( ring.hasPackedStorage() );
+    QCOMPARE( ring.size(), 3 );
+    QCOMPARE( ring.packedLongitudes().size(), 3 );
+    QCOMPARE( ring.packedLatitudes().at( 1 ), 0.4 );
+    QCOMPARE( ring.packedAltitudes().at( 1 ), 100.0 );
+    QCOMPARE( int( ring.packedDetails().at( 2 ) ), 7 );
+    QCOMPARE( ring.latLonAltBox(), box );
+    QCOMPARE( ring.length( 1.0 ), original.length( 1.0 ) );
+
+    // read access keeps the storage packed
+    const GeoDataLinearRing &packed = ring;
+    QCOMPARE( packed.at( 1 ), original.at( 1 ) );
+    QCOMPARE( packed.last().detail(), original.last().detail() );
+    QVERIFY( packed == original );
+    QVERIFY( packed.hasPackedStorage() );
+
+    ring << GeoDataCoordinates( 0.7, 0.8 );
+    QVERIFY( ring.hasPackedStorage() );
+    QCOMPARE( ring.size(), 4 );
+    QCOMPARE( packed.at( 3 ), GeoDataCoordinates( 0.7, 0.8 ) );
+    QCOMPARE( ring.packedAltitudes().size(), 4 );
+
+    ring.remove( 3 );
+    QVERIFY( !ring.hasPackedStorage() );
+    QVERIFY( ring.packedLongitudes().isEmpty() );
+    QVERIFY( ring == original );
+}
+
+void TestGeoDataGeometry::packedStorageDetachTest()
+{
+    GeoDataLineString line1;
+    line1 << GeoDataCoordinates( 0.1, 0.2 ) << GeoDataCoordinates( 0.3, 0.4 );
+    line1.setPackedStorage( true );
+
+    GeoDataLineString line2 = line1;
+    line2[0].setLongitude( 0.5 );
+
+    const GeoDataLineString &packed = line1;
+    QVERIFY( packed.hasPackedStorage() );
+    QVERIFY( !line2.hasPackedStorage() );
+    QCOMPARE( packed.at( 0 ).longitude(), 0.1 );
+    QCOMPARE( line2.at( 0 ).longitude(), 0.5 );
+}
+
+void TestGeoDataGeometry::levelIndicesTest()
+{
+    // a zigzag line with decreasing amplitude
+    GeoDataLineString line;
+    for ( int i = 0; i <= 64; ++i ) {
+        qreal const amplitude = ( i % 2 ? 1.0 : -1.0 ) / ( 1 << ( i % 8 ) );
+        line << GeoDataCoordinates( i * 0.1, amplitude, 0.0, GeoDataCoordinates::Degree );
+    }
+    QVERIFY( !line.hasLevelIndices() );
+    QVERIFY( line.levelIndices( 10 ).isEmpty() );
+
+    GeoDataLineString optimized = line.optimized();
+    // non-const access to the nodes would drop the indices
+    const GeoDataLineString &lod = optimized;
+    QVERIFY( optimized.hasLevelIndices() );
+    QCOMPARE( optimized.levelIndices( 17 ).size(), line.size() );
+
+    // each level contains the nodes of the lower levels, in order
+    const int startLevel = lod.first().detail();
+    QVERIFY( startLevel > 0 );
+    QCOMPARE( int( lod.last().detail() ), startLevel );
+    QVector<int> previous;
+    for ( int level = 1; level <= 17; ++level ) {
+        const QVector<int> indices = optimized.levelIndices( level );
+        if ( level < startLevel ) {
+            QVERIFY( indices.isEmpty() );
+            continue;
+        }
+        QCOMPARE( indices.first(), 0 );
+        QCOMPARE( indices.last(), line.size() - 1 );
+        for ( int i = 0; i < indices.size(); ++i ) {
+            QVERIFY( lod.at( indices[i] ).detail() <= level );
+            QVERIFY( i == 0 || indices[i - 1] < indices[i] );
+        }
+        foreach ( int index, previous ) {
+            QVERIFY( indices.contains( index ) );
+        }
+        previous = indices;
+    }
+    QVERIFY( optimized.levelIndices( startLevel ).size() < optimized.levelIndices( 17 ).size() );
+
+    // packing keeps the indices, modifications drop them
+    optimized.setPackedStorage( true );
+    QCOMPARE( optimized.levelIndices( 17 ).size(), line.size() );
+    optimized.setPackedStorage( false );
+    QCOMPARE( optimized.levelIndices( 17 ).size(), line.size() );
+    optimized << GeoDataCoordinates( 0.0, 0.0 );
+    QVERIFY( !optimized.hasLevelIndices() );
+}
+
 QTEST_MAIN( TestGeoDataGeometry )
 #include "TestGeoDataGeometry.moc"
 
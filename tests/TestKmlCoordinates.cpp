@@ -0,0 +1,138 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QObject>
+
+#include "TestUtils.h"
+#include <GeoDataDocument.h>
+#include <GeoDataLineString.h>
+#include <GeoDataPlacemark.h>
+#include <GeoDataPoint.h>
+
+using namespace Marble;
+
+class TestKmlCoordinates : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void point_data();
+    void point();
+    void lineString_data();
+    void lineString();
+    void longLineString();
+};
+
+static GeoDataPlacemark *parsePlacemark( GeoDataDocument *document )
+{
+    if ( document->size() != 1 ) {
+        return 0;
+    }
+    return dynamic_cast<GeoDataPlacemark*>( document->child( 0 ) );
+}
+
+static QString placemarkKml( const QString &geometry )
+{
+    return QString( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                    "<kml xmlns=\"http://www.opengis.net/kml/2.2\">"
+                    "<Document><Placemark>%1</Placemark></Document>"
+                    "</kml>" ).arg( geometry );
+}
+
+void TestKmlCoordinates::point_data()
+{
+    QTest::addColumn<QString>( "coordinates" );
+    QTest::addColumn<qreal>( "longitude" );
+    QTest::addColumn<qreal>( "latitude" );
+    QTest::addColumn<qreal>( "altitude" );
+
+    addRow() << "13.592294,52.675926" << 13.592294 << 52.675926 << 0.0;
+    addRow() << "13.592294,52.675926,71" << 13.592294 << 52.675926 << 71.0;
+    addRow() << "\n   -1.5e1 , +2.25E-1 ,\t3.  \n" << -15.0 << 0.225 << 3.0;
+    addRow() << "<![CDATA[-179.99999999999999,-89.123456789012345678]]>" << -179.99999999999999 << -89.123456789012345678 << 0.0;
+}
+
+void TestKmlCoordinates::point()
+{
+    QFETCH( QString, coordinates );
+    QFETCH( qreal, longitude );
+    QFETCH( qreal, latitude );
+    QFETCH( qreal, altitude );
+
+    GeoDataDocument *document = parseKml( placemarkKml( "<Point><coordinates>" + coordinates + "</coordinates></Point>" ) );
+    GeoDataPlacemark *placemark = parsePlacemark( document );
+    QVERIFY( placemark != 0 );
+
+    QFUZZYCOMPARE( placemark->coordinate().longitude( GeoDataCoordinates::Degree ), longitude, 1e-9 );
+    QFUZZYCOMPARE( placemark->coordinate().latitude( GeoDataCoordinates::Degree ), latitude, 1e-9 );
+    QCOMPARE( placemark->coordinate().altitude(), altitude );
+
+    delete document;
+}
+
+void TestKmlCoordinates::lineString_data()
+{
+    QTest::addColumn<QString>( "coordinates" );
+    QTest::addColumn<int>( "size" );
+    QTest::addColumn<qreal>( "lastLongitude" );
+    QTest::addColumn<qreal>( "lastAltitude" );
+
+    addRow() << "1,2 3,4 5,6" << 3 << 5.0 << 0.0;
+    addRow() << "1,2,3\n4,5,6\n\n7,8,9\n" << 3 << 7.0 << 9.0;
+    addRow() << "  1 ,2 ,3   4, 5, 6 " << 2 << 4.0 << 6.0;
+    addRow() << "1,2<!-- comment -->3,4 5,6" << 2 << 5.0 << 0.0;
+    addRow() << "" << 0 << 0.0 << 0.0;
+}
+
+void TestKmlCoordinates::lineString()
+{
+    QFETCH( QString, coordinates );
+    QFETCH( int, size );
+    QFETCH( qreal, lastLongitude );
+    QFETCH( qreal, lastAltitude );
+
+    GeoDataDocument *document = parseKml( placemarkKml( "<LineString><coordinates>" + coordinates + "</coordinates></LineString>" ) );
+    GeoDataPlacemark *placemark = parsePlacemark( document );
+    QVERIFY( placemark != 0 );
+    const GeoDataLineString *lineString = dynamic_cast<const GeoDataLineString*>( placemark->geometry() );
+    QVERIFY( lineString != 0 );
+
+    QCOMPARE( lineString->size(), size );
+    if ( size > 0 ) {
+        QFUZZYCOMPARE( lineString->last().longitude( GeoDataCoordinates::Degree ), lastLongitude, 1e-9 );
+        QCOMPARE( lineString->last().altitude(), lastAltitude );
+    }
+
+    delete document;
+}
+
+void TestKmlCoordinates::longLineString()
+{
+    QString coordinates;
+    for ( int i = 0; i < 10000; ++i ) {
+        coordinates += QString( "%1,%2,%3 " ).arg( i * 0.0001, 0, 'f', 4 ).arg( -i * 0.0002, 0, 'f', 4 ).arg( i );
+    }
+
+    GeoDataDocument *document = parseKml( placemarkKml( "<LineString><coordinates>" + coordinates + "</coordinates></LineString>" ) );
+    GeoDataPlacemark *placemark = parsePlacemark( document );
+    QVERIFY( placemark != 0 );
+    const GeoDataLineString *lineString = dynamic_cast<const GeoDataLineString*>( placemark->geometry() );
+    QVERIFY( lineString != 0 );
+
+    QCOMPARE( lineString->size(), 10000 );
+    for ( int i = 0; i < 10000; i += 999 ) {
+        QFUZZYCOMPARE( lineString->at( i ).longitude( GeoDataCoordinates::Degree ), i * 0.0001, 1e-9 );
+        QFUZZYCOMPARE( lineString->at( i ).latitude( GeoDataCoordinates::Degree ), -i * 0.0002, 1e-9 );
+        QCOMPARE( lineString->at( i ).altitude(), qreal( i ) );
+    }
+
+    delete document;
+}
+
+QTEST_MAIN( TestKmlCoordinates )
+
+#include "TestKmlCoordinates.moc"
@@ -0,0 +1,211 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "GeoPainter.h"
+#include "MarbleDirs.h"
+#include "MarbleMap.h"
+#include "RenderState.h"
+#include "TileId.h"
+#include "layers/TextureLayer.h"
+
+#include <QImage>
+#include <QPixmap>
+#include <QSignalSpy>
+#include <QStringList>
+#include <QTest>
+
+namespace Marble
+{
+
+class TextureLayerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void panWhileTilesArePending_data();
+    void panWhileTilesArePending();
+
+    void placeholdersAreReplaced();
+    void themeChangeWhileTilesArePending();
+    void updateWhileTilesArePending();
+
+private:
+    static void paint( MarbleMap &map, QPixmap &paintDevice );
+    static int visibleTileCount( const MarbleMap &map );
+    static QList<TileId> visibleTileIds( const MarbleMap &map );
+    static void zoomIn( MarbleMap &map, QPixmap &paintDevice );
+};
+
+void TextureLayerTest::initTestCase()
+{
+    MarbleDirs::setMarbleDataPath( DATA_PATH );
+    MarbleDirs::setMarblePluginPath( PLUGIN_PATH );
+}
+
+void TextureLayerTest::paint( MarbleMap &map, QPixmap &paintDevice )
+{
+    GeoPainter painter( &paintDevice, map.viewport(), map.mapQuality() );
+    map.paint( painter, QRect() );
+}
+
+int TextureLayerTest::visibleTileCount( const MarbleMap &map )
+{
+    // the texture layer holds the state of the stacked tiles on display
+    const RenderState state = map.textureLayer()->renderState();
+    return state.children() > 0 ? state.childAt( 0 ).children() : 0;
+}
+
+QList<TileId> TextureLayerTest::visibleTileIds( const MarbleMap &map )
+{
+    QList<TileId> result;
+    const RenderState state = map.textureLayer()->renderState();
+    if ( state.children() == 0 ) {
+        return result;
+    }
+
+    // the states of the stacked tiles are named "Tile level/x/y"
+    const RenderState tiles = state.childAt( 0 );
+    for ( int i = 0; i < tiles.children(); ++i ) {
+        const QStringList coordinates = tiles.childAt( i ).name().section( ' ', 1 ).split( '/' );
+        if ( coordinates.size() == 3 ) {
+            result << TileId( 0, coordinates[0].toInt(), coordinates[1].toInt(), coordinates[2].toInt() );
+        }
+    }
+    return result;
+}
+
+void TextureLayerTest::zoomIn( MarbleMap &map, QPixmap &paintDevice )
+{
+    // the tiles of the lowest level are decoded right away
+    map.setRadius( 100 );
+    paint( map, paintDevice );
+
+    // while the tiles of the higher level are decoded in the background
+    map.setRadius( 700 );
+    paint( map, paintDevice );
+}
+
+void TextureLayerTest::panWhileTilesArePending_data()
+{
+    QTest::addColumn<int>( "projection" );
+
+    QTest::newRow( "equirectangular" ) << int( Equirectangular );
+    QTest::newRow( "mercator" ) << int( Mercator );
+}
+
+void TextureLayerTest::panWhileTilesArePending()
+{
+    QFETCH( int, projection );
+
+    MarbleMap map;
+    map.setMapThemeId( "earth/bluemarble/bluemarble.dgml" );
+    map.setProjection( Projection( projection ) );
+    map.setSize( 800, 600 );
+    QPixmap paintDevice( map.size() );
+
+    // the tiles of the lowest level are decoded right away
+    map.setRadius( 100 );
+    paint( map, paintDevice );
+
+    // zooming in shows placeholders scaled from them while the tiles
+    // of the higher level are decoded in the background
+    map.setRadius( 700 );
+    paint( map, paintDevice );
+    QVERIFY( map.tileZoomLevel() > 0 );
+    const int tileCount = visibleTileCount( map );
+    QVERIFY( tileCount > 0 );
+
+    // panning before any decoded tile arrived only maps the exposed strips,
+    // the tiles under the scrolled content have to stay on display
+    map.centerOn( map.centerLongitude() + 1.0, map.centerLatitude() );
+    paint( map, paintDevice );
+    QVERIFY( visibleTileCount( map ) >= tileCount );
+
+    // so that they still get replaced by the decoded tiles
+    QSignalSpy repaintSpy( &map, SIGNAL(repaintNeeded(QRegion)) );
+    QTRY_VERIFY( repaintSpy.count() > 0 );
+    paint( map, paintDevice );
+    QVERIFY( visibleTileCount( map ) >= tileCount );
+}
+
+void TextureLayerTest::placeholdersAreReplaced()
+{
+    MarbleMap map;
+    map.setMapThemeId( "earth/bluemarble/bluemarble.dgml" );
+    map.setSize( 800, 600 );
+    QPixmap paintDevice( map.size() );
+
+    QSignalSpy repaintSpy( &map, SIGNAL(repaintNeeded(QRegion)) );
+    zoomIn( map, paintDevice );
+    QVERIFY( map.tileZoomLevel() > 0 );
+    const int tileCount = visibleTileCount( map );
+    const QImage placeholders = paintDevice.toImage();
+
+    // the placeholders scaled from the lower level differ from the decoded tiles
+    QTRY_VERIFY( repaintSpy.count() > 0 );
+    paint( map, paintDevice );
+    QCOMPARE( visibleTileCount( map ), tileCount );
+    QVERIFY( paintDevice.toImage() != placeholders );
+}
+
+void TextureLayerTest::themeChangeWhileTilesArePending()
+{
+    MarbleMap map;
+    map.setMapThemeId( "earth/bluemarble/bluemarble.dgml" );
+    map.setSize( 800, 600 );
+    QPixmap paintDevice( map.size() );
+
+    zoomIn( map, paintDevice );
+    QVERIFY( visibleTileCount( map ) > 0 );
+
+    // the tiles still decoded for the previous theme are discarded
+    map.setMapThemeId( "earth/citylights/citylights.dgml" );
+
+    QSignalSpy repaintSpy( &map, SIGNAL(repaintNeeded(QRegion)) );
+    paint( map, paintDevice );
+    QVERIFY( visibleTileCount( map ) > 0 );
+    QTRY_VERIFY( repaintSpy.count() > 0 );
+    paint( map, paintDevice );
+    QVERIFY( visibleTileCount( map ) > 0 );
+}
+
+void TextureLayerTest::updateWhileTilesArePending()
+{
+    MarbleMap map;
+    map.setMapThemeId( "earth/bluemarble/bluemarble.dgml" );
+    map.setSize( 800, 600 );
+    QPixmap paintDevice( map.size() );
+
+    zoomIn( map, paintDevice );
+    const QList<TileId> tileIds = visibleTileIds( map );
+    QVERIFY( !tileIds.isEmpty() );
+
+    // a downloaded tile arriving while its stacked tile is decoded marks it
+    // as outdated, so that it gets decoded again instead of being dropped
+    QImage tileImage( 675, 675, QImage::Format_ARGB32_Premultiplied );
+    tileImage.fill( Qt::red );
+    QSignalSpy repaintSpy( &map, SIGNAL(repaintNeeded(QRegion)) );
+    foreach ( const TileId &id, tileIds ) {
+        const bool invoked = QMetaObject::invokeMethod( map.textureLayer(), "updateTile",
+                                                        Q_ARG( TileId, id ),
+                                                        Q_ARG( QImage, tileImage ) );
+        QVERIFY( invoked );
+    }
+
+    QTRY_VERIFY( repaintSpy.count() > 0 );
+    paint( map, paintDevice );
+    QCOMPARE( visibleTileIds( map ).size(), tileIds.size() );
+}
+
+}
+
+QTEST_MAIN( Marble::TextureLayerTest )
+
+#include "TextureLayerTest.moc"
@@ -0,0 +1,116 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "TileCreator_p.h"
+
+#include <QTest>
+#include <QVector>
+
+namespace Marble
+{
+
+class TileCreatorTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void averagePixels_data();
+    void averagePixels();
+    void downsampleLine_data();
+    void downsampleLine();
+
+private:
+    static uint referenceAverage( uint topLeft, uint topRight, uint bottomLeft, uint bottomRight );
+};
+
+uint TileCreatorTest::referenceAverage( uint topLeft, uint topRight, uint bottomLeft, uint bottomRight )
+{
+    uint result = 0;
+    for ( int shift = 0; shift < 32; shift += 8 ) {
+        const uint sum = ( ( topLeft >> shift ) & 0xff ) + ( ( topRight >> shift ) & 0xff )
+                       + ( ( bottomLeft >> shift ) & 0xff ) + ( ( bottomRight >> shift ) & 0xff );
+        result |= ( ( sum + 2 ) / 4 ) << shift;
+    }
+
+    return result;
+}
+
+void TileCreatorTest::averagePixels_data()
+{
+    QTest::addColumn<uint>( "topLeft" );
+    QTest::addColumn<uint>( "topRight" );
+    QTest::addColumn<uint>( "bottomLeft" );
+    QTest::addColumn<uint>( "bottomRight" );
+
+    QTest::newRow( "black" ) << 0xff000000u << 0xff000000u << 0xff000000u << 0xff000000u;
+    QTest::newRow( "white" ) << 0xffffffffu << 0xffffffffu << 0xffffffffu << 0xffffffffu;
+    QTest::newRow( "transparent" ) << 0x00000000u << 0x00000000u << 0x00000000u << 0x00000000u;
+    QTest::newRow( "rounding up" ) << 0x02020202u << 0x00000000u << 0x00000000u << 0x00000000u;
+    QTest::newRow( "rounding down" ) << 0x01010101u << 0x00000000u << 0x00000000u << 0x00000000u;
+    QTest::newRow( "mixed" ) << 0xff102030u << 0x80ff0040u << 0x40204060u << 0x00ffffffu;
+}
+
+void TileCreatorTest::averagePixels()
+{
+    QFETCH( uint, topLeft );
+    QFETCH( uint, topRight );
+    QFETCH( uint, bottomLeft );
+    QFETCH( uint, bottomRight );
+
+    QCOMPARE( Marble::averagePixels( topLeft, topRight, bottomLeft, bottomRight ),
+              referenceAverage( topLeft, topRight, bottomLeft, bottomRight ) );
+}
+
+void TileCreatorTest::downsampleLine_data()
+{
+    QTest::addColumn<int>( "count" );
+
+    // the vectorized kernel handles four pixels at a time plus a remainder
+    QTest::newRow( "empty" ) << 0;
+    QTest::newRow( "one" ) << 1;
+    QTest::newRow( "three" ) << 3;
+    QTest::newRow( "four" ) << 4;
+    QTest::newRow( "seven" ) << 7;
+    QTest::newRow( "half tile" ) << 337;
+}
+
+void TileCreatorTest::downsampleLine()
+{
+    QFETCH( int, count );
+
+    // deterministic pseudo random pixels, covering all channel values
+    QVector<uint> top( 2 * count );
+    QVector<uint> bottom( 2 * count );
+    uint state = 12345;
+    for ( int i = 0; i < 2 * count; ++i ) {
+        state = state * 1103515245u + 12345u;
+        top[i] = state;
+        state = state * 1103515245u + 12345u;
+        bottom[i] = state;
+    }
+
+    QVector<uint> portable( count, 0 );
+    downsampleLinePortable( top.constData(), bottom.constData(), portable.data(), count );
+    for ( int i = 0; i < count; ++i ) {
+        QCOMPARE( portable[i], referenceAverage( top[2 * i], top[2 * i + 1], bottom[2 * i], bottom[2 * i + 1] ) );
+    }
+
+#ifdef MARBLE_HAVE_SSE2
+    QVector<uint> sse2( count, 0 );
+    downsampleLineSse2( top.constData(), bottom.constData(), sse2.data(), count );
+    QCOMPARE( sse2, portable );
+#else
+    QSKIP( "SSE2 is not available" );
+#endif
+}
+
+}
+
+QTEST_MAIN( Marble::TileCreatorTest )
+
+#include "TileCreatorTest.moc"
@@ -0,0 +1,203 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "TileCutter.h"
+#include "TinyPlanetProcessor.h"
+
+#include "GeoDataDocument.h"
+#include "GeoDataLineString.h"
+#include "GeoDataPlacemark.h"
+#include "MarbleDirs.h"
+#include "PluginManager.h"
+#include "osm/OsmPlacemarkData.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThreadPool>
+
+namespace Marble
+{
+
+class TileCutterTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void pointPlacemarks_data();
+    void pointPlacemarks();
+    void quadTreeMatchesAllTiles();
+
+private:
+    static TileCutter::CutFunction cutOsm();
+    static QStringList tileContents( const QString &fileName );
+
+    PluginManager m_pluginManager;
+};
+
+void TileCutterTest::initTestCase()
+{
+    // The OSM writer is part of the OSM runner plugin
+    MarbleDirs::setMarblePluginPath( PLUGIN_PATH );
+    QVERIFY( !m_pluginManager.parsingRunnerPlugins().isEmpty() );
+
+    QThreadPool::globalInstance()->setMaxThreadCount( 8 );
+}
+
+TileCutter::CutFunction TileCutterTest::cutOsm()
+{
+    return []( GeoDataDocument *document, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY ) {
+        TinyPlanetProcessor processor( document );
+        return processor.cutToTiles( zoomLevel, tileX, tileY );
+    };
+}
+
+QStringList TileCutterTest::tileContents( const QString &fileName )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return QStringList();
+    }
+
+    // The ids of the written nodes and ways are allocated while writing,
+    // so they and the order of the elements differ between runs
+    QString contents = QString::fromUtf8( file.readAll() );
+    contents.remove( QRegularExpression( " (id|ref)=\"-?\\d+\"" ) );
+    QStringList lines = contents.split( '\n', QString::SkipEmptyParts );
+    for ( int i = 0; i < lines.size(); ++i ) {
+        lines[i] = lines[i].trimmed();
+    }
+    lines.sort();
+    return lines;
+}
+
+void TileCutterTest::pointPlacemarks_data()
+{
+    QTest::addColumn<bool>( "quadTree" );
+
+    QTest::newRow( "all tiles" ) << false;
+    QTest::newRow( "quad tree" ) << true;
+}
+
+void TileCutterTest::pointPlacemarks()
+{
+    QFETCH( bool, quadTree );
+
+    GeoDataDocument document;
+    QVector<GeoDataCoordinates> coordinates;
+    for ( int lat = -60; lat <= 60; lat += 5 ) {
+        for ( int lon = -175; lon <= 175; lon += 10 ) {
+            GeoDataPlacemark *placemark = new GeoDataPlacemark( QString( "%1 %2" ).arg( lon ).arg( lat ) );
+            placemark->setCoordinate( lon, lat, 0, GeoDataCoordinates::Degree );
+            OsmPlacemarkData osmData;
+            osmData.setId( -1 - coordinates.size() );
+            osmData.addTag( "place", "village" );
+            placemark->setOsmData( osmData );
+            document.append( placemark );
+            coordinates << placemark->coordinate();
+        }
+    }
+
+    QTemporaryDir directory;
+    QVERIFY( directory.isValid() );
+
+    TileCutter cutter( directory.path() );
+    cutter.setQuadTree( quadTree );
+    cutter.addLayer( &document, cutOsm() );
+    QVERIFY( cutter.cutToTiles( 3 ) );
+
+    for ( int x = 0; x < 8; ++x ) {
+        for ( int y = 0; y < 8; ++y ) {
+            QVERIFY( QFile::exists( QString( "%1/3/%2/%3.osm" ).arg( directory.path() ).arg( x ).arg( y ) ) );
+        }
+    }
+
+    // cutting must neither modify nor detach the placemarks of the input
+    const QVector<GeoDataPlacemark*> placemarks = document.placemarkList();
+    QCOMPARE( placemarks.size(), coordinates.size() );
+    for ( int i = 0; i < placemarks.size(); ++i ) {
+        const GeoDataPlacemark *placemark = placemarks[i];
+        QCOMPARE( placemark->coordinate(), coordinates[i] );
+        QVERIFY( placemark->geometry()->parent() == placemark );
+        QCOMPARE( placemark->osmData().id(), qint64( -1 - i ) );
+    }
+}
+
+void TileCutterTest::quadTreeMatchesAllTiles()
+{
+    // Parallels and meridians, which are split at the borders of every
+    // tile level and have vertices on no border
+    GeoDataDocument document;
+    QList<qreal> latitudes;
+    latitudes << -62 << -33 << -8 << 12 << 37 << 58;
+    foreach ( qreal lat, latitudes ) {
+        GeoDataLineString *parallel = new GeoDataLineString;
+        for ( int lon = -172; lon <= 168; lon += 10 ) {
+            parallel->append( GeoDataCoordinates( lon, lat, 0, GeoDataCoordinates::Degree ) );
+        }
+        GeoDataPlacemark *placemark = new GeoDataPlacemark( QString( "parallel %1" ).arg( lat ) );
+        placemark->setGeometry( parallel );
+        OsmPlacemarkData osmData;
+        osmData.addTag( "highway", "primary" );
+        placemark->setOsmData( osmData );
+        document.append( placemark );
+    }
+    QList<qreal> longitudes;
+    longitudes << -160 << -100 << -20 << 10 << 70 << 120;
+    foreach ( qreal lon, longitudes ) {
+        GeoDataLineString *meridian = new GeoDataLineString;
+        for ( int lat = -62; lat <= 58; lat += 10 ) {
+            meridian->append( GeoDataCoordinates( lon, lat, 0, GeoDataCoordinates::Degree ) );
+        }
+        GeoDataPlacemark *placemark = new GeoDataPlacemark( QString( "meridian %1" ).arg( lon ) );
+        placemark->setGeometry( meridian );
+        OsmPlacemarkData osmData;
+        osmData.addTag( "highway", "secondary" );
+        placemark->setOsmData( osmData );
+        document.append( placemark );
+    }
+
+    QTemporaryDir allTilesDirectory;
+    QVERIFY( allTilesDirectory.isValid() );
+    TileCutter allTilesCutter( allTilesDirectory.path() );
+    allTilesCutter.addLayer( &document, cutOsm() );
+    QVERIFY( allTilesCutter.cutToTiles( 3 ) );
+
+    QTemporaryDir quadTreeDirectory;
+    QVERIFY( quadTreeDirectory.isValid() );
+    TileCutter quadTreeCutter( quadTreeDirectory.path() );
+    quadTreeCutter.setQuadTree( true );
+    quadTreeCutter.addLayer( &document, cutOsm() );
+    QVERIFY( quadTreeCutter.cutToTiles( 3 ) );
+
+    int nonEmptyTiles = 0;
+    for ( int x = 0; x < 8; ++x ) {
+        for ( int y = 0; y < 8; ++y ) {
+            const QString tile = QString( "/3/%1/%2.osm" ).arg( x ).arg( y );
+            const QStringList expected = tileContents( allTilesDirectory.path() + tile );
+            QVERIFY( !expected.isEmpty() );
+            QCOMPARE( tileContents( quadTreeDirectory.path() + tile ), expected );
+            if ( expected.filter( "<way" ).size() > 0 ) {
+                ++nonEmptyTiles;
+            }
+        }
+    }
+    QVERIFY( nonEmptyTiles > 0 );
+
+    // the input documents stay with the caller in both modes
+    QCOMPARE( document.size(), latitudes.size() + longitudes.size() );
+}
+
+}
+
+QTEST_MAIN( Marble::TileCutterTest )
+
+#include "TileCutterTest.moc"
@@ -9,8 +9,10 @@
 // Copyright 2013      Dennis Nienhüser <nienhueser@kde.org>
 //
 
-// A simple tool to read a .kml file and write it back to a .cache file
+// A simple tool to read a .kml file and write it back to a .cache file,
+// or to a binary document snapshot if the target ends with .snapshot
 
+#include <DocumentSnapshot.h>
 #include <ParsingRunnerManager.h>
 #include <PluginManager.h>
 #include <MarbleClock.h>
@@ -92,7 +94,7 @@ int main(int argc, char** argv)
     if ( inputIndex > 0 && inputIndex + 1 < argc ) {
         inputFilename = app.arguments().at( inputIndex + 1 );
     } else {
-        qDebug( " Syntax: kml2cache -i sourcefile [-o cache-targetfile]" );
+        qDebug( " Syntax: kml2cache -i sourcefile [-o cache-targetfile|snapshot-targetfile.snapshot]" );
         return 1;
     }
 
@@ -108,5 +110,14 @@ int main(int argc, char** argv)
         return 2;
     }
 
+    if ( outputFilename.endsWith( '.' + DocumentSnapshot::fileExtension() ) ) {
+        QString error;
+        if ( !DocumentSnapshot::write( *document, outputFilename, error ) ) {
+            qDebug() << "Could not write snapshot:" << error;
+            return 3;
+        }
+        return 0;
+    }
+
     saveFile( outputFilename, document );
 }
@@ -35,6 +35,20 @@ BaseClipper::BaseClipper() :
 QPolygonF BaseClipper::lineString2Qpolygon(const GeoDataLineString& lineString)
 {
     QPolygonF polygon;
+    polygon.reserve(lineString.size());
+
+    // Packed line strings are read from their arrays, iterating them would
+    // create the nodes of every cut geometry
+    if (lineString.hasPackedStorage()) {
+        const QVector<qreal>& longitudes = lineString.packedLongitudes();
+        const QVector<qreal>& latitudes = lineString.packedLatitudes();
+        for (int i = 0; i < longitudes.size(); ++i) {
+            // Need to flip the Y axis(latitude)
+            polygon.append(QPointF(longitudes[i], -latitudes[i]));
+        }
+        return polygon;
+    }
+
     foreach (const GeoDataCoordinates& coord, lineString) {
         // Need to flip the Y axis(latitude)
         QPointF point(coord.longitude(), -coord.latitude());
@@ -46,14 +60,7 @@ QPolygonF BaseClipper::lineString2Qpolygon(const GeoDataLineString& lineString)
 
 QPolygonF BaseClipper::linearRing2Qpolygon(const GeoDataLinearRing& linearRing)
 {
-    QPolygonF polygon;
-    foreach (const GeoDataCoordinates& coord, linearRing) {
-        // Need to flip the Y axis(latitude)
-        QPointF point(coord.longitude(), -coord.latitude());
-        polygon.append(point);
-    }
-
-    return polygon;
+    return lineString2Qpolygon(linearRing);
 }
 
 GeoDataLineString BaseClipper::qPolygon2lineString(const QPolygonF& polygon)
@@ -59,10 +59,12 @@ GeoDataDocument *ShpCoastlineProcessor::cutToTiles(unsigned int zoomLevel, unsig
     tileBoundary.setBoundaries(north, south, east, west);
 
     foreach (GeoDataObject* object, m_objects) {
-        GeoDataPlacemark* placemark = static_cast<GeoDataPlacemark*>(object);
+        // Tiles are cut concurrently from the same document, so it must only be
+        // read through const accessors, which never detach or modify it
+        const GeoDataPlacemark* placemark = static_cast<const GeoDataPlacemark*>(object);
 
         if(placemark->geometry()->nodeType() == GeoDataTypes::GeoDataPolygonType) {
-            GeoDataPolygon* marblePolygon = static_cast<GeoDataPolygon*>(placemark->geometry());
+            const GeoDataPolygon* marblePolygon = static_cast<const GeoDataPolygon*>(placemark->geometry());
 
             if(tileBoundary.intersects(marblePolygon->latLonAltBox())) {
                 BaseClipper clipper;
@@ -0,0 +1,187 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "TileCutter.h"
+
+#include "GeoDataGeometry.h"
+#include "GeoDataLatLonAltBox.h"
+#include "GeoDataPlacemark.h"
+#include "GeoWriter.h"
+#include "OsmPlacemarkData.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QRunnable>
+#include <QThreadPool>
+
+class TileCutter::Job : public QRunnable
+{
+public:
+    Job(TileCutter* cutter, const QVector<GeoDataDocument*> &documents, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY) :
+        m_cutter(cutter),
+        m_documents(documents),
+        m_zoomLevel(zoomLevel),
+        m_tileX(tileX),
+        m_tileY(tileY)
+    {
+    }
+
+    virtual void run()
+    {
+        if (m_cutter->m_quadTree) {
+            m_cutter->cutRecursively(m_documents, m_zoomLevel, m_tileX, m_tileY);
+        } else {
+            m_cutter->writeTile(m_cutter->cut(m_documents, m_zoomLevel, m_tileX, m_tileY), m_tileX, m_tileY);
+        }
+    }
+
+private:
+    TileCutter* const m_cutter;
+    const QVector<GeoDataDocument*> m_documents;
+    const unsigned int m_zoomLevel;
+    const unsigned int m_tileX;
+    const unsigned int m_tileY;
+};
+
+TileCutter::TileCutter(const QString &outputDirectory) :
+    m_outputDirectory(outputDirectory),
+    m_quadTree(false),
+    m_zoomLevel(0)
+{
+}
+
+void TileCutter::addLayer(GeoDataDocument* document, const CutFunction &cutFunction)
+{
+    // Jobs read the input documents concurrently through const accessors.
+    // Make sure that reading doesn't modify them by calculating the bounding
+    // boxes, which are calculated on first use, up front.
+    foreach (const GeoDataPlacemark* placemark, document->placemarkList()) {
+        placemark->geometry()->latLonAltBox();
+    }
+
+    m_documents << document;
+    m_cutFunctions << cutFunction;
+}
+
+void TileCutter::setQuadTree(bool enabled)
+{
+    m_quadTree = enabled;
+}
+
+bool TileCutter::cutToTiles(unsigned int zoomLevel)
+{
+    m_zoomLevel = zoomLevel;
+    m_failedTiles.store(0);
+
+    QThreadPool* pool = QThreadPool::globalInstance();
+
+    if (!m_quadTree || zoomLevel == 0) {
+        unsigned int const N = 1u << zoomLevel;
+        for (unsigned int x = 0; x < N; ++x) {
+            for (unsigned int y = 0; y < N; ++y) {
+                pool->start(new Job(this, m_documents, zoomLevel, x, y));
+            }
+        }
+        pool->waitForDone();
+        return m_failedTiles.load() == 0;
+    }
+
+    // Split the upper levels here until there are enough subtrees to keep all
+    // threads busy, then cut each subtree depth first in a job of its own.
+    struct Tile {
+        unsigned int x;
+        unsigned int y;
+        QVector<GeoDataDocument*> documents;
+    };
+
+    QVector<Tile> tiles;
+    tiles << Tile{0, 0, m_documents};
+    unsigned int level = 0;
+    while (level < zoomLevel && tiles.size() < 4 * pool->maxThreadCount()) {
+        QVector<Tile> children;
+        foreach (const Tile &tile, tiles) {
+            for (unsigned int i = 0; i < 4; ++i) {
+                unsigned int const x = 2 * tile.x + i % 2;
+                unsigned int const y = 2 * tile.y + i / 2;
+                children << Tile{x, y, cut(tile.documents, level + 1, x, y)};
+            }
+            if (level > 0) {
+                qDeleteAll(tile.documents);
+            }
+        }
+        tiles = children;
+        ++level;
+    }
+
+    foreach (const Tile &tile, tiles) {
+        pool->start(new Job(this, tile.documents, level, tile.x, tile.y));
+    }
+    pool->waitForDone();
+    return m_failedTiles.load() == 0;
+}
+
+QVector<GeoDataDocument*> TileCutter::cut(const QVector<GeoDataDocument*> &documents, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY) const
+{
+    QVector<GeoDataDocument*> tiles;
+    for (int i = 0; i < documents.size(); ++i) {
+        tiles << m_cutFunctions[i](documents[i], zoomLevel, tileX, tileY);
+    }
+    return tiles;
+}
+
+void TileCutter::cutRecursively(const QVector<GeoDataDocument*> &documents, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY)
+{
+    if (zoomLevel == m_zoomLevel) {
+        writeTile(documents, tileX, tileY);
+        return;
+    }
+
+    for (unsigned int i = 0; i < 4; ++i) {
+        unsigned int const x = 2 * tileX + i % 2;
+        unsigned int const y = 2 * tileY + i / 2;
+        cutRecursively(cut(documents, zoomLevel + 1, x, y), zoomLevel + 1, x, y);
+    }
+    // The documents of level 0 are the ones passed to addLayer()
+    if (zoomLevel > 0) {
+        qDeleteAll(documents);
+    }
+}
+
+void TileCutter::writeTile(const QVector<GeoDataDocument*> &documents, unsigned int tileX, unsigned int tileY)
+{
+    // Merge the tiles of all layers into the first one
+    GeoDataDocument* tile = documents.first();
+    for (int i = 1; i < documents.size(); ++i) {
+        foreach (GeoDataFeature* feature, documents[i]->featureList()) {
+            tile->append(feature);
+        }
+        documents[i]->remove(0, documents[i]->size());
+        delete documents[i];
+    }
+
+    QString directory = QString("%1/%2").arg(m_zoomLevel).arg(tileX);
+    if (!m_outputDirectory.isEmpty()) {
+        directory = m_outputDirectory + QLatin1Char('/') + directory;
+    }
+    QDir().mkpath(directory);
+
+    QFile outputFile(QString("%1/%2.osm").arg(directory).arg(tileY));
+    outputFile.open(QIODevice::WriteOnly);
+
+    GeoWriter writer;
+    writer.setDocumentType("0.6");
+    if (writer.write(&outputFile, tile)) {
+        qInfo() << tile->name() << " done";
+    } else {
+        qDebug() << "Could not write the file " << outputFile.fileName();
+        m_failedTiles.ref();
+    }
+
+    delete tile;
+}
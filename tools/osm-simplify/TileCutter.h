@@ -0,0 +1,77 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef TILECUTTER_H
+#define TILECUTTER_H
+
+#include <QAtomicInt>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+#include "GeoDataDocument.h"
+
+using namespace Marble;
+
+/**
+ * Cuts documents into the tiles of a zoom level and writes every tile to
+ * <output directory>/<zoom level>/<x>/<y>.osm. Tiles are cut and written
+ * by the jobs of the global thread pool.
+ *
+ * By default every tile is clipped from the whole input. In quad tree mode
+ * every tile is clipped from the already clipped tile of the level above,
+ * so that features are only clipped against the tiles they are close to.
+ */
+class TileCutter
+{
+public:
+    /**
+     * Returns the features of @p document within the tile @p tileX, @p tileY of
+     * @p zoomLevel. The caller takes ownership of the returned document, which
+     * must not share any data with @p document.
+     */
+    typedef std::function<GeoDataDocument*(GeoDataDocument* document, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY)> CutFunction;
+
+    /**
+     * Creates a tile cutter writing to @p outputDirectory, or to the current
+     * directory if it is empty.
+     */
+    explicit TileCutter(const QString &outputDirectory);
+
+    /**
+     * Adds @p document to the documents to cut. The tiles cut from all
+     * documents are merged into a single file per tile. The document must
+     * stay valid until cutToTiles() returns.
+     */
+    void addLayer(GeoDataDocument* document, const CutFunction &cutFunction);
+
+    void setQuadTree(bool enabled);
+
+    /**
+     * Cuts all documents into the tiles of @p zoomLevel and writes them.
+     * @return whether all tiles could be written
+     */
+    bool cutToTiles(unsigned int zoomLevel);
+
+private:
+    class Job;
+
+    QVector<GeoDataDocument*> cut(const QVector<GeoDataDocument*> &documents, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY) const;
+    void cutRecursively(const QVector<GeoDataDocument*> &documents, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY);
+    void writeTile(const QVector<GeoDataDocument*> &documents, unsigned int tileX, unsigned int tileY);
+
+    QString m_outputDirectory;
+    QVector<GeoDataDocument*> m_documents;
+    QVector<CutFunction> m_cutFunctions;
+    bool m_quadTree;
+    unsigned int m_zoomLevel;
+    QAtomicInt m_failedTiles;
+};
+
+#endif // TILECUTTER_H
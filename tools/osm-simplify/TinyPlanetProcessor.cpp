@@ -12,7 +12,9 @@
 
 #include "BaseClipper.h"
 
+#include "GeoDataMultiGeometry.h"
 #include "GeoDataPlacemark.h"
+#include "GeoDataPoint.h"
 #include "OsmPlacemarkData.h"
 
 #include <QDebug>
@@ -24,6 +26,18 @@ TinyPlanetProcessor::TinyPlanetProcessor(GeoDataDocument* document) :
 
 }
 
+// Geometries are implicitly shared, copying one only increments the
+// reference count of the original
+static GeoDataGeometry* copyGeometry(const GeoDataGeometry* geometry)
+{
+    if (geometry->nodeType() == GeoDataTypes::GeoDataPointType) {
+        return new GeoDataPoint(*static_cast<const GeoDataPoint*>(geometry));
+    } else if (geometry->nodeType() == GeoDataTypes::GeoDataMultiGeometryType) {
+        return new GeoDataMultiGeometry(*static_cast<const GeoDataMultiGeometry*>(geometry));
+    }
+    return 0;
+}
+
 void TinyPlanetProcessor::process()
 {
     // ?
@@ -49,18 +63,20 @@ GeoDataDocument *TinyPlanetProcessor::cutToTiles(unsigned int zoomLevel, unsigne
     clipper.initClipRect(tileBoundary);
 
     foreach (GeoDataObject* object, m_objects) {
-        GeoDataPlacemark* placemark = static_cast<GeoDataPlacemark*>(object);
+        // Tiles are cut concurrently from the same document, so it must only be
+        // read through const accessors, which never detach or modify it
+        const GeoDataPlacemark* placemark = static_cast<const GeoDataPlacemark*>(object);
 
         if(tileBoundary.intersects(placemark->geometry()->latLonAltBox())) {
 
             if( placemark->geometry()->nodeType() == GeoDataTypes::GeoDataPolygonType ||
                 placemark->visualCategory() == GeoDataFeature::Landmass) {
 
-                GeoDataLinearRing* marblePolygon;
+                const GeoDataLinearRing* marblePolygon;
                 if(placemark->geometry()->nodeType() == GeoDataTypes::GeoDataPolygonType) {
-                    marblePolygon = &static_cast<GeoDataPolygon*>(placemark->geometry())->outerBoundary();
+                    marblePolygon = &static_cast<const GeoDataPolygon*>(placemark->geometry())->outerBoundary();
                 } else if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataLinearRingType) {
-                    marblePolygon = static_cast<GeoDataLinearRing*>(placemark->geometry());
+                    marblePolygon = static_cast<const GeoDataLinearRing*>(placemark->geometry());
                 }
 
                 QVector<QPolygonF> clippedPolygons;
@@ -86,7 +102,7 @@ GeoDataDocument *TinyPlanetProcessor::cutToTiles(unsigned int zoomLevel, unsigne
                     tile->append(newPlacemark);
                 }
             } else if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataLineStringType) {
-                GeoDataLineString* marbleWay = static_cast<GeoDataLineString*>(placemark->geometry());
+                const GeoDataLineString* marbleWay = static_cast<const GeoDataLineString*>(placemark->geometry());
 
                 QVector<QPolygonF> clippedPolygons;
 
@@ -115,7 +131,7 @@ GeoDataDocument *TinyPlanetProcessor::cutToTiles(unsigned int zoomLevel, unsigne
                 }
             } else if (placemark->geometry()->nodeType() == GeoDataTypes::GeoDataLinearRingType) {
 
-                    GeoDataLinearRing* marbleClosedWay = static_cast<GeoDataLinearRing*>(placemark->geometry());
+                    const GeoDataLinearRing* marbleClosedWay = static_cast<const GeoDataLinearRing*>(placemark->geometry());
 
                     QVector<QPolygonF> clippedPolygons;
 
@@ -146,7 +162,23 @@ GeoDataDocument *TinyPlanetProcessor::cutToTiles(unsigned int zoomLevel, unsigne
                     }
 
             } else {
-                tile->append(placemark);
+                GeoDataGeometry* geometry = copyGeometry(placemark->geometry());
+                if (!geometry) {
+                    qDebug() << "Skipping placemark with unsupported geometry" << placemark->geometry()->nodeType();
+                    continue;
+                }
+
+                // Build the copy from the properties instead of copying the
+                // placemark, which would share its data with the input
+                GeoDataPlacemark* newPlacemark = new GeoDataPlacemark();
+                newPlacemark->setGeometry(geometry);
+                newPlacemark->setName(placemark->name());
+                newPlacemark->setVisualCategory(placemark->visualCategory());
+                newPlacemark->setPopulation(placemark->population());
+                newPlacemark->setZoomLevel(placemark->zoomLevel());
+                newPlacemark->setPopularity(placemark->popularity());
+                newPlacemark->setOsmData(placemark->osmData());
+                tile->append(newPlacemark);
             }
         }
     }
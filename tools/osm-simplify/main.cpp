@@ -19,6 +19,7 @@
 #include <QDir>
 #include <QString>
 #include <QElapsedTimer>
+#include <QThreadPool>
 
 #include <QMessageLogContext>
 
@@ -26,6 +27,7 @@
 #include "ShpCoastlineProcessor.h"
 #include "TinyPlanetProcessor.h"
 #include "NodeReducer.h"
+#include "TileCutter.h"
 
 using namespace Marble;
 
@@ -74,17 +76,6 @@ void usage()
     qDebug() << "\t--no-streets-smaller-than %f - eliminates streets which have realsize smaller than %f";
 }
 
-GeoDataDocument* mergeDocuments(GeoDataDocument* map1, GeoDataDocument* map2)
-{
-    GeoDataDocument* mergedMap = new GeoDataDocument(*map1);
-
-    foreach (GeoDataFeature* feature, map2->featureList()) {
-        mergedMap->append(feature);
-    }
-
-    return mergedMap;
-}
-
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
@@ -120,6 +111,17 @@ int main(int argc, char *argv[])
                               QCoreApplication::translate("main", "Cuts into tiles based on the zoom level passed using -z."),
                           },
 
+                          {
+                              {"q", "quad-tree"},
+                              QCoreApplication::translate("main", "Cuts tiles recursively, clipping each zoom level from the tiles of the level above. This works together with the -c flag."),
+                          },
+
+                          {
+                              {"t", "threads"},
+                              QCoreApplication::translate("main", "The number of tiles cut at the same time. Defaults to the number of processor cores."),
+                              QCoreApplication::translate("main", "number")
+                          },
+
                           {
                               {"n", "node-reduce"},
                               QCoreApplication::translate("main", "Reduces the number of nodes for a given way based on zoom level"),
@@ -173,6 +175,15 @@ int main(int argc, char *argv[])
         qInstallMessageHandler( debugOutput );
     }
 
+    if(parser.isSet("threads")) {
+        bool ok = false;
+        int const threads = parser.value("threads").toInt(&ok);
+        if(!ok || threads < 1) {
+            qWarning() << "The number of threads has to be at least 1.";
+            return 1;
+        }
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
 
     QFileInfo file( inputFileName );
     if ( !file.exists() ) {
@@ -200,59 +211,26 @@ int main(int argc, char *argv[])
         mergeMap = manager.openFile(mergeFileName, DocumentRole::MapDocument, 600000);
     }
 
+    TileCutter::CutFunction cutOsm = [](GeoDataDocument* document, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY) {
+        TinyPlanetProcessor processor(document);
+        return processor.cutToTiles(zoomLevel, tileX, tileY);
+    };
+    TileCutter::CutFunction cutShp = [](GeoDataDocument* document, unsigned int zoomLevel, unsigned int tileX, unsigned int tileY) {
+        ShpCoastlineProcessor processor(document);
+        return processor.cutToTiles(zoomLevel, tileX, tileY);
+    };
+
+    TileCutter cutter(parser.isSet("output") ? outputName : QString());
+    cutter.setQuadTree(parser.isSet("quad-tree"));
+
     if(file.suffix() == "shp" && parser.isSet("cut-to-tiles")) {
         ShpCoastlineProcessor processor(map);
 
         processor.process();
 
-        unsigned int N = pow(2, zoomLevel);
-
-        for(unsigned int x = 0; x < N; ++x) {
-            for(unsigned int y = 0; y < N; ++y) {
-                GeoDataDocument* tile = processor.cutToTiles(zoomLevel, x, y);
-
-                GeoWriter writer;
-                writer.setDocumentType("0.6");
-
-                QFile outputFile;
-                if(parser.isSet("output")) {
-                    outputFile.setFileName( QString("%1/%2/%3/%4.osm").arg(outputName).arg(zoomLevel).arg(x).arg(y) );
-                } else {
-                    outputFile.setFileName( QString("%1/%2/%3.osm").arg(zoomLevel).arg(x).arg(y) );
-                }
-
-                QDir dir;
-                if(parser.isSet("output")) {
-                    if(!dir.exists(outputName)) {
-                        dir.mkdir(outputName);
-                    }
-
-                    if(!dir.exists(QString("%1/%2").arg(outputName).arg(zoomLevel))) {
-                        dir.mkdir(QString("%1/%2").arg(outputName).arg(zoomLevel));
-                    }
-
-                    if(!dir.exists(QString("%1/%2/%3").arg(outputName).arg(zoomLevel).arg(x))) {
-                        dir.mkdir(QString("%1/%2/%3").arg(outputName).arg(zoomLevel).arg(x));
-                    }
-                } else {
-                    if(!dir.exists(QString::number(zoomLevel))) {
-                        dir.mkdir(QString::number(zoomLevel));
-                    }
-                    if(!dir.exists(QString("%1/%2").arg(zoomLevel).arg(x))) {
-                        dir.mkdir(QString("%1/%2").arg(zoomLevel).arg(x));
-                    }
-                }
-
-                outputFile.open( QIODevice::WriteOnly );
-                if ( !writer.write( &outputFile, tile ) ) {
-                    qDebug() << "Could not write the file " << outputName;
-                    return 4;
-                }
-
-                qInfo() << tile->name() << " done";
-
-                delete tile;
-            }
+        cutter.addLayer(map, cutShp);
+        if (!cutter.cutToTiles(zoomLevel)) {
+            return 4;
         }
     } else if (file.suffix() == "osm" && parser.isSet("cut-to-tiles") && parser.isSet("merge")) {
         TinyPlanetProcessor processor(map);
@@ -261,113 +239,19 @@ int main(int argc, char *argv[])
         ShpCoastlineProcessor shpProcessor(mergeMap);
         shpProcessor.process();
 
-        unsigned int N = pow(2, zoomLevel);
-
-        for(unsigned int x = 0; x < N; ++x) {
-            for(unsigned int y = 0; y < N; ++y) {
-                GeoDataDocument* tile1 = processor.cutToTiles(zoomLevel, x, y);
-                GeoDataDocument* tile2 = shpProcessor.cutToTiles(zoomLevel, x, y);
-
-                GeoDataDocument* tile = mergeDocuments(tile1, tile2);
-
-                GeoWriter writer;
-                writer.setDocumentType("0.6");
-
-                QFile outputFile;
-                if(parser.isSet("output")) {
-                    outputFile.setFileName( QString("%1/%2/%3/%4.osm").arg(outputName).arg(zoomLevel).arg(x).arg(y) );
-                } else {
-                    outputFile.setFileName( QString("%1/%2/%3.osm").arg(zoomLevel).arg(x).arg(y) );
-                }
-
-                QDir dir;
-                if(parser.isSet("output")) {
-                    if(!dir.exists(outputName)) {
-                        dir.mkdir(outputName);
-                    }
-
-                    if(!dir.exists(QString("%1/%2").arg(outputName).arg(zoomLevel))) {
-                        dir.mkdir(QString("%1/%2").arg(outputName).arg(zoomLevel));
-                    }
-
-                    if(!dir.exists(QString("%1/%2/%3").arg(outputName).arg(zoomLevel).arg(x))) {
-                        dir.mkdir(QString("%1/%2/%3").arg(outputName).arg(zoomLevel).arg(x));
-                    }
-                } else {
-                    if(!dir.exists(QString::number(zoomLevel))) {
-                        dir.mkdir(QString::number(zoomLevel));
-                    }
-                    if(!dir.exists(QString("%1/%2").arg(zoomLevel).arg(x))) {
-                        dir.mkdir(QString("%1/%2").arg(zoomLevel).arg(x));
-                    }
-                }
-
-                outputFile.open( QIODevice::WriteOnly );
-                if ( !writer.write( &outputFile, tile ) ) {
-                    qDebug() << "Could not write the file " << outputName;
-                    return 4;
-                }
-
-                qInfo() << tile->name() << " done";
-
-                delete tile1;
-                delete tile2;
-                delete tile;
-            }
+        cutter.addLayer(map, cutOsm);
+        cutter.addLayer(mergeMap, cutShp);
+        if (!cutter.cutToTiles(zoomLevel)) {
+            return 4;
         }
     } else if (file.suffix() == "osm" && parser.isSet("cut-to-tiles")) {
         TinyPlanetProcessor processor(map);
 
         processor.process();
 
-        unsigned int N = pow(2, zoomLevel);
-
-        for(unsigned int x = 0; x < N; ++x) {
-            for(unsigned int y = 0; y < N; ++y) {
-                GeoDataDocument* tile = processor.cutToTiles(zoomLevel, x, y);
-
-                GeoWriter writer;
-                writer.setDocumentType("0.6");
-
-                QFile outputFile;
-                if(parser.isSet("output")) {
-                    outputFile.setFileName( QString("%1/%2/%3/%4.osm").arg(outputName).arg(zoomLevel).arg(x).arg(y) );
-                } else {
-                    outputFile.setFileName( QString("%1/%2/%3.osm").arg(zoomLevel).arg(x).arg(y) );
-                }
-
-                QDir dir;
-                if(parser.isSet("output")) {
-                    if(!dir.exists(outputName)) {
-                        dir.mkdir(outputName);
-                    }
-
-                    if(!dir.exists(QString("%1/%2").arg(outputName).arg(zoomLevel))) {
-                        dir.mkdir(QString("%1/%2").arg(outputName).arg(zoomLevel));
-                    }
-
-                    if(!dir.exists(QString("%1/%2/%3").arg(outputName).arg(zoomLevel).arg(x))) {
-                        dir.mkdir(QString("%1/%2/%3").arg(outputName).arg(zoomLevel).arg(x));
-                    }
-                } else {
-                    if(!dir.exists(QString::number(zoomLevel))) {
-                        dir.mkdir(QString::number(zoomLevel));
-                    }
-                    if(!dir.exists(QString("%1/%2").arg(zoomLevel).arg(x))) {
-                        dir.mkdir(QString("%1/%2").arg(zoomLevel).arg(x));
-                    }
-                }
-
-                outputFile.open( QIODevice::WriteOnly );
-                if ( !writer.write( &outputFile, tile ) ) {
-                    qDebug() << "Could not write the file " << outputName;
-                    return 4;
-                }
-
-                qInfo() << tile->name() << " done";
-
-                delete tile;
-            }
+        cutter.addLayer(map, cutOsm);
+        if (!cutter.cutToTiles(zoomLevel)) {
+            return 4;
         }
     } else if(parser.isSet("node-reduce")) {
         qDebug()<<"Entered Node reduce"<<endl;